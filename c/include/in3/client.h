@@ -50,6 +50,7 @@ extern "C" {
 #include "data.h"
 #include "error.h"
 #include "mem.h"
+#include "scache.h"
 #include "stringbuilder.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -199,6 +200,15 @@ struct in3_plugin {
   in3_plugin_t*          next;      /**< pointer to next plugin in list */
 };
 
+/** requests currently sent, which identical requests from other threads may wait for. */
+typedef struct in3_flights in3_flights_t;
+
+/** requests from different threads collected to be sent as one batch. */
+typedef struct in3_batches in3_batches_t;
+
+/** threads verifying independent parts of a response in parallel. */
+typedef struct in3_workers in3_workers_t;
+
 /** Incubed Configuration.
  *
  * This struct holds the configuration and also point to internal resources such as filters or chain configs.
@@ -220,6 +230,13 @@ typedef struct in3_t_ {
   in3_proof_t            proof;                 /**< the type of proof used */
   in3_chain_t            chain;                 /**< chain spec and nodeList definitions*/
   in3_plugin_t*          plugins;               /**< list of registered plugins */
+  in3_lru_cache_t*       response_cache;        /**< cache for verified responses of immutable requests (optional) */
+  in3_flights_t*         flights;               /**< requests currently sent (only if THREADSAFE) */
+  in3_batches_t*         batches;               /**< requests collected for the next batch (only if THREADSAFE) */
+  uint32_t               batch_window;          /**< number of milliseconds requests from different threads are collected to be sent as one batch (0 = no batching) */
+  uint16_t               batch_size;            /**< max number of requests in one batch */
+  in3_workers_t*         workers;               /**< threads used to verify responses (only if THREADSAFE) */
+  uint8_t                verify_threads;        /**< number of threads used to verify responses (0 or 1 = the calling thread only) */
 } in3_t;
 
 /** creates a new Incubed configuration for a specified chain and returns the pointer.
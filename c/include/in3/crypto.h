@@ -127,6 +127,21 @@ int decode_size(
 
 in3_ret_t crypto_sign_digest(in3_curve_type_t type, const bytes_t digest, const uint8_t* pk, const uint8_t* pubkey, uint8_t* signature);
 in3_ret_t crypto_recover(in3_curve_type_t type, const bytes_t digest, bytes_t signature, uint8_t* pubkey);
+
+/**
+ * recovers the public keys of multiple signatures.
+ *
+ * For secp256k1 the signatures share the modular inversions, which is faster than calling crypto_recover for each of them.
+ * returns IN3_OK if all public keys could be recovered, otherwise IN3_EINVAL.
+ */
+in3_ret_t crypto_recover_batch(
+    in3_curve_type_t type,       /**< the curve */
+    unsigned int     len,        /**< number of signatures */
+    const bytes_t*   digests,    /**< the digests which were signed */
+    const bytes_t*   signatures, /**< the signatures */
+    uint8_t*         pubkeys,    /**< len * 64 bytes to write the public keys to */
+    in3_ret_t*       results     /**< if not NULL the result of each signature is written to it */
+);
 in3_ret_t crypto_convert(in3_curve_type_t type, in3_convert_type_t conv_type, bytes_t src, uint8_t* dst, int* dst_len);
 
 void random_buffer(uint8_t* dst, size_t len);
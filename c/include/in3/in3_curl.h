@@ -45,6 +45,12 @@ extern "C" {
 #endif
 
 #include "client.h"
+#include "request.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#endif
 
 /**
  * a transport function using curl.
@@ -57,6 +63,105 @@ in3_ret_t send_curl(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx
  */
 in3_ret_t in3_register_curl(in3_t* c);
 
+/**
+ * sets the max number of keep-alive connections and idle multi-handles held by the connection-pool.
+ *
+ * The pool is shared by all clients of the process and can also be configured with the `connectionPoolSize`-config.
+ * Setting it to 0 disables reusing connections.
+ */
+void in3_curl_set_pool_size(uint32_t pool_size);
+
+/**
+ * closes all pooled connections and frees the connection-pool.
+ *
+ * The pool is freed automatically, when the last client using curl and the last multiplexer are freed or the process exits.
+ * Calling this function is only needed to close idle connections earlier. Transfers still running keep using the old pool,
+ * which is freed as soon as they are done. The next request will create a new pool.
+ */
+void in3_curl_pool_free();
+
+/**
+ * a multiplexer executing many requests concurrently on one multi-handle.
+ *
+ * Instead of blocking in `in3_send_req()` for each request, all requests added are executed together, so
+ * their transfers overlap. It is not threadsafe and must only be used by the thread driving it.
+ *
+ * Since the transfers are sent directly with curl, the multiplexer bypasses the transport-plugins registered with the client,
+ * like a mock-transport or the recorder. It also does not share responses with identical requests of other threads
+ * and does not collect requests into batches (see `batchWindow`), because this is only done by `in3_send_req()`.
+ *
+ * ```c
+ * in3_curl_multi_t* m = in3_curl_multi_new();
+ * for (int i = 0; i < 100; i++)
+ *   in3_curl_multi_add(m, req_new(c, requests[i]));
+ *
+ * for (int pending = 100; pending;) {
+ *   in3_curl_multi_wait(m, 1000);
+ *   for (in3_req_t* req = in3_curl_multi_next(m); req; req = in3_curl_multi_next(m), pending--) {
+ *     // handle the result
+ *     req_free(req);
+ *   }
+ * }
+ * in3_curl_multi_free(m);
+ * ```
+ *
+ * In order to integrate it into an external event-loop, use `in3_curl_multi_fdset()` and `in3_curl_multi_timeout()`
+ * to find out what to wait for and call `in3_curl_multi_perform()` whenever a socket is ready or the timeout expired.
+ */
+typedef struct in3_curl_multi in3_curl_multi_t;
+
+/**
+ * creates a new multiplexer, which takes its multi-handle from the connection-pool.
+ */
+in3_curl_multi_t* in3_curl_multi_new();
+
+/**
+ * adds a request and executes it until it needs to wait for a response.
+ *
+ * The request is still owned by the caller, but must not be freed before it was returned by `in3_curl_multi_next()`.
+ */
+void in3_curl_multi_add(in3_curl_multi_t* m, in3_req_t* req);
+
+/**
+ * handles all sockets ready without blocking and executes all requests which received responses.
+ *
+ * returns the number of requests not finished yet.
+ */
+uint32_t in3_curl_multi_perform(in3_curl_multi_t* m);
+
+/**
+ * waits for at most timeout ms for any activity and performs the requests.
+ *
+ * returns the number of requests not finished yet.
+ */
+uint32_t in3_curl_multi_wait(in3_curl_multi_t* m, uint32_t timeout);
+
+/**
+ * adds the sockets used by the transfers to the fd_sets (see `curl_multi_fdset`).
+ *
+ * max_fd will be -1 if there are currently no sockets, in which case the timeout should be used.
+ */
+in3_ret_t in3_curl_multi_fdset(in3_curl_multi_t* m, fd_set* read_fd_set, fd_set* write_fd_set, fd_set* exc_fd_set, int* max_fd);
+
+/**
+ * returns the time in ms until `in3_curl_multi_perform()` should be called at the latest or -1 if there is no timeout set.
+ */
+long in3_curl_multi_timeout(in3_curl_multi_t* m);
+
+/**
+ * returns the next finished request in the order they finished or NULL if there is none.
+ *
+ * After this the request is no longer handled by the multiplexer and can be freed.
+ */
+in3_req_t* in3_curl_multi_next(in3_curl_multi_t* m);
+
+/**
+ * aborts all pending transfers and frees the multiplexer.
+ *
+ * The requests are not freed, since they are owned by the caller.
+ */
+void in3_curl_multi_free(in3_curl_multi_t* m);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,68 @@
+
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+// @PUBLIC_HEADER
+/** @file
+ * storage plugin keeping all cached entries in one file.
+ *
+ * The file is an append-only log of records, which is memory mapped for reading. Each process keeps a hash index
+ * pointing to the latest record of each key, which is built when opening the file. Updates are appended and
+ * only become visible once the new length is written into the header, so an interrupted write is ignored.
+ * If more than half of the file is taken by outdated records, the latest records are copied into a new file
+ * which then atomically replaces the old one.
+ *
+ * Processes sharing the file use a shared lock for reading and an exclusive lock for writing.
+ * */
+
+#ifndef IN3_KV_STORAGE_H
+#define IN3_KV_STORAGE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "plugin.h"
+
+/**
+ * registers the storage plugin using the given file, which is created if it does not exist.
+ *
+ * The file is opened with the first access to the cache.
+ */
+in3_ret_t in3_register_kv_storage(in3_t* c, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IN3_KV_STORAGE_H
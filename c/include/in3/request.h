@@ -79,9 +79,10 @@ typedef struct weight {
  * if the error has a length>0 the response will be rejected
  */
 typedef struct in3_response {
-  uint32_t  time;  /**< measured time (in ms) which will be used for ajusting the weights */
-  in3_ret_t state; /**< the state of the response */
-  sb_t      data;  /**< a stringbuilder to add the result */
+  uint32_t       time;   /**< measured time (in ms) which will be used for ajusting the weights */
+  in3_ret_t      state;  /**< the state of the response */
+  sb_t           data;   /**< a stringbuilder to add the result */
+  json_stream_t* stream; /**< if set, the transport already parses the data while receiving it. */
 } in3_response_t;
 
 /**
@@ -107,6 +108,7 @@ typedef struct in3_req {
   cache_entry_t*  cache;              /**<optional cache-entries.  These entries will be freed when cleaning up the context.*/
   struct in3_req* required;           /**< pointer to the next required context. if not NULL the data from this context need get finished first, before being able to resume this context. */
   in3_t*          client;             /**< reference to the client*/
+  in3_arena_t     arena;              /**< memory allocated with `req_alloc()`, which is freed together with the context. */
 } in3_req_t;
 
 /**
@@ -133,6 +135,17 @@ NONULL in3_req_t* req_new(
     in3_t*      client,  /**< [in] the client-config. */
     const char* req_data /**< [in] the rpc-request as json string. */
 );
+/**
+ * allocates memory which lives as long as the request context.
+ *
+ * The memory must not be freed, since it will be released at once when the context is freed.
+ * Use this for allocations owned by the context instead of adding them to the cache with `in3_cache_add_ptr()`.
+ */
+NONULL void* req_alloc(
+    in3_req_t* req, /**< [in] the request context. */
+    size_t     size /**< [in] the number of bytes to allocate. */
+);
+
 /**
  * creates a new request but clones the request-data.
  *
@@ -14,6 +14,7 @@ option(LOGGING "if set logging and human readable error messages will be inculde
 option(EVM_GAS "if true the gas costs are verified when validating a eth_call. This is a optimization since most calls are only interessted in the result. EVM_GAS would be required if the contract uses gas-dependend op-codes." true)
 option(IN3_LIB "if true a shared anmd static library with all in3-modules will be build." ON)
 option(TEST "builds the tests and also adds special memory-management, which detects memory leaks, but will cause slower performance" OFF)
+option(EVM_WORDS "if true the evm-stack uses fixed 256-bit words with native 64-bit arithmetic, which makes eth_call verification faster, but requires a compiler supporting __int128." OFF)
 option(FAST_MATH "Math optimizations used in the EVM. This will also increase the filesize." OFF)
 option(SEGGER_RTT "Use the segger real time transfer terminal as the logging mechanism" OFF)
 option(CURL_BLOCKING "if true the curl-request will block until the response is received" OFF)
@@ -47,11 +48,13 @@ OPTION(PK_SIGNER "Enable Signing with private keys" ON)
 OPTION(NODESELECT_DEF "Enable default nodeselect implementation" ON)
 OPTION(NODESELECT_DEF_WL "Enable default nodeselect whitelist implementation" ON)
 OPTION(PLGN_CLIENT_DATA "Enable client-data plugin" OFF)
+OPTION(KV_STORAGE "Enable the storage plugin keeping the cache in one memory mapped file" ON)
 OPTION(THREADSAFE "uses mutex to protect shared nodelist access" ON)
 OPTION(SWIFT "swift API for swift bindings" OFF)
 OPTION(CORE_API "include basic core-utils" ON)
 OPTION(CRYPTO_TREZOR "include crypto-lib from trezor" ON)
 OPTION(CRYPTO_OPENSSL "include crypto-lib from openssl" OFF)
+OPTION(SECP256K1_FAST "use the optimized secp256k1 implementation (64bit limbs, GLV, precomputed tables) to recover signatures. Requires CRYPTO_TREZOR and a compiler supporting 128bit integers" ON)
 OPTION(BASE64 "include base64-encode" ON)
 OPTION(ED25519 "include ED25519 curve" ON)
 OPTION(RPC_ONLY "specifies a coma-seperqted list of rpc-methods which should be supported. all other rpc-methods will be removed reducing the size of executable a lot." OFF)
@@ -89,6 +92,10 @@ IF (CRYPTO_TREZOR)
   ADD_DEFINITIONS(-DCRYPTO_TREZOR)
 ENDIF (CRYPTO_TREZOR)
 
+IF (CRYPTO_TREZOR AND SECP256K1_FAST)
+  ADD_DEFINITIONS(-DSECP256K1_FAST)
+ENDIF (CRYPTO_TREZOR AND SECP256K1_FAST)
+
 IF (POA)
   ADD_DEFINITIONS(-DPOA)
 ENDIF (POA)
@@ -199,6 +206,10 @@ if(EVM_GAS)
     ADD_DEFINITIONS(-DEVM_GAS)
 endif(EVM_GAS)
 
+if(EVM_WORDS)
+    ADD_DEFINITIONS(-DEVM_WORDS)
+endif(EVM_WORDS)
+
 if(FAST_MATH)
     ADD_DEFINITIONS(-DIN3_MATH_FAST)
 else()
@@ -218,6 +229,15 @@ if (SENTRY)
   set(IN3_API ${IN3_API} in3_sentry)
 endif()
 
+if (WIN32 OR ESP_IDF OR WASM)
+  set(KV_STORAGE false)
+endif()
+
+if (KV_STORAGE)
+  ADD_DEFINITIONS(-DKV_STORAGE)
+  set(IN3_API ${IN3_API} kv_storage)
+endif()
+
 if (BASE64)
   ADD_DEFINITIONS(-DBASE64)
   set(IN3_API ${IN3_API} b64)
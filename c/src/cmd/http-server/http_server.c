@@ -37,25 +37,43 @@
 #include "../../core/client/request.h"
 #include "../../core/util/colors.h"
 #include "../../core/util/mem.h"
+#include "../../core/util/stringbuilder.h"
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#define MAX_HEADER_SIZE  (64 * 1024)        /**< max size of the request-line and all headers */
+#define MAX_REQUEST_SIZE (10 * 1024 * 1024) /**< max size of a request including the body */
+#define MAX_WRITE_BUFFER (1024 * 1024)      /**< we stop reading from a connection as long as more bytes wait to be sent */
+#define MAX_EVENTS       64
+#define READ_CHUNK       16384
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 void term(int signum) {
   printf("Finishing..!(caught signal  %i)\n", signum);
   exit(EXIT_SUCCESS);
 }
 
-static int listenfd;
-void*      respond(void* arg);
 typedef struct m {
   char*     method;
   struct m* next;
@@ -80,188 +98,553 @@ static bool is_allowed(char* method) {
   }
   return false;
 }
-typedef struct {
-  int    con;
-  int    s;
-  in3_t* in3;
-} req_t;
+
+/** a client connection */
+typedef struct con {
+  int      fd;         /**< the socket */
+  sb_t     in;         /**< received bytes, which are not handled yet */
+  sb_t     out;        /**< response-bytes waiting to be sent */
+  size_t   out_pos;    /**< number of bytes of out already sent */
+  uint32_t events;     /**< the events currently registered for the socket */
+  bool     busy;       /**< true while a request of this connection is executed */
+  bool     close;      /**< close the connection after all responses are sent */
+  struct con* next;    /**< next connection in the list of closed connections */
+} con_t;
+
+/** a http-request to be executed by a worker */
+typedef struct job {
+  con_t*        con;        /**< the connection */
+  char*         body;       /**< the body of the request */
+  bool          keep_alive; /**< true if the connection should be kept open after the response */
+  sb_t          response;   /**< the complete http-response */
+  struct job*   next;       /**< next job in the queue */
+  in3_t*        in3;        /**< the client to use */
+} job_t;
+
+// ---------------- event-loop -----------------
+
+#define EV_READ  1
+#define EV_WRITE 2
+
+#ifdef __linux__
+static int ev_fd = -1;
+
+static void ev_init() {
+  ev_fd = epoll_create1(0);
+  if (ev_fd < 0) {
+    perror("epoll_create() error");
+    exit(1);
+  }
+}
+
+static void ev_set(int fd, void* ptr, uint32_t old_events, uint32_t events) {
+  struct epoll_event e = {.events = ((events & EV_READ) ? EPOLLIN : 0) | ((events & EV_WRITE) ? EPOLLOUT : 0), .data.ptr = ptr};
+  epoll_ctl(ev_fd, old_events == (uint32_t) -1 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &e);
+}
+
+static void ev_del(int fd) {
+  epoll_ctl(ev_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static int ev_wait(void** ptrs, uint32_t* events, int max) {
+  struct epoll_event e[MAX_EVENTS];
+  int                n = epoll_wait(ev_fd, e, max > MAX_EVENTS ? MAX_EVENTS : max, -1);
+  for (int i = 0; i < n; i++) {
+    ptrs[i]   = e[i].data.ptr;
+    events[i] = ((e[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ? EV_READ : 0) | ((e[i].events & EPOLLOUT) ? EV_WRITE : 0);
+  }
+  return n;
+}
+#else
+// fallback for systems without epoll
+static struct pollfd* ev_fds  = NULL;
+static void**         ev_ptrs = NULL;
+static int            ev_len = 0, ev_size = 0;
+
+static void ev_init() {}
+
+static void ev_set(int fd, void* ptr, uint32_t old_events, uint32_t events) {
+  int i = 0;
+  for (; old_events != (uint32_t) -1 && i < ev_len && ev_fds[i].fd != fd; i++) {}
+  if (old_events == (uint32_t) -1 || i == ev_len) {
+    if (ev_len == ev_size) {
+      ev_fds  = ev_size ? _realloc(ev_fds, sizeof(struct pollfd) * ev_size * 2, sizeof(struct pollfd) * ev_size) : _malloc(sizeof(struct pollfd) * 16);
+      ev_ptrs = ev_size ? _realloc(ev_ptrs, sizeof(void*) * ev_size * 2, sizeof(void*) * ev_size) : _malloc(sizeof(void*) * 16);
+      ev_size = ev_size ? ev_size * 2 : 16;
+    }
+    i = ev_len++;
+  }
+  ev_fds[i]  = (struct pollfd){.fd = fd, .events = ((events & EV_READ) ? POLLIN : 0) | ((events & EV_WRITE) ? POLLOUT : 0), .revents = 0};
+  ev_ptrs[i] = ptr;
+}
+
+static void ev_del(int fd) {
+  for (int i = 0; i < ev_len; i++) {
+    if (ev_fds[i].fd == fd) {
+      ev_fds[i]  = ev_fds[--ev_len];
+      ev_ptrs[i] = ev_ptrs[ev_len];
+      return;
+    }
+  }
+}
+
+static int ev_wait(void** ptrs, uint32_t* events, int max) {
+  if (poll(ev_fds, ev_len, -1) < 0) return -1;
+  int n = 0;
+  for (int i = 0; i < ev_len && n < max; i++) {
+    if (!ev_fds[i].revents) continue;
+    ptrs[n]     = ev_ptrs[i];
+    events[n++] = ((ev_fds[i].revents & (POLLIN | POLLHUP | POLLERR)) ? EV_READ : 0) | ((ev_fds[i].revents & POLLOUT) ? EV_WRITE : 0);
+  }
+  return n;
+}
+#endif
+
+// ---------------- worker-pool -----------------
+
+static void execute_job(job_t* job);
 
 #ifdef THREADSAFE
 #include <pthread.h>
 
 #define POOL_SIZE 10
 
-pthread_t       thread_pool[POOL_SIZE];
-pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t  queue_cond  = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queue_cond  = PTHREAD_COND_INITIALIZER;
+static job_t *         q_head = NULL, *q_tail = NULL;     // jobs waiting to be executed
+static job_t*          done_head                = NULL; // jobs executed, but not handled by the event-loop yet
+static int             wakeup[2]                = {-1, -1}; // pipe used by the workers to wake up the event-loop
 
-typedef struct queue {
-  struct queue* next;
-  req_t*        r;
-} queue_t;
-
-queue_t *q_head = NULL, *q_tail = NULL;
-
-static void queue_add(req_t* r) {
+static void queue_add(job_t* job) {
   pthread_mutex_lock(&queue_mutex);
-  queue_t* q = _malloc(sizeof(queue_t));
-  q->next    = NULL;
-  q->r       = r;
+  job->next = NULL;
   if (q_tail)
-    q_tail->next = q;
+    q_tail->next = job;
   else
-    q_head = q_tail = q;
+    q_head = job;
+  q_tail = job;
   pthread_cond_signal(&queue_cond);
   pthread_mutex_unlock(&queue_mutex);
 }
 
-static req_t* queue_next() {
+static job_t* queue_next() {
   pthread_mutex_lock(&queue_mutex);
-  if (!q_head) pthread_cond_wait(&queue_cond, &queue_mutex);
-
-  req_t* r = NULL;
-  if (q_head) {
-    queue_t* q = q_head;
-    q_head     = q_head->next;
-    r          = q->r;
-    _free(q);
-    if (!q_head) q_tail = NULL;
-  }
+  while (!q_head) pthread_cond_wait(&queue_cond, &queue_mutex);
+  job_t* job = q_head;
+  q_head     = job->next;
+  if (!q_head) q_tail = NULL;
   pthread_mutex_unlock(&queue_mutex);
-  return r;
+  return job;
 }
+
+static void queue_done(job_t* job) {
+  pthread_mutex_lock(&queue_mutex);
+  job->next = done_head;
+  done_head = job;
+  pthread_mutex_unlock(&queue_mutex);
+  char c = 1;
+  if (write(wakeup[1], &c, 1) < 0 && errno != EAGAIN) perror("write() error");
+}
+
+/** returns all finished jobs in the order they were finished */
+static job_t* queue_take_done() {
+  pthread_mutex_lock(&queue_mutex);
+  job_t* list = done_head;
+  done_head   = NULL;
+  pthread_mutex_unlock(&queue_mutex);
+  job_t* ordered = NULL;
+  while (list) {
+    job_t* next = list->next;
+    list->next  = ordered;
+    ordered     = list;
+    list        = next;
+  }
+  return ordered;
+}
+
 static void* thread_run(void* p) {
   UNUSED_VAR(p);
   while (true) {
-    req_t* r = queue_next();
-    if (r) respond(r);
+    job_t* job = queue_next();
+    execute_job(job);
+    queue_done(job);
   }
   return NULL;
 }
-
-#else
-#define MAX_CON 100
-static int clients[MAX_CON];
 #endif
 
-static void error_response(char* message, int error_code) {
-  char* payload = alloca(strlen(message) + 100);
-  sprintf(payload, "{\"id\":1,\"jsonrpc\":\"2.0\",\"error\":{\"message\":\"%s\",\"code\":%i}}", message, error_code);
-  printf("HTTP/1.1 200\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %lu\r\n\r\n%s\r\n", strlen(payload), payload);
-}
-
-// client connection
-void* respond(void* arg) {
-  req_t* r    = arg;
-  char*  buf  = malloc(65535);
-  int    rcvd = recv(r->con, buf, 65535, 0);
-
-  if (rcvd < 0) // receive error
-    fprintf(stderr, ("recv() error\n"));
-  else if (rcvd == 0) // receive socket closedMAX_CON
-    fprintf(stderr, "Client disconnected upexpectedly.\n");
-  else // message received
-  {
-    buf[rcvd] = '\0';
-
-    char* method = strtok(buf, " \t\r\n");
-    char* uri    = method ? strtok(NULL, " \t") : NULL;
-    char* prot   = uri ? strtok(NULL, " \t\r\n") : NULL;
-    char* rest   = prot ? strstr(prot + strlen(prot) + 1, "\n\r\n") : NULL;
-
-    dup2(r->con, STDOUT_FILENO);
-    //    close(r->con);
-    if (rest) {
-      rest += 3;
-      if (strlen(rest) > 2 && (rest[0] == '{' || rest[0] == '[')) {
-        // execute in3
-        in3_req_t* req = req_new(r->in3, rest);
-        if (req == NULL)
-          error_response("Request can not be parsed", -32700);
-        else if (req->error)
-          error_response(req->error, -32603);
-        else if (!is_allowed(d_get_string(req->requests[0], K_METHOD)))
-          error_response("Method not allowed", -32601);
-        else {
-          // execute it
-          str_range_t range  = d_to_json(d_get(req->requests[0], key("params")));
-          char*       params = range.data ? alloca(range.len) : NULL;
-          if (params) {
-            memcpy(params, range.data + 1, range.len - 2);
-            params[range.len - 2] = 0;
-          }
-          fprintf(stderr, "RPC %s %s\n", d_get_string(req->requests[0], K_METHOD), params); // conceal typing and save position
-          if (in3_send_req(req) == IN3_OK) {
-            // the request was succesfull, so we delete interim errors (which can happen in case in3 had to retry)
-            if (req->error) _free(req->error);
-            req->error            = NULL;
-            str_range_t range     = d_to_json(req->responses[0]);
-            range.data[range.len] = 0;
-
-            // remove in3
-            char* end = strstr(range.data, ",\"in3\":");
-            if (end) {
-              *end   = '}';
-              end[1] = 0;
-            }
-            range.len = strlen(range.data);
-            printf("HTTP/1.1 200\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %i\r\n\r\n%s\r\n", (int) range.len, range.data);
-          }
-          else if (req->error)
-            error_response(req->error, req->verification_state);
-          else
-            error_response("Could not execute the request", req->verification_state);
-        }
-        if (req)
-          req_free(req);
+// ---------------- http -----------------
+
+static void add_response(sb_t* sb, const char* payload, size_t len, bool keep_alive) {
+  sb_print(sb, "HTTP/1.1 200 OK\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n", (unsigned int) len, keep_alive ? "keep-alive" : "close");
+  sb_add_range(sb, payload, 0, len);
+}
+
+static void error_response(sb_t* sb, char* message, int error_code, bool keep_alive) {
+  sb_t payload = {0};
+  sb_add_chars(&payload, "{\"id\":1,\"jsonrpc\":\"2.0\",\"error\":{\"message\":\"");
+  sb_add_escaped_chars(&payload, message, -1);
+  sb_print(&payload, "\",\"code\":%i}}", error_code);
+  add_response(sb, payload.data, payload.len, keep_alive);
+  _free(payload.data);
+}
+
+static void status_response(sb_t* sb, const char* status) {
+  sb_print(sb, "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+}
+
+static void execute_job(job_t* job) {
+  sb_t* sb         = &job->response;
+  bool  keep_alive = job->keep_alive;
+  char* body       = job->body;
+  if (!body || (body[0] != '{' && body[0] != '[') || strlen(body) <= 2) {
+    error_response(sb, "The server has no handler to the request", -32603, keep_alive);
+    return;
+  }
+
+  // execute in3
+  in3_req_t* req = req_new(job->in3, body);
+  if (req == NULL)
+    error_response(sb, "Request can not be parsed", -32700, keep_alive);
+  else if (req->error)
+    error_response(sb, req->error, -32603, keep_alive);
+  else if (!is_allowed(d_get_string(req->requests[0], K_METHOD)))
+    error_response(sb, "Method not allowed", -32601, keep_alive);
+  else {
+    // execute it
+    str_range_t range  = d_to_json(d_get(req->requests[0], key("params")));
+    char*       params = range.data ? alloca(range.len) : NULL;
+    if (params) {
+      memcpy(params, range.data + 1, range.len - 2);
+      params[range.len - 2] = 0;
+    }
+    fprintf(stderr, "RPC %s %s\n", d_get_string(req->requests[0], K_METHOD), params); // conceal typing and save position
+    if (in3_send_req(req) == IN3_OK) {
+      // the request was succesfull, so we delete interim errors (which can happen in case in3 had to retry)
+      if (req->error) _free(req->error);
+      req->error            = NULL;
+      str_range_t range     = d_to_json(req->responses[0]);
+      range.data[range.len] = 0;
+
+      // remove in3
+      char* end = strstr(range.data, ",\"in3\":");
+      if (end) {
+        *end   = '}';
+        end[1] = 0;
       }
-      else
-        rest = NULL;
+      add_response(sb, range.data, strlen(range.data), keep_alive);
     }
+    else if (req->error)
+      error_response(sb, req->error, req->verification_state, keep_alive);
+    else
+      error_response(sb, "Could not execute the request", req->verification_state, keep_alive);
+  }
+  if (req)
+    req_free(req);
+}
 
-    if (!rest)
-      error_response("The server has no handler to the request", -32603);
+/** finds the value of a header (case insensitive) within the header-block */
+static char* find_header(char* headers, const char* name, size_t* len) {
+  size_t l = strlen(name);
+  for (char* line = strstr(headers, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+    char* start = line + 2;
+    if (strncasecmp(start, name, l) || start[l] != ':') continue;
+    char* val = start + l + 1;
+    while (*val == ' ' || *val == '\t') val++;
+    char* end = strstr(val, "\r\n");
+    *len      = end ? (size_t) (end - val) : strlen(val);
+    return val;
+  }
+  return NULL;
+}
 
-    // tidy up
-    fflush(stdout);
-    shutdown(STDOUT_FILENO, SHUT_WR);
-    close(STDOUT_FILENO);
+static bool header_contains(char* val, size_t len, const char* token) {
+  size_t l = strlen(token);
+  for (size_t i = 0; val && i + l <= len; i++) {
+    if (strncasecmp(val + i, token, l) == 0) return true;
   }
+  return false;
+}
 
-  // Closing SOCKET
-  shutdown(r->con, SHUT_RDWR); // All further send and recieve operations are DISABLED...
-  close(r->con);
+/**
+ * decodes a chunked body.
+ * returns the number of bytes consumed, 0 if incomplete or -1 if invalid.
+ */
+static int decode_chunked(char* data, size_t len, sb_t* body) {
+  size_t pos = 0;
+  while (true) {
+    char* eol = pos < len ? strstr(data + pos, "\r\n") : NULL;
+    if (!eol) return 0;
+    char*         end  = NULL;
+    unsigned long size = strtoul(data + pos, &end, 16);
+    if (end == data + pos || size > MAX_REQUEST_SIZE) return -1;
+    pos = eol - data + 2;
+    if (size == 0) {
+      // skip the trailer
+      while (true) {
+        eol = strstr(data + pos, "\r\n");
+        if (!eol) return 0;
+        if (eol == data + pos) return pos + 2;
+        pos = eol - data + 2;
+      }
+    }
+    if (pos + size + 2 > len) return 0;
+    if (data[pos + size] != '\r' || data[pos + size + 1] != '\n') return -1;
+    sb_add_range(body, data, pos, size);
+    pos += size + 2;
+  }
+}
+
+/**
+ * tries to parse the next request of the connection.
+ * returns 1 if a request was found and the job was created, 0 if more data is needed or -1 if the request is invalid.
+ */
+static int parse_request(con_t* con, in3_t* in3, job_t** dst) {
+  if (!con->in.len) return 0;
+  char* data   = con->in.data;
+  char* header = strstr(data, "\r\n\r\n");
+  if (!header) return con->in.len > MAX_HEADER_SIZE || strlen(data) < con->in.len ? -1 : 0;
+  size_t header_len = header - data + 4;
+
+  // request-line
+  char* eol = strstr(data, "\r\n");
+  char* sp1 = memchr(data, ' ', eol - data);
+  char* sp2 = sp1 ? memchr(sp1 + 1, ' ', eol - sp1 - 1) : NULL;
+  if (!sp2) return -1;
+  bool http10 = strncmp(sp2 + 1, "HTTP/1.0", 8) == 0;
+
+  // headers
+  char   tmp        = header[2];
+  size_t len        = 0;
+  header[2]         = 0; // terminate the header-block, so we don't search within the body
+  char*  connection = find_header(data, "Connection", &len);
+  bool   keep_alive = connection ? (http10 ? header_contains(connection, len, "keep-alive") : !header_contains(connection, len, "close")) : !http10;
+  char*  te         = find_header(data, "Transfer-Encoding", &len);
+  bool   chunked    = te && header_contains(te, len, "chunked");
+  char*  cl         = find_header(data, "Content-Length", &len);
+  long   body_len   = cl ? strtol(cl, NULL, 10) : 0;
+  header[2]         = tmp;
+  // the whole request must fit into the input-buffer, since we stop reading once it is full
+  if (body_len < 0 || header_len + (size_t) body_len > MAX_REQUEST_SIZE) return -1;
+
+  // body
+  sb_t   body     = {0};
+  size_t consumed = header_len;
+  if (chunked) {
+    int r = decode_chunked(data + header_len, con->in.len - header_len, &body);
+    if (r <= 0) {
+      _free(body.data);
+      return r ? r : (con->in.len >= MAX_REQUEST_SIZE ? -1 : 0);
+    }
+    consumed += r;
+  }
+  else {
+    if (con->in.len < header_len + body_len) return 0;
+    sb_add_range(&body, data, header_len, body_len);
+    consumed += body_len;
+  }
+
+  // remove the request from the input-buffer
+  memmove(con->in.data, con->in.data + consumed, con->in.len - consumed + 1);
+  con->in.len -= consumed;
+
+  job_t* job      = _calloc(1, sizeof(job_t));
+  job->con        = con;
+  job->body       = body.data;
+  job->in3        = in3;
+  job->keep_alive = keep_alive;
+  *dst            = job;
+  return 1;
+}
+
+// ---------------- connections -----------------
+
+static void update_events(con_t* con) {
+  uint32_t events = 0;
+  if (con->out.len > con->out_pos) events |= EV_WRITE;
+  // backpressure: we only read as long as we can buffer it
+  if (!con->close && con->in.len < MAX_REQUEST_SIZE && con->out.len - con->out_pos < MAX_WRITE_BUFFER) events |= EV_READ;
+  if (events != con->events) ev_set(con->fd, con, con->events, events);
+  con->events = events;
+}
+
+static con_t* closed_cons = NULL; // closed connections to be freed after handling the current events
+
+static void con_free(con_t* con) {
+  con->next   = closed_cons;
+  closed_cons = con;
+}
+
+static void free_closed_cons() {
+  for (con_t* con = closed_cons; con; con = closed_cons) {
+    closed_cons = con->next;
+    _free(con->in.data);
+    _free(con->out.data);
+    _free(con);
+  }
+}
+
+static void con_close(con_t* con) {
+  ev_del(con->fd);
+  shutdown(con->fd, SHUT_RDWR);
+  close(con->fd);
+  con->fd = -1;
+  // if a worker is still executing a request for this connection, it will be freed when the job is done
+  if (!con->busy) con_free(con);
+}
+
+/** sends as much as possible. returns false if the connection was closed */
+static bool con_write(con_t* con) {
+  while (con->out.len > con->out_pos) {
+    ssize_t n = send(con->fd, con->out.data + con->out_pos, con->out.len - con->out_pos, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      if (errno == EINTR) continue;
+      con_close(con);
+      return false;
+    }
+    con->out_pos += n;
+  }
+  if (con->out_pos == con->out.len) {
+    con->out.len = con->out_pos = 0;
+    if (con->close && !con->busy) {
+      con_close(con);
+      return false;
+    }
+  }
+  update_events(con);
+  return true;
+}
+
+/** starts the next request of the connection, if there is one and no other request is running */
+static void con_next(con_t* con, in3_t* in3) {
+  while (!con->busy && !con->close) {
+    job_t* job = NULL;
+    int    r   = parse_request(con, in3, &job);
+    if (r == 0) break;
+    if (r < 0) {
+      status_response(&con->out, "400 Bad Request");
+      con->close = true;
+      break;
+    }
+    con->busy = true;
 #ifdef THREADSAFE
-  _free(r);
+    queue_add(job);
+#else
+    execute_job(job);
+    con->busy = false;
+    sb_add_range(&con->out, job->response.data, 0, job->response.len);
+    if (!job->keep_alive) con->close = true;
+    _free(job->response.data);
+    _free(job->body);
+    _free(job);
 #endif
-  return NULL;
+  }
+  con_write(con);
+}
+
+static void con_read(con_t* con, in3_t* in3) {
+  char buf[READ_CHUNK];
+  while (true) {
+    ssize_t n = recv(con->fd, buf, READ_CHUNK, 0);
+    if (n > 0) {
+      sb_add_range(&con->in, buf, 0, n);
+      if (con->in.len >= MAX_REQUEST_SIZE) break;
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n < 0 && errno == EINTR) continue;
+    // closed by the client or error
+    con_close(con);
+    return;
+  }
+  con_next(con, in3);
 }
 
-void http_run_server(const char* port, in3_t* in3, char* allowed_methods) {
+#ifdef THREADSAFE
+static void handle_done(in3_t* in3) {
+  char buf[256];
+  while (read(wakeup[0], buf, sizeof(buf)) > 0) {}
+  for (job_t* job = queue_take_done(); job;) {
+    con_t* con = job->con;
+    con->busy  = false;
+    if (con->fd < 0)
+      con_free(con);
+    else {
+      sb_add_range(&con->out, job->response.data, 0, job->response.len);
+      if (!job->keep_alive) con->close = true;
+      con_next(con, in3);
+    }
+    job_t* next = job->next;
+    _free(job->response.data);
+    _free(job->body);
+    _free(job);
+    job = next;
+  }
+}
+#endif
+
+static void set_nonblocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void accept_connections(int listenfd) {
+  while (true) {
+    struct sockaddr_in clientaddr;
+    socklen_t          addrlen = sizeof(clientaddr);
+    int                fd      = accept(listenfd, (struct sockaddr*) &clientaddr, &addrlen);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept() error");
+      return;
+    }
+    int option = 1;
+    set_nonblocking(fd);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+    con_t* con  = _calloc(1, sizeof(con_t));
+    con->fd     = fd;
+    con->events = EV_READ;
+    ev_set(fd, con, (uint32_t) -1, EV_READ);
+  }
+}
+
+void http_run_server(const char* port, in3_t* in3, char* allowed_methods, uint32_t threads) {
   struct sigaction action;
   memset(&action, 0, sizeof(action));
   action.sa_handler = term;
   sigaction(SIGTERM, &action, NULL);
   sigaction(SIGKILL, &action, NULL);
   sigaction(SIGINT, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
 
   set_allowed_methods(allowed_methods);
-  struct sockaddr_in clientaddr;
-  socklen_t          addrlen;
 
   printf(
       "Server started %shttp://127.0.0.1:%s%s [%s]\n",
       COLORT_LIGHTGREEN, port, COLORT_RESET, allowed_methods ? allowed_methods : "all methods");
 
+  ev_init();
+
 #ifdef THREADSAFE
-  for (int i = 0; i < POOL_SIZE; i++) pthread_create(&thread_pool[i], NULL, thread_run, NULL);
+  if (!threads) threads = POOL_SIZE;
+  if (pipe(wakeup)) {
+    perror("pipe() error");
+    exit(1);
+  }
+  set_nonblocking(wakeup[0]);
+  set_nonblocking(wakeup[1]);
+  ev_set(wakeup[0], &wakeup, (uint32_t) -1, EV_READ);
+  for (uint32_t i = 0; i < threads; i++) {
+    pthread_t t;
+    pthread_create(&t, NULL, thread_run, NULL);
+    pthread_detach(t);
+  }
 #else
-  int s = 0;
-  for (int i = 0; i < MAX_CON; i++) clients[i] = -1;
+  UNUSED_VAR(threads);
 #endif
 
   // start the serevr
   struct addrinfo hints, *res, *p;
+  int             listenfd = -1;
 
   // getaddrinfo for host
   memset(&hints, 0, sizeof(hints));
@@ -276,9 +659,10 @@ void http_run_server(const char* port, in3_t* in3, char* allowed_methods) {
   for (p = res; p != NULL; p = p->ai_next) {
     int option = 1;
     listenfd   = socket(p->ai_family, p->ai_socktype, 0);
-    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
     if (listenfd == -1) continue;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
     if (bind(listenfd, p->ai_addr, p->ai_addrlen) == 0) break;
+    close(listenfd);
   }
   if (p == NULL) {
     perror("socket() or bind()");
@@ -287,44 +671,41 @@ void http_run_server(const char* port, in3_t* in3, char* allowed_methods) {
   freeaddrinfo(res);
 
   // listen for incoming connections
-  if (listen(listenfd, 1000000) != 0) {
+  if (listen(listenfd, SOMAXCONN) != 0) {
     perror("listen() error");
     exit(1);
   }
-  // Ignore SIGCHLD to avoid zombie threads
-  signal(SIGCHLD, SIG_IGN);
+  set_nonblocking(listenfd);
+  ev_set(listenfd, &listenfd, (uint32_t) -1, EV_READ);
 
-  // ACCEPT connections
+  // the event-loop
+  void*    ptrs[MAX_EVENTS];
+  uint32_t events[MAX_EVENTS];
   while (1) {
-    addrlen = sizeof(clientaddr);
-
-#ifdef THREADSAFE
-    int con = accept(listenfd, (struct sockaddr*) &clientaddr, &addrlen);
-    if (con < 0)
-      perror("accept() error");
-    else {
-      req_t* r = _malloc(sizeof(req_t));
-      r->con   = con;
-      r->s     = 0;
-      r->in3   = in3;
-      queue_add(r);
+    int n = ev_wait(ptrs, events, MAX_EVENTS);
+    if (n < 0) {
+      if (errno != EINTR) perror("wait() error");
+      continue;
     }
-
-#else
-    clients[s]                                 = accept(listenfd, (struct sockaddr*) &clientaddr, &addrlen);
-
-    if (clients[s] < 0) {
-      perror("accept() error");
+#ifdef THREADSAFE
+    // handle finished requests first, since they may free connections.
+    for (int i = 0; i < n; i++) {
+      if (ptrs[i] == &wakeup) handle_done(in3);
     }
-    else {
-      req_t r = {.con = clients[s], .s = s, .in3 = in3};
-      if (fork() == 0) {
-        respond(&r);
-        clients[s] = -1;
-        exit(0);
+#endif
+    for (int i = 0; i < n; i++) {
+      if (ptrs[i] == &listenfd)
+        accept_connections(listenfd);
+#ifdef THREADSAFE
+      else if (ptrs[i] == &wakeup)
+        continue;
+#endif
+      else {
+        con_t* con = ptrs[i];
+        if (con->fd < 0 || ((events[i] & EV_WRITE) && !con_write(con))) continue;
+        if (events[i] & EV_READ) con_read(con, in3);
       }
     }
-    while (clients[s] != -1) s = (s + 1) % MAX_CON;
-#endif
+    free_closed_cons();
   }
 }
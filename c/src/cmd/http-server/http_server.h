@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include <string.h>
 
-void http_run_server(const char* port, in3_t* in3, char* allowed_methods);
+/**
+ * runs a http-server listening on the given port and executes all json-rpc-requests with the client.
+ * If build with THREADSAFE, the requests are executed by a pool of worker-threads ( 0 for the default size of 10 ).
+ */
+void http_run_server(const char* port, in3_t* in3, char* allowed_methods, uint32_t threads);
 
 #endif
@@ -2,7 +2,7 @@
 
 #include <stdlib.h>
 
-const char* bool_props[] = {"includeCode", "debug", "keepIn3", "stats", "useBinary", "experimental", "autoUpdateList", "bootWeights", "useHttp", "nodes.needsUpdate", "clearCache", "eth", "wait", "json", "hex", "debug", "quiet", "human", "test-request", "test-health-request", "response.in", "response.out", "onlysign", "noproof", "nostats", "version", "help", NULL};
+const char* bool_props[] = {"includeCode", "debug", "keepIn3", "stats", "useBinary", "experimental", "autoUpdateList", "bootWeights", "useHttp", "nodes.needsUpdate", "clearCache", "eth", "ordered", "wait", "json", "hex", "debug", "quiet", "human", "test-request", "test-health-request", "response.in", "response.out", "onlysign", "noproof", "nostats", "version", "help", NULL};
 
 const char* help_args = "\
 --chainId                     -c     the chainId or the name of a known chain\n\
@@ -64,6 +64,8 @@ const char* help_args = "\
 --eth                         -e     converts the result (as wei) to ether\n\
 --port                        -port  if specified it will run as http-server listening to the given port\n\
 --allowed-methods             -am    only works if port is specified and declares a comma-seperated list of rpc-methods which are allowed\n\
+--threads                     -wt    defines the number of worker-threads executing the requests of the http-server or, when reading requ...\n\
+--ordered                     -ord   writes the responses of requests read from stdin in the order of the requests, even if they are exec...\n\
 --block                       -b     the blocknumber to use when making calls\n\
 --to                          -to    the target address of the call\n\
 --from                        -from  the sender of a call or tx (only needed if no signer is registered)\n\
@@ -163,6 +165,8 @@ const char* aliases[] = {
     "e", "eth=true",
     "port", "port",
     "am", "allowed-methods",
+    "wt", "threads",
+    "ord", "ordered=true",
     "b", "block",
     "to", "to",
     "from", "from",
@@ -2,6 +2,9 @@
 #include "../../nodeselect/full/nodeselect_def.h"
 #include "../../signer/multisig/multisig.h"
 #include "../../signer/pk-signer/signer.h"
+#ifdef KV_STORAGE
+#include "../../tools/storage/kv_storage.h"
+#endif
 
 #include "handlers.h"
 #include "helper.h"
@@ -123,6 +126,10 @@ static bool set_uint32(uint32_t* dst, char* value) {
   *dst = (uint32_t) atoi(value);
   return true;
 }
+static bool set_bool(bool* dst, char* value) {
+  *dst = strcmp(value, "true") == 0;
+  return true;
+}
 static bool set_create2(char* value, sb_t* sb) {
   if (strlen(value) != 176) die("create2-arguments must have the form -zc2 <creator>:<codehash>:<saltarg>");
   char tmp[177], t2[500];
@@ -218,6 +225,8 @@ bool handle_option(in3_t* c, char* key, char* value, sb_t* conf, int argc, char*
   CHECK_OPTION("quiet", set_quiet())
   CHECK_OPTION("port", set_string(&get_req_exec()->port, value))
   CHECK_OPTION("allowed-methods", set_string(&get_req_exec()->allowed_methods, value))
+  CHECK_OPTION("threads", set_uint32(&get_req_exec()->threads, value))
+  CHECK_OPTION("ordered", set_bool(&get_req_exec()->ordered, value))
   CHECK_OPTION("onlysign", set_onlyshow_rawtx())
   CHECK_OPTION("sigtype", set_string(&get_txdata()->signtype, value))
   CHECK_OPTION("debug", set_debug())
@@ -243,8 +252,15 @@ void init_env(in3_t* c, int argc, char* argv[]) {
   // handle clear cache opt before initializing cache
   if (get_argument(argc, argv, "-ccache", "--clearCache", false))
     storage_clear(NULL);
+#ifdef KV_STORAGE
+  // use a single file in .in3 to cache data
+  char* db = alloca(strlen(get_storage_dir()) + 10);
+  sprintf(db, "%scache.db", get_storage_dir());
+  in3_register_kv_storage(c, db);
+#else
   // use the storagehandler to cache data in .in3
   in3_register_file_storage(c);
+#endif
 
   // PK
   if (getenv("IN3_PK") && !get_argument(argc, argv, "-pk", "--pk", true)) {
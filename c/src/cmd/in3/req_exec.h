@@ -1,8 +1,10 @@
 #include "helper.h"
 
 typedef struct req_exec {
-  char* port;
-  char* allowed_methods;
+  char*    port;
+  char*    allowed_methods;
+  uint32_t threads;
+  bool     ordered;
 } req_exec_t;
 
 req_exec_t* get_req_exec();
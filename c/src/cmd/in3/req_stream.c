@@ -0,0 +1,224 @@
+#include "req_stream.h"
+#include "../../core/client/keys.h"
+#include "../../core/client/request.h"
+#include "../../core/util/data.h"
+#include "../../core/util/mem.h"
+#include <inttypes.h>
+
+bool json_splitter_add(json_splitter_t* s, char c) {
+  if (!s->level) {
+    if (c != '{' && c != '[') return false; // skip everything between requests
+    s->sb.len = 0;
+  }
+  sb_add_char(&s->sb, c);
+  if (s->in_string) {
+    if (s->escaped)
+      s->escaped = false;
+    else if (c == '\\')
+      s->escaped = true;
+    else if (c == '"')
+      s->in_string = false;
+  }
+  else if (c == '"')
+    s->in_string = true;
+  else if (c == '{' || c == '[')
+    s->level++;
+  else if (c == '}' || c == ']')
+    return --s->level == 0;
+  return false;
+}
+
+/** starts the response line with the id of the request as it was sent or null if the request has none */
+static void add_head(sb_t* sb, in3_req_t* ctx) {
+  d_token_t* id = ctx->requests ? d_get(ctx->requests[0], K_ID) : NULL;
+  sb_add_chars(sb, "{\"jsonrpc\":\"2.0\",\"id\":");
+  if (!id || d_type(id) == T_NULL)
+    sb_add_chars(sb, "null");
+  else if (d_type(id) == T_INTEGER)
+    sb_print(sb, "%" PRIu64, d_long(id)); // d_create_json would write it as hex
+  else {
+    char* json = d_create_json(ctx->request_context, id);
+    sb_add_chars(sb, json);
+    _free(json);
+  }
+}
+
+static void add_error(sb_t* sb, in3_req_t* ctx, int code, char* msg) {
+  add_head(sb, ctx);
+  sb_print(sb, ",\"error\":{\"code\":%i,\"message\":\"", code);
+  if (msg) {
+    for (char* x = msg; *x; x++) {
+      if (*x == '\n') *x = ' ';
+    }
+  }
+  sb_add_escaped_chars(sb, msg ? msg : "Unknown error", -1);
+  sb_add_chars(sb, "\"}}\n");
+}
+
+void req_stream_exec_request(in3_t* c, char* data, sb_t* sb) {
+  in3_req_t* ctx = req_new(c, data);
+  if (!ctx) {
+    sb_add_chars(sb, "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32603,\"message\":\"Too many pending requests\"}}\n");
+    return;
+  }
+  if (ctx->error)
+    add_error(sb, ctx, ctx->verification_state, ctx->error);
+  else if (in3_send_req(ctx) == IN3_OK) {
+    if (c->flags & FLAGS_KEEP_IN3) {
+      str_range_t rr = d_to_json(ctx->responses[0]);
+      sb_add_range(sb, rr.data, 0, rr.len);
+      sb_add_char(sb, '\n');
+    }
+    else {
+      d_token_t* result = d_get(ctx->responses[0], K_RESULT);
+      d_token_t* error  = d_get(ctx->responses[0], K_ERROR);
+      char*      r      = d_create_json(ctx->response_context, result ? result : error);
+      add_head(sb, ctx);
+      sb_print(sb, ",\"%s\":%s}\n", result ? "result" : "error", r);
+      _free(r);
+    }
+  }
+  else
+    add_error(sb, ctx, ctx->verification_state, ctx->error);
+  req_free(ctx);
+}
+
+#ifdef THREADSAFE
+#include <pthread.h>
+
+/** a request read from the stream */
+typedef struct pipe_job {
+  char*            request;  /**< the request as read */
+  sb_t             response; /**< the response line */
+  uint64_t         seq;      /**< position within the input */
+  struct pipe_job* next;
+} pipe_job_t;
+
+typedef struct {
+  in3_t*              c;
+  req_stream_write_fn write;
+  void*               ptr;
+  bool                ordered;
+  bool                eof;
+  unsigned int        in_flight; // jobs read, but not written yet
+  uint64_t            next_seq;  // the next job to write, if ordered
+  pipe_job_t*         queue;     // jobs waiting to be executed
+  pipe_job_t**        queue_tail;
+  pipe_job_t*         done; // jobs executed, but waiting for previous jobs to be written (ordered by seq)
+  pthread_mutex_t     mutex;
+  pthread_cond_t      has_job;
+  pthread_cond_t      has_room;
+} pipe_t;
+
+static void pipe_job_free(pipe_job_t* job) {
+  _free(job->request);
+  _free(job->response.data);
+  _free(job);
+}
+
+/** writes the response or keeps it until all previous responses are written. This must be called with the locked mutex. */
+static void pipe_write(pipe_t* p, pipe_job_t* job) {
+  if (!p->ordered) {
+    p->write(p->ptr, job->response.data, p->queue != NULL);
+    pipe_job_free(job);
+    p->in_flight--;
+  }
+  else {
+    pipe_job_t** d = &p->done;
+    while (*d && (*d)->seq < job->seq) d = &(*d)->next;
+    job->next = *d;
+    *d        = job;
+    while (p->done && p->done->seq == p->next_seq) {
+      job     = p->done;
+      p->done = job->next;
+      p->write(p->ptr, job->response.data, p->queue != NULL);
+      pipe_job_free(job);
+      p->next_seq++;
+      p->in_flight--;
+    }
+  }
+  pthread_cond_signal(&p->has_room);
+}
+
+static void* pipe_worker(void* ptr) {
+  pipe_t* p = ptr;
+  while (true) {
+    pthread_mutex_lock(&p->mutex);
+    while (!p->queue && !p->eof) pthread_cond_wait(&p->has_job, &p->mutex);
+    pipe_job_t* job = p->queue;
+    if (!job) break;
+    p->queue = job->next;
+    if (!p->queue) p->queue_tail = &p->queue;
+    pthread_mutex_unlock(&p->mutex);
+
+    req_stream_exec_request(p->c, job->request, &job->response);
+
+    pthread_mutex_lock(&p->mutex);
+    pipe_write(p, job);
+    pthread_mutex_unlock(&p->mutex);
+  }
+  pthread_mutex_unlock(&p->mutex);
+  return NULL;
+}
+
+/** reads requests from the stream while executing them with multiple threads. */
+static in3_ret_t exec_parallel(in3_t* c, FILE* f, uint32_t threads, bool ordered, req_stream_write_fn write, void* ptr) {
+  json_splitter_t s       = {0};
+  uint64_t        seq     = 0;
+  pthread_t*      workers = _malloc(threads * sizeof(pthread_t));
+  pipe_t          p       = {.c = c, .write = write, .ptr = ptr, .ordered = ordered};
+  p.queue_tail            = &p.queue;
+  pthread_mutex_init(&p.mutex, NULL);
+  pthread_cond_init(&p.has_job, NULL);
+  pthread_cond_init(&p.has_room, NULL);
+  for (uint32_t i = 0; i < threads; i++) pthread_create(workers + i, NULL, pipe_worker, &p);
+
+  for (int d = fgetc(f); d != EOF; d = fgetc(f)) {
+    if (!json_splitter_add(&s, (char) d)) continue;
+    pipe_job_t* job = _calloc(1, sizeof(pipe_job_t));
+    job->request    = _strdupn(s.sb.data, s.sb.len);
+    job->seq        = seq++;
+
+    // we keep up to 2 jobs per thread, so the workers never wait for the reader
+    pthread_mutex_lock(&p.mutex);
+    while (p.in_flight >= threads * 2) pthread_cond_wait(&p.has_room, &p.mutex);
+    p.in_flight++;
+    *p.queue_tail = job;
+    p.queue_tail  = &job->next;
+    pthread_cond_signal(&p.has_job);
+    pthread_mutex_unlock(&p.mutex);
+  }
+
+  pthread_mutex_lock(&p.mutex);
+  p.eof = true;
+  pthread_cond_broadcast(&p.has_job);
+  pthread_mutex_unlock(&p.mutex);
+  for (uint32_t i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+  pthread_cond_destroy(&p.has_room);
+  pthread_cond_destroy(&p.has_job);
+  pthread_mutex_destroy(&p.mutex);
+  _free(workers);
+  _free(s.sb.data);
+  return s.level ? IN3_EINVAL : IN3_OK;
+}
+#endif
+
+in3_ret_t req_stream_exec(in3_t* c, FILE* f, uint32_t threads, bool ordered, req_stream_write_fn write, void* ptr) {
+#ifdef THREADSAFE
+  if (threads > 1) return exec_parallel(c, f, threads, ordered, write, ptr);
+#else
+  UNUSED_VAR(threads);
+  UNUSED_VAR(ordered);
+#endif
+  json_splitter_t s        = {0};
+  sb_t            response = {0};
+  for (int d = fgetc(f); d != EOF; d = fgetc(f)) {
+    if (!json_splitter_add(&s, (char) d)) continue;
+    response.len = 0;
+    req_stream_exec_request(c, s.sb.data, &response);
+    write(ptr, response.data, false);
+  }
+  _free(response.data);
+  _free(s.sb.data);
+  return s.level ? IN3_EINVAL : IN3_OK;
+}
@@ -0,0 +1,41 @@
+#ifndef REQ_STREAM_H
+#define REQ_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../../core/client/plugin.h"
+#include "../../core/util/stringbuilder.h"
+#include <stdio.h>
+
+/** incremental splitter detecting the end of a json-object or array read from a stream */
+typedef struct json_splitter {
+  sb_t sb;        /**< the data of the current request */
+  int  level;     /**< nesting level of objects and arrays */
+  bool in_string; /**< true if we are within a string, where brackets are ignored */
+  bool escaped;   /**< true if the last char within a string was a backslash */
+} json_splitter_t;
+
+/** called for each response line. more is true if more responses are about to be written, so flushing can be skipped. */
+typedef void (*req_stream_write_fn)(void* ptr, const char* response, bool more);
+
+/** adds the next char and returns true if the request is complete */
+bool json_splitter_add(json_splitter_t* s, char c);
+
+/** executes the request and writes the response as one line, using the id of the request */
+void req_stream_exec_request(in3_t* c, char* data, sb_t* sb);
+
+/**
+ * reads requests from the stream until EOF and writes the responses.
+ *
+ * With more than one thread the requests are executed in parallel. In this case responses are written in the order of the requests only if ordered is true.
+ * Returns IN3_EINVAL if the stream ends within a request.
+ */
+in3_ret_t req_stream_exec(in3_t* c, FILE* f, uint32_t threads, bool ordered, req_stream_write_fn write, void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
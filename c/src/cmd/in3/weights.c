@@ -85,6 +85,7 @@ bool exec_weights(in3_t* c) {
 
         if (ctx.raw_response->data.data)
           _free(ctx.raw_response->data.data);
+        json_stream_free(ctx.raw_response->stream);
         _free(ctx.raw_response);
         if (health_res) json_free(health_res);
       }
@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+
+#include "../util/data.h"
+#include "../util/log.h"
+#include "../util/mem.h"
+#include "../util/stringbuilder.h"
+#include "../util/utils.h"
+#include "client.h"
+#include "keys.h"
+#include "request_internal.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef THREADSAFE
+
+/** requests collected from different threads, which will be sent as one batch. */
+typedef struct {
+  in3_req_t** reqs;    /**< the requests (the first one is the leader sending the batch) */
+  char**      results; /**< the json of the result or error of each request, or NULL if it failed */
+  bool*       errors;  /**< true if the result is an error */
+  uint16_t    len;     /**< number of requests */
+  uint16_t    max;     /**< max number of requests */
+  bool        done;    /**< true if the results are set */
+  uint16_t    refs;    /**< number of requests still using the batch */
+  in3_cond_t  full;    /**< signaled when the batch is full */
+  in3_cond_t  ready;   /**< signaled when the results are set */
+} in3_batch_t;
+
+struct in3_batches {
+  in3_batch_t* open;  /**< the batch currently collecting requests */
+  in3_mutex_t  mutex; /**< protects the batches */
+};
+
+in3_batches_t* in3_batches_new() {
+  in3_batches_t* b = _calloc(1, sizeof(in3_batches_t));
+  MUTEX_INIT(b->mutex)
+  return b;
+}
+
+void in3_batches_free(in3_batches_t* b) {
+  if (!b) return;
+  MUTEX_FREE(b->mutex)
+  _free(b);
+}
+
+static void batch_release(in3_batch_t* b) {
+  if (--b->refs) return;
+  for (int i = 0; i < b->len; i++) _free(b->results[i]);
+  COND_FREE(b->full)
+  COND_FREE(b->ready)
+  _free(b->reqs);
+  _free(b->results);
+  _free(b->errors);
+  _free(b);
+}
+
+/**
+ * only requests without side effects are batched, since a failed batch is resent as single requests.
+ */
+static bool is_batchable(in3_req_t* req) {
+  in3_t*      c      = req->client;
+  const char* method = req->len == 1 ? d_get_string(req->requests[0], K_METHOD) : NULL;
+  return c->batches && c->batch_window && !(c->flags & FLAGS_BINARY) && req->type == RT_RPC && method && in3_is_read_only(method) && !req->raw_response && !d_get(req->requests[0], K_IN3) && in3_chain_id(req) == c->chain.id;
+}
+
+/**
+ * sends all requests of the batch as one request and collects the results.
+ */
+static void batch_send(in3_batch_t* b) {
+  in3_t* c  = b->reqs[0]->client;
+  sb_t   sb = {0};
+  for (int i = 0; i < b->len; i++) {
+    char* p = d_create_json(b->reqs[i]->request_context, d_get(b->reqs[i]->requests[0], K_PARAMS));
+    sb_add_chars(&sb, i ? ",{\"method\":\"" : "[{\"method\":\"");
+    sb_add_chars(&sb, d_get_string(b->reqs[i]->requests[0], K_METHOD));
+    sb_add_chars(&sb, "\",\"params\":");
+    sb_add_chars(&sb, p);
+    sb_add_char(&sb, '}');
+    _free(p);
+  }
+  sb_add_char(&sb, ']');
+
+  in3_log_debug("sending %i requests as batch\n", b->len);
+  in3_req_t* req = req_new(c, sb.data);
+  if (req && in3_send_req(req) == IN3_OK && req->len == b->len) {
+    for (int i = 0; i < b->len; i++) {
+      d_token_t* r  = d_get(req->responses[i], K_RESULT);
+      b->errors[i]  = !r;
+      r             = r ? r : d_get(req->responses[i], K_ERROR);
+      b->results[i] = r ? d_create_json(req->response_context, r) : NULL;
+    }
+  }
+  req_free(req);
+  _free(sb.data);
+}
+
+bool in3_batch_join(in3_req_t* req) {
+  if (!is_batchable(req)) return false;
+  in3_batches_t* bs  = req->client->batches;
+  in3_batch_t*   b   = NULL;
+  int            idx = 0;
+
+  MUTEX_LOCK(bs->mutex)
+  if (bs->open) {
+    // we join the batch and wake up the leader if it is full now
+    b            = bs->open;
+    idx          = b->len;
+    b->reqs[idx] = req;
+    b->len++;
+    b->refs++;
+    if (b->len == b->max) {
+      bs->open = NULL;
+      COND_BROADCAST(b->full)
+    }
+    while (!b->done) COND_WAIT(b->ready, bs->mutex)
+  }
+  else {
+    // we start a new batch and wait for others to join
+    b          = _calloc(1, sizeof(in3_batch_t));
+    b->max     = req->client->batch_size ? req->client->batch_size : 1;
+    b->reqs    = _calloc(b->max, sizeof(in3_req_t*));
+    b->results = _calloc(b->max, sizeof(char*));
+    b->errors  = _calloc(b->max, sizeof(bool));
+    b->reqs[0] = req;
+    b->len     = 1;
+    b->refs    = 1;
+    COND_INIT(b->full)
+    COND_INIT(b->ready)
+    bs->open = b;
+
+    uint64_t end = current_ms() + req->client->batch_window;
+    for (uint64_t now = current_ms(); b->len < b->max && now < end; now = current_ms()) COND_WAIT_MS(b->full, bs->mutex, (uint32_t) (end - now))
+    if (bs->open == b) bs->open = NULL;
+
+    // if nobody joined, we simply send it as it is
+    if (b->len == 1) {
+      batch_release(b);
+      MUTEX_UNLOCK(bs->mutex)
+      return false;
+    }
+
+    // the other requests wait for the results, so we don't need the lock while sending.
+    MUTEX_UNLOCK(bs->mutex)
+    batch_send(b);
+    MUTEX_LOCK(bs->mutex)
+    b->done = true;
+    COND_BROADCAST(b->ready)
+  }
+
+  char* res       = b->results[idx];
+  bool  error     = b->errors[idx];
+  b->results[idx] = NULL;
+  batch_release(b);
+  MUTEX_UNLOCK(bs->mutex)
+
+  // if the batch failed, we send it on our own
+  if (!res) return false;
+  req_set_internal_response(req, error ? "error" : "result", res, -1);
+  _free(res);
+  return true;
+}
+
+uint16_t in3_batches_open_len(in3_batches_t* bs) {
+  MUTEX_LOCK(bs->mutex)
+  uint16_t len = bs->open ? bs->open->len : 0;
+  MUTEX_UNLOCK(bs->mutex)
+  return len;
+}
+
+#endif
@@ -380,3 +380,47 @@ void in3_set_storage_handler(
   handler->clear                 = clear;
   in3_plugin_register(c, PLGN_ACT_CACHE | PLGN_ACT_TERM, handle_cache, handler, true);
 }
+
+typedef struct {
+  in3_lru_cache_t* lru;    /**< the values */
+  in3_t*           client; /**< the client, which defines the cache_timeout */
+} in3_memory_cache_t;
+
+static in3_ret_t handle_memory_cache(void* data, in3_plugin_act_t action, void* arg) {
+  in3_memory_cache_t* cache = data;
+  in3_cache_ctx_t*    ctx   = arg;
+  switch (action) {
+    case PLGN_ACT_CACHE_GET:
+      return (ctx->content = in3_lru_get(cache->lru, bytes((uint8_t*) ctx->key, strlen(ctx->key)), cache->client->cache_timeout)) ? IN3_OK : IN3_EIGNORE;
+    case PLGN_ACT_CACHE_SET:
+      in3_lru_set(cache->lru, bytes((uint8_t*) ctx->key, strlen(ctx->key)), *ctx->content);
+      return IN3_OK;
+    case PLGN_ACT_CACHE_CLEAR:
+      in3_lru_clear(cache->lru);
+      return IN3_OK;
+    case PLGN_ACT_TERM:
+      in3_lru_free(cache->lru);
+      _free(cache);
+      return IN3_OK;
+    default: return IN3_EINVAL;
+  }
+}
+
+void in3_set_memory_cache(in3_t* c, size_t max_bytes) {
+  in3_memory_cache_t* cache = in3_plugin_get_data(c, handle_memory_cache);
+  if (cache) {
+    // only the size changes, so we keep the handler
+    in3_lru_free(cache->lru);
+    cache->lru = in3_lru_new(max_bytes);
+    return;
+  }
+  cache         = _malloc(sizeof(in3_memory_cache_t));
+  cache->lru    = in3_lru_new(max_bytes);
+  cache->client = c;
+  in3_plugin_register(c, PLGN_ACT_CACHE | PLGN_ACT_TERM, handle_memory_cache, cache, true);
+}
+
+size_t in3_get_memory_cache(in3_t* c) {
+  in3_memory_cache_t* cache = in3_plugin_get_data(c, handle_memory_cache);
+  return cache ? in3_lru_max_bytes(cache->lru) : 0;
+}
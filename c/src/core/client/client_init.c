@@ -40,6 +40,7 @@
 #include "client.h"
 #include "plugin.h"
 #include "request_internal.h"
+#include "workers.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -94,6 +95,10 @@ static in3_ret_t in3_client_init(in3_t* c, chain_id_t chain_id) {
   c->replace_latest_block  = 0;
   c->timeout               = 10000;
   c->id_count              = 1;
+  c->batch_size            = 16;
+#ifdef THREADSAFE
+  c->flights = in3_flights_new();
+#endif
 
   if (chain_id == CHAIN_ID_MAINNET)
     in3_client_register_chain(c, 0x01, CHAIN_ETH, 2);
@@ -160,6 +165,10 @@ void in3_free(in3_t* a) {
   }
 
   if (a->chain.verified_hashes) _free(a->chain.verified_hashes);
+  in3_lru_free(a->response_cache);
+  in3_flights_free(a->flights);
+  in3_batches_free(a->batches);
+  in3_workers_free(a->workers);
   _free(a);
 }
 
@@ -240,6 +249,18 @@ char* in3_get_config(in3_t* c) {
   add_bool(sb, ',', "experimental", c->flags & FLAGS_ALLOW_EXPERIMENTAL);
   add_uint(sb, ',', "maxVerifiedHashes", c->max_verified_hashes);
   add_uint(sb, ',', "timeout", c->timeout);
+  if (c->cache_timeout)
+    add_uint(sb, ',', "cacheTimeout", c->cache_timeout);
+  if (c->response_cache)
+    add_uint(sb, ',', "responseCache", in3_lru_max_bytes(c->response_cache));
+  if (in3_get_memory_cache(c))
+    add_uint(sb, ',', "memoryCache", in3_get_memory_cache(c));
+  if (c->batch_window) {
+    add_uint(sb, ',', "batchWindow", c->batch_window);
+    add_uint(sb, ',', "batchSize", c->batch_size);
+  }
+  if (c->verify_threads)
+    add_uint(sb, ',', "verifyThreads", c->verify_threads);
   add_string(sb, ',', "proof", (c->proof == PROOF_NONE) ? "none" : (c->proof == PROOF_STANDARD ? "standard" : "full"));
   if (c->replace_latest_block)
     add_uint(sb, ',', "replaceLatestBlock", c->replace_latest_block);
@@ -363,6 +384,39 @@ char* in3_configure(in3_t* c, const char* config) {
       EXPECT_TOK_U32(token);
       c->timeout = d_long(token);
     }
+    else if (token->key == CONFIG_KEY("cacheTimeout")) {
+      EXPECT_TOK_U32(token);
+      c->cache_timeout = d_long(token);
+    }
+    else if (token->key == CONFIG_KEY("responseCache")) {
+      EXPECT_TOK_U32(token);
+      in3_lru_free(c->response_cache);
+      c->response_cache = d_long(token) ? in3_lru_new(d_long(token)) : NULL;
+    }
+    else if (token->key == CONFIG_KEY("memoryCache")) {
+      EXPECT_TOK_U32(token);
+      if (d_long(token) || in3_get_memory_cache(c)) in3_set_memory_cache(c, d_long(token));
+    }
+    else if (token->key == CONFIG_KEY("batchWindow")) {
+      EXPECT_TOK_U32(token);
+      c->batch_window = d_long(token);
+#ifdef THREADSAFE
+      if (c->batch_window && !c->batches) c->batches = in3_batches_new();
+#endif
+    }
+    else if (token->key == CONFIG_KEY("verifyThreads")) {
+      EXPECT_TOK_U8(token);
+      if (c->verify_threads != (uint8_t) d_int(token)) {
+        c->verify_threads = (uint8_t) d_int(token);
+        in3_workers_free(c->workers);
+        c->workers = in3_workers_new(c->verify_threads);
+      }
+    }
+    else if (token->key == CONFIG_KEY("batchSize")) {
+      EXPECT_TOK_U16(token);
+      EXPECT_CFG(d_int(token) > 0, "batchSize must be greater than 0");
+      c->batch_size = d_int(token);
+    }
     else if (token->key == CONFIG_KEY("proof")) {
       EXPECT_TOK_STR(token);
       EXPECT_TOK(token, !strcmp(d_string(token), "full") || !strcmp(d_string(token), "standard") || !strcmp(d_string(token), "none"), "expected values - full/standard/none");
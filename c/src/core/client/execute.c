@@ -59,11 +59,11 @@ NONULL static void response_free(in3_req_t* ctx) {
   if (ctx->raw_response) {
     for (int i = 0; i < nodes_count; i++) {
       if (ctx->raw_response[i].data.data) _free(ctx->raw_response[i].data.data);
+      json_stream_free(ctx->raw_response[i].stream);
     }
     _free(ctx->raw_response);
   }
 
-  if (ctx->responses) _free(ctx->responses);
   if (ctx->response_context) json_free(ctx->response_context);
   if (ctx->signers) _free(ctx->signers);
   ctx->response_context = NULL;
@@ -90,6 +90,8 @@ NONULL void in3_check_verified_hashes(in3_t* c) {
 
 NONULL static void req_free_intern(in3_req_t* ctx, bool is_sub) {
   assert_in3_req(ctx);
+  // release requests still waiting for us
+  if (ctx->type == RT_RPC) in3_flight_done(ctx);
   // only for intern requests, we actually free the original request-string
   if (is_sub && ctx->request_context)
     _free(ctx->request_context->c);
@@ -99,9 +101,9 @@ NONULL static void req_free_intern(in3_req_t* ctx, bool is_sub) {
   if (ctx->request_context)
     json_free(ctx->request_context);
 
-  if (ctx->requests) _free(ctx->requests);
   if (ctx->cache) in3_cache_free(ctx->cache, !is_sub);
   if (ctx->required) req_free_intern(ctx->required, true);
+  arena_free(&ctx->arena);
 
   in3_check_verified_hashes(ctx->client);
   _free(ctx);
@@ -245,13 +247,14 @@ NONULL static in3_ret_t ctx_create_payload(in3_req_t* c, sb_t* sb, bool no_in3)
   return IN3_OK;
 }
 
-NONULL static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data, int len) {
+/** parses the response, unless the transport already did it while receiving the data (parsed). */
+static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data, int len, json_ctx_t* parsed) {
   assert_in3_req(ctx);
   assert(response_data);
   const bool is_json = response_data[0] == '{' || response_data[0] == '[' || response_data[0] == '"';
 
   if (is_raw_http(ctx)) {
-    ctx->response_context = is_json ? parse_json(response_data) : NULL;
+    ctx->response_context = parsed ? parsed : (is_json ? parse_json(response_data) : NULL);
     if (!ctx->response_context) {
       // we create a context only holding the raw data
       ctx->response_context               = _calloc(1, sizeof(json_ctx_t));
@@ -261,7 +264,7 @@ NONULL static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data,
       ctx->response_context->result->len  = len;
       ctx->response_context->result->data = (uint8_t*) response_data;
     }
-    ctx->responses    = _malloc(sizeof(d_token_t*));
+    ctx->responses    = req_response_array(ctx);
     ctx->responses[0] = ctx->response_context->result;
     return IN3_OK;
   }
@@ -269,7 +272,7 @@ NONULL static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data,
     assert(len);
   }
 
-  ctx->response_context = is_json ? parse_json(response_data) : parse_binary_str(response_data, len);
+  ctx->response_context = parsed ? parsed : (is_json ? parse_json(response_data) : parse_binary_str(response_data, len));
 
   if (!ctx->response_context) {
     char* error = is_json ? parse_json_error(response_data) : NULL;
@@ -280,7 +283,7 @@ NONULL static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data,
 
   if (d_type(ctx->response_context->result) == T_OBJECT) {
     // it is a single result
-    ctx->responses    = _malloc(sizeof(d_token_t*));
+    ctx->responses    = req_response_array(ctx);
     ctx->responses[0] = ctx->response_context->result;
     if (ctx->len != 1) return req_set_error(ctx, "The response must be an array!", IN3_EINVALDT);
   }
@@ -289,7 +292,7 @@ NONULL static in3_ret_t ctx_parse_response(in3_req_t* ctx, char* response_data,
     d_token_t* t = NULL;
     if (d_len(ctx->response_context->result) != (int) ctx->len)
       return req_set_error(ctx, "The responses must be a array with the same number as the requests!", IN3_EINVALDT);
-    ctx->responses = _malloc(sizeof(d_token_t*) * ctx->len);
+    ctx->responses = req_response_array(ctx);
     for (i = 0, t = ctx->response_context->result + 1; i < (int) ctx->len; i++, t = d_next(t))
       ctx->responses[i] = t;
   }
@@ -316,6 +319,8 @@ NONULL static void clear_response(in3_response_t* response) {
     response->data.allocted = 0;
     response->data.len      = 0;
   }
+  json_stream_free(response->stream);
+  response->stream = NULL;
 }
 
 static in3_ret_t handle_error_response(in3_req_t* ctx, node_match_t* node, in3_response_t* response) {
@@ -338,7 +343,6 @@ static void clean_up_ctx(in3_req_t* ctx) {
 
   if (ctx->verification_state != IN3_OK && ctx->verification_state != IN3_WAITING) ctx->verification_state = IN3_WAITING;
   if (ctx->error) _free(ctx->error);
-  if (ctx->responses) _free(ctx->responses);
   if (ctx->response_context) json_free(ctx->response_context);
   ctx->error = NULL;
 }
@@ -349,9 +353,9 @@ NONULL in3_ret_t in3_retry_same_node(in3_req_t* ctx) {
   for (int i = 0; i < nodes_count; i++) {
     if (ctx->raw_response[i].data.data)
       _free(ctx->raw_response[i].data.data);
+    json_stream_free(ctx->raw_response[i].stream);
   }
   _free(ctx->raw_response);
-  _free(ctx->responses);
   json_free(ctx->response_context);
 
   ctx->raw_response     = NULL;
@@ -379,8 +383,10 @@ static in3_ret_t verify_response(in3_req_t* ctx, in3_chain_t* chain, node_match_
   // we need to clean up the previos responses if set
   clean_up_ctx(ctx);
 
-  // parse
-  if (ctx_parse_response(ctx, response->data.data, response->data.len)) {
+  // parse (or take the tokens already created while receiving)
+  json_ctx_t* parsed = response->stream ? json_stream_finish(response->stream, response->data.data, response->data.len) : NULL;
+  response->stream   = NULL;
+  if (ctx_parse_response(ctx, response->data.data, response->data.len, parsed)) {
     // in case of an error we get a error-code and error is set in the ctx?
     // so we need to block the node.
     if (node) {
@@ -495,7 +501,6 @@ static in3_ret_t find_valid_result(in3_req_t* ctx, node_match_t** vnode) {
   if (state && still_pending) {
     in3_log_debug("failed to verify, but waiting for pending\n");
     if (ctx->error) _free(ctx->error);
-    if (ctx->responses) _free(ctx->responses);
     if (ctx->response_context) json_free(ctx->response_context);
     ctx->error              = NULL;
     ctx->verification_state = IN3_WAITING;
@@ -821,7 +826,8 @@ in3_ret_t in3_send_req(in3_req_t* ctx) {
             in3_handle_sign(last);
             break;
           case RT_RPC:
-            in3_handle_rpc(last, &transports);
+            // if another thread sends the same request, we wait for its response or we may send it with others as batch
+            if (!in3_flight_join(last) && !in3_batch_join(last)) in3_handle_rpc(last, &transports);
         }
       }
     }
@@ -938,6 +944,91 @@ static inline in3_ret_t select_nodes(in3_req_t* req) {
   return in3_plugin_execute_first_or_none(req, PLGN_ACT_PAY_PREPARE, req);
 }
 
+/** number of blocks a block needs to be behind the current block, before responses for it are cached. */
+#define RESPONSE_CACHE_FINALITY 64
+
+/**
+ * checks if the result of the request will never change once verified.
+ *
+ * Returns 0 for requests by hash, -1 if the request is not cacheable or the index+1 of the block-param, which must be final.
+ */
+static int response_cache_block_param(const char* method) {
+  if (!strcmp(method, "eth_getBlockByHash") || !strcmp(method, "eth_getTransactionByHash") || !strcmp(method, "eth_getTransactionReceipt") || !strcmp(method, "eth_getTransactionByBlockHashAndIndex") || !strcmp(method, "eth_getBlockTransactionCountByHash")) return 0;
+  if (!strcmp(method, "eth_getBlockByNumber") || !strcmp(method, "eth_getBlockTransactionCountByNumber") || !strcmp(method, "eth_getTransactionByBlockNumberAndIndex")) return 1;
+  if (!strcmp(method, "eth_getBalance") || !strcmp(method, "eth_getCode") || !strcmp(method, "eth_getTransactionCount") || !strcmp(method, "eth_call")) return 2;
+  if (!strcmp(method, "eth_getStorageAt")) return 3;
+  return -1;
+}
+
+/**
+ * creates the key for the response-cache as keccak(chain_id, method, params) or returns false if the request is not cacheable.
+ */
+static bool response_cache_key(in3_req_t* req, bytes32_t cache_key, int* block_param) {
+  if (!req->client->response_cache || req->len != 1 || req->type != RT_RPC || in3_req_get_proof(req, 0) == PROOF_NONE) return false;
+  const char* method = d_get_string(req->requests[0], K_METHOD);
+  d_token_t*  params = d_get(req->requests[0], K_PARAMS);
+  if (!method || (*block_param = response_cache_block_param(method)) < 0) return false;
+
+  // a block-number needs to be a number, since latest or pending may change
+  if (*block_param) {
+    if (!d_is_bytes(d_get_at(params, *block_param - 1))) return false;
+  }
+
+  sb_t sb = {0};
+  sb_add_int(&sb, (int64_t) in3_chain_id(req));
+  sb_add_char(&sb, ':');
+  sb_add_chars(&sb, method);
+  sb_add_char(&sb, ':');
+  char* p = d_create_json(req->request_context, params);
+  sb_add_chars(&sb, p);
+  _free(p);
+  keccak(bytes((uint8_t*) sb.data, sb.len), cache_key);
+  _free(sb.data);
+  return true;
+}
+
+/**
+ * looks for a verified response in the response-cache and sets it as raw_response.
+ */
+static void response_cache_get(in3_req_t* req) {
+  int       block_param;
+  bytes32_t cache_key;
+  if (req->raw_response || req->response_context || req->nodes || !response_cache_key(req, cache_key, &block_param)) return;
+  bytes_t* cached = in3_lru_get(req->client->response_cache, bytes(cache_key, 32), req->client->cache_timeout);
+  if (!cached) return;
+
+  // we set the response the same way internal handlers do, so it will be accepted without verification.
+  req_set_internal_response(req, "result", (char*) cached->data, cached->len);
+  b_free(cached);
+  in3_log_debug("using cached response for %s\n", d_get_string(req->requests[0], K_METHOD));
+}
+
+/**
+ * stores a verified result in the response-cache, if it can not change anymore.
+ */
+static void response_cache_set(in3_req_t* req, node_match_t* node) {
+  int       block_param;
+  bytes32_t cache_key;
+  if (!node || !req->responses || (req->client->flags & FLAGS_BINARY) || !response_cache_key(req, cache_key, &block_param)) return;
+  d_token_t* result = d_get(req->responses[0], K_RESULT);
+  if (!result || d_type(result) == T_NULL) return;
+
+  // pending transactions are not included in a block yet
+  d_token_t* block_hash = d_type(result) == T_OBJECT ? d_get(result, K_BLOCK_HASH) : NULL;
+  if (block_hash && d_type(block_hash) == T_NULL) return;
+
+  // only blocks, which are deep enough are treated as final. This includes transactions and receipts found by hash, since a reorg may move them to another block.
+  d_token_t* block = block_param ? d_get_at(d_get(req->requests[0], K_PARAMS), block_param - 1) : (block_hash ? d_get(result, K_BLOCK_NUMBER) : NULL);
+  if (block || block_hash) {
+    uint64_t current = d_get_long(d_get(req->responses[0], K_IN3), K_CURRENT_BLOCK);
+    if (!block || !current || d_long(block) + RESPONSE_CACHE_FINALITY > current) return;
+  }
+
+  char* json = d_create_json(req->response_context, result);
+  in3_lru_set(req->client->response_cache, bytes(cache_key, 32), bytes((uint8_t*) json, strlen(json)));
+  _free(json);
+}
+
 in3_ret_t in3_req_execute(in3_req_t* req) {
   in3_ret_t ret = IN3_OK;
 
@@ -967,6 +1058,9 @@ in3_ret_t in3_req_execute(in3_req_t* req) {
       if (!req->raw_response && !req->response_context && (ret = handle_internally(req)) < 0)
         return req->error ? ret : req_set_error(req, get_error_message(req, ret), ret);
 
+      // do we already have a verified response for it?
+      response_cache_get(req);
+
       // if we don't have a nodelist, we try to get it.
       if ((ret = select_nodes(req))) return ret;
 
@@ -977,6 +1071,9 @@ in3_ret_t in3_req_execute(in3_req_t* req) {
       // verify responses and return the node with the correct result.
       node_match_t* node = NULL;
       if ((ret = find_valid_result(req, &node)) == IN3_OK) {
+        response_cache_set(req, node);
+        in3_flight_done(req);
+
         // allow payments to to handle post actions
         in3_nl_followup_ctx_t fctx = {.req = req, .node = node};
         in3_plugin_execute_first_or_none(req, PLGN_ACT_NL_PICK_FOLLOWUP, &fctx);
@@ -1005,6 +1102,7 @@ in3_ret_t in3_req_execute(in3_req_t* req) {
         if (ctx_is_allowed_to_fail(req))
           req->verification_state = ret = IN3_EIGNORE;
         // we give up
+        in3_flight_done(req);
         return req->error ? (ret ? ret : IN3_ERPC) : req_set_error(req, "reaching max_attempts and giving up", IN3_ELIMIT);
       }
     }
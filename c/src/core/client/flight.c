@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+
+#include "../util/data.h"
+#include "../util/log.h"
+#include "../util/mem.h"
+#include "../util/scache.h"
+#include "../util/stringbuilder.h"
+#include "../util/utils.h"
+#include "client.h"
+#include "keys.h"
+#include "request_internal.h"
+#include <string.h>
+
+#ifdef THREADSAFE
+
+/** a request, which is currently sent by one thread and identical requests from other threads wait for. */
+typedef struct in3_flight {
+  char*              key;    /**< chain, method, params and in3-section of the request */
+  uint32_t           hash;   /**< the hash of the key */
+  in3_req_t*         leader; /**< the request, which was sent */
+  uintptr_t          thread; /**< the thread sending the request */
+  char*              result; /**< the verified result as json or NULL if the leader failed */
+  bool               done;   /**< true if the leader has a result or gave up */
+  uint32_t           refs;   /**< number of requests (leader and waiting) using this flight */
+  in3_cond_t         cond;   /**< signaled, once done */
+  struct in3_flight* next;   /**< next flight */
+} in3_flight_t;
+
+struct in3_flights {
+  in3_flight_t* flights; /**< the requests currently sent */
+  in3_mutex_t   mutex;   /**< protects the list and the flights */
+};
+
+in3_flights_t* in3_flights_new() {
+  in3_flights_t* fl = _calloc(1, sizeof(in3_flights_t));
+  MUTEX_INIT(fl->mutex)
+  return fl;
+}
+
+static void flight_release(in3_flight_t* f) {
+  if (--f->refs) return;
+  COND_FREE(f->cond)
+  _free(f->key);
+  _free(f->result);
+  _free(f);
+}
+
+void in3_flights_free(in3_flights_t* fl) {
+  if (!fl) return;
+  while (fl->flights) {
+    in3_flight_t* f = fl->flights;
+    fl->flights     = f->next;
+    flight_release(f);
+  }
+  MUTEX_FREE(fl->mutex)
+  _free(fl);
+}
+
+bool in3_is_read_only(const char* method) {
+  if (!strncmp(method, "eth_get", 7)) return strncmp(method, "eth_getFilter", 13) != 0;
+  return !strcmp(method, "eth_blockNumber") || !strcmp(method, "eth_call") || !strcmp(method, "eth_chainId") || !strcmp(method, "eth_gasPrice") || !strcmp(method, "eth_estimateGas") || !strcmp(method, "in3_nodeList") || !strcmp(method, "in3_whiteList") || !strcmp(method, "in3_sign");
+}
+
+static char* flight_key(in3_req_t* req) {
+  const char* method = d_get_string(req->requests[0], K_METHOD);
+  if (!method || !in3_is_read_only(method)) return NULL;
+  sb_t       sb  = {0};
+  d_token_t* in3 = d_get(req->requests[0], K_IN3);
+  char*      p   = d_create_json(req->request_context, d_get(req->requests[0], K_PARAMS));
+  sb_add_int(&sb, (int64_t) in3_chain_id(req));
+  sb_add_char(&sb, ':');
+  sb_add_chars(&sb, method);
+  sb_add_char(&sb, ':');
+  sb_add_chars(&sb, p);
+  _free(p);
+  if (in3) {
+    p = d_create_json(req->request_context, in3);
+    sb_add_char(&sb, ':');
+    sb_add_chars(&sb, p);
+    _free(p);
+  }
+  return sb.data;
+}
+
+bool in3_flight_join(in3_req_t* req) {
+  in3_flights_t* fl = req->client->flights;
+  if (!fl || req->len != 1 || req->type != RT_RPC || req->raw_response) return false;
+  char* key = flight_key(req);
+  if (!key) return false;
+  uint32_t      hash = in3_cache_hash(bytes((uint8_t*) key, strlen(key)));
+  char*         res  = NULL;
+  in3_flight_t* f    = NULL;
+
+  MUTEX_LOCK(fl->mutex)
+  for (f = fl->flights; f && (f->hash != hash || strcmp(f->key, key)); f = f->next) {}
+
+  if (!f) {
+    // nobody sends it yet, so we do
+    f         = _calloc(1, sizeof(in3_flight_t));
+    f->key    = key;
+    f->hash   = hash;
+    f->leader = req;
+    f->thread = THREAD_ID();
+    f->refs   = 1;
+    f->next   = fl->flights;
+    COND_INIT(f->cond)
+    fl->flights = f;
+    key         = NULL;
+  }
+  else if (f->leader != req && f->thread != THREAD_ID()) {
+    // wait for the leader, but never for a request of our own thread, which could not finish while we wait
+    in3_log_debug("waiting for identical request %s\n", f->key);
+    f->refs++;
+    while (!f->done) COND_WAIT(f->cond, fl->mutex)
+    if (f->result) res = _strdupn(f->result, -1);
+    flight_release(f);
+  }
+  MUTEX_UNLOCK(fl->mutex)
+  _free(key);
+
+  // if the leader failed, we try it on our own
+  if (!res) return false;
+
+  // the result was already verified, so we set it like an internal response.
+  req_set_internal_response(req, "result", res, -1);
+  _free(res);
+  return true;
+}
+
+void in3_flight_done(in3_req_t* req) {
+  in3_flights_t* fl = req->client->flights;
+  if (!fl) return;
+  MUTEX_LOCK(fl->mutex)
+  for (in3_flight_t** p = &fl->flights; *p; p = &(*p)->next) {
+    if ((*p)->leader != req) continue;
+    in3_flight_t* f = *p;
+    d_token_t*    r = req->verification_state == IN3_OK && req->responses && !(req->client->flags & FLAGS_BINARY) ? d_get(req->responses[0], K_RESULT) : NULL;
+    *p              = f->next;
+    f->result       = r ? d_create_json(req->response_context, r) : NULL;
+    f->leader       = NULL;
+    f->done         = true;
+    COND_BROADCAST(f->cond)
+    flight_release(f);
+    break;
+  }
+  MUTEX_UNLOCK(fl->mutex)
+}
+
+uint32_t in3_flights_waiting(in3_flights_t* fl) {
+  uint32_t n = 0;
+  MUTEX_LOCK(fl->mutex)
+  for (in3_flight_t* f = fl->flights; f; f = f->next) n += f->refs - 1; // the leader holds one ref
+  MUTEX_UNLOCK(fl->mutex)
+  return n;
+}
+
+#endif
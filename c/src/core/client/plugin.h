@@ -446,6 +446,29 @@ void in3_set_storage_handler(
     void*                cptr      /**< custom pointer which will will be passed to functions */
 );
 
+/**
+ * sets a storage handler keeping the cached values in memory.
+ *
+ * The values are shared between all requests of the client, and the least recently used will be removed
+ * if the size exceeds max_bytes. Values older than `cache_timeout` seconds (if set) are not used anymore.
+ * This replaces any storage handler set with in3_set_storage_handler().
+ * If a memory cache is already set, all values are removed and only the size changes.
+ * A max_bytes of 0 turns the cache off without restoring the previous storage handler.
+ *
+ * This is also used by the `memoryCache` config.
+ */
+NONULL void in3_set_memory_cache(
+    in3_t* c,        /**< the incubed client */
+    size_t max_bytes /**< max number of bytes for all cached keys and values */
+);
+
+/**
+ * returns the max number of bytes of the memory cache set with in3_set_memory_cache() or 0 if there is none.
+ */
+NONULL size_t in3_get_memory_cache(
+    in3_t* c /**< the incubed client */
+);
+
 // ----------- VERIFY --------------
 
 #ifdef LOGGING
@@ -74,6 +74,10 @@ in3_req_t* req_new_clone(in3_t* client, const char* req_data) {
   return r;
 }
 
+void* req_alloc(in3_req_t* req, size_t size) {
+  return arena_alloc(&req->arena, size);
+}
+
 void in3_set_chain_id(in3_req_t* req, chain_id_t id) {
   if (!id || in3_chain_id(req) == id) return;
 
@@ -127,7 +131,7 @@ in3_req_t* req_new(in3_t* client, const char* req_data) {
   client->pending++;
 
   if (req_data != NULL) {
-    ctx->request_context = parse_json(req_data);
+    ctx->request_context = parse_json_arena(req_data, &ctx->arena);
     if (!ctx->request_context) {
       in3_log_error("Invalid json-request: %s\n", req_data);
       req_set_error(ctx, "Error parsing the JSON-request!", IN3_EINVAL);
@@ -139,9 +143,10 @@ in3_req_t* req_new(in3_t* client, const char* req_data) {
       return ctx;
     }
 
+    // the responses are stored right behind the requests, so all attempts use the same array (see req_response_array)
     if (d_type(ctx->request_context->result) == T_OBJECT) {
       // it is a single result
-      ctx->requests    = _malloc(sizeof(d_token_t*));
+      ctx->requests    = req_alloc(ctx, sizeof(d_token_t*) * 2);
       ctx->requests[0] = ctx->request_context->result;
       ctx->len         = 1;
     }
@@ -149,7 +154,7 @@ in3_req_t* req_new(in3_t* client, const char* req_data) {
       // we have an array, so we need to store the request-data as array
       d_token_t* t  = d_get_at(ctx->request_context->result, 0);
       ctx->len      = d_len(ctx->request_context->result);
-      ctx->requests = _malloc(sizeof(d_token_t*) * ctx->len);
+      ctx->requests = req_alloc(ctx, sizeof(d_token_t*) * ctx->len * 2);
       for (uint_fast16_t i = 0; i < ctx->len; i++, t = d_next(t))
         ctx->requests[i] = t;
     }
@@ -359,6 +364,19 @@ sb_t* in3_rpc_handle_start(in3_rpc_handle_ctx_t* hctx) {
   sb_add_int(&(*hctx->response)->data, hctx->req->id);
   return sb_add_chars(&(*hctx->response)->data, ",\"jsonrpc\":\"2.0\",\"result\":");
 }
+void req_set_internal_response(in3_req_t* req, const char* prop, const char* json, int len) {
+  if (req->nodes) in3_req_free_nodes(req->nodes);
+  req->nodes        = NULL;
+  req->raw_response = _calloc(1, sizeof(in3_response_t));
+  sb_add_chars(&req->raw_response->data, "{\"id\":");
+  sb_add_int(&req->raw_response->data, req->id);
+  sb_add_chars(&req->raw_response->data, ",\"jsonrpc\":\"2.0\",\"");
+  sb_add_chars(&req->raw_response->data, prop);
+  sb_add_chars(&req->raw_response->data, "\":");
+  sb_add_range(&req->raw_response->data, json, 0, len < 0 ? (int) strlen(json) : len);
+  sb_add_char(&req->raw_response->data, '}');
+}
+
 in3_ret_t in3_rpc_handle_finish(in3_rpc_handle_ctx_t* hctx) {
   sb_add_char(&(*hctx->response)->data, '}');
   return IN3_OK;
@@ -67,6 +67,13 @@ NONULL void request_free(
     in3_http_request_t* req /**< [in] the request. */
 );
 
+/**
+ * handles a RT_SIGN-request by calling the signer-plugin and sets the signature as raw_response.
+ */
+NONULL in3_ret_t in3_handle_sign(
+    in3_req_t* req /**< [in] the sign request context. */
+);
+
 /**
  * sets the error message in the context.
  *
@@ -124,8 +131,84 @@ NONULL in3_ret_t in3_retry_same_node(in3_req_t* req);
   assert(r->state != IN3_OK || r->data.data);
 
 NONULL void in3_req_free_nodes(node_match_t* c);
+
+/**
+ * returns the array for the responses, which is allocated in the arena together with the requests (see req_new) and reused for each attempt.
+ */
+NONULL static inline d_token_t** req_response_array(in3_req_t* req) {
+  return req->requests + req->len;
+}
+
+/**
+ * sets an already verified result (prop="result") or error (prop="error") as response, the same way internal handlers do.
+ * Already selected nodes are released, since the request is not sent anymore.
+ */
+NONULL void req_set_internal_response(in3_req_t* req, const char* prop, const char* json, int len);
 int         req_nodes_len(node_match_t* root);
 NONULL bool req_is_method(const in3_req_t* req, const char* method);
 in3_ret_t   req_send_sign_request(in3_req_t* ctx, d_digest_type_t type, d_curve_type_t curve_type, d_payload_type_t pl_type, bytes_t* signature, bytes_t raw_data, bytes_t from, d_token_t* meta, bytes_t cache_key);
 
+#ifdef THREADSAFE
+/**
+ * creates the list of requests currently sent by a client.
+ */
+in3_flights_t* in3_flights_new();
+
+/**
+ * frees the list of requests currently sent.
+ */
+void in3_flights_free(in3_flights_t* flights);
+
+/**
+ * checks, if an identical request is currently sent by another thread.
+ *
+ * In this case it waits for its verified result and sets it as response, otherwise the request will be registered,
+ * so others can wait for it. Returns true if the response was set.
+ */
+NONULL bool in3_flight_join(in3_req_t* req);
+
+/**
+ * passes the result of a sent request to all requests waiting for it.
+ * If the request did not get a verified result, the waiting requests will send it themselves.
+ */
+NONULL void in3_flight_done(in3_req_t* req);
+
+/**
+ * returns the number of requests currently waiting for the result of an identical request.
+ */
+NONULL uint32_t in3_flights_waiting(in3_flights_t* flights);
+
+/**
+ * returns true if the method has no side effects, so its response may be shared with or batched for other requests.
+ */
+NONULL bool in3_is_read_only(const char* method);
+
+/**
+ * creates the batches collecting requests from different threads.
+ */
+in3_batches_t* in3_batches_new();
+
+/**
+ * frees the batches.
+ */
+void in3_batches_free(in3_batches_t* batches);
+
+/**
+ * collects the request with requests from other threads within the configured batch-window and sends them as one batch.
+ * Returns true if the verified response was set.
+ */
+NONULL bool in3_batch_join(in3_req_t* req);
+
+/**
+ * returns the number of requests in the batch currently collecting requests.
+ */
+NONULL uint16_t in3_batches_open_len(in3_batches_t* batches);
+#else
+#define in3_flights_free(flights) ((void) 0)
+#define in3_flight_join(req)      false
+#define in3_flight_done(req)      ((void) 0)
+#define in3_batches_free(batches) ((void) 0)
+#define in3_batch_join(req)       false
+#endif
+
 #endif // REQ_INTERNAL_H
\ No newline at end of file
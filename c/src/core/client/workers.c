@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "workers.h"
+#include "../util/mem.h"
+#include "client.h"
+
+#ifdef IN3_WORKERS
+#include <pthread.h>
+
+struct in3_workers {
+  pthread_t*      threads;  /**< the worker threads */
+  uint32_t        len;      /**< number of worker threads */
+  bool            stop;     /**< if true the threads will end */
+  in3_work_fn     fn;       /**< the function of the current job */
+  void*           ctx;      /**< the context of the current job */
+  uint32_t        size;     /**< number of items of the current job */
+  uint32_t        next;     /**< the next item, which was not taken yet */
+  uint32_t        pending;  /**< number of items not finished yet */
+  pthread_mutex_t mutex;    /**< protects the job */
+  pthread_mutex_t running;  /**< held while a job is running, so only one thread uses the workers at a time */
+  pthread_cond_t  has_work; /**< signaled when a new job starts or the threads should stop */
+  pthread_cond_t  done;     /**< signaled when all items of the job are finished */
+};
+
+typedef struct {
+  in3_workers_t* workers;
+  uint32_t       index;
+} worker_arg_t;
+
+/**
+ * takes the next items of the current job until there are none left.
+ * Since every thread takes the next free item, threads finishing early simply take over the remaining work.
+ * The mutex must be locked.
+ */
+static void work(in3_workers_t* w, uint32_t worker) {
+  while (w->next < w->size) {
+    uint32_t    i   = w->next++;
+    in3_work_fn fn  = w->fn;
+    void*       ctx = w->ctx;
+    pthread_mutex_unlock(&w->mutex);
+    fn(ctx, i, worker);
+    pthread_mutex_lock(&w->mutex);
+    if (--w->pending == 0) pthread_cond_broadcast(&w->done);
+  }
+}
+
+static void* worker_run(void* p) {
+  worker_arg_t   arg = *((worker_arg_t*) p);
+  in3_workers_t* w   = arg.workers;
+  _free(p);
+  pthread_mutex_lock(&w->mutex);
+  while (!w->stop) {
+    if (w->next < w->size)
+      work(w, arg.index);
+    else
+      pthread_cond_wait(&w->has_work, &w->mutex);
+  }
+  pthread_mutex_unlock(&w->mutex);
+  return NULL;
+}
+
+in3_workers_t* in3_workers_new(uint32_t threads) {
+  if (threads < 2) return NULL;
+  in3_workers_t* w = _calloc(1, sizeof(in3_workers_t));
+  pthread_mutex_init(&w->mutex, NULL);
+  pthread_mutex_init(&w->running, NULL);
+  pthread_cond_init(&w->has_work, NULL);
+  pthread_cond_init(&w->done, NULL);
+
+  // the thread calling in3_workers_run is also working, so we need one thread less.
+  w->threads = _malloc((threads - 1) * sizeof(pthread_t));
+  for (uint32_t i = 0; i < threads - 1; i++) {
+    worker_arg_t* arg = _malloc(sizeof(worker_arg_t));
+    arg->workers      = w;
+    arg->index        = i + 1;
+    if (pthread_create(w->threads + w->len, NULL, worker_run, arg)) {
+      _free(arg);
+      break;
+    }
+    w->len++;
+  }
+  return w;
+}
+
+void in3_workers_free(in3_workers_t* w) {
+  if (!w) return;
+  pthread_mutex_lock(&w->mutex);
+  w->stop = true;
+  pthread_cond_broadcast(&w->has_work);
+  pthread_mutex_unlock(&w->mutex);
+  for (uint32_t i = 0; i < w->len; i++) pthread_join(w->threads[i], NULL);
+  pthread_mutex_destroy(&w->mutex);
+  pthread_mutex_destroy(&w->running);
+  pthread_cond_destroy(&w->has_work);
+  pthread_cond_destroy(&w->done);
+  _free(w->threads);
+  _free(w);
+}
+
+uint32_t in3_workers_count(in3_t* c) {
+  return c->workers ? c->workers->len + 1 : 1;
+}
+
+void in3_workers_run(in3_t* c, in3_work_fn fn, void* ctx, uint32_t len) {
+  in3_workers_t* w = c->workers;
+
+  // if another thread is already using the workers, we don't wait for them, but do the work ourself.
+  if (!w || len < 2 || pthread_mutex_trylock(&w->running)) {
+    for (uint32_t i = 0; i < len; i++) fn(ctx, i, 0);
+    return;
+  }
+
+  pthread_mutex_lock(&w->mutex);
+  w->fn      = fn;
+  w->ctx     = ctx;
+  w->size    = len;
+  w->next    = 0;
+  w->pending = len;
+  pthread_cond_broadcast(&w->has_work);
+  work(w, 0);
+  while (w->pending) pthread_cond_wait(&w->done, &w->mutex);
+  w->size = w->next = 0;
+  pthread_mutex_unlock(&w->mutex);
+  pthread_mutex_unlock(&w->running);
+}
+
+#else
+
+in3_workers_t* in3_workers_new(uint32_t threads) {
+  UNUSED_VAR(threads);
+  return NULL;
+}
+
+void in3_workers_free(in3_workers_t* w) {
+  UNUSED_VAR(w);
+}
+
+uint32_t in3_workers_count(in3_t* c) {
+  UNUSED_VAR(c);
+  return 1;
+}
+
+void in3_workers_run(in3_t* c, in3_work_fn fn, void* ctx, uint32_t len) {
+  UNUSED_VAR(c);
+  for (uint32_t i = 0; i < len; i++) fn(ctx, i, 0);
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * threads of the client used to verify independent parts of a response in parallel.
+ * */
+
+#ifndef IN3_WORKERS_H
+#define IN3_WORKERS_H
+
+#include "../util/mem.h"
+#include "client.h"
+
+#if defined(THREADSAFE) && !defined(_MSC_VER) && !defined(__MINGW32__)
+#define IN3_WORKERS
+#endif
+
+/**
+ * the function handling one item of a job.
+ *
+ * \param ctx the context passed to in3_workers_run
+ * \param index the index of the item
+ * \param worker the index of the thread (0 - in3_workers_count()-1), which can be used for data owned by each thread.
+ */
+typedef void (*in3_work_fn)(void* ctx, uint32_t index, uint32_t worker);
+
+/**
+ * starts the threads.
+ *
+ * Since the thread calling in3_workers_run also takes part, `threads-1` threads are created.
+ * Returns NULL if less than 2 threads are requested or the client is not built threadsafe.
+ */
+in3_workers_t* in3_workers_new(uint32_t threads);
+
+/**
+ * stops the threads and frees the workers.
+ */
+void in3_workers_free(in3_workers_t* workers);
+
+/**
+ * returns the number of threads working on a job including the calling thread.
+ */
+NONULL uint32_t in3_workers_count(in3_t* c);
+
+/**
+ * calls fn for each item from 0 to len-1 and returns when all are finished.
+ *
+ * The items are taken by all threads of the client as soon as they are idle, so the function must be threadsafe.
+ * If the client has no workers or they are used by another request, the items are handled by the calling thread.
+ */
+NONULL_FOR((1, 2))
+void in3_workers_run(in3_t* c, in3_work_fn fn, void* ctx, uint32_t len);
+
+#endif
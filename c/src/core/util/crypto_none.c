@@ -81,6 +81,15 @@ in3_ret_t crypto_recover(in3_curve_type_t type, const bytes_t digest, bytes_t si
   UNUSED_VAR(dst);
   return IN3_ENOTSUP;
 }
+in3_ret_t crypto_recover_batch(in3_curve_type_t type, unsigned int len, const bytes_t* digests, const bytes_t* signatures, uint8_t* pubkeys, in3_ret_t* results) {
+  in3_ret_t res = IN3_OK;
+  for (unsigned int i = 0; i < len; i++) {
+    in3_ret_t r = crypto_recover(type, digests[i], signatures[i], pubkeys + i * 64);
+    if (results) results[i] = r;
+    if (r) res = IN3_EINVAL;
+  }
+  return res;
+}
 in3_ret_t crypto_convert(in3_curve_type_t type, in3_convert_type_t conv_type, bytes_t src, uint8_t* dst, int* dst_len) {
   UNUSED_VAR(type);
   UNUSED_VAR(conv_type);
@@ -2,6 +2,7 @@
 #include "crypto.h"
 #include "debug.h"
 #include "mem.h"
+#include "secp256k1_recover.h"
 #include "utils.h"
 #include <stdint.h>
 #include <stdlib.h>
@@ -114,10 +115,15 @@ in3_ret_t crypto_sign_digest(in3_curve_type_t type, const bytes_t digest, const
 in3_ret_t crypto_recover(in3_curve_type_t type, const bytes_t digest, bytes_t signature, uint8_t* dst) {
   switch (type) {
     case ECDSA_SECP256K1: {
+      if (digest.len != 32 || signature.len != 65) return IN3_EINVAL;
+#ifdef SECP256K1_RECOVER_FAST
+      return secp256k1_recover(signature.data, digest.data, dst) ? IN3_EINVAL : IN3_OK;
+#else
       uint8_t pub[65] = {0};
       if (ecdsa_recover_pub_from_sig(&secp256k1, pub, signature.data, digest.data, signature.data[64] % 27)) return IN3_EINVAL;
       memcpy(dst, pub + 1, 64);
       return IN3_OK;
+#endif
     }
 #ifdef ED25519
     case EDDSA_ED25519: {
@@ -127,6 +133,34 @@ in3_ret_t crypto_recover(in3_curve_type_t type, const bytes_t digest, bytes_t si
     default: return IN3_ENOTSUP;
   }
 }
+in3_ret_t crypto_recover_batch(in3_curve_type_t type, unsigned int len, const bytes_t* digests, const bytes_t* signatures, uint8_t* pubkeys, in3_ret_t* results) {
+  in3_ret_t res = IN3_OK;
+#ifdef SECP256K1_RECOVER_FAST
+  // signatures with a wrong length are rejected one by one below
+  bool batch = type == ECDSA_SECP256K1 && len > 1;
+  for (unsigned int i = 0; i < len && batch; i++) batch = digests[i].len == 32 && signatures[i].len == 65;
+  if (batch) {
+    const uint8_t** data = _malloc(len * 2 * sizeof(uint8_t*));
+    int*            rs   = _malloc(len * sizeof(int));
+    for (unsigned int i = 0; i < len; i++) {
+      data[i]       = signatures[i].data;
+      data[len + i] = digests[i].data;
+    }
+    if (secp256k1_recover_batch(len, data, data + len, pubkeys, rs)) res = IN3_EINVAL;
+    for (unsigned int i = 0; i < len && results; i++) results[i] = rs[i] ? IN3_EINVAL : IN3_OK;
+    _free(data);
+    _free(rs);
+    return res;
+  }
+#endif
+  for (unsigned int i = 0; i < len; i++) {
+    in3_ret_t r = crypto_recover(type, digests[i], signatures[i], pubkeys + i * 64);
+    if (results) results[i] = r;
+    if (r) res = IN3_EINVAL;
+  }
+  return res;
+}
+
 static in3_ret_t crypto_pk_to_public_key(in3_curve_type_t type, const uint8_t* pk, uint8_t* dst) {
   switch (type) {
     case ECDSA_SECP256K1: {
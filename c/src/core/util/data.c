@@ -46,6 +46,10 @@
 #ifdef LOGGING
 #include "used_keys.h"
 #endif
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define IN3_SSE2
+#endif
 // Here we check the pointer-size, because pointers smaller than 32bit may result in a undefined behavior, when calling d_bytes() for a T_INTEGER
 // verify(sizeof(void*) >= 4);
 
@@ -103,14 +107,26 @@ static d_key_t add_key(json_ctx_t* ctx, const char* name, size_t len) {
   return (d_key_t) k + 1;
 }
 
+/** stores the number of tokens of the subtree in the state, if it fits. */
+static inline void set_token_size(d_token_t* item, size_t size) {
+  if (size <= TOKEN_STATE_SIZE_MAX) item->state = (item->state & ((1 << TOKEN_STATE_SIZE_SHIFT) - 1)) | size << TOKEN_STATE_SIZE_SHIFT;
+}
+
+/** returns the number of tokens of the subtree without a function call for primitives or objects with a known size. */
+static inline size_t token_size(const d_token_t* item) {
+  if ((item->len & 0xE0000000) != 0x20000000) return 1; // neither an array nor an object
+  return (item->state >> TOKEN_STATE_SIZE_SHIFT) ? (size_t) (item->state >> TOKEN_STATE_SIZE_SHIFT) : d_token_size(item);
+}
+
 size_t d_token_size(const d_token_t* item) {
   if (item == NULL) return 0;
   size_t i, c = 1;
   switch (d_type(item)) {
     case T_ARRAY:
     case T_OBJECT:
+      if (item->state >> TOKEN_STATE_SIZE_SHIFT) return item->state >> TOKEN_STATE_SIZE_SHIFT;
       for (i = 0; i < (item->len & 0xFFFFFFF); i++)
-        c += d_token_size(item + c);
+        c += token_size(item + c);
       return c;
     default:
       return 1;
@@ -166,15 +182,7 @@ bytes_t d_bytes(d_token_t* item) {
       if (item->state & TOKEN_STATE_CONVERTED) return bytes(item->data, l);
 
       // is it a hex-string?
-      bool ishex = l > 1 && *start == '0' && start[1] == 'x';
-      if (ishex)
-        for (int n = 2; n < l; n++) {
-          char cc = start[n];
-          if (!((cc >= '0' && cc <= '9') || (cc >= 'a' && cc <= 'f') || (cc >= 'A' && cc <= 'F'))) {
-            ishex = false;
-            break;
-          }
-        }
+      bool ishex = l > 1 && *start == '0' && start[1] == 'x' && is_hex_chars(start + 2, l - 2);
       if (!ishex) {
         item->state |= TOKEN_STATE_CONVERTED;
         return bytes(item->data, l);
@@ -350,7 +358,7 @@ d_token_t* d_get(d_token_t* item, const uint16_t key) {
   if (item == NULL || (item->len & 0xF0000000) != 0x30000000) return NULL; // is it an object?
   int i = 0, l = item->len & 0xFFFFFFF;                                    // l is the number of properties in the object
   item += 1;                                                               // we start with the first, which is the next token
-  for (; i < l; i++, item += d_token_size(item)) {                         // and iterate through all
+  for (; i < l; i++, item += token_size(item)) {                           // and iterate through all
     if (item->key == key) return item;                                     // until we find the one with the matching key
   }
   return NULL;
@@ -360,7 +368,7 @@ d_token_t* d_get_or(d_token_t* item, const uint16_t key, const uint16_t key2) {
   d_token_t* s = NULL;
   int        i = 0, l = item->len & 0xFFFFFFF;
   item += 1;
-  for (; i < l; i++, item += d_token_size(item)) {
+  for (; i < l; i++, item += token_size(item)) {
     if (item->key == key) return item;
     if (item->key == key2) s = item;
   }
@@ -370,15 +378,17 @@ d_token_t* d_get_or(d_token_t* item, const uint16_t key, const uint16_t key2) {
 d_token_t* d_get_at(d_token_t* item, const uint32_t index) {
   if (item == NULL || (item->len & 0xF0000000) != 0x20000000) return NULL; // is it an array?
   uint32_t i = 0, l = item->len & 0xFFFFFFF;
+  if (index >= l) return NULL;
+  if ((item->state >> TOKEN_STATE_SIZE_SHIFT) == l + 1) return item + 1 + index; // only primitive values, so we can access it directly
   item += 1;
-  for (; i < l; i++, item += d_token_size(item)) {
+  for (; i < l; i++, item += token_size(item)) {
     if (i == index) return item;
   }
   return NULL;
 }
 
 d_token_t* d_next(d_token_t* item) {
-  return item == NULL ? NULL : item + d_token_size(item);
+  return item == NULL ? NULL : item + token_size(item);
 }
 
 static NONULL char next_char(json_ctx_t* jp) {
@@ -396,9 +406,17 @@ static NONULL char next_char(json_ctx_t* jp) {
   }
 }
 
+/** allocates the data of a token, which only needs to be freed if it is not allocated within the arena. */
+static inline uint8_t* token_alloc(json_ctx_t* jp, d_token_t* item, size_t len) {
+  item->state = jp->arena ? TOKEN_STATE_CONVERTED : (TOKEN_STATE_CONVERTED | TOKEN_STATE_ALLOCATED);
+  return jp->arena ? arena_alloc(jp->arena, len) : _malloc(len);
+}
+
 static RETURNS_NONULL NONULL d_token_t* parsed_next_item(json_ctx_t* jp, d_type_t type, d_key_t key, int parent) {
   if (jp->len + 1 > jp->allocated) {
-    jp->result = _realloc(jp->result, (jp->allocated << 1) * sizeof(d_token_t), jp->allocated * sizeof(d_token_t));
+    jp->result = jp->arena
+                     ? arena_realloc(jp->arena, jp->result, (jp->allocated << 1) * sizeof(d_token_t), jp->allocated * sizeof(d_token_t))
+                     : _realloc(jp->result, (jp->allocated << 1) * sizeof(d_token_t), jp->allocated * sizeof(d_token_t));
     jp->allocated <<= 1;
   }
   d_token_t* n = jp->result + jp->len;
@@ -421,7 +439,7 @@ static NONULL int parse_key(json_ctx_t* jp) {
         r = add_key(jp, start, jp->c - start - 1);
         return next_char(jp) == ':' ? r : -2;
       case '\\':
-        jp->c++;
+        if (!*(jp->c++)) return JSON_E_END_OF_STRING; // we must not skip the terminating 0
         break;
     }
   }
@@ -459,9 +477,8 @@ static NONULL int parse_number(json_ctx_t* jp, d_token_t* item) {
               jp->c += i;
               return JSON_E_INVALID_CHAR;
           }
-          item->state = TOKEN_STATE_CONVERTED | TOKEN_STATE_ALLOCATED;
-          item->data  = _malloc(i + 1);
-          item->len   = T_STRING << 28 | (unsigned) i;
+          item->data = token_alloc(jp, item, i + 1);
+          item->len  = T_STRING << 28 | (unsigned) i;
           memcpy(item->data, jp->c, i);
           item->data[i] = 0;
           break;
@@ -484,9 +501,8 @@ static NONULL int parse_number(json_ctx_t* jp, d_token_t* item) {
             long_to_bytes(value, tmp);
             uint8_t *p = tmp, len = 8;
             optimize_len(p, len);
-            item->state = TOKEN_STATE_CONVERTED | TOKEN_STATE_ALLOCATED;
-            item->data  = _malloc(len);
-            item->len   = T_BYTES << 28 | len;
+            item->data = token_alloc(jp, item, len);
+            item->len  = T_BYTES << 28 | len;
             memcpy(item->data, p, len);
           }
           break;
@@ -502,12 +518,34 @@ static NONULL int parse_number(json_ctx_t* jp, d_token_t* item) {
   return JSON_E_NUMBER_TOO_LONG;
 }
 
+#ifdef IN3_SSE2
+/**
+ * returns the next quote, backslash or 0 starting at c, checking 16 chars at once.
+ *
+ * Since we only use aligned loads, which never cross a page boundary, reading beyond the terminating 0 is safe,
+ * but the address sanitizer would still complain about it.
+ */
+__attribute__((no_sanitize_address)) static const char* find_string_special(const char* c) {
+  const uintptr_t offset = (uintptr_t) c & 15;
+  const __m128i*  p      = (const __m128i*) (c - offset);
+  for (uint32_t mask = 0xFFFF << offset;; p++, mask = 0xFFFF) {
+    const __m128i x = _mm_load_si128(p);
+    mask &= _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\''))),
+                                           _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\')), _mm_cmpeq_epi8(x, _mm_setzero_si128()))));
+    if (mask) return (const char*) p + __builtin_ctz(mask);
+  }
+}
+#endif
+
 static NONULL int parse_string(json_ctx_t* jp, d_token_t* item) {
   char*  start = jp->c;
   size_t l;
   int    escape = 0;
 
   while (true) {
+#ifdef IN3_SSE2
+    jp->c = (char*) find_string_special(jp->c);
+#endif
     switch (*(jp->c++)) {
       case 0:
         return JSON_E_END_OF_STRING;
@@ -516,9 +554,8 @@ static NONULL int parse_string(json_ctx_t* jp, d_token_t* item) {
         if (start[-1] != jp->c[-1]) continue; // is the kind of quote the same as the quote we used to start the string?
         l = jp->c - start - 1;
         if (l == 6 && *start == '\\' && start[1] == 'u') {
-          item->state = TOKEN_STATE_ALLOCATED | TOKEN_STATE_CONVERTED;
           item->len   = 1;
-          item->data  = _malloc(1);
+          item->data  = token_alloc(jp, item, 1);
           *item->data = hexchar_to_int(start[4]) << 4 | hexchar_to_int(start[5]);
         }
         else {
@@ -529,20 +566,19 @@ static NONULL int parse_string(json_ctx_t* jp, d_token_t* item) {
           }
           l -= escape;
           item->len  = l | T_STRING << 28;
-          item->data = escape ? _malloc(l + 1) : start;
+          item->data = escape ? token_alloc(jp, item, l + 1) : (uint8_t*) start;
           if (escape) {
             char* x = start;
             for (size_t n = 0; n < l; n++, x++) {
               if (*x == '\\') x++;
               item->data[n] = *x;
             }
-            item->state   = TOKEN_STATE_ALLOCATED | TOKEN_STATE_CONVERTED;
             item->data[l] = 0;
           }
         }
         return 0;
       case '\\':
-        jp->c++;
+        if (!*(jp->c++)) return JSON_E_END_OF_STRING; // we must not skip the terminating 0
         escape++;
         break;
     }
@@ -569,6 +605,7 @@ static NONULL int parse_object(json_ctx_t* jp, int parent, uint32_t key) {
             break;
           case '}': {
             jp->depth--;
+            set_token_size(jp->result + p_index, jp->len - p_index);
             return 0;
           }
           default:
@@ -580,6 +617,7 @@ static NONULL int parse_object(json_ctx_t* jp, int parent, uint32_t key) {
           case ',': break; // we continue reading the next property
           case '}': {
             jp->depth--;
+            set_token_size(jp->result + p_index, jp->len - p_index);
             return 0; // this was the last property, so we return successfully.
           }
           default:
@@ -591,6 +629,7 @@ static NONULL int parse_object(json_ctx_t* jp, int parent, uint32_t key) {
       parsed_next_item(jp, T_ARRAY, key, parent)->data = (uint8_t*) jp->c - 1;
       if (next_char(jp) == ']') {
         jp->depth--;
+        set_token_size(jp->result + p_index, 1);
         return 0;
       }
       jp->c--;
@@ -602,6 +641,7 @@ static NONULL int parse_object(json_ctx_t* jp, int parent, uint32_t key) {
           case ',': break; // we continue reading the next property
           case ']': {
             jp->depth--;
+            set_token_size(jp->result + p_index, jp->len - p_index);
             return 0; // this was the last element, so we return successfully.
           }
           default:
@@ -660,6 +700,7 @@ void json_free(json_ctx_t* jp) {
       _free(jp->result[i].data);
   }
   if (jp->keys) _free(jp->keys);
+  if (jp->arena) return; // the tokens and the context are freed with the arena
   _free(jp->result);
   _free(jp);
 }
@@ -710,6 +751,18 @@ json_ctx_t* parse_json(const char* js) {
   return parser;
 }
 
+json_ctx_t* parse_json_arena(const char* js, in3_arena_t* arena) {
+  json_ctx_t* parser = arena_alloc(arena, sizeof(json_ctx_t));
+  *parser            = (json_ctx_t){.c = (char*) js, .allocated = JSON_INIT_TOKENS, .arena = arena};
+  parser->result     = arena_alloc(arena, sizeof(d_token_t) * JSON_INIT_TOKENS); // the tokens grow within the arena
+  if (parse_object(parser, -1, 0) < 0) {
+    json_free(parser); // only tokens converted are freed, the rest stays in the arena
+    return NULL;
+  }
+  parser->c = (char*) js; // since this pointer changed during parsing, we set it back to the original string
+  return parser;
+}
+
 json_ctx_t* parse_json_indexed(const char* js) {
   json_ctx_t* parser = _calloc(1, sizeof(json_ctx_t));                // new parser
   parser->c          = (char*) js;                                    // the pointer to the string to parse
@@ -725,6 +778,169 @@ json_ctx_t* parse_json_indexed(const char* js) {
   return parser;
 }
 
+/** what the stream-parser expects as next char */
+typedef enum {
+  STREAM_VALUE,        /**< a value after a colon or comma */
+  STREAM_VALUE_OR_END, /**< the first value of an array or the end of an empty array */
+  STREAM_KEY,          /**< a property name after a comma */
+  STREAM_KEY_OR_END,   /**< the first property name of an object or the end of an empty object */
+  STREAM_NEXT          /**< a comma or the end of the current container */
+} stream_expect_t;
+
+struct json_stream {
+  json_ctx_t*     jp;                          /**< the context holding all tokens parsed so far */
+  uintptr_t       base;                        /**< the address of the buffer the tokens are pointing to */
+  size_t          pos;                         /**< offset of the first char which was not parsed yet */
+  int             error;                       /**< the first error found or 0 */
+  bool            done;                        /**< true if the root value is complete */
+  stream_expect_t expect;                      /**< what we expect next */
+  d_key_t         key;                         /**< the key of the next property */
+  uint32_t        depth;                       /**< number of open containers */
+  int             parents[DATA_DEPTH_MAX + 2]; /**< the token-index of all open containers */
+};
+
+json_stream_t* json_stream_new() {
+  json_stream_t* s = _calloc(1, sizeof(json_stream_t));
+  s->jp            = _calloc(1, sizeof(json_ctx_t));
+  s->jp->allocated = JSON_INIT_TOKENS;
+  s->jp->result    = _malloc(sizeof(d_token_t) * JSON_INIT_TOKENS);
+  return s;
+}
+
+void json_stream_free(json_stream_t* s) {
+  if (!s) return;
+  json_free(s->jp);
+  _free(s);
+}
+
+/** since the buffer may be moved when growing, all tokens pointing into it need to be fixed. */
+static void stream_rebase(json_stream_t* s, char* data) {
+  const uintptr_t base = (uintptr_t) data;
+  if (base == s->base) return;
+  for (size_t i = 0; i < s->jp->len; i++) {
+    d_token_t* t = s->jp->result + i;
+    if (t->data && !(t->state & TOKEN_STATE_ALLOCATED)) t->data = (uint8_t*) (base + ((uintptr_t) t->data - s->base));
+  }
+  s->base = base;
+}
+
+/** checks whether a primitive value starting at c is already complete, since the parser would accept a truncated number. Incomplete strings are detected by the parser. */
+static bool stream_leaf_complete(const char* c) {
+  switch (*c) {
+    case '"':
+    case '\'':
+      return true;
+    case 't':
+    case 'n':
+      return memchr(c, 0, 4) == NULL;
+    case 'f':
+      return memchr(c, 0, 5) == NULL;
+    default:
+      while ((*c >= '0' && *c <= '9') || *c == '.' || *c == '-' || *c == '+' || *c == 'e' || *c == 'E') c++;
+      return *c != 0;
+  }
+}
+
+/** removes the tokens created by an incomplete value, so we can parse it again, once we have more data. */
+static void stream_rollback(json_ctx_t* jp, size_t len, int parent) {
+  for (; jp->len > len; jp->len--) {
+    d_token_t* t = jp->result + jp->len - 1;
+    if (t->data && (t->state & TOKEN_STATE_ALLOCATED)) _free(t->data);
+    if (parent >= 0) jp->result[parent].len--;
+  }
+}
+
+static int stream_parse(json_stream_t* s, char* data, size_t len, bool final) {
+  json_ctx_t* jp = s->jp;
+  stream_rebase(s, data);
+  if (s->error || s->done) return s->error ? s->error : 1;
+
+  const char* end = data + len;
+  jp->c           = data + s->pos;
+  while (true) {
+    const char c = next_char(jp);
+    s->pos       = --jp->c - data; // we only continue from here, if the next value is complete
+    if (!c) return final ? (s->error = JSON_E_END_OF_STRING) : 0;
+
+    const int  parent    = s->depth ? s->parents[s->depth - 1] : -1;
+    const bool in_object = parent >= 0 && d_type(jp->result + parent) == T_OBJECT;
+    if ((c == '}' && s->expect == STREAM_KEY_OR_END) || (c == ']' && s->expect == STREAM_VALUE_OR_END)) s->expect = STREAM_NEXT;
+
+    switch (s->expect) {
+      case STREAM_NEXT:
+        jp->c++;
+        if (c == ',')
+          s->expect = in_object ? STREAM_KEY : STREAM_VALUE;
+        else if (parent >= 0 && c == (in_object ? '}' : ']')) {
+          set_token_size(jp->result + parent, jp->len - parent);
+          if (--s->depth == 0) {
+            s->done = true;
+            s->pos  = jp->c - data;
+            return 1;
+          }
+        }
+        else
+          return (s->error = JSON_E_INVALID_CHAR);
+        break;
+
+      case STREAM_KEY:
+      case STREAM_KEY_OR_END: {
+        if (c != '"') return (s->error = JSON_E_INVALID_CHAR);
+        jp->c++;
+        const int key = parse_key(jp);
+        if (key < 0) return (final || jp->c < end) ? (s->error = key) : 0;
+        s->key    = key;
+        s->expect = STREAM_VALUE;
+        break;
+      }
+
+      case STREAM_VALUE:
+      case STREAM_VALUE_OR_END: {
+        const d_key_t key = in_object ? s->key : (parent >= 0 ? d_len(jp->result + parent) : 0);
+        if (c == '{' || c == '[') {
+          if (s->depth > DATA_DEPTH_MAX) return (s->error = JSON_E_MAX_DEPTH);
+          s->parents[s->depth++] = jp->len;
+          s->expect              = c == '{' ? STREAM_KEY_OR_END : STREAM_VALUE_OR_END;
+          parsed_next_item(jp, c == '{' ? T_OBJECT : T_ARRAY, key, parent)->data = (uint8_t*) jp->c++;
+          break;
+        }
+
+        if (!final && !stream_leaf_complete(jp->c)) return 0;
+        const size_t tokens = jp->len;
+        jp->depth           = s->depth;
+        const int res       = parse_object(jp, parent, key);
+        if (res < 0) {
+          if (final || jp->c < end) return (s->error = res);
+          stream_rollback(jp, tokens, parent);
+          return 0;
+        }
+        s->expect = STREAM_NEXT;
+        if (!s->depth) {
+          s->done = true;
+          s->pos  = jp->c - data;
+          return 1;
+        }
+        break;
+      }
+    }
+  }
+}
+
+int json_stream_parse(json_stream_t* s, char* data, size_t len) {
+  return stream_parse(s, data, len, false);
+}
+
+json_ctx_t* json_stream_finish(json_stream_t* s, char* data, size_t len) {
+  json_ctx_t* jp = NULL;
+  if (stream_parse(s, data, len, true) == 1) {
+    jp    = s->jp;
+    jp->c = data;
+    s->jp = NULL;
+  }
+  json_stream_free(s);
+  return jp;
+}
+
 static int find_end(const char* str) {
   int         l = 0;
   const char* c = str;
@@ -885,7 +1101,8 @@ static int read_token(json_ctx_t* jp, const uint8_t* d, size_t* p, size_t max) {
     return 0;
   }
 
-  d_token_t* t = next_item(jp, type, len);
+  const size_t idx = jp->len;
+  d_token_t*   t   = next_item(jp, type, len);
   switch (type) {
     case T_ARRAY:
       for (i = 0; i < len; i++) {
@@ -894,6 +1111,7 @@ static int read_token(json_ctx_t* jp, const uint8_t* d, size_t* p, size_t max) {
         assert(ll < jp->allocated);
         jp->result[ll].key = i;
       }
+      set_token_size(jp->result + idx, jp->len - idx); // t may have been moved while reading the children
       break;
     case T_OBJECT:
       for (i = 0; i < len; i++) {
@@ -905,6 +1123,7 @@ static int read_token(json_ctx_t* jp, const uint8_t* d, size_t* p, size_t max) {
         assert(ll < jp->allocated);
         jp->result[ll].key = key;
       }
+      set_token_size(jp->result + idx, jp->len - idx);
       break;
     case T_STRING:
       t->data = (uint8_t*) d + ((*p)++);
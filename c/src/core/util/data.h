@@ -84,6 +84,14 @@ typedef enum {
  * The data has been converted, which means in case of an string, it does not point to the original anymore.
  */
 #define TOKEN_STATE_CONVERTED 2
+/**
+ * for objects and arrays the upper bits of the state hold the number of tokens of the subtree including the token itself,
+ * so skipping it does not need to walk its children. 0 means unknown, which is the case for tokens created with `json_create_object()`
+ * or `json_create_array()` and for subtrees larger than TOKEN_STATE_SIZE_MAX tokens.
+ */
+#define TOKEN_STATE_SIZE_SHIFT 2
+/** the max subtree size which can be stored in the state of a token */
+#define TOKEN_STATE_SIZE_MAX 0x3FFF
 
 /** a token holding any kind of value.
  *
@@ -115,15 +123,23 @@ typedef struct str_range {
 
 /** parser for json or binary-data. it needs to freed after usage.*/
 typedef struct json_parser {
-  d_token_t* result;    /**< the list of all tokens. the first token is the main-token as returned by the parser.*/
-  char*      c;         /**< pointer to the src-data*/
-  size_t     allocated; /**< amount of tokens allocated result */
-  size_t     len;       /**< number of tokens in result */
-  size_t     depth;     /**< max depth of tokens in result */
-  uint8_t*   keys;      // key-data
-  size_t     keys_last; // points to the position of the last key.
+  d_token_t*   result;    /**< the list of all tokens. the first token is the main-token as returned by the parser.*/
+  char*        c;         /**< pointer to the src-data*/
+  size_t       allocated; /**< amount of tokens allocated result */
+  size_t       len;       /**< number of tokens in result */
+  size_t       depth;     /**< max depth of tokens in result */
+  uint8_t*     keys;      // key-data
+  size_t       keys_last; // points to the position of the last key.
+  in3_arena_t* arena;     /**< if set, the context and its tokens are allocated within the arena and freed with it. */
 } json_ctx_t;
 
+/**
+ * incremental json-parser, which creates the tokens while the data is still being received.
+ *
+ * The tokens point directly into the buffer passed, so no copy of the response is needed.
+ */
+typedef struct json_stream json_stream_t;
+
 /**
  *
  * returns the byte-representation of token.
@@ -166,7 +182,12 @@ NONULL json_ctx_t* parse_binary_str(const char* data, int len);           /**< p
 NONULL char*       parse_json_error(const char* js);                      /**< parses the json, but only return an error if the json is invalid. The returning string must be freed! */
 NONULL json_ctx_t* parse_json(const char* js);                            /**< parses json-data, which needs to be freed after usage! */
 NONULL json_ctx_t* parse_json_indexed(const char* js);                    /**< parses json-data, which needs to be freed after usage! */
+NONULL json_ctx_t* parse_json_arena(const char* js, in3_arena_t* arena);  /**< parses json-data into the arena. json_free() only frees tokens converted later, the rest is freed with the arena. */
 NONULL void        json_free(json_ctx_t* parser_ctx);                     /**< frees the parse-context after usage */
+json_stream_t*     json_stream_new();                                     /**< creates a new stream-parser, which needs to be freed with json_stream_free or json_stream_finish. */
+NONULL int         json_stream_parse(json_stream_t* s, char* data, size_t len); /**< parses all data received so far (data must be 0-terminated and may have been moved since the last call). returns 1 if the value is complete, 0 if more data is needed or a negative value in case of an error */
+NONULL json_ctx_t* json_stream_finish(json_stream_t* s, char* data, size_t len); /**< parses the remaining data and returns the context if the value is complete or NULL if not. The stream is freed in both cases. */
+void               json_stream_free(json_stream_t* s);                    /**< frees the stream-parser with all tokens. */
 NONULL str_range_t d_to_json(const d_token_t* item);                      /**< returns the string for a object or array. This only works for json as string. For binary it will not work! */
 char*              d_create_json(json_ctx_t* ctx, d_token_t* item);       /**< creates a json-string. It does not work for objects if the parsed data were binary!*/
 
@@ -36,6 +36,7 @@
 #include "debug.h"
 #include "log.h"
 #include <stdlib.h>
+#include <string.h>
 #ifdef __ZEPHYR__
 void* k_realloc(void* ptr, size_t size, size_t oldsize) {
   void* new = NULL;
@@ -114,12 +115,79 @@ void _free_(void* ptr) {
 #endif
 }
 
+#define ARENA_ALIGN(x)   (((x) + 7) & ~((size_t) 7))
+#define ARENA_DATA(block) (((uint8_t*) (block)) + ARENA_ALIGN(sizeof(arena_block_t)))
+
+void* arena_alloc(in3_arena_t* arena, size_t size) {
+  size                 = ARENA_ALIGN(size);
+  arena_block_t* block = arena->blocks;
+  if (!block || block->used + size > block->size) {
+    // large allocations get their own block, so we can keep using the current one.
+    const int      large = size > ARENA_BLOCK_SIZE / 2;
+    arena_block_t* b     = _malloc(ARENA_ALIGN(sizeof(arena_block_t)) + (large ? size : ARENA_BLOCK_SIZE));
+    b->size              = large ? size : ARENA_BLOCK_SIZE;
+    b->used              = 0;
+    if (block && large) {
+      b->next     = block->next;
+      block->next = b;
+    }
+    else {
+      b->next       = block;
+      arena->blocks = b;
+    }
+    block = b;
+  }
+  void* ptr = ARENA_DATA(block) + block->used;
+  block->used += size;
+  return ptr;
+}
+
+void* arena_realloc(in3_arena_t* arena, void* ptr, size_t size, size_t old_size) {
+  if (!ptr) return arena_alloc(arena, size);
+  size     = ARENA_ALIGN(size);
+  old_size = ARENA_ALIGN(old_size);
+  if (size <= old_size) return ptr;
+
+  // the last allocation of the current block can grow in place
+  arena_block_t* block = arena->blocks;
+  if (ARENA_DATA(block) + block->used == (uint8_t*) ptr + old_size && block->used - old_size + size <= block->size) {
+    block->used += size - old_size;
+    return ptr;
+  }
+
+  // if it is the only allocation of its block, we reallocate the whole block
+  for (arena_block_t** b = &arena->blocks; *b; b = &(*b)->next) {
+    if (ARENA_DATA(*b) != ptr || (*b)->used != old_size) continue;
+    *b            = _realloc(*b, ARENA_ALIGN(sizeof(arena_block_t)) + size, ARENA_ALIGN(sizeof(arena_block_t)) + (*b)->size);
+    (*b)->size    = size;
+    (*b)->used    = size;
+    return ARENA_DATA(*b);
+  }
+
+  // otherwise the old memory stays unused until the arena is freed
+  return memcpy(arena_alloc(arena, size), ptr, old_size);
+}
+
+void arena_free(in3_arena_t* arena) {
+  for (arena_block_t* b = arena->blocks; b; b = arena->blocks) {
+    arena->blocks = b->next;
+    _free(b);
+  }
+}
+
 #ifdef TEST
 
 static int mem_count = 0;
 
+// allocations may happen in worker threads of the client
+#if defined(THREADSAFE) && defined(__GNUC__)
+#define MEM_COUNT(n) __atomic_add_fetch(&mem_count, n, __ATOMIC_RELAXED)
+#else
+#define MEM_COUNT(n) (mem_count += (n))
+#endif
+
 void* t_malloc(size_t size, char* file, const char* func, int line) {
-  mem_count++;
+  MEM_COUNT(1);
   void* p = _malloc_(size, file, func, line);
   //  printf("+++  malloc %p %s : %s : %i\n", p, file, func, line);
   return p;
@@ -137,7 +205,7 @@ void t_free(void* ptr, char* file, const char* func, int line) {
   UNUSED_VAR(line);
 
   if (!ptr) return;
-  mem_count--;
+  MEM_COUNT(-1);
 
   //  printf("--- free   %p  %s : %s : %i\n", ptr, file, func, line);
   _free_(ptr);
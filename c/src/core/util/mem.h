@@ -116,4 +116,38 @@ RETURNS_NONULL void* _calloc_(size_t n, size_t size, char* file, const char* fun
 void                 _free_(void* ptr);
 #endif /* TEST */
 
+#ifndef ARENA_BLOCK_SIZE
+/** the min size of a memory block allocated by an arena. */
+#define ARENA_BLOCK_SIZE 512
+#endif
+
+/** a memory block of an arena, which is followed by its data. */
+typedef struct arena_block {
+  struct arena_block* next; /**< the previous block */
+  size_t              size; /**< the size of the data */
+  size_t              used; /**< the number of bytes already used */
+} arena_block_t;
+
+/**
+ * a bump allocator for memory sharing the same lifetime.
+ *
+ * Allocations are not freed individually, but all at once with `arena_free()`.
+ * A zero-initialized arena is empty and can be used directly.
+ */
+typedef struct arena {
+  arena_block_t* blocks; /**< the blocks with the current block first */
+} in3_arena_t;
+
+/** allocates size bytes (8 byte aligned) within the arena. The memory is not initialized. */
+RETURNS_NONULL void* arena_alloc(in3_arena_t* arena, size_t size);
+/**
+ * resizes memory allocated within the arena.
+ *
+ * The memory grows in place, if it is the last allocation of the current block or the only one of its block.
+ * Otherwise it is copied and the old memory stays unused until the arena is freed.
+ */
+RETURNS_NONULL void* arena_realloc(in3_arena_t* arena, void* ptr, size_t size, size_t old_size);
+/** frees all memory allocated within the arena, which can be used again afterwards. */
+void arena_free(in3_arena_t* arena);
+
 #endif /* __MEM_H__ */
\ No newline at end of file
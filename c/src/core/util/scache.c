@@ -32,9 +32,19 @@
  * with this program. If not, see <https://www.gnu.org/licenses/>.
  *******************************************************************************/
 
+#define _XOPEN_SOURCE 600
+
 #include "scache.h"
 #include "data.h"
 #include "mem.h"
+#include "utils.h"
+#include <string.h>
+
+uint32_t in3_cache_hash(bytes_t data) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < data.len; i++) hash = (hash ^ data.data[i]) * 16777619u;
+  return hash;
+}
 
 bytes_t* in3_cache_get_entry(cache_entry_t* cache, bytes_t* key) {
   for (; cache; cache = cache->next) {
@@ -74,4 +84,165 @@ cache_entry_t* in3_cache_get_entry_by_prop(cache_entry_t* cache, cache_props_t p
     if (cache->props == prop) return cache;
   }
   return NULL;
-}
\ No newline at end of file
+}
+typedef struct lru_entry {
+  bytes_t           key;         /**< the key, stored right after the entry */
+  bytes_t           value;       /**< the value, stored right after the key */
+  uint32_t          hash;        /**< hash of the key */
+  uint64_t          created;     /**< time in seconds, when the entry was set */
+  struct lru_entry* prev;        /**< the more recently used entry */
+  struct lru_entry* next;        /**< the less recently used entry */
+  struct lru_entry* bucket_next; /**< next entry within the same bucket */
+} lru_entry_t;
+
+struct in3_lru_cache {
+  lru_entry_t** buckets;      /**< the hash index */
+  uint32_t      bucket_count; /**< number of buckets (always a power of 2) */
+  uint32_t      len;          /**< number of entries */
+  lru_entry_t*  head;         /**< the most recently used entry */
+  lru_entry_t*  tail;         /**< the least recently used entry */
+  size_t        size;         /**< current size of all entries in bytes */
+  size_t        max_bytes;    /**< the max size of all entries */
+#ifdef THREADSAFE
+  in3_mutex_t mutex;
+#endif
+};
+
+#ifdef THREADSAFE
+#define LRU_LOCK(cache)   MUTEX_LOCK(cache->mutex)
+#define LRU_UNLOCK(cache) MUTEX_UNLOCK(cache->mutex)
+#else
+#define LRU_LOCK(cache)
+#define LRU_UNLOCK(cache)
+#endif
+
+#define LRU_ENTRY_SIZE(e) (sizeof(lru_entry_t) + (e)->key.len + (e)->value.len)
+
+static lru_entry_t** lru_bucket(in3_lru_cache_t* cache, uint32_t hash) {
+  return cache->buckets + (hash & (cache->bucket_count - 1));
+}
+
+static lru_entry_t* lru_find(in3_lru_cache_t* cache, bytes_t* key, uint32_t hash) {
+  for (lru_entry_t* e = *lru_bucket(cache, hash); e; e = e->bucket_next) {
+    if (e->hash == hash && b_cmp(&e->key, key)) return e;
+  }
+  return NULL;
+}
+
+static void lru_unlink(in3_lru_cache_t* cache, lru_entry_t* e) {
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    cache->head = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    cache->tail = e->prev;
+}
+
+static void lru_push_front(in3_lru_cache_t* cache, lru_entry_t* e) {
+  e->prev = NULL;
+  e->next = cache->head;
+  if (cache->head) cache->head->prev = e;
+  cache->head = e;
+  if (!cache->tail) cache->tail = e;
+}
+
+static void lru_remove(in3_lru_cache_t* cache, lru_entry_t* e) {
+  for (lru_entry_t** p = lru_bucket(cache, e->hash); *p; p = &(*p)->bucket_next) {
+    if (*p == e) {
+      *p = e->bucket_next;
+      break;
+    }
+  }
+  lru_unlink(cache, e);
+  cache->size -= LRU_ENTRY_SIZE(e);
+  cache->len--;
+  _free(e);
+}
+
+static void lru_grow(in3_lru_cache_t* cache) {
+  uint32_t      count   = cache->bucket_count * 2;
+  lru_entry_t** buckets = _calloc(count, sizeof(lru_entry_t*));
+  for (lru_entry_t* e = cache->head; e; e = e->next) {
+    lru_entry_t** b = buckets + (e->hash & (count - 1));
+    e->bucket_next  = *b;
+    *b              = e;
+  }
+  _free(cache->buckets);
+  cache->buckets      = buckets;
+  cache->bucket_count = count;
+}
+
+in3_lru_cache_t* in3_lru_new(size_t max_bytes) {
+  in3_lru_cache_t* cache = _calloc(1, sizeof(in3_lru_cache_t));
+  cache->bucket_count    = 16;
+  cache->buckets         = _calloc(cache->bucket_count, sizeof(lru_entry_t*));
+  cache->max_bytes       = max_bytes;
+#ifdef THREADSAFE
+  MUTEX_INIT(cache->mutex)
+#endif
+  return cache;
+}
+
+void in3_lru_clear(in3_lru_cache_t* cache) {
+  LRU_LOCK(cache)
+  while (cache->head) lru_remove(cache, cache->head);
+  LRU_UNLOCK(cache)
+}
+
+size_t in3_lru_max_bytes(in3_lru_cache_t* cache) {
+  return cache->max_bytes;
+}
+
+void in3_lru_free(in3_lru_cache_t* cache) {
+  if (!cache) return;
+  in3_lru_clear(cache);
+#ifdef THREADSAFE
+  MUTEX_FREE(cache->mutex)
+#endif
+  _free(cache->buckets);
+  _free(cache);
+}
+
+bytes_t* in3_lru_get(in3_lru_cache_t* cache, bytes_t key, uint32_t ttl) {
+  bytes_t* res = NULL;
+  LRU_LOCK(cache)
+  lru_entry_t* e = lru_find(cache, &key, in3_cache_hash(key));
+  if (e && ttl && e->created + ttl < in3_time(NULL))
+    lru_remove(cache, e);
+  else if (e) {
+    lru_unlink(cache, e);
+    lru_push_front(cache, e);
+    res = b_dup(&e->value);
+  }
+  LRU_UNLOCK(cache)
+  return res;
+}
+
+void in3_lru_set(in3_lru_cache_t* cache, bytes_t key, bytes_t value) {
+  size_t size = sizeof(lru_entry_t) + key.len + value.len;
+  if (size > cache->max_bytes) return; // we would need to remove everything and it still won't fit
+
+  lru_entry_t* e = _malloc(size);
+  e->key         = bytes((uint8_t*) (e + 1), key.len);
+  e->value       = bytes(e->key.data + key.len, value.len);
+  e->hash        = in3_cache_hash(key);
+  e->created     = in3_time(NULL);
+  memcpy(e->key.data, key.data, key.len);
+  if (value.len) memcpy(e->value.data, value.data, value.len);
+
+  LRU_LOCK(cache)
+  lru_entry_t* old = lru_find(cache, &key, e->hash);
+  if (old) lru_remove(cache, old);
+  while (cache->tail && cache->size + size > cache->max_bytes) lru_remove(cache, cache->tail);
+  if (cache->len >= cache->bucket_count) lru_grow(cache);
+
+  lru_entry_t** b = lru_bucket(cache, e->hash);
+  e->bucket_next  = *b;
+  *b              = e;
+  lru_push_front(cache, e);
+  cache->size += size;
+  cache->len++;
+  LRU_UNLOCK(cache)
+}
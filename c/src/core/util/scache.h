@@ -71,6 +71,13 @@ typedef struct cache_entry {
   struct cache_entry* next;      /**< pointer to the next entry.*/
 } cache_entry_t;
 
+/**
+ * calculates the hash used to index the entries of a lru-cache (FNV-1a).
+ */
+uint32_t in3_cache_hash(
+    bytes_t data /**< the data to hash */
+);
+
 /**
  * get the entry for a given key.
  */
@@ -104,6 +111,62 @@ void in3_cache_free(
     bool           is_external /**< true if this is the root context or an external. */
 );
 
+/**
+ * a bounded cache, which may be shared between requests and threads.
+ *
+ * Entries are indexed by the hash of their key. If the total size of all keys and values exceeds the limit,
+ * the least recently used entries are removed.
+ */
+typedef struct in3_lru_cache in3_lru_cache_t;
+
+/**
+ * creates a new lru-cache.
+ */
+in3_lru_cache_t* in3_lru_new(
+    size_t max_bytes /**< the max number of bytes for all keys and values */
+);
+
+/**
+ * frees the cache and all its entries.
+ */
+void in3_lru_free(
+    in3_lru_cache_t* cache /**< the cache */
+);
+
+/**
+ * returns a copy of the value for the key, which must be freed with b_free() or NULL if not found.
+ *
+ * Entries which are older than ttl seconds are removed instead. A ttl of 0 means entries never expire.
+ */
+bytes_t* in3_lru_get(
+    in3_lru_cache_t* cache, /**< the cache */
+    bytes_t          key,   /**< the key */
+    uint32_t         ttl    /**< the max age of the entry in seconds */
+);
+
+/**
+ * stores a copy of the value.
+ */
+void in3_lru_set(
+    in3_lru_cache_t* cache, /**< the cache */
+    bytes_t          key,   /**< the key */
+    bytes_t          value  /**< the value */
+);
+
+/**
+ * removes all entries.
+ */
+void in3_lru_clear(
+    in3_lru_cache_t* cache /**< the cache */
+);
+
+/**
+ * returns the max number of bytes the cache was created with.
+ */
+size_t in3_lru_max_bytes(
+    in3_lru_cache_t* cache /**< the cache */
+);
+
 /**
  * adds a pointer, which should be freed when the context is freed.
  */
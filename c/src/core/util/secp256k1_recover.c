@@ -0,0 +1,748 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#include "secp256k1_recover.h"
+#ifdef SECP256K1_RECOVER_FAST
+#include "mem.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned __int128 u128_t;
+typedef uint64_t          fe_t[4]; /**< field element or scalar as little endian limbs */
+
+/** point in jacobian coordinates (x = X/Z^2, y = Y/Z^3) */
+typedef struct {
+  fe_t x, y, z;
+  bool inf;
+} jac_t;
+
+/** affine point */
+typedef struct {
+  fe_t x, y;
+} aff_t;
+
+/** state of one signature during recovery */
+typedef struct {
+  fe_t  r, s, z;  /**< the scalars of the signature and the digest */
+  aff_t p;        /**< the point R */
+  jac_t q;        /**< the resulting public key */
+  fe_t  prod;     /**< running product used for the batch inversion */
+  bool  valid;    /**< false if the signature can not be recovered */
+} rec_t;
+
+#define WINDOW_G 8 /**< wnaf-window for the generator, which uses the precomputed table */
+#define WINDOW_A 5 /**< wnaf-window for the point R, which is computed for each signature */
+#define WNAF_LEN 260
+
+static const fe_t P        = {0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t N        = {0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t ONE      = {1, 0, 0, 0};
+static const fe_t P_MINUS2 = {0xFFFFFFFEFFFFFC2DULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t P_SQRT   = {0xFFFFFFFFBFFFFF0CULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0x3FFFFFFFFFFFFFFFULL}; /**< (p+1)/4 */
+static const fe_t N_MINUS2 = {0xBFD25E8CD036413FULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t BETA     = {0xc1396c28719501eeULL, 0x9cf0497512f58995ULL, 0x6e64479eac3434e9ULL, 0x7ae96a2b657c0710ULL}; /**< cube root of 1 mod p */
+static const fe_t LAMBDA   = {0xdf02967c1b23bd72ULL, 0x122e22ea20816678ULL, 0xa5261c028812645aULL, 0x5363ad4cc05c30e0ULL}; /**< cube root of 1 mod n */
+static const fe_t G1       = {0xe893209a45dbb031ULL, 0x3daa8a1471e8ca7fULL, 0xe86c90e49284eb15ULL, 0x3086d221a7d46bcdULL}; /**< round(2^384 * b2 / n) */
+static const fe_t G2       = {0x1571b4ae8ac47f71ULL, 0x221208ac9df506c6ULL, 0x6f547fa90abfe4c4ULL, 0xe4437ed6010e8828ULL}; /**< round(2^384 * -b1 / n) */
+static const fe_t MINUS_B1 = {0x6f547fa90abfe4c3ULL, 0xe4437ed6010e8828ULL, 0, 0};
+static const fe_t MINUS_B2 = {0xd765cda83db1562cULL, 0x8a280ac50774346dULL, 0xfffffffffffffffeULL, 0xffffffffffffffffULL};
+
+#define P_C  0x1000003D1ULL                                                         /**< 2^256 - p */
+static const uint64_t N_C[3] = {0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 1}; /**< 2^256 - n */
+
+/** odd multiples (1G, 3G, ... 127G) of the generator */
+static const aff_t G_TABLE[1 << (WINDOW_G - 2)] = {
+    {{0x59f2815b16f81798ULL, 0x029bfcdb2dce28d9ULL, 0x55a06295ce870b07ULL, 0x79be667ef9dcbbacULL}, {0x9c47d08ffb10d4b8ULL, 0xfd17b448a6855419ULL, 0x5da4fbfc0e1108a8ULL, 0x483ada7726a3c465ULL}},
+    {{0x8601f113bce036f9ULL, 0xb531c845836f99b0ULL, 0x49344f85f89d5229ULL, 0xf9308a019258c310ULL}, {0x6cb9fd7584b8e672ULL, 0x6500a99934c2231bULL, 0x0fe337e62a37f356ULL, 0x388f7b0f632de814ULL}},
+    {{0xcba8d569b240efe4ULL, 0xe88b84bddc619ab7ULL, 0x55b4a7250a5c5128ULL, 0x2f8bde4d1a072093ULL}, {0xdca87d3aa6ac62d6ULL, 0xf788271bab0d6840ULL, 0xd4dba9dda6c9c426ULL, 0xd8ac222636e5e3d6ULL}},
+    {{0xe92bddedcac4f9bcULL, 0x3d419b7e0330e39cULL, 0xa398f365f2ea7a0eULL, 0x5cbdf0646e5db4eaULL}, {0xa5082628087264daULL, 0xa813d0b813fde7b5ULL, 0xa3178d6d861a54dbULL, 0x6aebca40ba255960ULL}},
+    {{0xc35f110dfc27ccbeULL, 0xe09796974c57e714ULL, 0x09ad178a9f559abdULL, 0xacd484e2f0c7f653ULL}, {0x05cc262ac64f9c37ULL, 0xadd888a4375f8e0fULL, 0x64380971763b61e9ULL, 0xcc338921b0a7d9fdULL}},
+    {{0xbbec17895da008cbULL, 0x5649980be5c17891ULL, 0x5ef4246b70c65aacULL, 0x774ae7f858a9411eULL}, {0x301d74c9c953c61bULL, 0x372db1e2dff9d6a8ULL, 0x0243dd56d7b7b365ULL, 0xd984a032eb6b5e19ULL}},
+    {{0xdeeddf8f19405aa8ULL, 0xb075fbc6610e58cdULL, 0xc7d1d205c3748651ULL, 0xf28773c2d975288bULL}, {0x29b5cb52db03ed81ULL, 0x3a1a06da521fa91fULL, 0x758212eb65cdaf47ULL, 0x0ab0902e8d880a89ULL}},
+    {{0x44adbcf8e27e080eULL, 0x31e5946f3c85f79eULL, 0x5a465ae3095ff411ULL, 0xd7924d4f7d43ea96ULL}, {0xc504dc9ff6a26b58ULL, 0xea40af2bd896d3a5ULL, 0x83842ec228cc6defULL, 0x581e2872a86c72a6ULL}},
+    {{0x66e4faa04a2d4a34ULL, 0xeb9898ae79b97687ULL, 0xa420fee807eacf21ULL, 0xdefdea4cdb677750ULL}, {0xcfb199f69e56eb77ULL, 0xced1f4a04a95c0f6ULL, 0xe997b0ead2a93daeULL, 0x4211ab0694635168ULL}},
+    {{0x7475656138385b6cULL, 0xf06acfebd7e86d27ULL, 0x93ef5cff444f4979ULL, 0x2b4ea0a797a443d2ULL}, {0xb570c854e5c09b7aULL, 0x1a01f60c50269763ULL, 0xb343083b5a1c8613ULL, 0x85e89bc037945d93ULL}},
+    {{0x81340aef25be59d5ULL, 0x1d9ad40271f81071ULL, 0x4f93fa332ce33330ULL, 0x352bbf4a4cdd1256ULL}, {0x67bd3d8bcf81998cULL, 0x4a1b3b2e71b1039cULL, 0xd59c18259dda3e1fULL, 0x321eb4075348f534ULL}},
+    {{0xdc9cdadd4ecacc3fULL, 0xe42ab8dfeff5ff29ULL, 0x0230010559879124ULL, 0x2fa2104d6b38d11bULL}, {0x423ba76b532b7d67ULL, 0x181d70ecfc882648ULL, 0xb64569335bd5dd80ULL, 0x02de1068295dd865ULL}},
+    {{0x69ca0cd7f5453714ULL, 0x263c3d84e09572e2ULL, 0xab21a9b066edda83ULL, 0x9248279b09b4d68dULL}, {0xe54a32ce97cb3402ULL, 0x3fc0de2a887912ffULL, 0x5d1aa71bdea2b1ffULL, 0x73016f7bf234aadeULL}},
+    {{0x7e996d443dee8729ULL, 0x2f570e144bf615c0ULL, 0x8e70132fb0beb752ULL, 0xdaed4f2be3a8bf27ULL}, {0xab40e52290be1c55ULL, 0x3f83c230f3afa726ULL, 0xd4a1aca87ef8d700ULL, 0xa69dce4a7d6c98e8ULL}},
+    {{0xe6a3b5e87d22e7dbULL, 0x11ecd9e9fdf281b0ULL, 0x8acf28d7cbb19f90ULL, 0xc44d12c7065d812eULL}, {0xa039063f0e0e6482ULL, 0x0e106e861edf61c5ULL, 0x76c45926c982fdacULL, 0x2119a460ce326cdcULL}},
+    {{0xb61c65cbd269e6b4ULL, 0x152b695336c28063ULL, 0xc89a20cfded60853ULL, 0x6a245bf6dc698504ULL}, {0xfd5e6348100d8a82ULL, 0x8b33ba48d0423b6eULL, 0x8b3f5126f16a24adULL, 0xe022cf42c2bd4a70ULL}},
+    {{0xf95ae57f0d0bd6a5ULL, 0xce13300b0bec1146ULL, 0xc077e3d2fe541084ULL, 0x1697ffa6fd9de627ULL}, {0xadee9d63d01b2396ULL, 0xa2cf15009e498ae7ULL, 0x27561506e4557433ULL, 0xb9c398f186806f5dULL}},
+    {{0xf982345ef27a7479ULL, 0x9deb8360ffb7f61dULL, 0x986d0f07e834cb0dULL, 0x605bdb019981718bULL}, {0x3b01e1e9056b8c49ULL, 0xc26bfae84fb14db4ULL, 0x81a78d93ec96fe23ULL, 0x02972d2de4f8d206ULL}},
+    {{0xfe31c7e9d87ff33dULL, 0xdcb01c354959b10cULL, 0x7402fdc45a215e10ULL, 0x62d14dab4150bf49ULL}, {0x35f5642483b25eafULL, 0x01aa132967ab4722ULL, 0x98088a1950eed0dbULL, 0x80fc06bd8cc5b010ULL}},
+    {{0x5e555c2f86308b6fULL, 0x2c50e9f56b9b8b42ULL, 0xde5b4b06c408e56bULL, 0x80c60ad0040f27daULL}, {0x1aa01f56430bd57aULL, 0xa65eed4cbe7024ebULL, 0x26e66bad7fe72f70ULL, 0x1c38303f1cc5c30fULL}},
+    {{0x9d5eabb0fa03c8fbULL, 0x4cc5dc9487d84704ULL, 0xaa74c6348cc54d34ULL, 0x7a9375ad6167ad54ULL}, {0x02d499ec224dc7f7ULL, 0xbdc59ea10c70ce2bULL, 0x09559e0d79269046ULL, 0x0d0e3fa9eca87269ULL}},
+    {{0x4bb51f459bc3ffc9ULL, 0xbb408ec39b68df50ULL, 0x907a9ed045447a79ULL, 0xd528ecd9b696b54cULL}, {0x063465b521409933ULL, 0xbc4345405c520dbcULL, 0x9966f21881fd656eULL, 0xeecf41253136e5f9ULL}},
+    {{0x87231808f8b45963ULL, 0x5266115e4a7ecb13ULL, 0xea25f514e8ecdad0ULL, 0x049370a4b5f43412ULL}, {0xb653052a12949c9aULL, 0x54c3f3afbb5b6764ULL, 0x8b3081b0512fd62aULL, 0x758f3f41afd6ed42ULL}},
+    {{0xf1c13eb1fc345d74ULL, 0x881d811e0e1498e2ULL, 0xd73df930d64702efULL, 0x77f230936ee88cbbULL}, {0xbe8eb3c7671c60d6ULL, 0x96c95330d97077cbULL, 0x0a08266e9ba1b378ULL, 0x958ef42a7886b640ULL}},
+    {{0xeb28531b7739f530ULL, 0x58c80074ab9d4dbaULL, 0xea44887e5c7c0bceULL, 0xf2dac991cc4ce4b9ULL}, {0x1a117dba703a3c37ULL, 0x9eb5fbeb0598e4fdULL, 0x4da1f32dec2531dfULL, 0xe0dedc9b3b2f8dadULL}},
+    {{0xbcba4850c690d45bULL, 0x5a216cdfc9dae3deULL, 0x1b4be8fbbe252012ULL, 0x463b3d9f662621fbULL}, {0x1cb377b01af7307eULL, 0xc622e27c970a1de3ULL, 0x43114306dd8622d7ULL, 0x5ed430d78c296c35ULL}},
+    {{0xa32496b49998f247ULL, 0x6b98fac14328a2d1ULL, 0x09232d4aff3b5997ULL, 0xf16f804244e46e2aULL}, {0xd6579962c4e31df6ULL, 0x2a6c53c26e5cce26ULL, 0x13d206fcdf4e33d9ULL, 0xcedabd9b82203f7eULL}},
+    {{0x369e15f7151d41d1ULL, 0x5d245315ace27c65ULL, 0xb0352b7a14311af5ULL, 0xcaf754272dc84563ULL}, {0xc32f908318a04476ULL, 0x5f4fa9b7962232a5ULL, 0xa41b643fa5e46057ULL, 0xcb474660ef35f5f2ULL}},
+    {{0x24497bc86f082120ULL, 0x44a09c07cb86d7c1ULL, 0xf85d0f1709979d8bULL, 0x2600ca4b282cb986ULL}, {0x4b0be9475a7e4b40ULL, 0x5ac6be74ab5f0ef4ULL, 0xa693b03fcddbb45dULL, 0x4119b88753c15bd6ULL}},
+    {{0xc602a7746998e435ULL, 0x01c48685e24f7dc8ULL, 0x338ec53cd12220bcULL, 0x7635ca72d7e8432cULL}, {0xd9e76f302c5b9c61ULL, 0x4ecfc061d57048baULL, 0x3d1d5e590f78e6d7ULL, 0x091b649609489d61ULL}},
+    {{0xc1a50743bf56cc18ULL, 0xb7f2b33479d468fbULL, 0xdbbf4a87deee8a66ULL, 0x754e3239f325570cULL}, {0x0c5d98093c536683ULL, 0x23ee33d0197a695dULL, 0xb3cd0ed304ea49a0ULL, 0x0673fb86e5bda30fULL}},
+    {{0x9fe2694691d9b9e8ULL, 0x330800661d1c952fULL, 0xff57859c82d570f0ULL, 0xe3e6bd1071a1e96aULL}, {0x67002af4920e37f5ULL, 0xa5a2283993e90c41ULL, 0x40c0aa58379a3cb6ULL, 0x59c9e0bba394e76fULL}},
+    {{0x4cc47fdcf04aa6ebULL, 0xc4ccb1f32ba35f4bULL, 0x26ae73d88f732985ULL, 0x186b483d056a0338ULL}, {0xa4a797f86e80888bULL, 0x21fb8090895138b4ULL, 0x2e17446e204180abULL, 0x3b952d32c67cf77eULL}},
+    {{0x1a8321724ce0963fULL, 0x5442e6d2b737d9c9ULL, 0x44c98561f4be4f72ULL, 0xdf9d70a6b9876ce5ULL}, {0x17b8c45cf2ba2417ULL, 0xb157222720ef9da2ULL, 0x5f862b785dc39d4aULL, 0x55eb2dafd84d6ccdULL}},
+    {{0x5de64c5f34ce7143ULL, 0xab52554f849ed899ULL, 0x497ca815d5dce0f8ULL, 0x5edd5cc23c51e87aULL}, {0xcdc706ab7399a868ULL, 0xc13c66c0d17a2905ULL, 0x61e8cec030c89ad0ULL, 0xefae9c8dbc141306ULL}},
+    {{0x722d362f84614fbaULL, 0x7aa3fba1c355b17aULL, 0xda12fe02287e9e77ULL, 0x290798c2b6476830ULL}, {0x6d003afd41943e7aULL, 0x5b29c094db2a2314ULL, 0x988d00bcf79af25dULL, 0xe38da76dcd440621ULL}},
+    {{0x62dfdecef4053b45ULL, 0xcd29552fe3602573ULL, 0x054754efa150ac39ULL, 0xaf3c423a95d9f5b3ULL}, {0xbc2feded498fd9c6ULL, 0xc8cd5aa667a15581ULL, 0x9a93b0e6f35cfb40ULL, 0xf98a3fd831eb2b74ULL}},
+    {{0x8d2fed50d884249aULL, 0x06bb66b26dcf98dfULL, 0xcccaa28c99bf2749ULL, 0x766dbb24d134e745ULL}, {0x2c924f97cbac5996ULL, 0x97584a65fa06ceddULL, 0x8dcc887980da38b8ULL, 0x744b1152eacbe5e3ULL}},
+    {{0xce92e666191abe3eULL, 0x45f7b44f6c596a58ULL, 0xa21277c33784f416ULL, 0x59dbf46f8c94759bULL}, {0xd85e216c4a307f6eULL, 0x42ce739a7919798cULL, 0x0f4ea6ce648309a0ULL, 0xc534ad44175fbc30ULL}},
+    {{0xb62dc6018cfd87b8ULL, 0xdd647e711a95e73cULL, 0x305e691e74e9a4a8ULL, 0xf13ada95103c4537ULL}, {0x0778419bdaf5733dULL, 0x6949e21a6a75c257ULL, 0x63bf4bc808341f32ULL, 0xe13817b44ee14de6ULL}},
+    {{0x488550015a88522cULL, 0xda1869c06ebadfb6ULL, 0x6d4167a2c59cca4cULL, 0x7754b4fa0e8aced0ULL}, {0x37a48b57841163a2ULL, 0x8d1e4e350b6cbcc5ULL, 0x224b967c3020b8faULL, 0x30e93e864e669d82ULL}},
+    {{0xa6828c99e2262519ULL, 0x01858f95de8041d2ULL, 0xaa3874d46abef9d7ULL, 0x948dcadf5990e048ULL}, {0xcbba2cae5347d57eULL, 0xdf9154efbd2ef1d2ULL, 0xd5d28a3224b1bc25ULL, 0xe491a42537f6e597ULL}},
+    {{0x70328a8a3d7c77abULL, 0xfb224cf5ac0bfa15ULL, 0x89c7b48f8202ec37ULL, 0x7962414450c76c16ULL}, {0x60afa5b29db83437ULL, 0x12507a051f04ac57ULL, 0x0d5c1fc133ef6f6bULL, 0x100b610ec4ffb476ULL}},
+    {{0xb0dd085137ec47caULL, 0x5a16977225b8847bULL, 0xb15b160644d91548ULL, 0x3514087834964b54ULL}, {0x7e7d15a0de293311ULL, 0x6039e77c15c2378bULL, 0x8e1652c48e8127fcULL, 0xef0afbb205620544ULL}},
+    {{0x42943d3f7b527eafULL, 0x93e947eb8df787b4ULL, 0xc79ce2c9dd8bc549ULL, 0xd3cc30ad6b483e4bULL}, {0xafb34db04eede0a4ULL, 0x3c2ad46290358630ULL, 0x89c5e9be8f9508aeULL, 0x8b378a22d827278dULL}},
+    {{0x3975ba0ff4847610ULL, 0x2b29823db913f649ULL, 0xce1c78fcbfefe08bULL, 0x1624d84780732860ULL}, {0xcc06e2a404078575ULL, 0x896878f5282be4c8ULL, 0x0914448c6cd9d4caULL, 0x68651cf9b6da903eULL}},
+    {{0x6df7b4fd5fc61cd4ULL, 0x5192474b5af207daULL, 0x6902c95633e62a98ULL, 0x733ce80da955a8a2ULL}, {0xc54673bc1dc5ea1dULL, 0x3e1ef8e0201e4578ULL, 0x485a4d8b8db9fcceULL, 0xf5435a2bd2badf7dULL}},
+    {{0xef258dfab81c045cULL, 0x8966c5092171e699ULL, 0xcf1a1c33bbd3b49fULL, 0x15d9441254945064ULL}, {0xfc37bbe9efe4070dULL, 0x434800bacebfc685ULL, 0x34f5137b73b84177ULL, 0xd56eb30b69463e72ULL}},
+    {{0xac138599d0717940ULL, 0x1c21417c9d2b8aaaULL, 0xb612136e5ce70d27ULL, 0xa1d0fcf2ec9de675ULL}, {0x19212d39c197a629ULL, 0x641462a54070f3d5ULL, 0xb2e90737309667f2ULL, 0xedd77f50bcb5a3caULL}},
+    {{0xc7ca37331cb36980ULL, 0xa790badee8245c06ULL, 0x5780c0735f84dbe9ULL, 0xe22fbe15c0af8cccULL}, {0xe43d06d77d31da06ULL, 0xa38289154964799bULL, 0x88b430a69f53a1a7ULL, 0x0a855babad5cd60cULL}},
+    {{0x4009452246cfa9b3ULL, 0x69635e394704eaa7ULL, 0x0ee13473c1155f5fULL, 0x311091dd9860e8e2ULL}, {0xbd80f0b1286d8374ULL, 0x871ec5a64feee685ULL, 0xffd1f04788c06830ULL, 0x66db656f87d1f04fULL}},
+    {{0x1867d4232ec2dbdfULL, 0x883928b45a934078ULL, 0xb31c0442d3e6ac24ULL, 0x34c1fd04d301be89ULL}, {0xc5321857ba73abeeULL, 0xd57f1ceeb487443dULL, 0x54bd46f730174136ULL, 0x09414685e97b1b59ULL}},
+    {{0xcc2a5e6b049b8d63ULL, 0x8d13f3abbcd08affULL, 0x1c14de5b557eb42aULL, 0xf219ea5d6b54701cULL}, {0xd8c2962a400766d1ULL, 0xf4b08d3c07b27fb8ULL, 0xf73af4544cccf6b1ULL, 0x4cb95957e83d40b0ULL}},
+    {{0x7236912469a0b448ULL, 0x543a5490bca62708ULL, 0xb1f683db8f45de26ULL, 0xd7b8740f74a8fbaaULL}, {0x411e0315eaa4593bULL, 0xff15db5ed3c049b3ULL, 0xe1010f337ad4717eULL, 0xfa77968128d9c92eULL}},
+    {{0x9fe4d3091aa824bfULL, 0xad5bcd32abdd9428ULL, 0xf86f7c98d3a3335eULL, 0x32d31c222f8f6f0eULL}, {0x118d14b8462e1661ULL, 0x2e6dac9e6f26e961ULL, 0x9ccd3d7915b9e1daULL, 0x5f3032f5892156e3ULL}},
+    {{0x340f86cbc18347b5ULL, 0x8793d77cd59592c4ULL, 0x71045a155d9831eaULL, 0x7461f371914ab326ULL}, {0xb39847b3cc092ff6ULL, 0x2eee1ff50c986ea6ULL, 0xcbdddcae0aa44254ULL, 0x8ec0ba238b96bec0ULL}},
+    {{0x287698bad7b2b2d6ULL, 0x6d716b2c3e67453dULL, 0x74356a25aa38206aULL, 0xee079adb1df18600ULL}, {0xebaac479ec1c8c1eULL, 0xa446989af04c4e25ULL, 0x4c5f37e0ecc5f9f6ULL, 0x8dc2412aafe3be5cULL}},
+    {{0x2bfd8616ba9da6b5ULL, 0xe65de331874c9dc7ULL, 0x467b18302ee620f7ULL, 0x16ec93e447ec83f0ULL}, {0x9626778e25b0674dULL, 0x9d58186a50e49713ULL, 0xd0e8c2a7ca5804a3ULL, 0x5e4631150e62fb40ULL}},
+    {{0x85b96065d537bd99ULL, 0xd8855897f98b6aa4ULL, 0x38978290afa70b6bULL, 0xeaa5f980c245f6f0ULL}, {0xb18041024edc07dcULL, 0xd784869d7e6ea67fULL, 0x19a528391c994624ULL, 0xf65f5d3e292c2e08ULL}},
+    {{0xa96c4b6b35a49f51ULL, 0x58ae04877151342eULL, 0x692ee1910a024399ULL, 0x078c9407544ac132ULL}, {0x62b675f194a3ddb4ULL, 0xfa1fbd583c064d24ULL, 0xd5404795539a5e68ULL, 0xf3e0319169eb9b85ULL}},
+    {{0x726578d9702857a5ULL, 0x01cdc8ae7a6fc688ULL, 0x16dcd838431aea00ULL, 0x494f4be219a1a770ULL}, {0x55f4b031880d562cULL, 0xf925ce30d767ed6eULL, 0x39ba7f075e36ba2aULL, 0x42242a969283a5f3ULL}},
+    {{0xbf4c1e665c1fe9b5ULL, 0xd28211ea58faa70eULL, 0x6bc7f2f5144ea549ULL, 0xa598a8030da6d86cULL}, {0x10026dbd2d864e6bULL, 0x23fc63b65b35f86aULL, 0x7e4b4a7140737aecULL, 0x204b5d6f84822c30ULL}},
+    {{0x4dbadc3e58595997ULL, 0x208f020f12570a18ULL, 0x09192f5f2dbeafecULL, 0xc41916365abb2b5dULL}, {0xed16e96b58fa9913ULL, 0xd5caf9450f34bfc0ULL, 0x49d245b328984989ULL, 0x04f14351d0087efaULL}},
+    {{0xe4c73a5514742881ULL, 0x92a2e0d2e0a36acfULL, 0x5a724604da03bc5bULL, 0x841d6063a586fa47ULL}, {0xe7a36de01a8d6154ULL, 0xe62562d6744c169cULL, 0x1904f9a1c7543698ULL, 0x073867f59c0659e8ULL}},
+};
+
+/** odd multiples of lambda * G = (beta * x, y) */
+static const aff_t G_LAMBDA_TABLE[1 << (WINDOW_G - 2)] = {
+    {{0xa7bba04400b88fcbULL, 0x872844067f15e98dULL, 0xab0102b696902325ULL, 0xbcace2e99da01887ULL}, {0x9c47d08ffb10d4b8ULL, 0xfd17b448a6855419ULL, 0x5da4fbfc0e1108a8ULL, 0x483ada7726a3c465ULL}},
+    {{0xf7f0728c77206b2fULL, 0x8af1e022c6dc8e1cULL, 0x8dcd8dcf2a28fa2fULL, 0xdf6edf03731f9b4bULL}, {0x6cb9fd7584b8e672ULL, 0x6500a99934c2231bULL, 0x0fe337e62a37f356ULL, 0x388f7b0f632de814ULL}},
+    {{0x138c694695a83668ULL, 0xa045693ee0d097ccULL, 0xf79f54fbccb94671ULL, 0x337b52e3acda49dfULL}, {0xdca87d3aa6ac62d6ULL, 0xf788271bab0d6840ULL, 0xd4dba9dda6c9c426ULL, 0xd8ac222636e5e3d6ULL}},
+    {{0x3bc4686e4e53bc94ULL, 0x0d3b20e20faf7aaaULL, 0xa4fec4d1c095c06eULL, 0x13f26e754bea0b77ULL}, {0xa5082628087264daULL, 0xa813d0b813fde7b5ULL, 0xa3178d6d861a54dbULL, 0x6aebca40ba255960ULL}},
+    {{0x20cd912e65953a52ULL, 0xb565cdf5ef6d44e1ULL, 0x7b6558afec58ab20ULL, 0x87b404037e44e819ULL}, {0x05cc262ac64f9c37ULL, 0xadd888a4375f8e0fULL, 0x64380971763b61e9ULL, 0xcc338921b0a7d9fdULL}},
+    {{0xc5ff4334bb209ce7ULL, 0x79859bb70b5ff620ULL, 0x8d897c41bebf1a26ULL, 0x51f4d3d1171dac1dULL}, {0x301d74c9c953c61bULL, 0x372db1e2dff9d6a8ULL, 0x0243dd56d7b7b365ULL, 0xd984a032eb6b5e19ULL}},
+    {{0x60aaee6a475fb678ULL, 0x32907ed74a3d0562ULL, 0x07046c4578fc783bULL, 0xf14d58374bb890a2ULL}, {0x29b5cb52db03ed81ULL, 0x3a1a06da521fa91fULL, 0x758212eb65cdaf47ULL, 0x0ab0902e8d880a89ULL}},
+    {{0x3ac0a40c71b1b3b4ULL, 0x05cc3bc9c1c0a639ULL, 0x0e1b4825512b6948ULL, 0x805f1105f5f9454aULL}, {0xc504dc9ff6a26b58ULL, 0xea40af2bd896d3a5ULL, 0x83842ec228cc6defULL, 0x581e2872a86c72a6ULL}},
+    {{0xc640b26af6433cc9ULL, 0x5cd58547a6754102ULL, 0xdd08754cc8986867ULL, 0xc2e95843a1f110e2ULL}, {0xcfb199f69e56eb77ULL, 0xced1f4a04a95c0f6ULL, 0xe997b0ead2a93daeULL, 0x4211ab0694635168ULL}},
+    {{0x5d2eb9142ed76769ULL, 0x57bafb25d78eeb1cULL, 0x3272082dbfc45cc5ULL, 0x54f51a8f5a6bb0f6ULL}, {0xb570c854e5c09b7aULL, 0x1a01f60c50269763ULL, 0xb343083b5a1c8613ULL, 0x85e89bc037945d93ULL}},
+    {{0x2fdeaab069cbbc35ULL, 0x592bc884809f2969ULL, 0xa63d667a0a204325ULL, 0x680eb70f9b7e452eULL}, {0x67bd3d8bcf81998cULL, 0x4a1b3b2e71b1039cULL, 0xd59c18259dda3e1fULL, 0x321eb4075348f534ULL}},
+    {{0xb6704dce788930fcULL, 0x47c5360f34a09b26ULL, 0xcfe162a03aed4da4ULL, 0xbae0440b1659bc6eULL}, {0x423ba76b532b7d67ULL, 0x181d70ecfc882648ULL, 0xb64569335bd5dd80ULL, 0x02de1068295dd865ULL}},
+    {{0x8d758e87ef3195beULL, 0xe15b71f68400aa85ULL, 0x1f7497e0301d395fULL, 0xf7554ece5468c831ULL}, {0xe54a32ce97cb3402ULL, 0x3fc0de2a887912ffULL, 0x5d1aa71bdea2b1ffULL, 0x73016f7bf234aadeULL}},
+    {{0x837a2dfef61b7229ULL, 0x546322c61318a794ULL, 0x1d6d435f1ac76911ULL, 0x8ca980cfe497be98ULL}, {0xab40e52290be1c55ULL, 0x3f83c230f3afa726ULL, 0xd4a1aca87ef8d700ULL, 0xa69dce4a7d6c98e8ULL}},
+    {{0xc5c56571d53ba020ULL, 0x1b9c0525119bd70cULL, 0x188c807e0658f9ebULL, 0xe48590b373b31775ULL}, {0xa039063f0e0e6482ULL, 0x0e106e861edf61c5ULL, 0x76c45926c982fdacULL, 0x2119a460ce326cdcULL}},
+    {{0x8f8022a6afac1b9bULL, 0x20ba50015945eb46ULL, 0xe84d275183b19a3aULL, 0xe6034c74dae527c2ULL}, {0xfd5e6348100d8a82ULL, 0x8b33ba48d0423b6eULL, 0x8b3f5126f16a24adULL, 0xe022cf42c2bd4a70ULL}},
+    {{0x4457db1dae44e551ULL, 0x1fa0e628e0674325ULL, 0x73175272408c8fa1ULL, 0xd3ea40607daab599ULL}, {0xadee9d63d01b2396ULL, 0xa2cf15009e498ae7ULL, 0x27561506e4557433ULL, 0xb9c398f186806f5dULL}},
+    {{0xb5888b9a7429b03fULL, 0xa473aa2f5494174bULL, 0x6851dcdf234e9878ULL, 0x7ff6966b4f8f79e9ULL}, {0x3b01e1e9056b8c49ULL, 0xc26bfae84fb14db4ULL, 0x81a78d93ec96fe23ULL, 0x02972d2de4f8d206ULL}},
+    {{0xeb070ef4045cfcb3ULL, 0xd1acc036018d2aadULL, 0x554ce32c94e4ec59ULL, 0xab880849ed4c54afULL}, {0x35f5642483b25eafULL, 0x01aa132967ab4722ULL, 0x98088a1950eed0dbULL, 0x80fc06bd8cc5b010ULL}},
+    {{0xef4eadd83e1f51a1ULL, 0x3aa695ac94af5f75ULL, 0xfaa581fba9fccfdfULL, 0x148d9eee8fa96dbdULL}, {0x1aa01f56430bd57aULL, 0xa65eed4cbe7024ebULL, 0x26e66bad7fe72f70ULL, 0x1c38303f1cc5c30fULL}},
+    {{0x30e6211e6a19f543ULL, 0xc7b2def83c35304cULL, 0x6bc8823efdba68baULL, 0xc5011eacb8769193ULL}, {0x02d499ec224dc7f7ULL, 0xbdc59ea10c70ce2bULL, 0x09559e0d79269046ULL, 0x0d0e3fa9eca87269ULL}},
+    {{0x60bb6fa33b5e25e7ULL, 0x3fa22df8ec823ea9ULL, 0x89eb86d54a9bd852ULL, 0xe9c9d489f658169bULL}, {0x063465b521409933ULL, 0xbc4345405c520dbcULL, 0x9966f21881fd656eULL, 0xeecf41253136e5f9ULL}},
+    {{0x06ba66db4351973dULL, 0xb9af414eeeb1662dULL, 0x4abe8c119f6c352eULL, 0x5e51873a71eb0aa7ULL}, {0xb653052a12949c9aULL, 0x54c3f3afbb5b6764ULL, 0x8b3081b0512fd62aULL, 0x758f3f41afd6ed42ULL}},
+    {{0x575e312130323cacULL, 0xe26f62cd10a2ed1dULL, 0x0cf2d3ea4dce1c4fULL, 0xa0a5df60c8a81c44ULL}, {0xbe8eb3c7671c60d6ULL, 0x96c95330d97077cbULL, 0x0a08266e9ba1b378ULL, 0x958ef42a7886b640ULL}},
+    {{0xa9b4c1e66d0865eeULL, 0xd68631e918ec3d0dULL, 0x8cce3ff1a1c0ba81ULL, 0x88bf82907965eff5ULL}, {0x1a117dba703a3c37ULL, 0x9eb5fbeb0598e4fdULL, 0x4da1f32dec2531dfULL, 0xe0dedc9b3b2f8dadULL}},
+    {{0xdb2eb2c6a6151ccdULL, 0x2ee49dc8f4120947ULL, 0xa273c509461c8f85ULL, 0xd3d898009f38f50eULL}, {0x1cb377b01af7307eULL, 0xc622e27c970a1de3ULL, 0x43114306dd8622d7ULL, 0x5ed430d78c296c35ULL}},
+    {{0xf8e4228dbb643650ULL, 0xe618bd708c9cdda6ULL, 0xe68c6222c186e54dULL, 0xaaaa6ea8422ead4aULL}, {0xd6579962c4e31df6ULL, 0x2a6c53c26e5cce26ULL, 0x13d206fcdf4e33d9ULL, 0xcedabd9b82203f7eULL}},
+    {{0xd41882a114a4f300ULL, 0xb7f55b5495505fa9ULL, 0x783f1d5be329e931ULL, 0x9bdf1191c50b7cf2ULL}, {0xc32f908318a04476ULL, 0x5f4fa9b7962232a5ULL, 0xa41b643fa5e46057ULL, 0xcb474660ef35f5f2ULL}},
+    {{0x0abd22060cb65103ULL, 0xe3d8d7924d3f70f9ULL, 0x77df55e43b922921ULL, 0x6c89c3391cfcff60ULL}, {0x4b0be9475a7e4b40ULL, 0x5ac6be74ab5f0ef4ULL, 0xa693b03fcddbb45dULL, 0x4119b88753c15bd6ULL}},
+    {{0x7b55a11ed0e6c1cfULL, 0xc139c7ab67d378faULL, 0x361baf7aa5cf654aULL, 0xfb81bec00632ec3aULL}, {0xd9e76f302c5b9c61ULL, 0x4ecfc061d57048baULL, 0x3d1d5e590f78e6d7ULL, 0x091b649609489d61ULL}},
+    {{0x0d769207101c2518ULL, 0xf6cdff78fd8b3e68ULL, 0x6228149ad347db19ULL, 0xbe02db9626ddc9f5ULL}, {0x0c5d98093c536683ULL, 0x23ee33d0197a695dULL, 0xb3cd0ed304ea49a0ULL, 0x0673fb86e5bda30fULL}},
+    {{0xc17b586f6baeef76ULL, 0xaf721aa9a550463eULL, 0x175635870889d21dULL, 0x87bd9a8f1c28c565ULL}, {0x67002af4920e37f5ULL, 0xa5a2283993e90c41ULL, 0x40c0aa58379a3cb6ULL, 0x59c9e0bba394e76fULL}},
+    {{0xa728031158d30e3fULL, 0xfaa0dddbb9624747ULL, 0x82602c3c002f9697ULL, 0x2b6a73604e57f39eULL}, {0xa4a797f86e80888bULL, 0x21fb8090895138b4ULL, 0x2e17446e204180abULL, 0x3b952d32c67cf77eULL}},
+    {{0x591932131c6074dbULL, 0x7c28977d64893824ULL, 0xeadce5ac6c793132ULL, 0x689ff442f8586658ULL}, {0x17b8c45cf2ba2417ULL, 0xb157222720ef9da2ULL, 0x5f862b785dc39d4aULL, 0x55eb2dafd84d6ccdULL}},
+    {{0xd5e63c7c5add7b20ULL, 0x89d9b6de36a3c416ULL, 0x79fbe4c3892900c3ULL, 0x3c431ae2642bc765ULL}, {0xcdc706ab7399a868ULL, 0xc13c66c0d17a2905ULL, 0x61e8cec030c89ad0ULL, 0xefae9c8dbc141306ULL}},
+    {{0xdfb858419bfe323bULL, 0xcce185ad8ccd0198ULL, 0xf9aefb9126c20244ULL, 0x30571001b9f78798ULL}, {0x6d003afd41943e7aULL, 0x5b29c094db2a2314ULL, 0x988d00bcf79af25dULL, 0xe38da76dcd440621ULL}},
+    {{0x86e92a72e701991aULL, 0x9ad442008ba9ced5ULL, 0x5edab57a183e8dcbULL, 0x00d263ad8326f2b8ULL}, {0xbc2feded498fd9c6ULL, 0xc8cd5aa667a15581ULL, 0x9a93b0e6f35cfb40ULL, 0xf98a3fd831eb2b74ULL}},
+    {{0xeb258f4db2e63cf9ULL, 0x41290bdf6ac298beULL, 0x70dc5ba76f2903f8ULL, 0x3cff41ca67de3fddULL}, {0x2c924f97cbac5996ULL, 0x97584a65fa06ceddULL, 0x8dcc887980da38b8ULL, 0x744b1152eacbe5e3ULL}},
+    {{0x4bf07a876c079ef2ULL, 0xb65cb88558a6076bULL, 0x1fb0e230e64efd81ULL, 0x04c5c14383b1bf52ULL}, {0xd85e216c4a307f6eULL, 0x42ce739a7919798cULL, 0x0f4ea6ce648309a0ULL, 0xc534ad44175fbc30ULL}},
+    {{0x7998212e095052c4ULL, 0xb1e99c3030db955fULL, 0x3070fdba90063187ULL, 0x86c9895737bb6706ULL}, {0x0778419bdaf5733dULL, 0x6949e21a6a75c257ULL, 0x63bf4bc808341f32ULL, 0xe13817b44ee14de6ULL}},
+    {{0xd7c4e0c12be7dba3ULL, 0x2990a5aa1cc01df6ULL, 0x4dac8fdcb60af467ULL, 0x8f4c4a008e5cec56ULL}, {0x37a48b57841163a2ULL, 0x8d1e4e350b6cbcc5ULL, 0x224b967c3020b8faULL, 0x30e93e864e669d82ULL}},
+    {{0x55b863add20c3970ULL, 0xce7f2d98202526a1ULL, 0x45332a0368bbd810ULL, 0x9cd292290e9e7708ULL}, {0xcbba2cae5347d57eULL, 0xdf9154efbd2ef1d2ULL, 0xd5d28a3224b1bc25ULL, 0xe491a42537f6e597ULL}},
+    {{0xbac23033100b5d72ULL, 0xa1bc0cf2b751f987ULL, 0xc611b701b641d0c1ULL, 0x8e5ccf4e7ea43db6ULL}, {0x60afa5b29db83437ULL, 0x12507a051f04ac57ULL, 0x0d5c1fc133ef6f6bULL, 0x100b610ec4ffb476ULL}},
+    {{0x9f0aca6c5498d815ULL, 0x5a885c86698c6afbULL, 0x13a5f96fa79a40acULL, 0x8036894bb4d69021ULL}, {0x7e7d15a0de293311ULL, 0x6039e77c15c2378bULL, 0x8e1652c48e8127fcULL, 0xef0afbb205620544ULL}},
+    {{0xb6d5cec8b7b44e89ULL, 0x0e6158465db7e19fULL, 0xba0ae6b3814be933ULL, 0xb524f8a331b07052ULL}, {0xafb34db04eede0a4ULL, 0x3c2ad46290358630ULL, 0x89c5e9be8f9508aeULL, 0x8b378a22d827278dULL}},
+    {{0x689d7429559f7bb4ULL, 0xa1179a0de44cc5a2ULL, 0xd1ced61c15bc3c2aULL, 0xcf04550093816ae0ULL}, {0xcc06e2a404078575ULL, 0x896878f5282be4c8ULL, 0x0914448c6cd9d4caULL, 0x68651cf9b6da903eULL}},
+    {{0x05ac50187ca9bce6ULL, 0xf4a4f9e34f51067fULL, 0x37b2e3dc35025697ULL, 0x0ccbd8ba298a5973ULL}, {0xc54673bc1dc5ea1dULL, 0x3e1ef8e0201e4578ULL, 0x485a4d8b8db9fcceULL, 0xf5435a2bd2badf7dULL}},
+    {{0x2eef9d7fe11a2857ULL, 0xf1a04744376babaeULL, 0xb696c0e3feefa7d9ULL, 0x65384c59e84ea37aULL}, {0xfc37bbe9efe4070dULL, 0x434800bacebfc685ULL, 0x34f5137b73b84177ULL, 0xd56eb30b69463e72ULL}},
+    {{0x94bb79217de9a019ULL, 0x19c4a96a3a6ea125ULL, 0x77cbb3baf8635b1eULL, 0xd3231073a5a886c5ULL}, {0x19212d39c197a629ULL, 0x641462a54070f3d5ULL, 0xb2e90737309667f2ULL, 0xedd77f50bcb5a3caULL}},
+    {{0xe3ed90c700b8dbb6ULL, 0xae79ae57129d49dcULL, 0x5605537fba6e8944ULL, 0x55987956c1020a09ULL}, {0xe43d06d77d31da06ULL, 0xa38289154964799bULL, 0x88b430a69f53a1a7ULL, 0x0a855babad5cd60cULL}},
+    {{0xf2ca639e978d98beULL, 0x457399aa9853e177ULL, 0x3633e5b458d8d905ULL, 0x92889fa7f164bbe6ULL}, {0xbd80f0b1286d8374ULL, 0x871ec5a64feee685ULL, 0xffd1f04788c06830ULL, 0x66db656f87d1f04fULL}},
+    {{0x44ff7627f6b22bb8ULL, 0xbace2a8a273d519cULL, 0xfcc6b989f5d1a0fbULL, 0x723284d28f50aea2ULL}, {0xc5321857ba73abeeULL, 0xd57f1ceeb487443dULL, 0x54bd46f730174136ULL, 0x09414685e97b1b59ULL}},
+    {{0x6795505bf4f97b56ULL, 0xfadf69e1abb760f2ULL, 0xdf057d63dbb17512ULL, 0x330d232fa1cf7d21ULL}, {0xd8c2962a400766d1ULL, 0xf4b08d3c07b27fb8ULL, 0xf73af4544cccf6b1ULL, 0x4cb95957e83d40b0ULL}},
+    {{0x57f696886d76dfbfULL, 0xcb65335bb7caf16aULL, 0x99cb563ce7abb401ULL, 0x90a8b67ed2e6d154ULL}, {0x411e0315eaa4593bULL, 0xff15db5ed3c049b3ULL, 0xe1010f337ad4717eULL, 0xfa77968128d9c92eULL}},
+    {{0x890d88ce2c84596bULL, 0x1479376c2905d4baULL, 0xb167513853f5d433ULL, 0x8f264368f04301d9ULL}, {0x118d14b8462e1661ULL, 0x2e6dac9e6f26e961ULL, 0x9ccd3d7915b9e1daULL, 0x5f3032f5892156e3ULL}},
+    {{0x9ab88e9bac307f42ULL, 0x1e0554114ab0be7fULL, 0xf9d9bf0476fed794ULL, 0x309d096507710d6cULL}, {0xb39847b3cc092ff6ULL, 0x2eee1ff50c986ea6ULL, 0xcbdddcae0aa44254ULL, 0x8ec0ba238b96bec0ULL}},
+    {{0x291f70f8de1e873bULL, 0x79e054f13a2f60efULL, 0xd81c5d76967a81d5ULL, 0x8292903799c9e044ULL}, {0xebaac479ec1c8c1eULL, 0xa446989af04c4e25ULL, 0x4c5f37e0ecc5f9f6ULL, 0x8dc2412aafe3be5cULL}},
+    {{0xd6372271f3f309bbULL, 0x0c9196c4d333fcf6ULL, 0xf0c2ef7a6f7838e5ULL, 0xaad8f0b2bd30abdeULL}, {0x9626778e25b0674dULL, 0x9d58186a50e49713ULL, 0xd0e8c2a7ca5804a3ULL, 0x5e4631150e62fb40ULL}},
+    {{0x58a60b22526c24deULL, 0x84bddb39f4acbb50ULL, 0xa4d06222622d9d32ULL, 0x28eabe22cee183ddULL}, {0xb18041024edc07dcULL, 0xd784869d7e6ea67fULL, 0x19a528391c994624ULL, 0xf65f5d3e292c2e08ULL}},
+    {{0xb5f7d474aceb43f3ULL, 0x7f7f90b086ccfd73ULL, 0x533a9dd7ef778890ULL, 0xaecdefd0c3358ecdULL}, {0x62b675f194a3ddb4ULL, 0xfa1fbd583c064d24ULL, 0xd5404795539a5e68ULL, 0xf3e0319169eb9b85ULL}},
+    {{0x1feb25a8fe399d2dULL, 0xbfca43eb42c7f9f1ULL, 0xcaeeac7aff3c2d67ULL, 0x4db9267bb76c2c02ULL}, {0x55f4b031880d562cULL, 0xf925ce30d767ed6eULL, 0x39ba7f075e36ba2aULL, 0x42242a969283a5f3ULL}},
+    {{0x631e0d8332fae1efULL, 0xdf5daed4c77e1b62ULL, 0xd12ca4fd8a8d1e86ULL, 0x4a23f26eb70f60aaULL}, {0x10026dbd2d864e6bULL, 0x23fc63b65b35f86aULL, 0x7e4b4a7140737aecULL, 0x204b5d6f84822c30ULL}},
+    {{0x5a8add0fb9a43852ULL, 0x82f1e9a3ccf762f1ULL, 0xfd6d55fbbed899bdULL, 0xe378ca57b07eb88cULL}, {0xed16e96b58fa9913ULL, 0xd5caf9450f34bfc0ULL, 0x49d245b328984989ULL, 0x04f14351d0087efaULL}},
+    {{0xe6b55f70b1038e42ULL, 0x6645a5ea00b6172bULL, 0xeeabb561a27043ddULL, 0xcf1f4919c237ff97ULL}, {0xe7a36de01a8d6154ULL, 0xe62562d6744c169cULL, 0x1904f9a1c7543698ULL, 0x073867f59c0659e8ULL}},
+};
+
+// ---- multiword helpers
+
+static inline int cmp4(const fe_t a, const fe_t b) {
+  for (int i = 3; i >= 0; i--) {
+    if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+  }
+  return 0;
+}
+
+static inline bool is_zero4(const fe_t a) {
+  return !(a[0] | a[1] | a[2] | a[3]);
+}
+
+/** r = a + b, returns the carry */
+static inline uint64_t add4(fe_t r, const fe_t a, const fe_t b) {
+  u128_t c = 0;
+  for (int i = 0; i < 4; i++) {
+    c += (u128_t) a[i] + b[i];
+    r[i] = (uint64_t) c;
+    c >>= 64;
+  }
+  return (uint64_t) c;
+}
+
+/** r = a - b, returns the borrow */
+static inline uint64_t sub4(fe_t r, const fe_t a, const fe_t b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    u128_t d = (u128_t) a[i] - b[i] - borrow;
+    r[i]     = (uint64_t) d;
+    borrow   = (uint64_t) (d >> 64) & 1;
+  }
+  return borrow;
+}
+
+/** t = a * b */
+static inline void mul4(uint64_t t[8], const fe_t a, const fe_t b) {
+  memset(t, 0, 8 * sizeof(uint64_t));
+  for (int i = 0; i < 4; i++) {
+    u128_t c = 0;
+    for (int j = 0; j < 4; j++) {
+      c += (u128_t) a[i] * b[j] + t[i + j];
+      t[i + j] = (uint64_t) c;
+      c >>= 64;
+    }
+    t[i + 4] = (uint64_t) c;
+  }
+}
+
+static void read_be(fe_t r, const uint8_t* b) {
+  for (int i = 0; i < 4; i++) {
+    uint64_t v = 0;
+    for (int j = 0; j < 8; j++) v = (v << 8) | b[(3 - i) * 8 + j];
+    r[i] = v;
+  }
+}
+
+static void write_be(uint8_t* b, const fe_t a) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 8; j++) b[(3 - i) * 8 + j] = (uint8_t) (a[i] >> (56 - 8 * j));
+  }
+}
+
+/** r = a ^ e using 4bit windows */
+static void pow4(fe_t r, const fe_t a, const fe_t e, void (*mul)(fe_t, const fe_t, const fe_t)) {
+  fe_t table[16], res;
+  memcpy(table[0], ONE, sizeof(fe_t));
+  memcpy(table[1], a, sizeof(fe_t));
+  for (int i = 2; i < 16; i++) mul(table[i], table[i - 1], a);
+  memcpy(res, ONE, sizeof(fe_t));
+  for (int i = 63; i >= 0; i--) {
+    for (int j = 0; j < 4; j++) mul(res, res, res);
+    unsigned int w = (e[i / 16] >> ((i % 16) * 4)) & 0xf;
+    if (w) mul(res, res, table[w]);
+  }
+  memcpy(r, res, sizeof(fe_t));
+}
+
+// ---- field arithmetic mod p. the values are kept below 2^256, but not always below p
+
+static void fe_reduce(fe_t r, const uint64_t t[8]) {
+  u128_t   c = 0;
+  uint64_t l[4];
+  for (int i = 0; i < 4; i++) {
+    c += (u128_t) t[4 + i] * P_C + t[i];
+    l[i] = (uint64_t) c;
+    c >>= 64;
+  }
+  c = (u128_t) ((uint64_t) c) * P_C + l[0];
+  r[0] = (uint64_t) c;
+  c >>= 64;
+  for (int i = 1; i < 4; i++) {
+    c += l[i];
+    r[i] = (uint64_t) c;
+    c >>= 64;
+  }
+  if (c) { // the result wrapped around, so it is small and adding the constant can not overflow again
+    c = (u128_t) r[0] + P_C;
+    r[0] = (uint64_t) c;
+    for (int i = 1; i < 4 && (c >>= 64); i++) {
+      c += r[i];
+      r[i] = (uint64_t) c;
+    }
+  }
+}
+
+static void fe_mul(fe_t r, const fe_t a, const fe_t b) {
+  uint64_t t[8];
+  mul4(t, a, b);
+  fe_reduce(r, t);
+}
+
+static inline void fe_sqr(fe_t r, const fe_t a) {
+  fe_mul(r, a, a);
+}
+
+static void fe_add(fe_t r, const fe_t a, const fe_t b) {
+  static const fe_t c = {P_C, 0, 0, 0};
+  if (add4(r, a, b)) {
+    while (add4(r, r, c)) {}
+  }
+}
+
+static void fe_sub(fe_t r, const fe_t a, const fe_t b) {
+  static const fe_t c = {P_C, 0, 0, 0};
+  if (sub4(r, a, b)) {
+    while (sub4(r, r, c)) {}
+  }
+}
+
+static inline void fe_neg(fe_t r, const fe_t a) {
+  static const fe_t zero = {0, 0, 0, 0};
+  fe_sub(r, zero, a);
+}
+
+/** r = a * k for small k */
+static void fe_mul_int(fe_t r, const fe_t a, uint64_t k) {
+  u128_t c = 0;
+  for (int i = 0; i < 4; i++) {
+    c += (u128_t) a[i] * k;
+    r[i] = (uint64_t) c;
+    c >>= 64;
+  }
+  uint64_t t[8] = {r[0], r[1], r[2], r[3], (uint64_t) c, 0, 0, 0};
+  fe_reduce(r, t);
+}
+
+static inline void fe_normalize(fe_t a) {
+  if (cmp4(a, P) >= 0) sub4(a, a, P);
+}
+
+static inline bool fe_is_zero(const fe_t a) {
+  fe_t t;
+  memcpy(t, a, sizeof(fe_t));
+  fe_normalize(t);
+  return is_zero4(t);
+}
+
+static inline bool fe_equal(const fe_t a, const fe_t b) {
+  fe_t t;
+  fe_sub(t, a, b);
+  return fe_is_zero(t);
+}
+
+// ---- scalar arithmetic mod n. the values are always below n
+
+static void sc_reduce(fe_t r, const uint64_t t[8]) {
+  uint64_t a[8];
+  int      len = 8;
+  memcpy(a, t, sizeof(a));
+  for (; len > 4 && !a[len - 1]; len--) {}
+  while (len > 4) { // a = low + high * (2^256 - n)
+    uint64_t u[8] = {a[0], a[1], a[2], a[3], 0, 0, 0, 0};
+    for (int i = 0; i < len - 4; i++) {
+      u128_t c = 0;
+      for (int j = 0; j < 3; j++) {
+        c += (u128_t) a[4 + i] * N_C[j] + u[i + j];
+        u[i + j] = (uint64_t) c;
+        c >>= 64;
+      }
+      for (int j = i + 3; c && j < 8; j++) {
+        c += u[j];
+        u[j] = (uint64_t) c;
+        c >>= 64;
+      }
+    }
+    memcpy(a, u, sizeof(a));
+    for (len = 8; len > 4 && !a[len - 1]; len--) {}
+  }
+  memcpy(r, a, sizeof(fe_t));
+  if (cmp4(r, N) >= 0) sub4(r, r, N);
+}
+
+static void sc_mul(fe_t r, const fe_t a, const fe_t b) {
+  uint64_t t[8];
+  mul4(t, a, b);
+  sc_reduce(r, t);
+}
+
+static void sc_add(fe_t r, const fe_t a, const fe_t b) {
+  if (add4(r, a, b) || cmp4(r, N) >= 0) sub4(r, r, N);
+}
+
+static void sc_neg(fe_t r, const fe_t a) {
+  if (is_zero4(a))
+    memset(r, 0, sizeof(fe_t));
+  else
+    sub4(r, N, a);
+}
+
+/** r = round(a * b / 2^384) */
+static void sc_mul_shift_384(fe_t r, const fe_t a, const fe_t b) {
+  uint64_t t[8];
+  mul4(t, a, b);
+  r[0] = t[6];
+  r[1] = t[7];
+  r[2] = r[3] = 0;
+  if (t[5] >> 63) {
+    static const fe_t one = {1, 0, 0, 0};
+    add4(r, r, one);
+  }
+}
+
+/** splits k into k1 + k2 * lambda with k1 and k2 having about 128 bits */
+static void sc_split(fe_t k1, fe_t k2, const fe_t k) {
+  fe_t c1, c2;
+  sc_mul_shift_384(c1, k, G1);
+  sc_mul_shift_384(c2, k, G2);
+  sc_mul(c1, c1, MINUS_B1);
+  sc_mul(c2, c2, MINUS_B2);
+  sc_add(k2, c1, c2);
+  sc_mul(k1, k2, LAMBDA);
+  sc_neg(k1, k1);
+  sc_add(k1, k1, k);
+}
+
+/**
+ * writes the wnaf-representation of the scalar.
+ * if the scalar is larger than n/2 the representation of -k is negated, which keeps the splitted scalars small.
+ * returns the number of digits.
+ */
+static int sc_wnaf(int8_t* out, const fe_t k, int w) {
+  uint64_t a[5]  = {k[0], k[1], k[2], k[3], 0};
+  fe_t     half  = {0xDFE92F46681B20A0ULL, 0x5D576E7357A4501DULL, 0xFFFFFFFFFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL};
+  int      sign  = 1, len = 0;
+  int      range = 1 << w;
+  if (cmp4(k, half) > 0) {
+    sc_neg(a, k);
+    sign = -1;
+  }
+  memset(out, 0, WNAF_LEN);
+  while (a[0] | a[1] | a[2] | a[3] | a[4]) {
+    if (a[0] & 1) {
+      int d = (int) (a[0] & (range - 1));
+      if (d >= range / 2) d -= range;
+      if (d > 0) { // a -= d
+        uint64_t b = (uint64_t) d;
+        for (int i = 0; i < 5 && b; i++) {
+          uint64_t o = a[i];
+          a[i]       = o - b;
+          b          = o < b;
+        }
+      }
+      else { // a += -d
+        uint64_t c = (uint64_t) -d;
+        for (int i = 0; i < 5 && c; i++) {
+          a[i] += c;
+          c = a[i] < c;
+        }
+      }
+      out[len] = (int8_t) (d * sign);
+    }
+    for (int i = 0; i < 4; i++) a[i] = (a[i] >> 1) | (a[i + 1] << 63);
+    a[4] >>= 1;
+    len++;
+  }
+  return len;
+}
+
+// ---- point arithmetic
+
+static void jac_double(jac_t* r, const jac_t* p) {
+  if (p->inf) {
+    r->inf = true;
+    return;
+  }
+  fe_t a, b, c, d, e, f;
+  fe_sqr(a, p->x);
+  fe_sqr(b, p->y);
+  fe_sqr(c, b);
+  fe_add(d, p->x, b);
+  fe_sqr(d, d);
+  fe_sub(d, d, a);
+  fe_sub(d, d, c);
+  fe_add(d, d, d); // d = 2 * ((x + b)^2 - a - c)
+  fe_mul_int(e, a, 3);
+  fe_sqr(f, e);
+  fe_mul(r->z, p->y, p->z);
+  fe_add(r->z, r->z, r->z);
+  fe_sub(r->x, f, d);
+  fe_sub(r->x, r->x, d);
+  fe_sub(d, d, r->x);
+  fe_mul(r->y, e, d);
+  fe_mul_int(c, c, 8);
+  fe_sub(r->y, r->y, c);
+  r->inf = false;
+}
+
+/** adds the points with u1 = x1*z2^2, s1 = y1*z2^3, u2 = x2*z1^2, s2 = y2*z1^3 already computed. z is z1*z2 */
+static void jac_add_finish(jac_t* r, const jac_t* p, const fe_t u1, const fe_t s1, const fe_t u2, const fe_t s2, const fe_t z) {
+  fe_t h, rr, hh, hhh, v;
+  fe_sub(h, u2, u1);
+  fe_sub(rr, s2, s1);
+  if (fe_is_zero(h)) {
+    if (fe_is_zero(rr))
+      jac_double(r, p);
+    else
+      r->inf = true;
+    return;
+  }
+  fe_sqr(hh, h);
+  fe_mul(hhh, h, hh);
+  fe_mul(v, u1, hh);
+  fe_mul(r->z, z, h);
+  fe_sqr(r->x, rr);
+  fe_sub(r->x, r->x, hhh);
+  fe_sub(r->x, r->x, v);
+  fe_sub(r->x, r->x, v);
+  fe_sub(v, v, r->x);
+  fe_mul(r->y, rr, v);
+  fe_mul(hhh, hhh, s1);
+  fe_sub(r->y, r->y, hhh);
+  r->inf = false;
+}
+
+/** r = p + q for q being affine (with y negated if neg is set) */
+static void jac_add_aff(jac_t* r, const jac_t* p, const aff_t* q, bool neg) {
+  fe_t z2, u2, s2, qy;
+  if (neg)
+    fe_neg(qy, q->y);
+  else
+    memcpy(qy, q->y, sizeof(fe_t));
+  if (p->inf) {
+    memcpy(r->x, q->x, sizeof(fe_t));
+    memcpy(r->y, qy, sizeof(fe_t));
+    memcpy(r->z, ONE, sizeof(fe_t));
+    r->inf = false;
+    return;
+  }
+  fe_sqr(z2, p->z);
+  fe_mul(u2, q->x, z2);
+  fe_mul(s2, qy, z2);
+  fe_mul(s2, s2, p->z);
+  jac_t pc = *p;
+  jac_add_finish(r, &pc, pc.x, pc.y, u2, s2, pc.z);
+}
+
+/** r = p + q (with the y of q negated if neg is set) */
+static void jac_add(jac_t* r, const jac_t* p, const jac_t* q, bool neg) {
+  if (q->inf) {
+    if (r != p) *r = *p;
+    return;
+  }
+  jac_t qc = *q;
+  if (neg) fe_neg(qc.y, qc.y);
+  if (p->inf) {
+    *r = qc;
+    return;
+  }
+  fe_t z1z1, z2z2, u1, u2, s1, s2, z;
+  fe_sqr(z1z1, p->z);
+  fe_sqr(z2z2, qc.z);
+  fe_mul(u1, p->x, z2z2);
+  fe_mul(u2, qc.x, z1z1);
+  fe_mul(s1, p->y, z2z2);
+  fe_mul(s1, s1, qc.z);
+  fe_mul(s2, qc.y, z1z1);
+  fe_mul(s2, s2, p->z);
+  fe_mul(z, p->z, qc.z);
+  jac_t pc = *p;
+  jac_add_finish(r, &pc, u1, s1, u2, s2, z);
+}
+
+/** q = u1 * G + u2 * R */
+static void ecmult(jac_t* q, const aff_t* pr, const fe_t u1, const fe_t u2) {
+  int8_t wg1[WNAF_LEN], wg2[WNAF_LEN], wa1[WNAF_LEN], wa2[WNAF_LEN];
+  fe_t   k1, k2;
+  jac_t  ta[1 << (WINDOW_A - 2)], tl[1 << (WINDOW_A - 2)], d;
+
+  sc_split(k1, k2, u1);
+  int lg1 = sc_wnaf(wg1, k1, WINDOW_G);
+  int lg2 = sc_wnaf(wg2, k2, WINDOW_G);
+  sc_split(k1, k2, u2);
+  int la1 = sc_wnaf(wa1, k1, WINDOW_A);
+  int la2 = sc_wnaf(wa2, k2, WINDOW_A);
+
+  // odd multiples of R and lambda * R
+  memcpy(ta[0].x, pr->x, sizeof(fe_t));
+  memcpy(ta[0].y, pr->y, sizeof(fe_t));
+  memcpy(ta[0].z, ONE, sizeof(fe_t));
+  ta[0].inf = false;
+  jac_double(&d, ta);
+  for (int i = 1; i < (1 << (WINDOW_A - 2)); i++) jac_add(ta + i, ta + i - 1, &d, false);
+  for (int i = 0; i < (1 << (WINDOW_A - 2)); i++) {
+    tl[i] = ta[i];
+    fe_mul(tl[i].x, ta[i].x, BETA);
+  }
+
+  int len = lg1;
+  if (lg2 > len) len = lg2;
+  if (la1 > len) len = la1;
+  if (la2 > len) len = la2;
+
+  q->inf = true;
+  for (int i = len - 1; i >= 0; i--) {
+    jac_double(q, q);
+    if (wg1[i]) jac_add_aff(q, q, G_TABLE + (abs(wg1[i]) >> 1), wg1[i] < 0);
+    if (wg2[i]) jac_add_aff(q, q, G_LAMBDA_TABLE + (abs(wg2[i]) >> 1), wg2[i] < 0);
+    if (wa1[i]) jac_add(q, q, ta + (abs(wa1[i]) >> 1), wa1[i] < 0);
+    if (wa2[i]) jac_add(q, q, tl + (abs(wa2[i]) >> 1), wa2[i] < 0);
+  }
+}
+
+// ---- recovery
+
+/** reads the signature and computes the point R. */
+static bool rec_init(rec_t* rec, const uint8_t* sig, const uint8_t* digest) {
+  static const fe_t seven = {7, 0, 0, 0};
+  int               recid = sig[64] % 27;
+  fe_t              y2, t;
+
+  read_be(rec->r, sig);
+  read_be(rec->s, sig + 32);
+  read_be(rec->z, digest);
+  if (cmp4(rec->z, N) >= 0) sub4(rec->z, rec->z, N);
+  if (is_zero4(rec->r) || cmp4(rec->r, N) >= 0 || is_zero4(rec->s) || cmp4(rec->s, N) >= 0) return false;
+
+  memcpy(rec->p.x, rec->r, sizeof(fe_t));
+  if ((recid & 2) && (add4(rec->p.x, rec->p.x, N) || cmp4(rec->p.x, P) >= 0)) return false;
+
+  // y = sqrt(x^3 + 7)
+  fe_sqr(y2, rec->p.x);
+  fe_mul(y2, y2, rec->p.x);
+  fe_add(y2, y2, seven);
+  pow4(rec->p.y, y2, P_SQRT, fe_mul);
+  fe_sqr(t, rec->p.y);
+  if (!fe_equal(t, y2)) return false;
+  fe_normalize(rec->p.y);
+  if ((int) (rec->p.y[0] & 1) != (recid & 1)) {
+    fe_neg(rec->p.y, rec->p.y);
+    fe_normalize(rec->p.y);
+  }
+  return true;
+}
+
+unsigned int secp256k1_recover_batch(unsigned int len, const uint8_t* const* sigs, const uint8_t* const* digests, uint8_t* pubkeys, int* results) {
+  rec_t        single;
+  rec_t*       recs   = len > 1 ? _malloc(len * sizeof(rec_t)) : &single;
+  unsigned int failed = 0;
+  fe_t         acc, inv, t;
+
+  for (unsigned int i = 0; i < len; i++) recs[i].valid = rec_init(recs + i, sigs[i], digests[i]);
+
+  // invert all r at once: inv(r_i) = prod(r_0..r_i-1) * inv(prod(r_0..r_i))
+  memcpy(acc, ONE, sizeof(fe_t));
+  for (unsigned int i = 0; i < len; i++) {
+    if (!recs[i].valid) continue;
+    memcpy(recs[i].prod, acc, sizeof(fe_t));
+    sc_mul(acc, acc, recs[i].r);
+  }
+  pow4(inv, acc, N_MINUS2, sc_mul);
+  for (unsigned int i = len; i-- > 0;) {
+    if (!recs[i].valid) continue;
+    sc_mul(t, inv, recs[i].prod); // inverse of r_i
+    sc_mul(inv, inv, recs[i].r);
+    memcpy(recs[i].prod, t, sizeof(fe_t));
+  }
+
+  // Q = -z/r * G + s/r * R
+  for (unsigned int i = 0; i < len; i++) {
+    if (!recs[i].valid) continue;
+    rec_t* rec = recs + i;
+    fe_t   u1, u2;
+    sc_mul(u1, rec->z, rec->prod);
+    sc_neg(u1, u1);
+    sc_mul(u2, rec->s, rec->prod);
+    ecmult(&rec->q, &rec->p, u1, u2);
+    if (rec->q.inf || fe_is_zero(rec->q.z)) rec->valid = false;
+  }
+
+  // invert all z at once
+  memcpy(acc, ONE, sizeof(fe_t));
+  for (unsigned int i = 0; i < len; i++) {
+    if (!recs[i].valid) continue;
+    memcpy(recs[i].prod, acc, sizeof(fe_t));
+    fe_mul(acc, acc, recs[i].q.z);
+  }
+  pow4(inv, acc, P_MINUS2, fe_mul);
+  for (unsigned int i = len; i-- > 0;) {
+    rec_t* rec = recs + i;
+    if (results) results[i] = rec->valid ? 0 : 1;
+    if (!rec->valid) {
+      memset(pubkeys + i * 64, 0, 64);
+      failed++;
+      continue;
+    }
+    fe_t zi, zi2;
+    fe_mul(zi, inv, rec->prod);
+    fe_mul(inv, inv, rec->q.z);
+    fe_sqr(zi2, zi);
+    fe_mul(rec->q.x, rec->q.x, zi2);
+    fe_mul(zi2, zi2, zi);
+    fe_mul(rec->q.y, rec->q.y, zi2);
+    fe_normalize(rec->q.x);
+    fe_normalize(rec->q.y);
+    write_be(pubkeys + i * 64, rec->q.x);
+    write_be(pubkeys + i * 64 + 32, rec->q.y);
+  }
+
+  if (recs != &single) _free(recs);
+  return failed;
+}
+
+int secp256k1_recover(const uint8_t* sig, const uint8_t* digest, uint8_t* pubkey) {
+  return secp256k1_recover_batch(1, &sig, &digest, pubkey, NULL) ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * optimized recovery of secp256k1 public keys from signatures.
+ *
+ * The field and scalar arithmetic uses 4x64bit limbs, the point multiplication splits the scalars with the GLV-endomorphism
+ * and combines them in one wNAF-loop using a precomputed table for the generator.
+ * This requires a compiler supporting 128bit integers, otherwise the generic implementation of the crypto-lib is used.
+ * */
+
+#ifndef UTIL_SECP256K1_RECOVER_H
+#define UTIL_SECP256K1_RECOVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#if defined(SECP256K1_FAST) && defined(__SIZEOF_INT128__)
+#define SECP256K1_RECOVER_FAST
+
+/**
+ * recovers the public key from a signature.
+ *
+ * returns 0 if the public key could be recovered.
+ */
+int secp256k1_recover(
+    const uint8_t* sig,    /**< the 65 bytes signature (r,s,v) with v being the recovery id (v % 27 is used) */
+    const uint8_t* digest, /**< the 32 bytes digest which was signed */
+    uint8_t*       pubkey  /**< the 64 bytes to write the public key to (without 0x04 prefix) */
+);
+
+/**
+ * recovers the public keys of multiple signatures.
+ *
+ * All signatures share the modular inversions, which makes this faster than recovering each signature on its own.
+ * returns the number of signatures which could not be recovered.
+ */
+unsigned int secp256k1_recover_batch(
+    unsigned int          len,     /**< the number of signatures */
+    const uint8_t* const* sigs,    /**< pointers to the 65 bytes signatures */
+    const uint8_t* const* digests, /**< pointers to the 32 bytes digests */
+    uint8_t*              pubkeys, /**< the len * 64 bytes to write the public keys to */
+    int*                  results  /**< if not NULL the result for each signature is written to it ( 0 if it could be recovered) */
+);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -54,6 +54,11 @@
 #include <unistd.h>
 #endif
 
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define IN3_SSE2
+#endif
+
 #ifdef __ZEPHYR__
 static uint64_t time_zephyr(void* t) {
   UNUSED_VAR(t);
@@ -144,6 +149,43 @@ const char* u64_to_str(uint64_t value, char* buffer, int buffer_len) {
 }
 #endif
 
+#ifdef IN3_SSE2
+/** returns a mask with the bits set for each of the 16 chars which is a hex char and sets the value of each char in nibbles. */
+static inline int hex_block(const char* src, __m128i* nibbles) {
+  const __m128i x         = _mm_loadu_si128((const __m128i*) src);
+  const __m128i digit     = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+  const __m128i letter    = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a')); // lowercase, since 'A'|0x20 == 'a'
+  const __m128i is_digit  = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);          // unsigned digit <= 9
+  const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);        // unsigned letter <= 5
+  *nibbles                = _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_andnot_si128(is_digit, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+  return _mm_movemask_epi8(_mm_or_si128(is_digit, is_letter));
+}
+
+/** converts 16 hex chars into 8 bytes, but only if all of them are hex chars. */
+static inline bool hex_block_to_bytes(const char* src, uint8_t* dst) {
+  __m128i nibbles;
+  if (hex_block(src, &nibbles) != 0xFFFF) return false;
+  // each 16bit lane holds the high nibble in the lower byte and the low nibble in the upper byte.
+  const __m128i b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0xFF)), 4), _mm_srli_epi16(nibbles, 8));
+  _mm_storel_epi64((__m128i*) dst, _mm_packus_epi16(b, b));
+  return true;
+}
+#endif
+
+bool is_hex_chars(const char* c, int len) {
+  int i = 0;
+#ifdef IN3_SSE2
+  __m128i nibbles;
+  for (; i + 16 <= len; i += 16) {
+    if (hex_block(c + i, &nibbles) != 0xFFFF) return false;
+  }
+#endif
+  for (; i < len; i++) {
+    if (hexchar_to_int(c[i]) == 255) return false;
+  }
+  return true;
+}
+
 int hex_to_bytes(const char* buf, int len, uint8_t* out, int outbuf_size) {
   if (!buf || len < -1) return len == 0 ? 0 : -1;
   if (len == -1) len = strlen(buf);
@@ -161,6 +203,10 @@ int hex_to_bytes(const char* buf, int len, uint8_t* out, int outbuf_size) {
     j = i = 1;
   }
 
+#ifdef IN3_SSE2
+  // blocks with invalid chars are handled by the loop below.
+  for (; i + 16 <= len && hex_block_to_bytes(buf + i, out + j); i += 16, j += 8) {}
+#endif
   for (; i < len; i += 2, ++j)
     out[j] = (hexchar_to_int(buf[i]) << 4) | hexchar_to_int(buf[i + 1]);
 
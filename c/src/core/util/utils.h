@@ -110,6 +110,9 @@ uint64_t char_to_long(const char* a, int l);
 /**  converts a hexchar to byte (4bit). In case of a nonhex char 0xff will be returned. */
 uint8_t hexchar_to_int(char c);
 
+/** returns true if all len chars are hex chars (without a 0x-prefix). */
+bool is_hex_chars(const char* c, int len);
+
 #ifdef __ZEPHYR__
 // this function is only used in zephyr, because there it does not support printf("%ull",u64);
 
@@ -381,6 +384,31 @@ char* bytes_to_hex_string(char* out, const char* prefix, const bytes_t b, const
         ReleaseMutex(_NAME(_lock_handle_, NAME)); \
   }
 
+typedef HANDLE in3_mutex_t;
+#define MUTEX_INIT(mutex)   mutex = CreateMutex(NULL, FALSE, NULL);
+#define MUTEX_LOCK(mutex)   WaitForSingleObject(mutex, INFINITE);
+#define MUTEX_UNLOCK(mutex) ReleaseMutex(mutex);
+#define MUTEX_FREE(mutex)   CloseHandle(mutex);
+
+// on windows a condition is a manual-reset event, so it can only be signaled once.
+typedef HANDLE in3_cond_t;
+#define COND_INIT(cond)        cond = CreateEvent(NULL, TRUE, FALSE, NULL);
+#define COND_WAIT(cond, mutex)            \
+  {                                       \
+    ReleaseMutex(mutex);                  \
+    WaitForSingleObject(cond, INFINITE);  \
+    WaitForSingleObject(mutex, INFINITE); \
+  }
+#define COND_WAIT_MS(cond, mutex, ms)     \
+  {                                       \
+    ReleaseMutex(mutex);                  \
+    WaitForSingleObject(cond, ms);        \
+    WaitForSingleObject(mutex, INFINITE); \
+  }
+#define COND_BROADCAST(cond) SetEvent(cond);
+#define COND_FREE(cond)      CloseHandle(cond);
+#define THREAD_ID()          ((uintptr_t) GetCurrentThreadId())
+
 #else
 #include <pthread.h>
 #define INIT_LOCK(NAME) static pthread_mutex_t _NAME(_lock_handle_, NAME) = PTHREAD_MUTEX_INITIALIZER;
@@ -390,10 +418,37 @@ char* bytes_to_hex_string(char* out, const char* prefix, const bytes_t b, const
     code                                                     \
         pthread_mutex_unlock(&(_NAME(_lock_handle_, NAME))); \
   }
+
+typedef pthread_mutex_t in3_mutex_t;
+#define MUTEX_INIT(mutex)                                      \
+  {                                                            \
+    pthread_mutexattr_t attr;                                  \
+    pthread_mutexattr_init(&attr);                             \
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); \
+    pthread_mutex_init(&(mutex), &attr);                       \
+  }
+#define MUTEX_LOCK(mutex)   pthread_mutex_lock(&(mutex));
+#define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&(mutex));
+#define MUTEX_FREE(mutex)   pthread_mutex_destroy(&(mutex));
+
+typedef pthread_cond_t in3_cond_t;
+#define COND_INIT(cond)        pthread_cond_init(&(cond), NULL);
+#define COND_WAIT(cond, mutex) pthread_cond_wait(&(cond), &(mutex));
+#define COND_WAIT_MS(cond, mutex, ms)                     \
+  {                                                       \
+    struct timespec _ts;                                  \
+    clock_gettime(CLOCK_REALTIME, &_ts);                  \
+    _ts.tv_nsec += (long) ((ms) % 1000) * 1000000;        \
+    _ts.tv_sec += (ms) / 1000 + _ts.tv_nsec / 1000000000; \
+    _ts.tv_nsec %= 1000000000;                            \
+    pthread_cond_timedwait(&(cond), &(mutex), &_ts);      \
+  }
+#define COND_BROADCAST(cond)   pthread_cond_broadcast(&(cond));
+#define COND_FREE(cond)        pthread_cond_destroy(&(cond));
+#define THREAD_ID()            ((uintptr_t) pthread_self())
 #endif
 #else
-#define INIT_LOCK(NAME) \
-  {}
+#define INIT_LOCK(NAME)
 #define LOCK(NAME, code) \
   { code }
 #endif
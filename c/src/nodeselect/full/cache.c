@@ -38,18 +38,67 @@
 #include "../../core/util/bitset.h"
 #include "../../core/util/log.h"
 #include "../../core/util/mem.h"
+#include "../../core/util/scache.h"
 #include "../../core/util/utils.h"
 #include "nodelist.h"
 #include "stdio.h"
 #include <assert.h>
 #include <inttypes.h>
+#include <stddef.h>
 #include <string.h>
 
 #define NODE_LIST_KEY   "nodelist_%d"
 #define WHITTE_LIST_KEY "_0x%s"
-#define CACHE_VERSION   7
+#define CACHE_VERSION   9
+#define CACHE_VERSION_8 8 // written field by field
+#define CACHE_VERSION_7 7 // written field by field with weights without latency stats
+#define CACHE_CHECKSUM  4 // position of the checksum of all data after the header
 #define MAX_KEYLEN      200
 
+/*
+ * Since version 9 the nodelist is stored with fixed positions, so it can be used without parsing:
+ *
+ *   header:     version (1 byte), checksum (4 bytes at CACHE_CHECKSUM), last_block, node count, hash count
+ *               and the positions of the node records, verified hashes and string table.
+ *   weights:    in3_node_weight_t for each node.
+ *   nodes:      fixed size records for each node with the position of its url within the string table.
+ *   hashes:     in3_verified_hash_t for each verified hash.
+ *   strings:    the 0-terminated urls of all nodes, which are used in place.
+ *
+ * The whitelist is stored as header (version, checksum, last_block and count) followed by the addresses.
+ * All numbers are stored in the byte order of the host.
+ */
+#define NL_LAST_BLOCK  8
+#define NL_NODE_COUNT  16
+#define NL_HASH_COUNT  20
+#define NL_NODES_POS   24
+#define NL_HASHES_POS  28
+#define NL_STRINGS_POS 32
+#define NL_HEADER_SIZE 40
+#define NODE_DEPOSIT   0
+#define NODE_PROPS     8
+#define NODE_CAPACITY  16
+#define NODE_INDEX     20
+#define NODE_URL       24
+#define NODE_ADDRESS   28
+#define NL_NODE_SIZE   48
+#define WL_LAST_BLOCK  8
+#define WL_COUNT       16
+#define WL_HEADER_SIZE 20
+
+static uint32_t read_u32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+static uint64_t read_u64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+static void write_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); }
+static void write_u64(uint8_t* p, uint64_t v) { memcpy(p, &v, 8); }
+
 /**
  * generates and writes the cachekey
  */
@@ -82,6 +131,111 @@ in3_ret_t in3_cache_init(in3_t* c, in3_nodeselect_def_t* data) {
   return IN3_OK;
 }
 
+/** counts the verified hashes to store */
+static uint32_t verified_hashes_count(in3_t* c) {
+  if (!c->chain.verified_hashes) return 0;
+  for (uint32_t i = 0; i < c->max_verified_hashes; i++) {
+    if (!c->chain.verified_hashes[i].block_number) return i;
+  }
+  return c->max_verified_hashes;
+}
+
+static void set_verified_hashes(in3_t* c, const uint8_t* hashes, uint32_t count) {
+  if (!c->chain.verified_hashes && count) c->chain.verified_hashes = _calloc(c->max_verified_hashes, sizeof(in3_verified_hash_t));
+  if (count) memcpy(c->chain.verified_hashes, hashes, sizeof(in3_verified_hash_t) * (min(count, c->max_verified_hashes)));
+}
+
+/** replaces the nodes with an empty nodelist of the given length */
+static void reset_nodelist(in3_nodeselect_def_t* data, uint64_t last_block, uint32_t node_count) {
+  in3_nodelist_clear(data);
+  if (data->nodelist_upd8_params) _free(data->nodelist_upd8_params);
+  data->last_block           = last_block;
+  data->nodelist_upd8_params = NULL;
+  NODELIST_STATS_LOCK(data)
+  data->nodelist_length = node_count;
+  data->nodelist        = _calloc(node_count, sizeof(in3_node_t));
+  data->weights         = _calloc(node_count, sizeof(in3_node_weight_t));
+  NODELIST_STATS_UNLOCK(data)
+}
+
+/** reads a nodelist of version 7 or 8, which were written field by field */
+static in3_ret_t read_legacy_nodelist(in3_t* c, in3_nodeselect_def_t* data, bytes_t* b, uint8_t version) {
+  size_t         pos        = 1;
+  const uint64_t last_block = b_read_long(b, &pos);
+  const int      node_count = b_read_int(b, &pos);
+  reset_nodelist(data, last_block, node_count);
+
+  // older versions only stored the weights up to the latency stats, which then start with 0
+  const size_t weight_size = version == CACHE_VERSION_8 ? sizeof(in3_node_weight_t) : offsetof(in3_node_weight_t, latency);
+  NODELIST_STATS_LOCK(data)
+  for (int i = 0; i < node_count; i++, pos += weight_size)
+    memcpy(data->weights + i, b->data + pos, weight_size);
+  NODELIST_STATS_UNLOCK(data)
+
+  for (int i = 0; i < node_count; i++) {
+    in3_node_t* n = data->nodelist + i;
+    n->capacity   = b_read_int(b, &pos);
+    n->index      = b_read_int(b, &pos);
+    n->deposit    = b_read_long(b, &pos);
+    n->props      = b_read_long(b, &pos);
+    memcpy(n->address, b->data + pos, 20);
+    pos += 20;
+    n->url = b_new_chars(b, &pos);
+    BIT_CLEAR(n->attrs, ATTR_WHITELISTED);
+  }
+
+  // read verified hashes
+  const unsigned int hashes = b_read_int(b, &pos);
+  set_verified_hashes(c, b->data + pos, hashes);
+  b_free(b);
+  return IN3_OK;
+}
+
+/**
+ * reads the nodelist, which then keeps the data, since the urls point to its string table.
+ */
+static in3_ret_t read_nodelist(in3_t* c, in3_nodeselect_def_t* data, bytes_t* b) {
+  const uint32_t node_count  = read_u32(b->data + NL_NODE_COUNT);
+  const uint32_t hash_count  = read_u32(b->data + NL_HASH_COUNT);
+  const uint32_t nodes_pos   = read_u32(b->data + NL_NODES_POS);
+  const uint32_t hashes_pos  = read_u32(b->data + NL_HASHES_POS);
+  const uint32_t strings_pos = read_u32(b->data + NL_STRINGS_POS);
+
+  // validate the layout, so we can use it without any further checks
+  if (nodes_pos != NL_HEADER_SIZE + (uint64_t) node_count * sizeof(in3_node_weight_t) ||
+      hashes_pos != nodes_pos + (uint64_t) node_count * NL_NODE_SIZE ||
+      strings_pos != hashes_pos + (uint64_t) hash_count * sizeof(in3_verified_hash_t) ||
+      strings_pos > b->len || (strings_pos < b->len && b->data[b->len - 1]) ||
+      read_u32(b->data + CACHE_CHECKSUM) != in3_cache_hash(bytes(b->data + NL_HEADER_SIZE, b->len - NL_HEADER_SIZE))) {
+    b_free(b);
+    return IN3_EINVALDT;
+  }
+  for (uint32_t i = 0; i < node_count; i++) {
+    if (strings_pos + read_u32(b->data + nodes_pos + i * NL_NODE_SIZE + NODE_URL) >= b->len) {
+      b_free(b);
+      return IN3_EINVALDT;
+    }
+  }
+
+  reset_nodelist(data, read_u64(b->data + NL_LAST_BLOCK), node_count);
+  NODELIST_STATS_LOCK(data)
+  memcpy(data->weights, b->data + NL_HEADER_SIZE, node_count * sizeof(in3_node_weight_t));
+  NODELIST_STATS_UNLOCK(data)
+  for (uint32_t i = 0; i < node_count; i++) {
+    const uint8_t* record = b->data + nodes_pos + i * NL_NODE_SIZE;
+    in3_node_t*    n      = data->nodelist + i;
+    n->deposit            = read_u64(record + NODE_DEPOSIT);
+    n->props              = read_u64(record + NODE_PROPS);
+    n->capacity           = read_u32(record + NODE_CAPACITY);
+    n->index              = read_u32(record + NODE_INDEX);
+    n->url                = (char*) b->data + strings_pos + read_u32(record + NODE_URL);
+    memcpy(n->address, record + NODE_ADDRESS, 20);
+  }
+  set_verified_hashes(c, b->data + hashes_pos, hash_count);
+  data->cached = b;
+  return IN3_OK;
+}
+
 /**
  * updates the nodlist from the cache.
  */
@@ -102,49 +256,18 @@ in3_ret_t in3_cache_update_nodelist(in3_t* c, in3_nodeselect_def_t* data) {
   bytes_t* b = cctx.content;
   if (!b) return IN3_OK;
 
-  // so we have a result... let's decode it.
-  int    node_count;
-  size_t pos = 0;
-
   // version check
-  if (b_read_byte(b, &pos) != CACHE_VERSION) {
+  const uint8_t version = b->len ? b->data[0] : 0;
+  in3_ret_t     res     = IN3_EVERS;
+  if (version == CACHE_VERSION && b->len >= NL_HEADER_SIZE)
+    res = read_nodelist(c, data, b);
+  else if (version == CACHE_VERSION_7 || version == CACHE_VERSION_8)
+    res = read_legacy_nodelist(c, data, b, version);
+  else
     b_free(b);
-    return IN3_EVERS;
-  }
-
-  // clean up old
-  in3_nodelist_clear(data);
-  if (data->nodelist_upd8_params) _free(data->nodelist_upd8_params);
-
-  data->last_block           = b_read_long(b, &pos);
-  data->nodelist_length      = (node_count = b_read_int(b, &pos));
-  data->nodelist             = _calloc(node_count, sizeof(in3_node_t));
-  data->weights              = _calloc(node_count, sizeof(in3_node_weight_t));
-  data->nodelist_upd8_params = NULL;
-  memcpy(data->weights, b->data + pos, node_count * sizeof(in3_node_weight_t));
-  pos += node_count * sizeof(in3_node_weight_t);
-
-  for (int i = 0; i < node_count; i++) {
-    in3_node_t* n = data->nodelist + i;
-    n->capacity   = b_read_int(b, &pos);
-    n->index      = b_read_int(b, &pos);
-    n->deposit    = b_read_long(b, &pos);
-    n->props      = b_read_long(b, &pos);
-    memcpy(n->address, b->data + pos, 20);
-    pos += 20;
-    n->url = b_new_chars(b, &pos);
-    BIT_CLEAR(n->attrs, ATTR_WHITELISTED);
-  }
 
-  // read verified hashes
-  const unsigned int hashes = b_read_int(b, &pos);
-  if (!c->chain.verified_hashes && hashes) c->chain.verified_hashes = _calloc(c->max_verified_hashes, sizeof(in3_verified_hash_t));
-  if (hashes)
-    memcpy(c->chain.verified_hashes, b->data + pos, sizeof(in3_verified_hash_t) * (min(hashes, c->max_verified_hashes)));
-
-  b_free(b);
-  data->dirty = false;
-  return IN3_OK;
+  if (res == IN3_OK) data->dirty = false;
+  return res;
 }
 
 in3_ret_t in3_cache_store_nodelist(in3_t* c, in3_nodeselect_def_t* data) {
@@ -154,52 +277,55 @@ in3_ret_t in3_cache_store_nodelist(in3_t* c, in3_nodeselect_def_t* data) {
   // it is ok not to have a storage
   if (!in3_plugin_is_registered(c, PLGN_ACT_CACHE_SET) || !data->dirty) return IN3_OK;
 
-  // write to bytes_buffer
-  bytes_builder_t* bb = bb_new();
-  bb_write_byte(bb, CACHE_VERSION); // Version flag
-  bb_write_long(bb, data->last_block);
-  bb_write_int(bb, data->nodelist_length);
-  bb_write_raw_bytes(bb, data->weights, data->nodelist_length * sizeof(in3_node_weight_t));
-
-  for (unsigned int i = 0; i < data->nodelist_length; i++) {
-    in3_node_t* n    = data->nodelist + i;
-    bytes_t     addr = bytes(n->address, 20);
-    bb_write_int(bb, n->capacity);
-    bb_write_int(bb, n->index);
-    bb_write_long(bb, n->deposit);
-    bb_write_long(bb, n->props);
-    bb_write_fixed_bytes(bb, addr);
-    bb_write_chars(bb, n->url, strlen(n->url));
+  // calculate the layout
+  const uint32_t node_count  = data->nodelist_length;
+  const uint32_t hash_count  = verified_hashes_count(c);
+  const uint32_t nodes_pos   = NL_HEADER_SIZE + node_count * sizeof(in3_node_weight_t);
+  const uint32_t hashes_pos  = nodes_pos + node_count * NL_NODE_SIZE;
+  const uint32_t strings_pos = hashes_pos + hash_count * sizeof(in3_verified_hash_t);
+  uint32_t       len         = strings_pos;
+  for (uint32_t i = 0; i < node_count; i++) len += strlen(data->nodelist[i].url ? data->nodelist[i].url : "") + 1;
+
+  bytes_t b = bytes(_calloc(1, len), len);
+  b.data[0] = CACHE_VERSION;
+  write_u64(b.data + NL_LAST_BLOCK, data->last_block);
+  write_u32(b.data + NL_NODE_COUNT, node_count);
+  write_u32(b.data + NL_HASH_COUNT, hash_count);
+  write_u32(b.data + NL_NODES_POS, nodes_pos);
+  write_u32(b.data + NL_HASHES_POS, hashes_pos);
+  write_u32(b.data + NL_STRINGS_POS, strings_pos);
+  NODELIST_STATS_LOCK(data)
+  memcpy(b.data + NL_HEADER_SIZE, data->weights, node_count * sizeof(in3_node_weight_t));
+  NODELIST_STATS_UNLOCK(data)
+
+  uint32_t url_pos = 0;
+  for (uint32_t i = 0; i < node_count; i++) {
+    const in3_node_t* n      = data->nodelist + i;
+    uint8_t*          record = b.data + nodes_pos + i * NL_NODE_SIZE;
+    const char*       url    = n->url ? n->url : "";
+    const uint32_t    l      = strlen(url) + 1;
+    write_u64(record + NODE_DEPOSIT, n->deposit);
+    write_u64(record + NODE_PROPS, n->props);
+    write_u32(record + NODE_CAPACITY, n->capacity);
+    write_u32(record + NODE_INDEX, n->index);
+    write_u32(record + NODE_URL, url_pos);
+    memcpy(record + NODE_ADDRESS, n->address, 20);
+    memcpy(b.data + strings_pos + url_pos, url, l);
+    url_pos += l;
   }
-
-  // verified hashes
-  int count = 0;
-  if (c->chain.verified_hashes) {
-    count = c->max_verified_hashes;
-    for (int i = 0; i < count; i++) {
-      if (!c->chain.verified_hashes[i].block_number) {
-        count = i;
-        break;
-      }
-    }
-    bb_write_int(bb, count);
-    bb_write_raw_bytes(bb, c->chain.verified_hashes, count * sizeof(in3_verified_hash_t));
-  }
-  else
-    bb_write_int(bb, 0);
+  if (hash_count) memcpy(b.data + hashes_pos, c->chain.verified_hashes, hash_count * sizeof(in3_verified_hash_t));
+  write_u32(b.data + CACHE_CHECKSUM, in3_cache_hash(bytes(b.data + NL_HEADER_SIZE, len - NL_HEADER_SIZE)));
 
   // create key
-  char key[200];
+  char key[MAX_KEYLEN];
   write_cache_key(key, c->chain.id, data->contract);
 
   // store it and ignore return value since failing when writing cache should not stop us.
-  in3_cache_ctx_t cctx = {.req = NULL, .content = &bb->b, .key = key};
+  in3_cache_ctx_t cctx = {.req = NULL, .content = &b, .key = key};
   in3_plugin_execute_all(c, PLGN_ACT_CACHE_SET, &cctx);
 
   data->dirty = false;
-
-  // clear buffer
-  bb_free(bb);
+  _free(b.data);
   return IN3_OK;
 }
 
@@ -222,10 +348,28 @@ in3_ret_t in3_cache_update_whitelist(in3_t* c, in3_nodeselect_def_t* data) {
   in3_plugin_execute_all(c, PLGN_ACT_CACHE_GET, &cctx);
   bytes_t* cached_data = cctx.content;
   if (cached_data) {
-    size_t pos = 0;
+    size_t   pos = 0;
+    uint64_t last_block;
+    uint32_t count;
 
     // version check
-    if (b_read_byte(cached_data, &pos) != CACHE_VERSION) {
+    const uint8_t version = cached_data->len ? cached_data->data[0] : 0;
+    if (version == CACHE_VERSION && cached_data->len >= WL_HEADER_SIZE) {
+      last_block = read_u64(cached_data->data + WL_LAST_BLOCK);
+      count      = read_u32(cached_data->data + WL_COUNT);
+      pos        = WL_HEADER_SIZE;
+      if (cached_data->len != WL_HEADER_SIZE + (uint64_t) count * 20 ||
+          read_u32(cached_data->data + CACHE_CHECKSUM) != in3_cache_hash(bytes(cached_data->data + WL_HEADER_SIZE, count * 20))) {
+        b_free(cached_data);
+        return IN3_EINVALDT;
+      }
+    }
+    else if (version == CACHE_VERSION_7 || version == CACHE_VERSION_8) {
+      pos        = 1;
+      last_block = b_read_long(cached_data, &pos);
+      count      = b_read_int(cached_data, &pos);
+    }
+    else {
       b_free(cached_data);
       return IN3_EVERS;
     }
@@ -234,10 +378,9 @@ in3_ret_t in3_cache_update_whitelist(in3_t* c, in3_nodeselect_def_t* data) {
     if (wl->addresses.data) _free(wl->addresses.data);
 
     // fill cached_data
-    wl->last_block         = b_read_long(cached_data, &pos);
-    uint32_t adress_length = b_read_int(cached_data, &pos) * 20;
-    wl->addresses          = bytes(_malloc(adress_length), adress_length);
-    memcpy(wl->addresses.data, cached_data->data + pos, adress_length);
+    wl->last_block = last_block;
+    wl->addresses  = bytes(_malloc(count * 20), count * 20);
+    memcpy(wl->addresses.data, cached_data->data + pos, count * 20);
     b_free(cached_data);
   }
   return IN3_OK;
@@ -251,11 +394,12 @@ in3_ret_t in3_cache_store_whitelist(in3_t* c, in3_nodeselect_def_t* data) {
   if (!in3_plugin_is_registered(c, PLGN_ACT_CACHE_SET) || !data->whitelist) return IN3_OK;
 
   const in3_whitelist_t* wl = data->whitelist;
-  bytes_builder_t*       bb = bb_new();
-  bb_write_byte(bb, CACHE_VERSION); // Version flag
-  bb_write_long(bb, wl->last_block);
-  bb_write_int(bb, wl->addresses.len / 20);
-  bb_write_fixed_bytes(bb, wl->addresses);
+  bytes_t                b  = bytes(_calloc(1, WL_HEADER_SIZE + wl->addresses.len), WL_HEADER_SIZE + wl->addresses.len);
+  b.data[0]                 = CACHE_VERSION;
+  write_u64(b.data + WL_LAST_BLOCK, wl->last_block);
+  write_u32(b.data + WL_COUNT, wl->addresses.len / 20);
+  if (wl->addresses.len) memcpy(b.data + WL_HEADER_SIZE, wl->addresses.data, wl->addresses.len);
+  write_u32(b.data + CACHE_CHECKSUM, in3_cache_hash(bytes(b.data + WL_HEADER_SIZE, wl->addresses.len)));
 
   // create key
   char key[MAX_KEYLEN];
@@ -263,11 +407,10 @@ in3_ret_t in3_cache_store_whitelist(in3_t* c, in3_nodeselect_def_t* data) {
 
   // store it and ignore return value since failing when writing cache should not stop us.
   in3_req_t       tmp_ctx = {.client = c};
-  in3_cache_ctx_t cctx    = {.req = &tmp_ctx, .key = key, .content = &bb->b};
+  in3_cache_ctx_t cctx    = {.req = &tmp_ctx, .key = key, .content = &b};
   in3_plugin_execute_first_or_none(&tmp_ctx, PLGN_ACT_CACHE_SET, &cctx);
 
-  // clear buffer
-  bb_free(bb);
+  _free(b.data);
   return IN3_OK;
 }
 #endif
@@ -48,10 +48,18 @@
 #define BLACKLISTTIME    DAY
 #define BLACKLISTWEIGHT  (7 * DAY)
 
-NONULL static void free_nodeList(in3_node_t* nodelist, unsigned int count) {
+#ifdef THREADSAFE
+#define NODELIST_LOCK(data)   MUTEX_LOCK(data->mutex)
+#define NODELIST_UNLOCK(data) MUTEX_UNLOCK(data->mutex)
+#else
+#define NODELIST_LOCK(data)   UNUSED_VAR(data);
+#define NODELIST_UNLOCK(data)
+#endif
+
+NONULL static void free_nodeList(const in3_nodeselect_def_t* data, in3_node_t* nodelist, unsigned int count) {
   // clean data..
   for (unsigned int i = 0; i < count; i++)
-    if (nodelist[i].url) _free(nodelist[i].url);
+    in3_node_free_url(data, nodelist[i].url);
   _free(nodelist);
 }
 
@@ -133,7 +141,11 @@ NONULL static in3_ret_t fill_chain(in3_nodeselect_def_t* data, in3_req_t* ctx, d
         }
       }
     }
-    if (old_index >= 0) memcpy(weights + i, data->weights + old_index, sizeof(in3_node_weight_t));
+    if (old_index >= 0) {
+      NODELIST_STATS_LOCK(data)
+      memcpy(weights + i, data->weights + old_index, sizeof(in3_node_weight_t));
+      NODELIST_STATS_UNLOCK(data)
+    }
 
     // if this is a newly registered node, we wait 24h before we use it, since this is the time where mallicous nodes may be unregistered.
     const uint64_t register_time = d_get_long(node, K_REGISTER_TIME);
@@ -151,17 +163,22 @@ NONULL static in3_ret_t fill_chain(in3_nodeselect_def_t* data, in3_req_t* ctx, d
 
   if (res == IN3_OK) {
     // successfull, so we can update the data.
-    free_nodeList(data->nodelist, data->nodelist_length);
+    NODELIST_STATS_LOCK(data)
+    free_nodeList(data, data->nodelist, data->nodelist_length);
     _free(data->weights);
+    if (data->cached) b_free(data->cached);
+    data->cached          = NULL;
     data->nodelist        = newList;
     data->nodelist_length = len;
     data->weights         = weights;
+    NODELIST_STATS_UNLOCK(data)
   }
   else {
-    free_nodeList(newList, len);
+    free_nodeList(data, newList, len);
     _free(weights);
   }
 
+  in3_nodelist_snapshot_clear(data);
   data->dirty = true;
   return res;
 }
@@ -179,6 +196,7 @@ NONULL void in3_client_run_chain_whitelisting(in3_nodeselect_def_t* data) {
       if (!memcmp(data->whitelist->addresses.data + i, data->nodelist[j].address, 20))
         BIT_SET(data->nodelist[j].attrs, ATTR_WHITELISTED);
   }
+  in3_nodelist_snapshot_clear(data);
 }
 
 NONULL static in3_ret_t in3_client_fill_chain_whitelist(in3_nodeselect_def_t* data, in3_req_t* ctx, d_token_t* result) {
@@ -389,9 +407,8 @@ static bool in_address_list(bytes_t* filter, address_t adr) {
   return false;
 }
 
-node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in3_nodeselect_def_t* data, in3_node_t* all_nodes, in3_node_weight_t* weights,
-                                        unsigned int len, uint64_t now, uint32_t* total_weight, unsigned int* total_found,
-                                        const in3_node_filter_t* filter, bytes_t* pre_filter) {
+node_match_t* in3_node_list_fill_weight(in3_nodeselect_config_t* w, in3_nodelist_snapshot_t* snapshot, uint64_t now, uint32_t* total_weight,
+                                        unsigned int* total_found, const in3_node_filter_t* filter, bytes_t* pre_filter) {
 
   int                found      = 0;
   uint32_t           weight_sum = 0;
@@ -402,9 +419,9 @@ node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in
   node_match_t*      first      = NULL;
   *total_found                  = 0;
 
-  for (unsigned int i = 0; i < len; i++) {
-    node_def   = all_nodes + i;
-    weight_def = weights + i;
+  for (unsigned int i = 0; i < snapshot->len; i++) {
+    node_def   = snapshot->nodes + i;
+    weight_def = snapshot->weights + i;
 
     if (pre_filter && !in_address_list(pre_filter, node_def->address)) continue;
 
@@ -435,11 +452,7 @@ node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in
     if (weight_def->blacklisted_until > (uint64_t) now) continue;
     if (BIT_CHECK(node_def->attrs, ATTR_BOOT_NODE)) goto SKIP_FILTERING;
 
-#ifdef NODESELECT_DEF_WL
-    if (data->whitelist && !BIT_CHECK(node_def->attrs, ATTR_WHITELISTED)) continue;
-#else
-    UNUSED_VAR(data);
-#endif
+    if (snapshot->whitelist && !BIT_CHECK(node_def->attrs, ATTR_WHITELISTED)) continue;
 
     if (node_def->deposit < w->min_deposit) continue;
     if (filter && !in3_node_props_match(filter->props, node_def->props)) continue;
@@ -447,12 +460,11 @@ node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in
   SKIP_FILTERING:
     current = _malloc(sizeof(node_match_t));
     if (!first) first = current;
-    current->index    = i;
-    node_def->blocked = false;
-    current->next     = NULL;
-    current->s        = weight_sum;
-    current->w        = in3_node_calculate_weight(weight_def, node_def->capacity, now);
-    current->url      = (c->flags & FLAGS_HTTP) ? to_http_url(node_def->url) : _strdupn(node_def->url, -1);
+    current->index = i;
+    current->next  = NULL;
+    current->s     = weight_sum;
+    current->w     = in3_node_calculate_weight(weight_def, node_def->capacity, now);
+    current->url   = NULL; // the url is only copied for the picked nodes
     memcpy(current->address, node_def->address, 20);
     weight_sum += current->w;
     found++;
@@ -464,6 +476,68 @@ node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in
   return first;
 }
 
+static node_match_t* set_urls(in3_t* c, in3_node_t* all_nodes, node_match_t* nodes) {
+  for (node_match_t* n = nodes; n; n = n->next) {
+    if (!n->url) n->url = (c->flags & FLAGS_HTTP) ? to_http_url(all_nodes[n->index].url) : _strdupn(all_nodes[n->index].url, -1);
+  }
+  return nodes;
+}
+
+/** the expected response time of a node, increased by its error rate */
+static uint64_t latency_score(const in3_node_weight_t* w, uint32_t capa) {
+  const uint64_t latency = w->latency ? w->latency : (10000 / (max(capa, 100) + 100));
+  return latency * (1000 + 4 * (uint64_t) w->error_rate);
+}
+
+/** picks nodes by choosing the better of two random candidates each time, which prefers fast nodes without sending all requests to the same one. */
+static node_match_t* pick_by_latency(node_match_t* found, unsigned int found_len, unsigned int request_count, in3_node_t* all_nodes, in3_node_weight_t* weights) {
+  node_match_t** candidates = _malloc(found_len * sizeof(node_match_t*));
+  node_match_t*  first      = NULL;
+  node_match_t** last       = &first;
+  unsigned int   len        = 0;
+  for (node_match_t* n = found; n && len < found_len; n = n->next) candidates[len++] = n;
+
+  for (unsigned int i = 0; i < request_count && len; i++) {
+    unsigned int pick = in3_rand(NULL) % len;
+    if (len > 1) {
+      unsigned int other = in3_rand(NULL) % (len - 1);
+      if (other >= pick) other++;
+      if (latency_score(weights + candidates[other]->index, all_nodes[candidates[other]->index].capacity) <
+          latency_score(weights + candidates[pick]->index, all_nodes[candidates[pick]->index].capacity))
+        pick = other;
+    }
+    *last            = candidates[pick];
+    last             = &(*last)->next;
+    candidates[pick] = candidates[--len];
+  }
+  *last = NULL;
+
+  // free the remaining candidates
+  for (unsigned int i = 0; i < len; i++) {
+    candidates[i]->next = NULL;
+    in3_req_free_nodes(candidates[i]);
+  }
+  _free(candidates);
+  return first;
+}
+
+/** nodes, which are picked again, are not blocked anymore. */
+static void unblock_nodes(in3_nodeselect_def_t* data, const in3_nodelist_snapshot_t* s, const node_match_t* found) {
+  const node_match_t* n = found;
+  while (n && !s->nodes[n->index].blocked) n = n->next;
+  if (!n) return; // we only need to lock the nodelist, if there is a blocked node.
+
+  NODELIST_LOCK(data)
+  NODELIST_STATS_LOCK(data)
+  for (; n; n = n->next) {
+    in3_node_t* node = get_node_idx(data, n->index);
+    if (node && !memcmp(node->address, n->address, 20)) node->blocked = false;
+  }
+  NODELIST_STATS_UNLOCK(data)
+  in3_nodelist_snapshot_clear(data);
+  NODELIST_UNLOCK(data)
+}
+
 static bool update_in_progress(const in3_req_t* ctx) {
   return req_is_method(ctx, "in3_nodeList");
 }
@@ -511,36 +585,53 @@ in3_ret_t in3_node_list_pick_nodes(in3_req_t* ctx, in3_nodeselect_config_t* w, i
   uint32_t           total_weight;
   unsigned int       all_nodes_len, total_found;
 
-  in3_ret_t res = in3_node_list_get(ctx, data, false, &all_nodes, &all_nodes_len, &weights);
+  // the nodelist is only locked to update it if needed and to take the snapshot we pick from
+  NODELIST_LOCK(data)
+  in3_ret_t                res = in3_node_list_get(ctx, data, false, &all_nodes, &all_nodes_len, &weights);
+  in3_nodelist_snapshot_t* s   = res < 0 ? NULL : in3_nodelist_snapshot(data);
+  NODELIST_UNLOCK(data)
   if (res < 0)
     return req_set_error(ctx, "could not find the data", res);
 
   // filter out nodes
-  node_match_t* found = in3_node_list_fill_weight(
-      ctx->client, w, data, all_nodes, weights, all_nodes_len,
-      now, &total_weight, &total_found, filter, data->pre_address_filter);
+  node_match_t* found = in3_node_list_fill_weight(w, s, now, &total_weight, &total_found, filter, s->pre_filter);
 
   if (total_found == 0) {
     // no node available, so we should check if we can retry some blacklisted
     unsigned int blacklisted = 0;
-    for (unsigned int i = 0; i < all_nodes_len; i++) {
-      if (weights[i].blacklisted_until > (uint64_t) now) blacklisted++;
+    for (unsigned int i = 0; i < s->len; i++) {
+      if (s->weights[i].blacklisted_until > (uint64_t) now) blacklisted++;
     }
 
     // if morethan 50% of the nodes are blacklisted, we remove the mark and try again
-    if (blacklisted > all_nodes_len / 2 || data->pre_address_filter) {
-      for (unsigned int i = 0; i < all_nodes_len; i++)
-        weights[i].blacklisted_until = 0;
-      found = in3_node_list_fill_weight(ctx->client, w, data, all_nodes, weights, all_nodes_len, now, &total_weight, &total_found, filter, NULL);
+    if (blacklisted > s->len / 2 || s->pre_filter) {
+      NODELIST_LOCK(data)
+      for (unsigned int i = 0; i < data->nodelist_length; i++)
+        data->weights[i].blacklisted_until = 0;
+      in3_nodelist_snapshot_clear(data);
+      in3_nodelist_snapshot_release(data, s);
+      s = in3_nodelist_snapshot(data);
+      NODELIST_UNLOCK(data)
+      found = in3_node_list_fill_weight(w, s, now, &total_weight, &total_found, filter, NULL);
     }
 
-    if (total_found == 0)
+    if (total_found == 0) {
+      in3_nodelist_snapshot_release(data, s);
       return req_set_error(ctx, "No nodes found that match the criteria", IN3_EFIND);
+    }
   }
+  unblock_nodes(data, s, found);
 
   unsigned int filled_len = total_found < request_count ? total_found : request_count;
+  if (w->selection == NODE_SELECTION_LATENCY) {
+    *nodes = set_urls(ctx->client, s->nodes, pick_by_latency(found, total_found, filled_len, s->nodes, s->weights));
+    in3_nodelist_snapshot_release(data, s);
+    return IN3_OK;
+  }
+
   if (total_found == filled_len) {
-    *nodes = found;
+    *nodes = set_urls(ctx->client, s->nodes, found);
+    in3_nodelist_snapshot_release(data, s);
     return IN3_OK;
   }
 
@@ -590,8 +681,9 @@ in3_ret_t in3_node_list_pick_nodes(in3_req_t* ctx, in3_nodeselect_config_t* w, i
     }
   }
 
-  *nodes = first;
+  *nodes = set_urls(ctx->client, s->nodes, first);
   if (found) in3_req_free_nodes(found);
+  in3_nodelist_snapshot_release(data, s);
 
   // select them based on random
   return res;
@@ -599,12 +691,84 @@ in3_ret_t in3_node_list_pick_nodes(in3_req_t* ctx, in3_nodeselect_config_t* w, i
 
 /** removes all nodes and their weights from the nodelist */
 void in3_nodelist_clear(in3_nodeselect_def_t* data) {
-  for (unsigned int i = 0; i < data->nodelist_length; i++) {
-    if (data->nodelist[i].url) _free(data->nodelist[i].url);
-  }
+  NODELIST_STATS_LOCK(data)
+  for (unsigned int i = 0; i < data->nodelist_length; i++)
+    in3_node_free_url(data, data->nodelist[i].url);
   _free(data->nodelist);
   _free(data->weights);
-  data->dirty = true;
+  data->nodelist        = NULL;
+  data->weights         = NULL;
+  data->nodelist_length = 0;
+  NODELIST_STATS_UNLOCK(data)
+  if (data->cached) b_free(data->cached);
+  in3_nodelist_snapshot_clear(data);
+  data->cached = NULL;
+  data->dirty  = true;
+}
+
+/** copies the nodes, weights and the pre_address_filter including the urls into one allocation. */
+static in3_nodelist_snapshot_t* snapshot_new(in3_nodeselect_def_t* data) {
+  const unsigned int len  = data->nodelist_length;
+  size_t             size = sizeof(in3_nodelist_snapshot_t) + len * (sizeof(in3_node_t) + sizeof(in3_node_weight_t));
+  if (data->pre_address_filter) size += sizeof(bytes_t) + data->pre_address_filter->len;
+  for (unsigned int i = 0; i < len; i++) size += data->nodelist[i].url ? strlen(data->nodelist[i].url) + 1 : 0;
+
+  in3_nodelist_snapshot_t* s = _malloc(size);
+  s->refs                    = 1; // the reference of the nodelist
+  s->len                     = len;
+  s->nodes                   = (in3_node_t*) (void*) (s + 1);
+  s->weights                 = (in3_node_weight_t*) (void*) (s->nodes + len);
+  s->pre_filter              = NULL;
+  s->created                 = in3_time(NULL);
+#ifdef NODESELECT_DEF_WL
+  s->whitelist = data->whitelist != NULL;
+#else
+  s->whitelist = false;
+#endif
+  if (len) {
+    NODELIST_STATS_LOCK(data)
+    memcpy(s->nodes, data->nodelist, len * sizeof(in3_node_t));
+    memcpy(s->weights, data->weights, len * sizeof(in3_node_weight_t));
+    NODELIST_STATS_UNLOCK(data)
+  }
+
+  uint8_t* p = (uint8_t*) (s->weights + len);
+  if (data->pre_address_filter) {
+    s->pre_filter  = (bytes_t*) (void*) p;
+    *s->pre_filter = bytes(p + sizeof(bytes_t), data->pre_address_filter->len);
+    if (s->pre_filter->len) memcpy(s->pre_filter->data, data->pre_address_filter->data, s->pre_filter->len);
+    p += sizeof(bytes_t) + s->pre_filter->len;
+  }
+  for (unsigned int i = 0; i < len; i++) {
+    if (!s->nodes[i].url) continue;
+    const size_t l = strlen(s->nodes[i].url) + 1;
+    memcpy(p, s->nodes[i].url, l);
+    s->nodes[i].url = (char*) p;
+    p += l;
+  }
+  return s;
+}
+
+in3_nodelist_snapshot_t* in3_nodelist_snapshot(in3_nodeselect_def_t* data) {
+  NODELIST_LOCK(data)
+  // the stats are updated in place, so we take the snapshot again from time to time to include them
+  if (data->snapshot && data->snapshot->created + NODELIST_SNAPSHOT_TTL <= in3_time(NULL)) in3_nodelist_snapshot_clear(data);
+  if (!data->snapshot) data->snapshot = snapshot_new(data);
+  in3_nodelist_snapshot_t* s = data->snapshot;
+  s->refs++;
+  NODELIST_UNLOCK(data)
+  return s;
+}
+
+void in3_nodelist_snapshot_release(in3_nodeselect_def_t* data, in3_nodelist_snapshot_t* snapshot) {
+  NODELIST_LOCK(data)
+  if (--snapshot->refs == 0) _free(snapshot);
+  NODELIST_UNLOCK(data)
+}
+
+void in3_nodelist_snapshot_clear(in3_nodeselect_def_t* data) {
+  if (data->snapshot && --data->snapshot->refs == 0) _free(data->snapshot);
+  data->snapshot = NULL;
 }
 
 #ifdef NODESELECT_DEF_WL
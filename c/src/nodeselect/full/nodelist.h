@@ -41,35 +41,12 @@
 #include "../../core/client/request.h"
 #include "../../core/util/log.h"
 #include "../../core/util/mem.h"
+#include "../../core/util/utils.h"
 #include <time.h>
 
 #ifndef NODELIST_H
 #define NODELIST_H
 
-#ifdef THREADSAFE
-#if defined(_MSC_VER) || defined(__MINGW32__)
-#include <windows.h>
-typedef HANDLE in3_mutex_t;
-#define MUTEX_INIT(mutex)   mutex = CreateMutex(NULL, FALSE, NULL);
-#define MUTEX_LOCK(mutex)   WaitForSingleObject(mutex, INFINITE);
-#define MUTEX_UNLOCK(mutex) ReleaseMutex(mutex);
-#define MUTEX_FREE(mutex)   CloseHandle(mutex);
-#else
-#include <pthread.h>
-typedef pthread_mutex_t in3_mutex_t;
-#define MUTEX_INIT(mutex)                                      \
-  {                                                            \
-    pthread_mutexattr_t attr;                                  \
-    pthread_mutexattr_init(&attr);                             \
-    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); \
-    pthread_mutex_init(&(mutex), &attr);                       \
-  }
-#define MUTEX_LOCK(mutex)   pthread_mutex_lock(&(mutex));
-#define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&(mutex));
-#define MUTEX_FREE(mutex)   pthread_mutex_destroy(&(mutex));
-#endif
-#endif
-
 /**
  * a list of node attributes (mostly used internally)
  */
@@ -104,6 +81,9 @@ typedef struct in3_node_weight {
   uint32_t response_count;      /**< counter for responses */
   uint32_t total_response_time; /**< total of all response times */
   uint64_t blacklisted_until;   /**< if >0 this node is blacklisted until k. k is a unix timestamp */
+  uint32_t latency;             /**< exponentially weighted moving average of the response time in ms (0 = unknown) */
+  uint32_t latency_dev;         /**< exponentially weighted moving average of the deviation from the latency in ms */
+  uint32_t error_rate;          /**< exponentially weighted rate of failed responses in 1/1000 */
 } in3_node_weight_t;
 
 /**
@@ -141,6 +121,25 @@ typedef struct node_offline_ {
   struct node_offline_* next;
 } node_offline_t;
 
+/**
+ * a copy of the nodes and their weights, which is used to pick nodes without holding the lock of the nodelist.
+ *
+ * The nodelist keeps a reference to its current snapshot and drops it as soon as the nodes change, so the next pick takes a new one (copy-on-write).
+ * Since the stats change with every response, a snapshot is also taken again after NODELIST_SNAPSHOT_TTL seconds.
+ */
+typedef struct in3_nodelist_snapshot {
+  uint32_t           refs;       /**< number of references (protected by the mutex of the nodelist) */
+  bool               whitelist;  /**< if true, only whitelisted nodes may be picked */
+  unsigned int       len;        /**< number of nodes */
+  uint64_t           created;    /**< time in seconds when the snapshot was taken */
+  in3_node_t*        nodes;      /**< copy of the nodes, with their urls stored within the snapshot */
+  in3_node_weight_t* weights;    /**< copy of the weights */
+  bytes_t*           pre_filter; /**< copy of the pre_address_filter or NULL */
+} in3_nodelist_snapshot_t;
+
+/** number of seconds a snapshot is used before it is taken again to include the latest stats */
+#define NODELIST_SNAPSHOT_TTL 1
+
 typedef struct in3_nodeselect_def {
   bool               dirty;           /**< indicates whether the nodelist has been modified after last read from cache */
   uint16_t           avg_block_time;  /**< average block time (seconds) for this data (calculated internally) */
@@ -167,12 +166,30 @@ typedef struct in3_nodeselect_def {
   struct in3_nodeselect_def* next;               /**< the next in the linked list */
   uint32_t                   ref_counter;        /**< number of client using this nodelist */
   bytes_t*                   pre_address_filter; /**< addresses of allowed list (usually because those nodes where paid for) */
+  bytes_t*                   cached;             /**< the nodelist read from cache, which holds the urls of the nodes (see in3_cache_update_nodelist) */
+  in3_nodelist_snapshot_t*   snapshot;           /**< the snapshot used for picking nodes or NULL if it needs to be taken again */
 
 #ifdef THREADSAFE
-  in3_mutex_t mutex; /**< mutex to lock this nodelist */
+  in3_mutex_t mutex;       /**< mutex to lock this nodelist */
+  in3_mutex_t stats_mutex; /**< protects the stats of the weights, which are updated with each response without locking the nodelist */
 #endif
 } in3_nodeselect_def_t;
 
+#ifdef THREADSAFE
+/** must be held to update the stats or to replace or resize the nodes and weights, since the stats are updated without locking the nodelist */
+#define NODELIST_STATS_LOCK(data)   MUTEX_LOCK((data)->stats_mutex)
+#define NODELIST_STATS_UNLOCK(data) MUTEX_UNLOCK((data)->stats_mutex)
+#else
+#define NODELIST_STATS_LOCK(data)
+#define NODELIST_STATS_UNLOCK(data)
+#endif
+
+/** defines how nodes are picked */
+typedef enum {
+  NODE_SELECTION_WEIGHT  = 0, /**< random, based on the weight calculated from the average response time */
+  NODE_SELECTION_LATENCY = 1, /**< the faster of two random nodes based on the recent response times and error rate */
+} in3_node_selection_t;
+
 /** config for each client pointing to the global data*/
 typedef struct in3_nodeselect_config {
   //  in3_nodeselect_def_t* data;          /**< points to the global nodelist data*/
@@ -182,6 +199,8 @@ typedef struct in3_nodeselect_config {
   uint64_t               min_deposit;   /**< min stake of the server. Only nodes owning at least this amount will be chosen. */
   uint16_t               node_limit;    /**< the limit of nodes to store in the client. */
   uint8_t                request_count; /**< the number of request send when getting a first answer */
+  in3_node_selection_t   selection;     /**< how nodes are picked */
+  uint32_t               hedge_timeout; /**< if the expected response time of a picked node exceeds it (in ms), another node is asked in parallel (0 = off) */
 } in3_nodeselect_config_t;
 
 /** returns the nodelistwrapper.*/
@@ -190,9 +209,31 @@ NONULL in3_nodeselect_def_t* in3_get_nodelist_data(in3_nodeselect_config_t* conf
 /** returns the nodelistwrapper.*/
 NONULL in3_nodeselect_config_t* in3_get_nodelist(in3_t* c);
 
+/** frees the url of a node unless it points to the string table of the cached nodelist */
+static inline void in3_node_free_url(const in3_nodeselect_def_t* data, char* url) {
+  if (url && !(data->cached && (uint8_t*) url >= data->cached->data && (uint8_t*) url < data->cached->data + data->cached->len)) _free(url);
+}
+
 /** removes all nodes and their weights from the nodelist */
 NONULL void in3_nodelist_clear(in3_nodeselect_def_t* data);
 
+/**
+ * returns a reference to the current snapshot of the nodelist, which must be released with in3_nodelist_snapshot_release().
+ *
+ * The nodelist is only locked while taking the reference.
+ */
+NONULL in3_nodelist_snapshot_t* in3_nodelist_snapshot(in3_nodeselect_def_t* data);
+
+/** releases a reference returned by in3_nodelist_snapshot() */
+NONULL void in3_nodelist_snapshot_release(in3_nodeselect_def_t* data, in3_nodelist_snapshot_t* snapshot);
+
+/**
+ * drops the current snapshot, so the next pick sees the changes.
+ *
+ * This must be called with the nodelist locked, whenever nodes or weights are changed.
+ */
+NONULL void in3_nodelist_snapshot_clear(in3_nodeselect_def_t* data);
+
 #ifdef NODESELECT_DEF_WL
 /** removes all nodes and their weights from the nodelist */
 NONULL void in3_whitelist_clear(in3_whitelist_t* data);
@@ -208,10 +249,12 @@ NONULL void in3_client_run_chain_whitelisting(in3_nodeselect_def_t* data);
 NONULL in3_ret_t in3_node_list_get(in3_req_t* req, in3_nodeselect_def_t* data, bool update, in3_node_t** nodelist, unsigned int* nodelist_length, in3_node_weight_t** weights);
 
 /**
- * filters and fills the weights on a returned linked list.
+ * filters the nodes of the snapshot and fills the weights on a returned linked list.
+ *
+ * The url of the returned nodes is not set, since it is only needed for the picked nodes.
  */
-NONULL_FOR((1, 2, 3, 4, 5, 8, 9))
-node_match_t* in3_node_list_fill_weight(in3_t* c, in3_nodeselect_config_t* w, in3_nodeselect_def_t* data, in3_node_t* all_nodes, in3_node_weight_t* weights, unsigned int len, uint64_t now, uint32_t* total_weight, unsigned int* total_found, const in3_node_filter_t* filter, bytes_t* pre_filter);
+NONULL_FOR((1, 2, 4, 5))
+node_match_t* in3_node_list_fill_weight(in3_nodeselect_config_t* w, in3_nodelist_snapshot_t* snapshot, uint64_t now, uint32_t* total_weight, unsigned int* total_found, const in3_node_filter_t* filter, bytes_t* pre_filter);
 
 /**
  * calculates the weight for a node.
@@ -301,10 +344,14 @@ NONULL static in3_ret_t blacklist_node(in3_nodeselect_def_t* data, unsigned int
 
     // blacklist the node
     uint64_t blacklisted_until_ = in3_time(NULL) + secs_from_now;
+    NODELIST_STATS_LOCK(data)
+    w->error_rate += (1000 - w->error_rate) / 8;
     if (w->blacklisted_until != blacklisted_until_)
       data->dirty = true;
     w->blacklisted_until = blacklisted_until_;
     node->blocked        = true;
+    NODELIST_STATS_UNLOCK(data)
+    in3_nodelist_snapshot_clear(data);
     in3_log_debug("Blacklisting node for unverifiable response: %s\n", node ? node->url : "");
   }
   return IN3_OK;
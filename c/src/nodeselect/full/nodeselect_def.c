@@ -77,6 +77,11 @@ static in3_ret_t rpc_verify(in3_nodeselect_def_t* data, in3_vctx_t* vc) {
   return IN3_EIGNORE;
 }
 
+/** only the verification of nodelist- or whitelist-responses needs the nodelist. */
+static bool verify_needs_nodelist(in3_vctx_t* vc) {
+  return vc->method && (!strcmp(vc->method, "in3_nodeList") || !strcmp(vc->method, "in3_whiteList"));
+}
+
 static uint16_t avg_block_time_for_chain_id(chain_id_t id) {
   switch (id) {
     case CHAIN_ID_MAINNET:
@@ -99,6 +104,7 @@ static in3_ret_t add_node(in3_nodeselect_def_t* data, char* url, in3_node_props_
       break;
     }
   }
+  NODELIST_STATS_LOCK(data)
   if (!node) {
     // init or change the size ofthe nodelist
     data->nodelist = data->nodelist
@@ -108,17 +114,21 @@ static in3_ret_t add_node(in3_nodeselect_def_t* data, char* url, in3_node_props_
     data->weights = data->weights
                         ? _realloc(data->weights, sizeof(in3_node_weight_t) * (data->nodelist_length + 1), sizeof(in3_node_weight_t) * data->nodelist_length)
                         : _calloc(data->nodelist_length + 1, sizeof(in3_node_weight_t));
-    if (!data->nodelist || !data->weights) return IN3_ENOMEM;
+    if (!data->nodelist || !data->weights) {
+      NODELIST_STATS_UNLOCK(data)
+      return IN3_ENOMEM;
+    }
     node = data->nodelist + data->nodelist_length;
     memcpy(node->address, address, 20);
     node->index    = data->nodelist_length;
     node->capacity = 1;
     node->deposit  = 0;
-    BIT_CLEAR(node->attrs, ATTR_WHITELISTED);
+    node->blocked  = false;
+    node->attrs    = 0; // the reallocated memory is not initialized
     data->nodelist_length++;
   }
   else
-    _free(node->url);
+    in3_node_free_url(data, node->url);
 
   node->props = props;
   node->url   = _malloc(strlen(url) + 1);
@@ -128,6 +138,11 @@ static in3_ret_t add_node(in3_nodeselect_def_t* data, char* url, in3_node_props_
   weight->blacklisted_until   = 0;
   weight->response_count      = 0;
   weight->total_response_time = 0;
+  weight->latency             = 0;
+  weight->latency_dev         = 0;
+  weight->error_rate          = 0;
+  NODELIST_STATS_UNLOCK(data)
+  in3_nodelist_snapshot_clear(data);
   return IN3_OK;
 }
 
@@ -135,9 +150,6 @@ static in3_ret_t clear_nodes(in3_nodeselect_def_t* data) {
   assert(data);
 
   in3_nodelist_clear(data);
-  data->nodelist        = NULL;
-  data->weights         = NULL;
-  data->nodelist_length = 0;
   return IN3_OK;
 }
 
@@ -162,6 +174,7 @@ static in3_ret_t nodelist_seperate_from_registry(in3_nodeselect_def_t** src, in3
         *src                       = data;                                              // and in the calling function
 #ifdef THREADSAFE
         MUTEX_INIT(data->mutex) // mutex is still needed to be threadsafe
+        MUTEX_INIT(data->stats_mutex)
 #endif
       })
   return IN3_OK;
@@ -181,6 +194,7 @@ static in3_ret_t config_set(in3_nodeselect_def_t* data, in3_configure_ctx_t* ctx
     else {
       EXPECT_CFG(d_type(token) == T_NULL, "invalid preselect_nodes ");
     }
+    in3_nodelist_snapshot_clear(data);
   }
   else if (d_is_key(token, CONFIG_KEY("replaceLatestBlock"))) {
     EXPECT_TOK_U8(token);
@@ -193,6 +207,19 @@ static in3_ret_t config_set(in3_nodeselect_def_t* data, in3_configure_ctx_t* ctx
     EXPECT_CFG(d_int(token), "requestCount must be at least 1");
     w->request_count = (uint8_t) d_int(token);
   }
+  else if (d_is_key(token, CONFIG_KEY("nodeSelection"))) {
+    EXPECT_TOK_STR(token);
+    if (strcmp(d_string(token), "weight") == 0)
+      w->selection = NODE_SELECTION_WEIGHT;
+    else if (strcmp(d_string(token), "latency") == 0)
+      w->selection = NODE_SELECTION_LATENCY;
+    else
+      EXPECT_CFG(false, "nodeSelection must be either weight or latency");
+  }
+  else if (d_is_key(token, CONFIG_KEY("hedgeTimeout"))) {
+    EXPECT_TOK_U32(token);
+    w->hedge_timeout = (uint32_t) d_int(token);
+  }
   else if (d_is_key(token, CONFIG_KEY("minDeposit"))) {
     EXPECT_TOK_U64(token);
     w->min_deposit = d_long(token);
@@ -310,6 +337,7 @@ static in3_ret_t config_set(in3_nodeselect_def_t* data, in3_configure_ctx_t* ctx
 
     clear_nodes(data);
     _free(data->nodelist_upd8_params);
+    NODELIST_STATS_LOCK(data)
     data->nodelist_length++;
     data->nodelist             = _calloc(1, sizeof(in3_node_t));
     data->weights              = _calloc(1, sizeof(in3_node_weight_t));
@@ -317,6 +345,7 @@ static in3_ret_t config_set(in3_nodeselect_def_t* data, in3_configure_ctx_t* ctx
     in3_node_t* n              = &data->nodelist[0];
     n->url                     = _strdupn(d_string(token), -1);
     data->nodelist_upd8_params = NULL;
+    NODELIST_STATS_UNLOCK(data)
   }
   else {
     return IN3_EIGNORE;
@@ -335,6 +364,10 @@ static in3_ret_t config_get(in3_nodeselect_config_t* w, in3_get_config_ctx_t* ct
   if (c->chain.id == CHAIN_ID_LOCAL)
     add_string(sb, ',', "rpc", data->nodelist->url);
   add_uint(sb, ',', "requestCount", w->request_count);
+  if (w->selection == NODE_SELECTION_LATENCY)
+    add_string(sb, ',', "nodeSelection", "latency");
+  if (w->hedge_timeout)
+    add_uint(sb, ',', "hedgeTimeout", w->hedge_timeout);
   add_uint(sb, ',', "minDeposit", w->min_deposit);
   add_uint(sb, ',', "nodeProps", w->node_props);
   add_uint(sb, ',', "nodeLimit", w->node_limit);
@@ -414,10 +447,21 @@ static void free_signers(node_match_t* signers) {
   }
 }
 
+/** checks if the recorded response times of the node exceed the timeout, based on the latency + 2 deviations (~p95). Nodes without any samples are not hedged, since on a cold start this would double the load for every request. */
+static bool needs_hedge(const in3_node_weight_t* w, uint32_t timeout) {
+  return w->latency && (uint64_t) w->latency + 2 * (uint64_t) w->latency_dev > timeout;
+}
+
 NONULL static in3_ret_t pick_data(in3_nodeselect_config_t* w, in3_nodeselect_def_t* data, in3_req_t* ctx) {
   // init cache lazily this also means we can be sure that all other related plugins are registered by now
-  if (data->nodelist == NULL && IN3_ECONFIG == init_boot_nodes(data, ctx->client, in3_chain_id(ctx)))
-    return IN3_ECONFIG;
+#ifdef THREADSAFE
+  MUTEX_LOCK(data->mutex)
+#endif
+  const bool invalid_config = data->nodelist == NULL && IN3_ECONFIG == init_boot_nodes(data, ctx->client, in3_chain_id(ctx));
+#ifdef THREADSAFE
+  MUTEX_UNLOCK(data->mutex)
+#endif
+  if (invalid_config) return IN3_ECONFIG;
 
   in3_node_filter_t filter = NODE_FILTER_INIT;
   filter.nodes             = d_get(d_get(ctx->requests[0], K_IN3), K_DATA_NODES);
@@ -431,8 +475,22 @@ NONULL static in3_ret_t pick_data(in3_nodeselect_config_t* w, in3_nodeselect_def
   if (ctx->client->signature_count && w->request_count <= 1)
     rc = 2;
 
+  // pick a second node in case we need to hedge the request
+  const bool hedge = w->hedge_timeout && rc == 1;
+  if (hedge) rc = 2;
+
   in3_ret_t ret = in3_node_list_pick_nodes(ctx, w, data, &ctx->nodes, rc, &filter);
   free_signers(filter.exclusions);
+
+  // only keep the hedge, if the first node is not expected to respond in time
+  if (hedge && ret == IN3_OK && ctx->nodes && ctx->nodes->next) {
+    in3_nodelist_snapshot_t* s = in3_nodelist_snapshot(data);
+    if (ctx->nodes->index < s->len && !needs_hedge(s->weights + ctx->nodes->index, w->hedge_timeout)) {
+      in3_req_free_nodes(ctx->nodes->next);
+      ctx->nodes->next = NULL;
+    }
+    in3_nodelist_snapshot_release(data, s);
+  }
   return ret;
 }
 
@@ -440,17 +498,18 @@ NONULL static bool auto_ask_sig(const in3_req_t* ctx) {
   return (req_is_method(ctx, "in3_nodeList") && !(ctx->client->flags & FLAGS_NODE_LIST_NO_SIG) && in3_chain_id(ctx) != CHAIN_ID_BTC);
 }
 
-NONULL static in3_ret_t pick_signer(in3_nodeselect_config_t* w, in3_nodeselect_def_t* data, in3_req_t* ctx) {
-  const in3_t* c = ctx->client;
-
+NONULL static uint8_t signer_count(in3_req_t* ctx) {
   if (in3_req_get_proof(ctx, 0) == PROOF_NONE && !auto_ask_sig(ctx))
-    return IN3_OK;
+    return 0;
 
   // For nodeList request, we always ask for proof & atleast one signature
-  uint8_t total_sig_cnt = c->signature_count
-                              ? c->signature_count
-                              : (auto_ask_sig(ctx) ? 1 : 0);
+  return ctx->client->signature_count
+             ? ctx->client->signature_count
+             : (auto_ask_sig(ctx) ? 1 : 0);
+}
 
+NONULL static in3_ret_t pick_signer(in3_nodeselect_config_t* w, in3_nodeselect_def_t* data, in3_req_t* ctx) {
+  uint8_t total_sig_cnt = signer_count(ctx);
   if (total_sig_cnt) {
     node_match_t*     signer_nodes = NULL;
     in3_node_filter_t filter       = NODE_FILTER_INIT;
@@ -465,10 +524,8 @@ NONULL static in3_ret_t pick_signer(in3_nodeselect_config_t* w, in3_nodeselect_d
     ctx->signers_length   = node_count;
     ctx->signers          = _malloc(20 * node_count); // 20 bytes per address
     const node_match_t* w = signer_nodes;
-    in3_node_t*         n = NULL;
     for (int i = 0; i < node_count; i++) {
-      n = get_node(data, w);
-      if (n) memcpy(ctx->signers + i * 20, n->address, 20);
+      memcpy(ctx->signers + i * 20, w->address, 20);
       w = w->next;
     }
     if (signer_nodes) in3_req_free_nodes(signer_nodes);
@@ -612,28 +669,54 @@ static void check_autoupdate(const in3_req_t* ctx, in3_nodeselect_def_t* data, d
 }
 
 static void handle_times(in3_nodeselect_def_t* data, node_match_t* node, in3_response_t* response) {
-  in3_node_t* n = get_node(data, node);
-  if (!node || (n && n->blocked) || !response || !response->time) return;
+  if (!node || !response || !response->time) return;
+  in3_node_t*        n = get_node(data, node);
   in3_node_weight_t* w = get_node_weight(data, node);
-  if (!w) return;
+  if (!w || (n && n->blocked)) return;
   w->response_count++;
   w->total_response_time += response->time;
+
+  // exponentially weighted moving averages, so recent responses count more
+  if (!w->latency) {
+    w->latency     = response->time;
+    w->latency_dev = response->time / 2;
+  }
+  else {
+    const uint32_t dev = response->time > w->latency ? response->time - w->latency : w->latency - response->time;
+    w->latency_dev     = w->latency_dev - w->latency_dev / 4 + dev / 4;
+    w->latency         = w->latency - w->latency / 8 + response->time / 8;
+  }
+  w->error_rate -= w->error_rate / 8;
   response->time = 0; // make sure we count the time only once
 }
 
+/**
+ * updates the stats of the nodes with the response times.
+ *
+ * This is done for every response without locking the nodelist. The snapshot is not dropped, so the stats are used
+ * by picks once the snapshot is taken again after NODELIST_SNAPSHOT_TTL seconds.
+ */
+static void update_stats(in3_nodeselect_def_t* data, in3_nl_followup_ctx_t* fctx) {
+  in3_req_t*    ctx         = fctx->req;
+  node_match_t* node        = ctx ? ctx->nodes : NULL;
+  int           nodes_count = req_nodes_len(node);
+  if (!node || !ctx->raw_response) return;
+
+  NODELIST_STATS_LOCK(data)
+  for (int n = 0; n < nodes_count && node; n++, node = node->next)
+    handle_times(data, node, ctx->raw_response + n);
+  NODELIST_STATS_UNLOCK(data)
+}
+
 NONULL static in3_ret_t pick_followup(in3_nodeselect_def_t* data, in3_nl_followup_ctx_t* fctx) {
   if (!fctx->req) return IN3_EUNKNOWN;
-  in3_req_t*    ctx         = fctx->req;
-  node_match_t* vnode       = fctx->node;
-  node_match_t* node        = ctx->nodes;
-  int           nodes_count = ctx->nodes == NULL ? 1 : req_nodes_len(ctx->nodes);
+  in3_req_t*    ctx   = fctx->req;
+  node_match_t* vnode = fctx->node;
+  node_match_t* node  = ctx->nodes;
 
   // no node - nothing to do here.
   if (!node) return IN3_EIGNORE;
 
-  for (int n = 0; n < nodes_count; n++, node = node ? node->next : NULL)
-    handle_times(data, node, ctx->raw_response + n);
-
   // check auto update opts only if this node wasn't blacklisted (due to wrong result/proof)
   if (!is_blacklisted(get_node(data, node)) && ctx->responses && d_get(ctx->responses[0], K_IN3) && !d_get(ctx->responses[0], K_ERROR))
     check_autoupdate(ctx, data, d_get(ctx->responses[0], K_IN3), vnode);
@@ -676,6 +759,7 @@ static void nodelist_return_or_free(in3_nodeselect_def_t* chain) {
 #endif
 #ifdef THREADSAFE
   MUTEX_FREE(chain->mutex)
+  MUTEX_FREE(chain->stats_mutex)
 #endif
   b_free(chain->pre_address_filter);
   _free(chain->nodelist_upd8_params);
@@ -703,6 +787,7 @@ static in3_nodeselect_def_t* nodelist_get_or_create(chain_id_t chain_id) {
         nodelist_registry          = data;
 #ifdef THREADSAFE
         MUTEX_INIT(data->mutex)
+        MUTEX_INIT(data->stats_mutex)
 #endif
       })
   return data;
@@ -739,6 +824,15 @@ in3_ret_t in3_nodeselect_handle_action(void* plugin_data, in3_plugin_act_t actio
   in3_req_t*               r    = get_req_from_plgn(plugin_ctx, action);
   if (r && r->client->chain.id != in3_chain_id(r)) data = in3_get_nodelist_data(w, in3_chain_id(r));
 
+  // verifying responses does not touch the nodelist and picking nodes only locks it while taking a snapshot, so we don't need to lock it
+  if (action == PLGN_ACT_RPC_VERIFY && !verify_needs_nodelist(plugin_ctx)) return rpc_verify(data, plugin_ctx);
+  if (action == PLGN_ACT_NL_PICK) {
+    in3_nl_pick_ctx_t* pctx = plugin_ctx;
+    if (!pctx || !pctx->req) return IN3_EUNKNOWN;
+    return pctx->type == NL_DATA ? pick_data(w, data, pctx->req) : pick_signer(w, data, pctx->req);
+  }
+  if (action == PLGN_ACT_NL_PICK_FOLLOWUP && plugin_ctx) update_stats(data, plugin_ctx);
+
 #ifdef THREADSAFE
   // lock only the nodelist
   MUTEX_LOCK(data->mutex)
@@ -765,11 +859,6 @@ in3_ret_t in3_nodeselect_handle_action(void* plugin_data, in3_plugin_act_t actio
       UNLOCK_AND_RETURN(config_set(data, (in3_configure_ctx_t*) plugin_ctx, plugin_data))
     case PLGN_ACT_CONFIG_GET:
       UNLOCK_AND_RETURN(config_get(w, (in3_get_config_ctx_t*) plugin_ctx))
-    case PLGN_ACT_NL_PICK: {
-      in3_nl_pick_ctx_t* pctx = plugin_ctx;
-      if (!pctx || !pctx->req) return IN3_EUNKNOWN;
-      UNLOCK_AND_RETURN(pctx->type == NL_DATA ? pick_data(w, data, pctx->req) : pick_signer(w, data, pctx->req))
-    }
     case PLGN_ACT_NL_PICK_FOLLOWUP:
       UNLOCK_AND_RETURN(plugin_ctx ? pick_followup(data, plugin_ctx) : IN3_EUNKNOWN)
     case PLGN_ACT_NL_BLACKLIST: {
@@ -849,6 +938,8 @@ in3_ret_t in3_register_nodeselect_def(in3_t* c) {
     return IN3_EIGNORE;
   in3_nodeselect_config_t* data = _malloc(sizeof(*data));
   data->request_count           = 1;
+  data->selection               = NODE_SELECTION_WEIGHT;
+  data->hedge_timeout           = 0;
   data->min_deposit             = 0;
   data->node_limit              = 0;
   data->node_props              = 0;
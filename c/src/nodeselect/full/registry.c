@@ -270,25 +270,32 @@ static in3_ret_t verify_account(in3_vctx_t* vc, address_t required_contract, d_t
   else
     return vc_err(vc, "no storage-hash found!");
 
+  // the storage proofs share most of their nodes, so we only hash them once.
+  trie_proof_cache_t cache = {0};
   for (d_iterator_t it = d_iter(*storage_proof); it.left; d_iter_next(&it)) {
     // prepare the key
     d_bytes_to(d_get(it.token, K_KEY), hash, 32);
     keccak(path, hash);
 
     proof = d_create_bytes_vec(d_get(it.token, K_PROOF));
-    if (!proof) return vc_err(vc, "no merkle proof for the storage");
+    if (!proof) {
+      trie_proof_cache_free(&cache);
+      return vc_err(vc, "no merkle proof for the storage");
+    }
 
     // rlp encode the value.
     if ((bb.b.len = d_bytes_to(d_get(it.token, K_VALUE), val, -1)))
       rlp_encode_to_item(&bb);
 
     // verify merkle proof
-    if (!trie_verify_proof(&root, &path, proof, bb.b.len ? &bb.b : NULL)) {
+    if (!trie_verify_proof_cached(&cache, &root, &path, proof, bb.b.len ? &bb.b : NULL)) {
       _free(proof);
+      trie_proof_cache_free(&cache);
       return vc_err(vc, "invalid storage proof");
     }
     _free(proof);
   }
+  trie_proof_cache_free(&cache);
 
   return IN3_OK;
 }
@@ -0,0 +1,361 @@
+
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include "kv_storage.h"
+#include "../../core/util/bytes.h"
+#include "../../core/util/log.h"
+#include "../../core/util/mem.h"
+#include "../../core/util/utils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KV_MAGIC       "in3kv\0\0\1"
+#define KV_HEADER_SIZE 16      // magic + committed length
+#define KV_RECORD_HEAD 12      // key length + value length + checksum
+#define KV_COMPACT_MIN 0x10000 // smaller files are never compacted
+#define KV_SLOTS_MIN   64
+#define KV_ALIGN(n)    (((n) + 7) & ~((uint64_t) 7))
+
+#ifdef THREADSAFE
+#define KV_LOCK(kv)   MUTEX_LOCK((kv)->mutex)
+#define KV_UNLOCK(kv) MUTEX_UNLOCK((kv)->mutex)
+#else
+#define KV_LOCK(kv)
+#define KV_UNLOCK(kv)
+#endif
+
+/** a slot of the hash index */
+typedef struct {
+  uint32_t hash;   // hash of the key (0 = empty)
+  uint64_t offset; // offset of the latest record of the key
+} kv_slot_t;
+
+typedef struct kv_storage {
+  char*      path;      // path of the file
+  int        fd;        // the opened file or -1
+  uint8_t*   map;       // memory mapped file content
+  size_t     map_len;   // length of the mapped content
+  uint64_t   indexed;   // length of the file already added to the index
+  uint64_t   live;      // number of bytes used by the latest records
+  kv_slot_t* slots;     // hash index
+  uint32_t   slots_len; // number of slots, always a power of 2
+  uint32_t   used;      // number of used slots
+#ifdef THREADSAFE
+  in3_mutex_t mutex;
+#endif
+} kv_storage_t;
+
+static uint32_t fnv1a(uint32_t h, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) h = (h ^ data[i]) * 16777619U;
+  return h;
+}
+
+static uint32_t key_hash(const char* key, size_t len) {
+  uint32_t h = fnv1a(2166136261U, (const uint8_t*) key, len);
+  return h ? h : 1;
+}
+
+static uint32_t read_u32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static uint64_t record_size(const uint8_t* record) {
+  return KV_ALIGN(KV_RECORD_HEAD + (uint64_t) read_u32(record) + read_u32(record + 4));
+}
+
+static void kv_reset_index(kv_storage_t* kv) {
+  _free(kv->slots);
+  kv->slots     = NULL;
+  kv->slots_len = 0;
+  kv->used      = 0;
+  kv->live      = 0;
+  kv->indexed   = KV_HEADER_SIZE;
+}
+
+static void kv_close(kv_storage_t* kv) {
+  if (kv->map) munmap(kv->map, kv->map_len);
+  if (kv->fd >= 0) close(kv->fd); // this also releases the lock
+  kv->map     = NULL;
+  kv->map_len = 0;
+  kv->fd      = -1;
+  kv_reset_index(kv);
+}
+
+static bool write_header(int fd, uint64_t len) {
+  uint8_t header[KV_HEADER_SIZE];
+  memcpy(header, KV_MAGIC, 8);
+  memcpy(header + 8, &len, 8);
+  return pwrite(fd, header, KV_HEADER_SIZE, 0) == KV_HEADER_SIZE;
+}
+
+/** reads the committed length from the header or returns 0 if the file is not valid */
+static uint64_t read_length(kv_storage_t* kv) {
+  uint8_t  header[KV_HEADER_SIZE];
+  uint64_t len;
+  if (pread(kv->fd, header, KV_HEADER_SIZE, 0) != KV_HEADER_SIZE || memcmp(header, KV_MAGIC, 8)) return 0;
+  memcpy(&len, header + 8, 8);
+  return len;
+}
+
+static bool kv_map(kv_storage_t* kv, uint64_t len) {
+  if (len <= kv->map_len) return true;
+  if (kv->map) munmap(kv->map, kv->map_len);
+  kv->map     = mmap(NULL, len, PROT_READ, MAP_SHARED, kv->fd, 0);
+  kv->map_len = len;
+  if (kv->map != MAP_FAILED) return true;
+  kv->map     = NULL;
+  kv->map_len = 0;
+  return false;
+}
+
+/** finds the slot of the key, which is either empty or points to the latest record of the key */
+static kv_slot_t* find_slot(kv_storage_t* kv, const char* key, uint32_t key_len, uint32_t hash) {
+  for (uint32_t i = hash & (kv->slots_len - 1);; i = (i + 1) & (kv->slots_len - 1)) {
+    kv_slot_t* slot = kv->slots + i;
+    if (!slot->hash) return slot;
+    const uint8_t* record = kv->map + slot->offset;
+    if (slot->hash == hash && read_u32(record) == key_len && memcmp(record + KV_RECORD_HEAD, key, key_len) == 0) return slot;
+  }
+}
+
+static void grow_slots(kv_storage_t* kv) {
+  kv_slot_t*     old     = kv->slots;
+  const uint32_t old_len = kv->slots_len;
+  kv->slots_len          = old_len ? old_len * 2 : KV_SLOTS_MIN;
+  kv->slots              = _calloc(kv->slots_len, sizeof(kv_slot_t));
+  for (uint32_t i = 0; i < old_len; i++) {
+    if (!old[i].hash) continue;
+    uint32_t n = old[i].hash & (kv->slots_len - 1);
+    while (kv->slots[n].hash) n = (n + 1) & (kv->slots_len - 1);
+    kv->slots[n] = old[i];
+  }
+  _free(old);
+}
+
+/** adds all records up to the given length to the index and returns false if a damaged record was found */
+static bool index_records(kv_storage_t* kv, uint64_t len) {
+  while (kv->indexed + KV_RECORD_HEAD <= len) {
+    const uint8_t* record    = kv->map + kv->indexed;
+    const uint32_t key_len   = read_u32(record);
+    const uint32_t value_len = read_u32(record + 4);
+    const uint64_t size      = record_size(record);
+    if (kv->indexed + size > len) return false;
+    const char* key = (const char*) record + KV_RECORD_HEAD;
+    if (fnv1a(key_hash(key, key_len), record + KV_RECORD_HEAD + key_len, value_len) != read_u32(record + 8)) return false;
+
+    if ((kv->used + 1) * 4 > kv->slots_len * 3) grow_slots(kv);
+    const uint32_t hash = key_hash(key, key_len);
+    kv_slot_t*     slot = find_slot(kv, key, key_len, hash);
+    if (slot->hash)
+      kv->live -= record_size(kv->map + slot->offset);
+    else
+      kv->used++;
+    slot->hash   = hash;
+    slot->offset = kv->indexed;
+    kv->live += size;
+    kv->indexed += size;
+  }
+  return kv->indexed == len;
+}
+
+/**
+ * locks the file and updates the index with all changes of other processes.
+ * If exclusive, a new file is initialized and damaged records are removed.
+ */
+static bool kv_lock(kv_storage_t* kv, bool exclusive) {
+  while (true) {
+    if (kv->fd < 0 && (kv->fd = open(kv->path, O_RDWR | O_CREAT, 0644)) < 0) {
+      in3_log_debug("could not open the storage file %s\n", kv->path);
+      return false;
+    }
+    struct stat fst, pst;
+    if (flock(kv->fd, exclusive ? LOCK_EX : LOCK_SH) || fstat(kv->fd, &fst)) {
+      kv_close(kv);
+      return false;
+    }
+    // make sure the file was not replaced by another process while waiting for the lock
+    if (stat(kv->path, &pst) == 0 && pst.st_ino == fst.st_ino) break;
+    kv_close(kv);
+  }
+
+  const uint64_t len = read_length(kv);
+  if (len < kv->indexed) kv_reset_index(kv);
+  if (len >= KV_HEADER_SIZE && !kv_map(kv, len)) {
+    flock(kv->fd, LOCK_UN);
+    return false;
+  }
+  if (len >= KV_HEADER_SIZE && index_records(kv, len)) return true;
+
+  // the file is new or damaged, so we only keep the valid records
+  if (exclusive && ftruncate(kv->fd, kv->indexed) == 0 && write_header(kv->fd, kv->indexed)) {
+    if (len) in3_log_warn("removed damaged records from the storage file %s\n", kv->path);
+    return true;
+  }
+  flock(kv->fd, LOCK_UN);
+  return false;
+}
+
+/** copies the latest records into a new file, which then replaces the current file */
+static void kv_compact(kv_storage_t* kv) {
+  char* tmp = alloca(strlen(kv->path) + 5);
+  sprintf(tmp, "%s.tmp", kv->path);
+  const int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return;
+
+  uint64_t len = KV_HEADER_SIZE;
+  bool     ok  = true;
+  for (uint32_t i = 0; ok && i < kv->slots_len; i++) {
+    if (!kv->slots[i].hash) continue;
+    const uint8_t* record = kv->map + kv->slots[i].offset;
+    const uint64_t size   = record_size(record);
+    ok                    = pwrite(fd, record, size, len) == (ssize_t) size;
+    len += size;
+  }
+
+  if (ok && write_header(fd, len) && fsync(fd) == 0 && rename(tmp, kv->path) == 0) {
+    close(fd);
+    kv_close(kv); // the next access will open the new file
+    return;
+  }
+  close(fd);
+  unlink(tmp);
+}
+
+static bytes_t* kv_get(kv_storage_t* kv, const char* key) {
+  bytes_t* res = NULL;
+  KV_LOCK(kv)
+  if (kv_lock(kv, false)) {
+    if (kv->used) {
+      const uint32_t   key_len = strlen(key);
+      const kv_slot_t* slot    = find_slot(kv, key, key_len, key_hash(key, key_len));
+      if (slot->hash) res = b_new(kv->map + slot->offset + KV_RECORD_HEAD + key_len, read_u32(kv->map + slot->offset + 4));
+    }
+    flock(kv->fd, LOCK_UN);
+  }
+  KV_UNLOCK(kv)
+  return res;
+}
+
+static in3_ret_t kv_set(kv_storage_t* kv, const char* key, bytes_t* value) {
+  const uint32_t key_len  = strlen(key);
+  const uint64_t size     = KV_ALIGN(KV_RECORD_HEAD + key_len + value->len);
+  const uint32_t checksum = fnv1a(key_hash(key, key_len), value->data, value->len);
+  uint8_t*       record   = _calloc(1, size);
+  memcpy(record, &key_len, 4);
+  memcpy(record + 4, &value->len, 4);
+  memcpy(record + 8, &checksum, 4);
+  memcpy(record + KV_RECORD_HEAD, key, key_len);
+  memcpy(record + KV_RECORD_HEAD + key_len, value->data, value->len);
+
+  in3_ret_t res = IN3_EUNKNOWN;
+  KV_LOCK(kv)
+  if (kv_lock(kv, true)) {
+    // the record is only committed by writing the new length after the record is stored
+    const uint64_t len = kv->indexed + size;
+    if (pwrite(kv->fd, record, size, kv->indexed) == (ssize_t) size && fsync(kv->fd) == 0 && write_header(kv->fd, len) && kv_map(kv, len) && index_records(kv, len)) {
+      res = IN3_OK;
+      if (len > KV_COMPACT_MIN && kv->live * 2 < len) kv_compact(kv);
+    }
+    if (kv->fd >= 0) flock(kv->fd, LOCK_UN);
+  }
+  KV_UNLOCK(kv)
+  _free(record);
+  return res;
+}
+
+static in3_ret_t kv_clear(kv_storage_t* kv) {
+  in3_ret_t res = IN3_EUNKNOWN;
+  KV_LOCK(kv)
+  if (kv_lock(kv, true)) {
+    // compacting without any records replaces the file with an empty one
+    kv_reset_index(kv);
+    kv_compact(kv);
+    if (kv->fd >= 0)
+      flock(kv->fd, LOCK_UN);
+    else
+      res = IN3_OK;
+  }
+  KV_UNLOCK(kv)
+  return res;
+}
+
+static void kv_free(kv_storage_t* kv) {
+  kv_close(kv);
+#ifdef THREADSAFE
+  MUTEX_FREE(kv->mutex)
+#endif
+  _free(kv->path);
+  _free(kv);
+}
+
+static in3_ret_t handle_kv_storage(void* data, in3_plugin_act_t action, void* arg) {
+  kv_storage_t*    kv  = data;
+  in3_cache_ctx_t* ctx = arg;
+  switch (action) {
+    case PLGN_ACT_CACHE_GET: {
+      ctx->content = kv_get(kv, ctx->key);
+      return ctx->content ? IN3_OK : IN3_EIGNORE;
+    }
+    case PLGN_ACT_CACHE_SET:
+      return kv_set(kv, ctx->key, ctx->content);
+    case PLGN_ACT_CACHE_CLEAR:
+      return kv_clear(kv);
+    case PLGN_ACT_TERM:
+      kv_free(kv);
+      return IN3_OK;
+    default:
+      return IN3_EINVAL;
+  }
+}
+
+in3_ret_t in3_register_kv_storage(in3_t* c, const char* path) {
+  kv_storage_t* kv = _calloc(1, sizeof(kv_storage_t));
+  kv->path         = _strdupn(path, -1);
+  kv->fd           = -1;
+  kv->indexed      = KV_HEADER_SIZE;
+#ifdef THREADSAFE
+  MUTEX_INIT(kv->mutex)
+#endif
+  return in3_plugin_register(c, PLGN_ACT_CACHE | PLGN_ACT_TERM, handle_kv_storage, kv, true);
+}
@@ -32,26 +32,237 @@
  * with this program. If not, see <https://www.gnu.org/licenses/>.
  *******************************************************************************/
 
+#define _XOPEN_SOURCE 600
+
 #include "in3_curl.h"
 #include "../../core/client/client.h"
 #include "../../core/client/plugin.h"
+#include "../../core/client/request_internal.h"
 #include "../../core/client/version.h"
+#include "../../core/util/colors.h"
+#include "../../core/util/debug.h"
 #include "../../core/util/log.h"
 #include "../../core/util/mem.h"
 #include "../../core/util/utils.h"
 #include <curl/curl.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef CURL_MAX_PARALLEL
 #define CURL_MAX_PARALLEL 50
 #endif
+
+/**
+ * the shared state of the transport, which is used by all clients of the process.
+ *
+ * All requests share the dns- and tls-session-cache. Multi-handles are not freed after a request,
+ * but put back into the pool, so the next request will reuse their keep-alive connections.
+ * Since a multi-handle is only used by one request at a time, connections are never shared between threads.
+ */
+typedef struct {
+  CURLSH*  share;     /**< share-handle holding the dns- and tls-session-cache */
+  CURLM**  idle;      /**< multi-handles currently not used by any request */
+  uint32_t idle_len;  /**< number of idle multi-handles */
+  uint32_t pool_size; /**< max number of connections kept alive per multi-handle and max number of idle multi-handles */
+  uint32_t refs;      /**< number of transfers and multiplexers using the pool, +1 as long as it is the pool of the process */
+#ifdef THREADSAFE
+  in3_mutex_t mutex;                      /**< protects the idle-list */
+  in3_mutex_t locks[CURL_LOCK_DATA_LAST]; /**< locks for the share-handle */
+#endif
+} in3_curl_pool_t;
+
 typedef struct {
   CURLM*             cm;
   uint32_t           start;
   struct curl_slist* headers;
-
+  in3_curl_pool_t*   pool;        /**< the pool to return the multi-handle to */
+  CURL**             handles;     /**< the easy-handles still attached to the multi-handle */
+  uint32_t           handles_len; /**< number of easy-handles */
 } in3_curl_t;
 
+static in3_curl_pool_t* curl_pool       = NULL;              /**< the pool of the process */
+static uint32_t         curl_pool_users = 0;                 /**< number of clients and multiplexers using the pool of the process */
+static uint32_t         curl_pool_size  = CURL_MAX_PARALLEL; /**< the configured size, which is kept if the pool is freed */
+static bool             curl_pool_exit  = false;             /**< true if the pool is freed on exit */
+INIT_LOCK(curl_pool)
+
+#ifdef THREADSAFE
+static void pool_lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+  UNUSED_VAR(handle);
+  UNUSED_VAR(access);
+  MUTEX_LOCK(((in3_curl_pool_t*) userptr)->locks[data])
+}
+
+static void pool_unlock(CURL* handle, curl_lock_data data, void* userptr) {
+  UNUSED_VAR(handle);
+  MUTEX_UNLOCK(((in3_curl_pool_t*) userptr)->locks[data])
+}
+#endif
+
+static in3_curl_pool_t* pool_new(uint32_t pool_size) {
+  in3_curl_pool_t* pool = _calloc(1, sizeof(in3_curl_pool_t));
+  pool->pool_size       = pool_size;
+  pool->refs            = 1;
+  pool->idle            = _malloc(sizeof(CURLM*) * (pool_size ? pool_size : 1));
+  pool->share           = curl_share_init();
+#ifdef THREADSAFE
+  MUTEX_INIT(pool->mutex)
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) MUTEX_INIT(pool->locks[i])
+  curl_share_setopt(pool->share, CURLSHOPT_LOCKFUNC, pool_lock);
+  curl_share_setopt(pool->share, CURLSHOPT_UNLOCKFUNC, pool_unlock);
+  curl_share_setopt(pool->share, CURLSHOPT_USERDATA, pool);
+#endif
+  curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  return pool;
+}
+
+static void pool_free(in3_curl_pool_t* pool) {
+  for (uint32_t i = 0; i < pool->idle_len; i++) curl_multi_cleanup(pool->idle[i]);
+  curl_share_cleanup(pool->share);
+#ifdef THREADSAFE
+  MUTEX_FREE(pool->mutex)
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) MUTEX_FREE(pool->locks[i])
+#endif
+  _free(pool->idle);
+  _free(pool);
+}
+
+/** returns the pool of the process and creates it, if needed. The returned reference must be released with `pool_put()`. */
+static in3_curl_pool_t* pool_get() {
+  in3_curl_pool_t* pool = NULL;
+  LOCK(curl_pool, {
+    if (!curl_pool) curl_pool = pool_new(curl_pool_size);
+    // processes like the cmdline-tool exit without freeing their clients, so the pool is freed on exit.
+    if (!curl_pool_exit) curl_pool_exit = atexit(in3_curl_pool_free) == 0;
+    pool = curl_pool;
+    pool->refs++;
+  })
+  return pool;
+}
+
+/** releases a reference and frees the pool, if it was the last one. */
+static void pool_put(in3_curl_pool_t* pool) {
+  bool last = false;
+  LOCK(curl_pool, { last = --pool->refs == 0; })
+  if (last) pool_free(pool);
+}
+
+/** registers a new user of the pool of the process, which needs to call `pool_unref()` when it is done. */
+static void pool_ref() {
+  LOCK(curl_pool, { curl_pool_users++; })
+}
+
+/** removes a user and releases the pool of the process, if it was the last one. Transfers still running keep their reference. */
+static void pool_unref() {
+  in3_curl_pool_t* pool = NULL;
+  LOCK(curl_pool, {
+    if (curl_pool_users && --curl_pool_users == 0) {
+      pool      = curl_pool;
+      curl_pool = NULL;
+    }
+  })
+  if (pool) pool_put(pool);
+}
+
+/** takes a idle multi-handle from the pool or creates a new one, if none is available. */
+static CURLM* pool_take(in3_curl_pool_t* pool) {
+  CURLM* cm = NULL;
+#ifdef THREADSAFE
+  MUTEX_LOCK(pool->mutex)
+#endif
+  if (pool->idle_len) cm = pool->idle[--pool->idle_len];
+  uint32_t pool_size = pool->pool_size;
+#ifdef THREADSAFE
+  MUTEX_UNLOCK(pool->mutex)
+#endif
+  if (!cm) cm = curl_multi_init();
+  curl_multi_setopt(cm, CURLMOPT_MAXCONNECTS, (long) pool_size);
+  return cm;
+}
+
+/** puts the multi-handle back into the pool, so its open connections can be reused. */
+static void pool_release(in3_curl_pool_t* pool, CURLM* cm) {
+#ifdef THREADSAFE
+  MUTEX_LOCK(pool->mutex)
+#endif
+  if (pool->idle_len < pool->pool_size) {
+    pool->idle[pool->idle_len++] = cm;
+    cm                           = NULL;
+  }
+#ifdef THREADSAFE
+  MUTEX_UNLOCK(pool->mutex)
+#endif
+  if (cm) curl_multi_cleanup(cm);
+}
+
+void in3_curl_set_pool_size(uint32_t pool_size) {
+  in3_curl_pool_t* pool = NULL;
+  LOCK(curl_pool, {
+    curl_pool_size = pool_size;
+    pool           = curl_pool;
+    if (pool) pool->refs++;
+  })
+  if (!pool) return;
+#ifdef THREADSAFE
+  MUTEX_LOCK(pool->mutex)
+#endif
+  while (pool->idle_len > pool_size) curl_multi_cleanup(pool->idle[--pool->idle_len]);
+  pool->idle      = _realloc(pool->idle, sizeof(CURLM*) * (pool_size ? pool_size : 1), sizeof(CURLM*) * (pool->pool_size ? pool->pool_size : 1));
+  pool->pool_size = pool_size;
+#ifdef THREADSAFE
+  MUTEX_UNLOCK(pool->mutex)
+#endif
+  pool_put(pool);
+}
+
+void in3_curl_pool_free() {
+  in3_curl_pool_t* pool = NULL;
+  LOCK(curl_pool, {
+    pool      = curl_pool;
+    curl_pool = NULL;
+  })
+  // transfers still running keep their reference, so the pool is freed by the last of them.
+  if (pool) pool_put(pool);
+}
+
+static in3_ret_t config_set(in3_configure_ctx_t* ctx) {
+  char*       res   = NULL;
+  json_ctx_t* json  = ctx->json;
+  d_token_t*  token = ctx->token;
+
+  if (d_is_key(token, key("connectionPoolSize"))) {
+    EXPECT_TOK_U16(token);
+    in3_curl_set_pool_size((uint32_t) d_int(token));
+  }
+  else
+    return IN3_EIGNORE;
+
+cleanup:
+  ctx->error_msg = res;
+  return ctx->error_msg ? IN3_ECONFIG : IN3_OK;
+}
+
+static in3_ret_t curl_config(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx) {
+  UNUSED_VAR(plugin_data);
+  switch (action) {
+    case PLGN_ACT_CONFIG_SET:
+      return config_set(plugin_ctx);
+    case PLGN_ACT_CONFIG_GET: {
+      uint32_t pool_size = 0;
+      LOCK(curl_pool, { pool_size = curl_pool_size; })
+      add_uint(((in3_get_config_ctx_t*) plugin_ctx)->sb, ',', "connectionPoolSize", pool_size);
+      return IN3_OK;
+    }
+    case PLGN_ACT_TERM:
+      // the client does not use the pool anymore
+      pool_unref();
+      return IN3_OK;
+    default:
+      return IN3_EIGNORE;
+  }
+}
+
 /*
 struct MemoryStruct {
   char *memory = NULL;
@@ -60,11 +271,14 @@ struct MemoryStruct {
  */
 static size_t WriteMemoryCallback(void* contents, size_t size, size_t nmemb, void* userp) {
   in3_response_t* r = (in3_response_t*) userp;
+  // json-responses are parsed while receiving them, so the tokens point directly into the buffer.
+  if (!r->data.len && !r->stream && size * nmemb > 0 && (*(char*) contents == '{' || *(char*) contents == '[')) r->stream = json_stream_new();
   sb_add_range(&r->data, contents, 0, size * nmemb);
+  if (r->stream) json_stream_parse(r->stream, r->data.data, r->data.len);
   return size * nmemb;
 }
 
-static void readDataNonBlocking(CURLM* cm, const char* url, const char* payload, uint32_t payload_len, struct curl_slist* headers, in3_response_t* r, uint32_t timeout, char* method) {
+static CURL* readDataNonBlocking(in3_curl_t* c, const char* url, const char* payload, uint32_t payload_len, in3_response_t* r, uint32_t timeout, char* method) {
   CURL*     curl;
   CURLMcode res;
 
@@ -78,25 +292,61 @@ static void readDataNonBlocking(CURLM* cm, const char* url, const char* payload,
 
     // curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_0);
     //    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, c->headers);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*) r);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, (uint64_t) timeout / 1000L);
     curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*) r);
     curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+    curl_easy_setopt(curl, CURLOPT_SHARE, c->pool->share);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
 
     /* Perform the request, res will get the return code */
-    res = curl_multi_add_handle(cm, curl);
+    res = curl_multi_add_handle(c->cm, curl);
     if (res != CURLM_OK) {
       sb_add_chars(&r->data, "Invalid response:");
-      sb_add_chars(&r->data, (char*) curl_easy_strerror((CURLcode) res));
+      sb_add_chars(&r->data, (char*) curl_multi_strerror(res));
       r->state = IN3_ERPC;
+      curl_easy_cleanup(curl);
+      return NULL;
     }
   }
   else {
     sb_add_chars(&r->data, "no curl:");
     r->state = IN3_ECONFIG;
   }
+  return curl;
+}
+
+/** removes the easy-handle from the multi-handle, which keeps the connection open for the next request */
+static void release_handle(in3_curl_t* c, CURL* e) {
+  for (uint32_t i = 0; i < c->handles_len; i++) {
+    if (c->handles[i] == e) c->handles[i] = NULL;
+  }
+  curl_multi_remove_handle(c->cm, e);
+  curl_easy_cleanup(e);
+}
+
+/** sets the state of the response after the transfer is finished. */
+static void set_response_state(in3_response_t* response, CURLcode res, long response_code) {
+  if (res != CURLE_OK) {
+    sb_add_chars(&response->data, "Invalid response:");
+    sb_add_chars(&response->data, (char*) curl_easy_strerror(res));
+    response->state = IN3_ERPC;
+  }
+  else if (response_code > 100 && response_code < 400)
+    response->state = IN3_OK;
+  else {
+    if (!response->data.len) {
+      sb_add_chars(&response->data, "returned with invalid status code ");
+      sb_add_int(&response->data, response_code);
+    }
+    response->state = -response_code;
+  }
+  if (!response->data.data) {
+    response->data.data     = _calloc(1, 1);
+    response->data.allocted = 1;
+  }
 }
 
 in3_ret_t receive_next(in3_http_request_t* req) {
@@ -115,27 +365,8 @@ in3_ret_t receive_next(in3_http_request_t* req) {
       curl_easy_getinfo(e, CURLINFO_PRIVATE, &response);
       curl_easy_getinfo(e, CURLINFO_RESPONSE_CODE, &response_code);
       if (msg->msg == CURLMSG_DONE) {
-        CURLcode res = msg->data.result;
-        if (res != CURLE_OK) {
-          sb_add_chars(&response->data, "Invalid response:");
-          sb_add_chars(&response->data, (char*) curl_easy_strerror((CURLcode) res));
-          response->state = IN3_ERPC;
-        }
-        else if (response_code > 100 && response_code < 400)
-          response->state = IN3_OK;
-        else {
-          if (!response->data.len) {
-            sb_add_chars(&response->data, "returned with invalid status code ");
-            sb_add_int(&response->data, response_code);
-          }
-          response->state = -response_code;
-        }
-        if (!response->data.data) {
-          response->data.data     = _calloc(1, 1);
-          response->data.allocted = 1;
-        }
-        curl_multi_remove_handle(c->cm, e);
-        curl_easy_cleanup(e);
+        set_response_state(response, msg->data.result, response_code);
+        release_handle(c, e);
         response->time = current_ms() - c->start;
         return response->state;
       }
@@ -149,23 +380,30 @@ in3_ret_t receive_next(in3_http_request_t* req) {
 }
 
 in3_ret_t cleanup(in3_curl_t* c) {
-
+  // pending transfers are aborted, so only finished connections go back into the pool.
+  for (uint32_t i = 0; i < c->handles_len; i++) {
+    if (c->handles[i]) release_handle(c, c->handles[i]);
+  }
+  pool_release(c->pool, c->cm);
+  pool_put(c->pool);
   curl_slist_free_all(c->headers);
-  curl_multi_cleanup(c->cm);
+  _free(c->handles);
   _free(c);
   return IN3_OK;
 }
 
-in3_ret_t send_curl_nonblocking(in3_http_request_t* req) {
+in3_ret_t send_curl_nonblocking(in3_curl_pool_t* pool, in3_http_request_t* req) {
 
   // init the cptr
-  in3_curl_t* c = _malloc(sizeof(in3_curl_t));
-  c->cm         = curl_multi_init();
-  c->start      = current_ms();
-  req->cptr     = c;
+  in3_curl_t* c  = _malloc(sizeof(in3_curl_t));
+  c->pool        = pool;
+  c->cm          = pool_take(pool);
+  c->start       = current_ms();
+  c->handles     = _calloc(req->urls_len ? req->urls_len : 1, sizeof(CURL*));
+  c->handles_len = req->urls_len;
+  req->cptr      = c;
 
   // define headers
-  curl_multi_setopt(c->cm, CURLMOPT_MAXCONNECTS, (long) CURL_MAX_PARALLEL);
   struct curl_slist* headers = curl_slist_append(NULL, "Accept: application/json");
   if (req->payload && *req->payload)
     headers = curl_slist_append(headers, "Content-Type: application/json");
@@ -175,7 +413,7 @@ in3_ret_t send_curl_nonblocking(in3_http_request_t* req) {
 
   // create requests
   for (unsigned int i = 0; i < req->urls_len; i++)
-    readDataNonBlocking(c->cm, req->urls[i], req->payload, req->payload_len, c->headers, req->req->raw_response + i, req->req->client->timeout, req->method);
+    c->handles[i] = readDataNonBlocking(c, req->urls[i], req->payload, req->payload_len, req->req->raw_response + i, req->req->client->timeout, req->method);
 
   in3_ret_t res = receive_next(req);
   if (req->urls_len == 1) {
@@ -185,7 +423,290 @@ in3_ret_t send_curl_nonblocking(in3_http_request_t* req) {
   return res;
 }
 
-static void readDataBlocking(const char* url, char* payload, in3_response_t* r, uint32_t timeout, in3_http_request_t* req) {
+/**
+ * a request driven by the multiplexer.
+ *
+ * Only the last waiting context of a request is sent at a time, so each job holds at most one set of transfers.
+ */
+typedef struct curl_job {
+  in3_req_t*          req;         /**< the request as passed by the application */
+  in3_req_t*          ctx;         /**< the context the transfers are running for */
+  in3_response_t*     responses;   /**< the responses of the ctx, the transfers are writing to */
+  CURL**              handles;     /**< the easy-handles, one per url */
+  uint32_t            handles_len; /**< number of easy-handles */
+  uint32_t            running;     /**< number of transfers not finished yet */
+  struct curl_slist*  headers;     /**< the headers used by the transfers */
+  uint64_t            start;       /**< the time the transfers were started */
+  in3_http_request_t* pending;     /**< a request waiting to be sent because of the `wait`-property */
+  uint64_t            send_at;     /**< the time the pending request should be sent */
+  bool                dirty;       /**< true if a transfer finished and the request needs to be executed again */
+  struct curl_job*    next;
+} curl_job_t;
+
+struct in3_curl_multi {
+  in3_curl_pool_t* pool;
+  CURLM*           cm;        /**< the multi-handle holding the transfers of all requests */
+  curl_job_t*      active;    /**< requests not finished yet */
+  curl_job_t*      done;      /**< finished requests in the order they finished */
+  curl_job_t*      done_last; /**< the last finished request */
+  uint32_t         active_len;
+};
+
+/** aborts all transfers and a pending request of the job. */
+static void job_abort(in3_curl_multi_t* m, curl_job_t* job) {
+  for (uint32_t i = 0; i < job->handles_len; i++) {
+    if (!job->handles[i]) continue;
+    curl_multi_remove_handle(m->cm, job->handles[i]);
+    curl_easy_cleanup(job->handles[i]);
+  }
+  if (job->pending) request_free(job->pending);
+  if (job->headers) curl_slist_free_all(job->headers);
+  _free(job->handles);
+  job->handles     = NULL;
+  job->handles_len = 0;
+  job->running     = 0;
+  job->headers     = NULL;
+  job->pending     = NULL;
+  job->ctx         = NULL;
+  job->responses   = NULL;
+}
+
+/** starts the transfers for all urls of the request and frees it. */
+static void job_send(in3_curl_multi_t* m, curl_job_t* job, in3_http_request_t* request) {
+  struct curl_slist* headers = curl_slist_append(NULL, "Accept: application/json");
+  if (request->payload && *request->payload)
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+  headers = curl_slist_append(headers, "charsets: utf-8");
+  for (in3_req_header_t* h = request->headers; h; h = h->next) headers = curl_slist_append(headers, h->value);
+  job->headers     = curl_slist_append(headers, "User-Agent: in3 curl " IN3_VERSION);
+  job->handles     = _calloc(request->urls_len ? request->urls_len : 1, sizeof(CURL*));
+  job->handles_len = request->urls_len;
+  job->start       = current_ms();
+
+  if (!request->urls_len) {
+    sb_add_chars(&job->responses->data, "The request could not be send!");
+    job->responses->state = IN3_ERPC;
+  }
+
+  for (uint32_t i = 0; i < request->urls_len; i++) {
+    in3_log_trace("... request to " COLOR_YELLOW_STR "\n... " COLOR_MAGENTA_STR "\n", request->urls[i], i == 0 ? request->payload : "");
+    in3_response_t* r    = job->responses + i;
+    CURL*           curl = curl_easy_init();
+    if (!curl) {
+      sb_add_chars(&r->data, "no curl:");
+      r->state = IN3_ECONFIG;
+      continue;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, request->urls[i]);
+    if (request->payload && request->payload_len) {
+      // the payload is copied, since the request is freed before the transfer is done.
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) request->payload_len);
+      curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, request->payload);
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, job->headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*) r);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (uint64_t) request->req->client->timeout / 1000L);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*) job);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request->method);
+    curl_easy_setopt(curl, CURLOPT_SHARE, m->pool->share);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    CURLMcode res = curl_multi_add_handle(m->cm, curl);
+    if (res != CURLM_OK) {
+      sb_add_chars(&r->data, "Invalid response:");
+      sb_add_chars(&r->data, (char*) curl_multi_strerror(res));
+      r->state = IN3_ERPC;
+      curl_easy_cleanup(curl);
+      continue;
+    }
+    job->handles[i] = curl;
+    job->running++;
+  }
+  request_free(request);
+}
+
+/** moves the job from the active list to the end of the done list. */
+static void job_finish(in3_curl_multi_t* m, curl_job_t* job) {
+  for (curl_job_t** p = &m->active; *p; p = &(*p)->next) {
+    if (*p == job) {
+      *p = job->next;
+      break;
+    }
+  }
+  m->active_len--;
+  job->next = NULL;
+  if (m->done_last)
+    m->done_last->next = job;
+  else
+    m->done = job;
+  m->done_last = job;
+}
+
+/** executes the request until it needs to wait for a response or is finished. */
+static void job_step(in3_curl_multi_t* m, curl_job_t* job) {
+  job->dirty = false;
+  while (true) {
+    switch (in3_req_exec_state(job->req)) {
+      case REQ_ERROR:
+      case REQ_SUCCESS:
+        job_abort(m, job);
+        job_finish(m, job);
+        return;
+
+      case REQ_WAITING_FOR_RESPONSE: {
+        in3_req_t* last = in3_req_last_waiting(job->req);
+        if (last == job->ctx && last->raw_response == job->responses && (job->running || job->pending)) return;
+        // the responses we are waiting for are not the ones our transfers are writing to.
+        job_abort(m, job);
+        req_set_error(last, "waiting to fetch more responses, but no transfer is pending", IN3_ENOTSUP);
+        break;
+      }
+
+      case REQ_WAITING_TO_SEND: {
+        // in case there are still transfers running, this is a retry and we don't need them anymore.
+        job_abort(m, job);
+        in3_req_t* last = in3_req_last_waiting(job->req);
+        if (last->type == RT_SIGN) {
+          in3_handle_sign(last);
+          break;
+        }
+
+        // if we can't create the request, this function will put it into error-state
+        in3_http_request_t* request = in3_create_request(last);
+        if (!request) break;
+        job->ctx       = request->req;
+        job->responses = request->req->raw_response;
+        if (request->wait) {
+          job->pending = request;
+          job->send_at = current_ms() + request->wait;
+          return;
+        }
+        job_send(m, job, request);
+        break;
+      }
+    }
+  }
+}
+
+in3_curl_multi_t* in3_curl_multi_new() {
+  pool_ref(); // keeps the pool of the process for the next multiplexers and requests
+  in3_curl_multi_t* m = _calloc(1, sizeof(in3_curl_multi_t));
+  m->pool             = pool_get();
+  m->cm               = pool_take(m->pool);
+  return m;
+}
+
+void in3_curl_multi_add(in3_curl_multi_t* m, in3_req_t* req) {
+  curl_job_t* job = _calloc(1, sizeof(curl_job_t));
+  job->req        = req;
+  job->next       = m->active;
+  m->active       = job;
+  m->active_len++;
+  job_step(m, job);
+}
+
+uint32_t in3_curl_multi_perform(in3_curl_multi_t* m) {
+  int      running   = 0;
+  int      msgs_left = 0;
+  CURLMsg* msg       = NULL;
+  curl_multi_perform(m->cm, &running);
+
+  // first we only collect the finished transfers, since executing a request may remove other handles.
+  while ((msg = curl_multi_info_read(m->cm, &msgs_left))) {
+    if (msg->msg != CURLMSG_DONE) continue;
+    CURL*       e   = msg->easy_handle;
+    curl_job_t* job = NULL;
+    long        response_code;
+    curl_easy_getinfo(e, CURLINFO_PRIVATE, (char**) &job);
+    curl_easy_getinfo(e, CURLINFO_RESPONSE_CODE, &response_code);
+    for (uint32_t i = 0; i < job->handles_len; i++) {
+      if (job->handles[i] != e) continue;
+      in3_response_t* response = job->responses + i;
+      set_response_state(response, msg->data.result, response_code);
+      response->time  = (uint32_t) (current_ms() - job->start);
+      job->handles[i] = NULL;
+      job->running--;
+      job->dirty = true;
+      break;
+    }
+    curl_multi_remove_handle(m->cm, e);
+    curl_easy_cleanup(e);
+  }
+
+  uint64_t now = current_ms();
+  for (curl_job_t *job = m->active, *next = NULL; job; job = next) {
+    next = job->next;
+    if (job->pending && job->send_at <= now) {
+      in3_http_request_t* request = job->pending;
+      job->pending                = NULL;
+      job_send(m, job, request);
+      job->dirty = true;
+    }
+    if (job->dirty) job_step(m, job);
+  }
+  return m->active_len;
+}
+
+uint32_t in3_curl_multi_wait(in3_curl_multi_t* m, uint32_t timeout) {
+  long t = in3_curl_multi_timeout(m);
+  if (t >= 0 && (uint32_t) t < timeout) timeout = (uint32_t) t;
+  if (timeout) {
+    bool transfers = false;
+    for (curl_job_t* job = m->active; job && !transfers; job = job->next) transfers = job->running > 0;
+    if (transfers)
+      curl_multi_wait(m->cm, NULL, 0, (int) timeout, NULL);
+    else if (m->active_len && t >= 0)
+      // only requests waiting for their timer
+      in3_sleep(timeout);
+  }
+  return in3_curl_multi_perform(m);
+}
+
+in3_ret_t in3_curl_multi_fdset(in3_curl_multi_t* m, fd_set* read_fd_set, fd_set* write_fd_set, fd_set* exc_fd_set, int* max_fd) {
+  return curl_multi_fdset(m->cm, read_fd_set, write_fd_set, exc_fd_set, max_fd) == CURLM_OK ? IN3_OK : IN3_ETRANS;
+}
+
+long in3_curl_multi_timeout(in3_curl_multi_t* m) {
+  long timeout = -1;
+  curl_multi_timeout(m->cm, &timeout);
+  uint64_t now = current_ms();
+  for (curl_job_t* job = m->active; job; job = job->next) {
+    if (job->dirty) return 0;
+    if (!job->pending) continue;
+    long t = job->send_at > now ? (long) (job->send_at - now) : 0;
+    if (timeout < 0 || t < timeout) timeout = t;
+  }
+  return timeout;
+}
+
+in3_req_t* in3_curl_multi_next(in3_curl_multi_t* m) {
+  curl_job_t* job = m->done;
+  if (!job) return NULL;
+  in3_req_t* req = job->req;
+  m->done        = job->next;
+  if (!m->done) m->done_last = NULL;
+  _free(job);
+  return req;
+}
+
+void in3_curl_multi_free(in3_curl_multi_t* m) {
+  for (curl_job_t* job = m->active; job; job = m->active) {
+    m->active = job->next;
+    job_abort(m, job);
+    _free(job);
+  }
+  for (curl_job_t* job = m->done; job; job = m->done) {
+    m->done = job->next;
+    _free(job);
+  }
+  pool_release(m->pool, m->cm);
+  pool_put(m->pool);
+  pool_unref();
+  _free(m);
+}
+
+static void readDataBlocking(in3_curl_pool_t* pool, const char* url, char* payload, in3_response_t* r, uint32_t timeout, in3_http_request_t* req) {
   CURL*    curl;
   CURLcode res;
 
@@ -210,6 +731,7 @@ static void readDataBlocking(const char* url, char* payload, in3_response_t* r,
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*) r);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, (uint64_t) timeout / 1000L);
     curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, req->method);
+    curl_easy_setopt(curl, CURLOPT_SHARE, pool->share);
 
     /* Perform the request, res will get the return code */
     res = curl_easy_perform(curl);
@@ -239,10 +761,10 @@ static void readDataBlocking(const char* url, char* payload, in3_response_t* r,
   }
 }
 
-in3_ret_t send_curl_blocking(const char** urls, int urls_len, char* payload, in3_response_t* result, uint32_t timeout, in3_http_request_t* req) {
+in3_ret_t send_curl_blocking(in3_curl_pool_t* pool, const char** urls, int urls_len, char* payload, in3_response_t* result, uint32_t timeout, in3_http_request_t* req) {
   int i;
   for (i = 0; i < urls_len; i++)
-    readDataBlocking(urls[i], payload, result + i, timeout, req);
+    readDataBlocking(pool, urls[i], payload, result + i, timeout, req);
   for (i = 0; i < urls_len; i++) {
     if ((result + i)->state) {
       in3_log_debug("curl: failed for %s\n", urls[i]);
@@ -257,16 +779,17 @@ in3_ret_t send_curl(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx
   in3_http_request_t* req = plugin_ctx;
   // set the init-time
 #ifdef CURL_BLOCKING
-  in3_ret_t res;
-  uint64_t  start = current_ms();
-  res             = send_curl_blocking((const char**) req->urls, req->urls_len, req->payload, req->req->raw_response, req->req->client->timeout, req);
-  uint32_t t      = (uint32_t) (current_ms() - start);
+  uint64_t         start = current_ms();
+  in3_curl_pool_t* pool  = pool_get();
+  in3_ret_t        res   = send_curl_blocking(pool, (const char**) req->urls, req->urls_len, req->payload, req->req->raw_response, req->req->client->timeout, req);
+  uint32_t         t     = (uint32_t) (current_ms() - start);
+  pool_put(pool);
   for (int i = 0; i < req->urls_len; i++) req->req->raw_response[i].time = t;
   return res;
 #else
   switch (action) {
     case PLGN_ACT_TRANSPORT_SEND:
-      return send_curl_nonblocking(req);
+      return send_curl_nonblocking(pool_get(), req); // the reference is released with the transfer in cleanup()
     case PLGN_ACT_TRANSPORT_RECEIVE:
       return receive_next(req);
     case PLGN_ACT_TRANSPORT_CLEAN:
@@ -281,5 +804,12 @@ in3_ret_t send_curl(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx
  * registers curl as a default transport.
  */
 in3_ret_t in3_register_curl(in3_t* c) {
+  // each client is counted only once as user of the pool, which it releases when it is freed.
+  bool registered = false;
+  for (in3_plugin_t* p = c->plugins; p && !registered; p = p->next) registered = p->action_fn == curl_config;
+  if (!registered) {
+    pool_ref();
+    in3_plugin_register(c, PLGN_ACT_CONFIG | PLGN_ACT_TERM, curl_config, NULL, false);
+  }
   return in3_plugin_register(c, PLGN_ACT_TRANSPORT, send_curl, NULL, true);
 }
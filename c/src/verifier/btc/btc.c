@@ -160,8 +160,7 @@ in3_ret_t btc_verify_tx(btc_target_conf_t* conf, in3_vctx_t* vc, uint8_t* tx_id,
     t = d_get(vc->result, key("hex"));
     if (!t || d_type(t) != T_STRING) return vc_err(vc, "missing hex");
     data.len  = (d_len(t) + 1) >> 1;
-    data.data = _malloc(data.len);
-    in3_cache_add_ptr(&vc->req->cache, data.data);
+    data.data = req_alloc(vc->req, data.len);
     hex_to_bytes(d_string(t), d_len(t), data.data, data.len);
 
     // parse tx
@@ -277,8 +276,7 @@ in3_ret_t btc_verify_tx(btc_target_conf_t* conf, in3_vctx_t* vc, uint8_t* tx_id,
     // here we expect the raw serialized transaction
     if (!vc->result || d_type(vc->result) != T_STRING) return vc_err(vc, "expected hex-data as result");
     data.len  = (d_len(vc->result) + 1) >> 1;
-    data.data = _malloc(data.len);
-    in3_cache_add_ptr(&vc->req->cache, data.data);
+    data.data = req_alloc(vc->req, data.len);
     hex_to_bytes(d_string(vc->result), d_len(vc->result), data.data, data.len);
 
     // parse tx
@@ -50,7 +50,7 @@ static int            is_not_existened(d_token_t* account) {
   return d_get_long(account, K_BALANCE) == 0 && bytes_cmp(d_bytesl(d_get(account, K_CODE_HASH), 32), bytes((uint8_t*) EMPTY_HASH, 32)) && bytes_cmp(d_bytesl(d_get(account, K_STORAGE_HASH), 32), bytes((uint8_t*) EMPTY_ROOT_HASH, 32)) && d_get_long(account, K_NONCE) == 0;
 }
 const uint8_t*   empty_hash() { return EMPTY_HASH; }
-static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* account) {
+static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* account, trie_proof_cache_t* cache) {
   d_token_t *     t, *storage_proof, *p;
   int             i;
   uint8_t         hash[32], val[36];
@@ -70,7 +70,7 @@ static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* accoun
   if (!proof) return vc_err(vc, "no merkle proof for the account");
   account_raw = serialize_account(account);
 
-  if (!trie_verify_proof(&root, &path, proof, is_not_existened(account) ? NULL : account_raw)) {
+  if (!trie_verify_proof_cached(cache, &root, &path, proof, is_not_existened(account) ? NULL : account_raw)) {
     _free(proof);
     b_free(account_raw);
     return vc_err(vc, "invalid account proof where blockheader does not match the rootstate, which might be a microfork");
@@ -122,7 +122,7 @@ static in3_ret_t verify_proof(in3_vctx_t* vc, bytes_t* header, d_token_t* accoun
         }
       }
 
-      if (!trie_verify_proof(&root, &path, proof, bb.b.len ? &bb.b : NULL)) {
+      if (!trie_verify_proof_cached(cache, &root, &path, proof, bb.b.len ? &bb.b : NULL)) {
         _free(proof);
         return vc_err(vc, "invalid storage proof");
       }
@@ -165,12 +165,18 @@ in3_ret_t eth_verify_account_proof(in3_vctx_t* vc) {
 
   // now check the results
   if (!(accounts = d_get(vc->proof, K_ACCOUNTS))) return vc_err(vc, "no accounts");
+
+  // all proofs share the upper nodes of the state trie, so each node is only hashed once.
+  trie_proof_cache_t cache = {0};
   for (i = 0, t = accounts + 1; i < d_len(accounts); i++, t = d_next(t)) {
-    if (verify_proof(vc, &header, t))
+    if (verify_proof(vc, &header, t, &cache)) {
+      trie_proof_cache_free(&cache);
       return vc_err(vc, "failed verifying the account");
+    }
     else if (proofed_account == NULL && d_eq(contract, d_getl(t, K_ADDRESS, 20)))
       proofed_account = t;
   }
+  trie_proof_cache_free(&cache);
 
   if (!proofed_account) return vc_err(vc, "the contract this proof is based on was not part of the proof");
 
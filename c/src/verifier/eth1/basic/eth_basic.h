@@ -76,6 +76,16 @@ in3_filter_handler_t* eth_basic_get_filters(in3_t* c);
  */
 in3_ret_t eth_verify_tx_values(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw);
 
+/**
+ * verifies the tx-values except the sender and writes the unsigned tx-hash and the 65 bytes signature to recover it.
+ */
+in3_ret_t eth_prepare_tx_signature(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw, bytes32_t hash, uint8_t* sig);
+
+/**
+ * verifies the from-address and publicKey of a tx against the recovered public key.
+ */
+in3_ret_t eth_verify_tx_sender(in3_vctx_t* vc, d_token_t* tx, const uint8_t* pubkey);
+
 /**
  * verifies a transaction.
  */
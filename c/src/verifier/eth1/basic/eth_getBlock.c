@@ -107,22 +107,23 @@ in3_ret_t eth_verify_eth_getBlockTransactionCount(in3_vctx_t* vc, bytes_t block_
   if (d_len(transactions) != count)
     return vc_err(vc, "Transaction count mismatch");
 
-  trie_t* trie = trie_new();
-  for (i = 0, t = d_get_at(transactions, 0); i < d_len(transactions); i++, t = d_next(t)) {
-    bool     is_raw_tx = d_is_bytes(t);
-    bytes_t* path      = create_tx_path(i);
-    bytes_t* tx        = is_raw_tx ? d_as_bytes(t) : serialize_tx(t);
-    trie_set_value(trie, path, tx);
-    if (!is_raw_tx) b_free(tx);
-    b_free(path);
+  bytes32_t root;
+  bytes_t*  txs = _malloc(count * sizeof(bytes_t) + 1);
+  for (i = 0, t = d_get_at(transactions, 0); i < count; i++, t = d_next(t)) {
+    bytes_t* tx = d_is_bytes(t) ? NULL : serialize_tx(t);
+    txs[i]      = tx ? *tx : d_bytes(t);
+    _free(tx);
   }
+  trie_index_root(txs, count, root);
+  for (i = 0, t = d_get_at(transactions, 0); i < count; i++, t = d_next(t)) {
+    if (!d_is_bytes(t)) _free(txs[i].data);
+  }
+  _free(txs);
 
   // check tx root
-  if (t_root.len != 32 || memcmp(t_root.data, trie->root, 32))
+  if (t_root.len != 32 || memcmp(t_root.data, root, 32))
     res = vc_err(vc, "Wrong Transaction root");
 
-  trie_free(trie);
-
   return res;
 }
 
@@ -178,18 +179,25 @@ in3_ret_t eth_verify_eth_getBlock(in3_vctx_t* vc, bytes_t block_hash, uint64_t b
     if (!include_full_tx && (!tx_hashs || d_len(transactions) != d_len(tx_hashs)))
       return vc_err(vc, "no transactionhashes found!");
 
-    trie_t* trie = trie_new();
-    for (i = 0, t = d_get_at(transactions, 0); i < d_len(transactions); i++, t = d_next(t)) {
+    // the senders of all transactions are recovered in one batch after the loop
+    int         tx_count   = d_len(transactions), signed_count = 0;
+    bytes32_t*  digests    = _malloc(tx_count * sizeof(bytes32_t));
+    uint8_t*    sigs       = _malloc(tx_count * 65);
+    d_token_t** signed_txs = _malloc(tx_count * sizeof(d_token_t*));
+    bytes_t*    txs        = _malloc(tx_count * sizeof(bytes_t) + 1); // the raw transactions used to build the transaction root
+    for (i = 0, t = d_get_at(transactions, 0); i < tx_count; i++, t = d_next(t)) {
       bool     is_raw_tx = d_is_bytes(t);
-      bytes_t* path      = create_tx_path(i);
       bytes_t* tx        = is_raw_tx ? d_as_bytes(t) : serialize_tx(t);
       uint8_t* h         = (full_proof || !include_full_tx) ? tmp_hash : NULL;
+      txs[i]             = *tx;
 
       if (h) keccak(*tx, h);
 
       if (!is_raw_tx) {
-        if (eth_verify_tx_values(vc, t, tx))
+        if (eth_prepare_tx_signature(vc, t, tx, digests[signed_count], sigs + signed_count * 65))
           res = IN3_EUNKNOWN;
+        else
+          signed_txs[signed_count++] = t;
 
         if ((t2 = d_getl(t, K_BLOCK_HASH, 32)) && !bytes_cmp(d_bytes(t2), bhash))
           res = vc_err(vc, "Wrong Blockhash in tx");
@@ -207,17 +215,40 @@ in3_ret_t eth_verify_eth_getBlock(in3_vctx_t* vc, bytes_t block_hash, uint64_t b
           res = vc_err(vc, "Wrong Transactionhash");
         txh = d_next(txh);
       }
-      trie_set_value(trie, path, tx);
-      if (!is_raw_tx) b_free(tx);
-      b_free(path);
+      if (!is_raw_tx) _free(tx); // the data will be freed after building the transaction root
     }
 
     bytes_t t_root = d_bytes(d_getl(vc->result, K_TRANSACTIONS_ROOT, 32));
-
-    if (t_root.len != 32 || memcmp(t_root.data, trie->root, 32))
+    trie_index_root(txs, tx_count, tmp_hash);
+    if (t_root.len != 32 || memcmp(t_root.data, tmp_hash, 32))
       res = vc_err(vc, "Wrong Transaction root");
-
-    trie_free(trie);
+    for (i = 0, t = d_get_at(transactions, 0); i < tx_count; i++, t = d_next(t)) {
+      if (!d_is_bytes(t)) _free(txs[i].data);
+    }
+    _free(txs);
+
+    if (signed_count) {
+      bytes_t*   dl      = _malloc(signed_count * 2 * sizeof(bytes_t));
+      uint8_t*   pubkeys = _malloc(signed_count * 64);
+      in3_ret_t* results = _malloc(signed_count * sizeof(in3_ret_t));
+      for (i = 0; i < signed_count; i++) {
+        dl[i]                = bytes(digests[i], 32);
+        dl[signed_count + i] = bytes(sigs + i * 65, 65);
+      }
+      crypto_recover_batch(ECDSA_SECP256K1, signed_count, dl, dl + signed_count, pubkeys, results);
+      for (i = 0; i < signed_count; i++) {
+        if (results[i])
+          res = vc_err(vc, "could not recover signature");
+        else if (eth_verify_tx_sender(vc, signed_txs[i], pubkeys + i * 64))
+          res = IN3_EUNKNOWN;
+      }
+      _free(dl);
+      _free(pubkeys);
+      _free(results);
+    }
+    _free(digests);
+    _free(sigs);
+    _free(signed_txs);
 
     // verify uncles
     if (res == IN3_OK && full_proof)
@@ -34,6 +34,7 @@
 
 #include "../../../core/client/keys.h"
 #include "../../../core/client/request.h"
+#include "../../../core/client/workers.h"
 #include "../../../core/util/crypto.h"
 #include "../../../core/util/data.h"
 #include "../../../core/util/log.h"
@@ -48,13 +49,29 @@
 #define LATEST_APPROX_ERR 1
 
 typedef struct receipt {
-  bytes32_t tx_hash;
-  bytes_t   data;
-  bytes_t   block_number;
-  bytes32_t block_hash;
-  uint32_t  transaction_index;
+  bytes32_t   tx_hash;
+  bytes_t     data;
+  bytes_t     block_number;
+  bytes32_t   block_hash;
+  uint32_t    transaction_index;
+  bytes_t     tx_root;      /**< the transactions root of the block */
+  bytes_t     receipt_root; /**< the receipts root of the block */
+  d_token_t*  proof;        /**< the proof of the receipt */
+  char*       error;        /**< the error found while verifying the proofs */
 } receipt_t;
 
+/** the receipts verified by the worker threads */
+typedef struct {
+  receipt_t*          receipts;
+  trie_proof_cache_t* caches; /**< one cache for each thread */
+} receipts_job_t;
+
+/** index of the receipts by transaction hash */
+typedef struct {
+  uint32_t* slots; /**< the index of the receipt + 1 or 0 if the slot is empty */
+  uint32_t  size;  /**< size of the table (a power of 2) */
+} receipt_index_t;
+
 static bool matches_filter_address(d_token_t* tx_params, bytes_t addrs) {
   d_token_t* jaddrs = d_getl(tx_params, K_ADDRESS, 20);
   if (jaddrs == NULL) {
@@ -196,19 +213,46 @@ static in3_ret_t filter_check_latest(d_token_t* req, uint64_t blk, uint64_t curr
   }
 }
 
-in3_ret_t eth_verify_eth_getLog(in3_vctx_t* vc, int l_logs) {
-  in3_ret_t  res = IN3_OK, i = 0;
-  receipt_t* receipts = alloca(sizeof(receipt_t) * l_logs);
-  bytes_t    logddata, tmp, tops;
-  char       xtmp[12];
+/**
+ * verifies the merkle proofs of the transaction and the receipt.
+ * Since this runs in a worker thread, errors are stored in the receipt and reported later.
+ */
+static void verify_receipt(void* ctx, uint32_t index, uint32_t worker) {
+  receipts_job_t*     job   = ctx;
+  receipt_t*          r     = job->receipts + index;
+  trie_proof_cache_t* cache = job->caches + worker;
+  bytes_t*            path  = create_tx_path(r->transaction_index);
+
+  // verify tx data first
+  bytes_t** proof = d_create_bytes_vec(d_get(r->proof, K_TX_PROOF));
+  r->data         = NULL_BYTES;
+  if (!proof || !trie_verify_proof_cached(cache, &r->tx_root, path, proof, &r->data))
+    r->error = "invalid tx merkle proof";
+  else {
+    // check txhash
+    keccak(r->data, r->tx_hash);
+    if (!bytes_cmp(d_bytes(d_getl(r->proof, K_TX_HASH, 32)), bytes(r->tx_hash, 32))) r->error = "invalid tx hash";
+  }
+  _free(proof);
+
+  // verify receipt data
+  if (!r->error) {
+    proof   = d_create_bytes_vec(d_get(r->proof, K_PROOF));
+    r->data = NULL_BYTES;
+    if (!proof || !trie_verify_proof_cached(cache, &r->receipt_root, path, proof, &r->data))
+      r->error = "invalid receipt proof";
+    _free(proof);
+  }
+  if (path) b_free(path);
+}
 
-  // invalid result-token
-  if (!vc->result || d_type(vc->result) != T_ARRAY) return vc_err(vc, "The result must be an array");
-  // no results -> nothing to verify
-  if (l_logs == 0) return IN3_OK;
-  // we require proof
-  if (!vc->proof) return vc_err(vc, "no proof for logs found");
-  if (d_len(d_get(vc->proof, K_LOG_PROOF)) > l_logs) return vc_err(vc, "too many proofs");
+/**
+ * verifies the blockheaders and prepares a receipt for each receipt of the proof.
+ * The blockheaders are verified by the calling thread, since this uses the verified hashes of the client.
+ */
+static in3_ret_t collect_receipts(in3_vctx_t* vc, receipt_t* receipts, int l_logs, int* len) {
+  int  i = 0;
+  char xtmp[12];
 
   for (d_iterator_t it = d_iter(d_get(vc->proof, K_LOG_PROOF)); it.left; d_iter_next(&it)) {
     sprintf(xtmp, "0x%" PRIx64, d_get_long(it.token, K_NUMBER));
@@ -221,67 +265,56 @@ in3_ret_t eth_verify_eth_getLog(in3_vctx_t* vc, int l_logs) {
       return vc_err(vc, "block number mismatch");
 
     // verify the blockheader of the log entry
-    bytes_t block = d_bytes(d_get(it.token, K_BLOCK)), tx_root, receipt_root;
-    int     bl    = i;
+    receipt_t block_receipt = {0};
+    bytes_t   block         = d_bytes(d_get(it.token, K_BLOCK));
     if (!block.len || eth_verify_blockheader(vc, block, NULL_BYTES) < 0) return vc_err(vc, "invalid blockheader");
-    keccak(block, receipts[i].block_hash);
+    keccak(block, block_receipt.block_hash);
     rlp_decode(&block, 0, &block);
-    if (rlp_decode(&block, BLOCKHEADER_RECEIPT_ROOT, &receipt_root) != 1) return vc_err(vc, "invalid receipt root");
-    if (rlp_decode(&block, BLOCKHEADER_TRANSACTIONS_ROOT, &tx_root) != 1) return vc_err(vc, "invalid tx root");
-    if (rlp_decode(&block, BLOCKHEADER_NUMBER, &receipts[i].block_number) != 1) return vc_err(vc, "invalid block number");
+    if (rlp_decode(&block, BLOCKHEADER_RECEIPT_ROOT, &block_receipt.receipt_root) != 1) return vc_err(vc, "invalid receipt root");
+    if (rlp_decode(&block, BLOCKHEADER_TRANSACTIONS_ROOT, &block_receipt.tx_root) != 1) return vc_err(vc, "invalid tx root");
+    if (rlp_decode(&block, BLOCKHEADER_NUMBER, &block_receipt.block_number) != 1) return vc_err(vc, "invalid block number");
 
-    // verify all receipts
     for (d_iterator_t receipt = d_iter(d_get(it.token, K_RECEIPTS)); receipt.left; d_iter_next(&receipt)) {
-      // verify that txn hash matches key
       if (i == l_logs) return vc_err(vc, "too many receipts in the proof");
-      receipt_t* r = receipts + i;
-      if (i != bl) memcpy(r, receipts + bl, sizeof(receipt_t)); // copy blocknumber and blockhash
-      i++;
-
-      // verify tx data first
-      r->data              = NULL_BYTES;
+      receipt_t* r         = receipts + i++;
+      *r                   = block_receipt; // copy blocknumber, blockhash and roots
+      r->proof             = receipt.token;
       r->transaction_index = d_get_int(receipt.token, K_TX_INDEX);
-      bytes_t** proof      = d_create_bytes_vec(d_get(receipt.token, K_TX_PROOF));
-      bytes_t*  path       = create_tx_path(r->transaction_index);
-
-      if (!proof || !trie_verify_proof(&tx_root, path, proof, &r->data))
-        res = vc_err(vc, "invalid tx merkle proof");
-      if (proof) _free(proof);
-      if (res != IN3_OK) {
-        if (path) b_free(path);
-        return res;
-      }
-
-      // check txhash
-
-      keccak(r->data, r->tx_hash);
-      if (!bytes_cmp(d_bytes(d_getl(receipt.token, K_TX_HASH, 32)), bytes(r->tx_hash, 32))) {
-        if (path) b_free(path);
-        return vc_err(vc, "invalid tx hash");
-      }
+    }
+  }
+  *len = i;
+  return IN3_OK;
+}
 
-      // verify receipt data
-      proof   = d_create_bytes_vec(d_get(receipt.token, K_PROOF));
-      r->data = NULL_BYTES;
+static receipt_t* find_receipt(receipt_index_t* index, receipt_t* receipts, bytes_t tx_hash) {
+  if (tx_hash.len != 32) return NULL;
+  for (uint32_t i = bytes_to_int(tx_hash.data, 4) & (index->size - 1); index->slots[i]; i = (i + 1) & (index->size - 1)) {
+    receipt_t* r = receipts + index->slots[i] - 1;
+    if (memcmp(r->tx_hash, tx_hash.data, 32) == 0) return r;
+  }
+  return NULL;
+}
 
-      if (!proof || !trie_verify_proof(&receipt_root, path, proof, &r->data))
-        res = vc_err(vc, "invalid receipt proof");
-      if (proof) _free(proof);
-      if (path) b_free(path);
-      if (res != IN3_OK) return res;
-    }
+static void index_receipts(receipt_index_t* index, receipt_t* receipts, int len) {
+  for (index->size = 2; index->size < (uint32_t) len * 2; index->size <<= 1) {}
+  index->slots = _calloc(index->size, sizeof(uint32_t));
+  for (int n = 0; n < len; n++) {
+    if (find_receipt(index, receipts, bytes(receipts[n].tx_hash, 32))) continue; // the first receipt wins
+    uint32_t i = bytes_to_int(receipts[n].tx_hash, 4) & (index->size - 1);
+    while (index->slots[i]) i = (i + 1) & (index->size - 1);
+    index->slots[i] = n + 1;
   }
+}
+
+/** verifies each log of the result against the verified receipts */
+static in3_ret_t verify_logs(in3_vctx_t* vc, receipt_index_t* index, receipt_t* receipts) {
+  bytes_t   logddata, tmp, tops;
+  in3_ret_t i;
 
   uint64_t prev_blk = 0;
   for (d_iterator_t it = d_iter(vc->result); it.left; d_iter_next(&it)) {
-    receipt_t* r = NULL;
+    receipt_t* r = find_receipt(index, receipts, d_bytes(d_get(it.token, K_TRANSACTION_HASH)));
     i            = 0;
-    for (int n = 0; n < l_logs; n++) {
-      if (bytes_cmp(d_bytes(d_get(it.token, K_TRANSACTION_HASH)), bytes(receipts[n].tx_hash, 32))) {
-        r = receipts + n;
-        break;
-      }
-    }
     if (!r) return vc_err(vc, "missing proof for log");
     d_token_t* topics = d_get(it.token, K_TOPICS);
     bytes_t    data   = r->data;
@@ -322,5 +355,43 @@ in3_ret_t eth_verify_eth_getLog(in3_vctx_t* vc, int l_logs) {
     if (filter_check_latest(vc->request, d_get_long(it.token, K_BLOCK_NUMBER), vc->currentBlock, it.left == 1) != IN3_OK) return vc_err(vc, "latest check failed");
   }
 
+  return IN3_OK;
+}
+
+in3_ret_t eth_verify_eth_getLog(in3_vctx_t* vc, int l_logs) {
+  in3_ret_t res = IN3_OK;
+  int       len = 0;
+
+  // invalid result-token
+  if (!vc->result || d_type(vc->result) != T_ARRAY) return vc_err(vc, "The result must be an array");
+  // no results -> nothing to verify
+  if (l_logs == 0) return IN3_OK;
+  // we require proof
+  if (!vc->proof) return vc_err(vc, "no proof for logs found");
+  if (d_len(d_get(vc->proof, K_LOG_PROOF)) > l_logs) return vc_err(vc, "too many proofs");
+
+  receipt_t* receipts = _calloc(l_logs, sizeof(receipt_t));
+  if ((res = collect_receipts(vc, receipts, l_logs, &len)) == IN3_OK) {
+    // the proofs of the receipts are independent, so they are verified in parallel.
+    // Each thread uses its own cache, since receipts of the same block share the upper nodes of the trie.
+    uint32_t       threads = in3_workers_count(vc->req->client);
+    receipts_job_t job     = {.receipts = receipts, .caches = _calloc(threads, sizeof(trie_proof_cache_t))};
+    in3_workers_run(vc->req->client, verify_receipt, &job, len);
+    for (uint32_t n = 0; n < threads; n++) trie_proof_cache_free(job.caches + n);
+    _free(job.caches);
+
+    // report the first error in the order of the proof
+    for (int n = 0; n < len && res == IN3_OK; n++) {
+      if (receipts[n].error) res = vc_err(vc, receipts[n].error);
+    }
+  }
+
+  if (res == IN3_OK) {
+    receipt_index_t index = {0};
+    index_receipts(&index, receipts, len);
+    res = verify_logs(vc, &index, receipts);
+    _free(index.slots);
+  }
+  _free(receipts);
   return res;
 }
@@ -81,9 +81,8 @@ bytes_t create_unsigned_tx(bytes_t raw, uint32_t chain_id) {
   return bb.b;
 }
 
-in3_ret_t eth_verify_tx_values(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw) {
+in3_ret_t eth_prepare_tx_signature(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw, bytes32_t hash, uint8_t* sdata) {
   d_token_t* t = NULL;
-  uint8_t    hash[32], pubkey[64], sdata[65];
   int        type     = raw && raw->len && raw->data && raw->data[0] < 0x7f ? raw->data[0] : 0;
   bytes_t    r        = d_get_byteskl(tx, K_R, 32);
   bytes_t    s        = d_get_byteskl(tx, K_S, 32);
@@ -124,19 +123,32 @@ in3_ret_t eth_verify_tx_values(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw) {
   bytes_t unsigned_tx = create_unsigned_tx(raw ? *raw : d_bytes(d_get(tx, K_RAW)), chain_id);
   keccak(unsigned_tx, hash);
   _free(unsigned_tx.data);
+  return IN3_OK;
+}
 
-  // verify signature
-  if (crypto_recover(ECDSA_SECP256K1, bytes(hash, 32), bytes(sdata, 65), pubkey))
-    return vc_err(vc, "could not recover signature");
+in3_ret_t eth_verify_tx_sender(in3_vctx_t* vc, d_token_t* tx, const uint8_t* pubkey) {
+  d_token_t* t = NULL;
+  bytes32_t  hash;
 
   if ((t = d_getl(tx, K_PUBLIC_KEY, 64)) && memcmp(pubkey, d_bytes(t).data, d_len(t)) != 0)
     return vc_err(vc, "invalid public Key");
 
-  if ((t = d_getl(tx, K_FROM, 20)) && keccak(bytes(pubkey, 64), hash) == 0 && memcmp(hash + 12, d_bytes(t).data, 20))
+  if ((t = d_getl(tx, K_FROM, 20)) && keccak(bytes((uint8_t*) pubkey, 64), hash) == 0 && memcmp(hash + 12, d_bytes(t).data, 20))
     return vc_err(vc, "invalid from address");
   return IN3_OK;
 }
 
+in3_ret_t eth_verify_tx_values(in3_vctx_t* vc, d_token_t* tx, bytes_t* raw) {
+  uint8_t hash[32], pubkey[64], sdata[65];
+  TRY(eth_prepare_tx_signature(vc, tx, raw, hash, sdata))
+
+  // verify signature
+  if (crypto_recover(ECDSA_SECP256K1, bytes(hash, 32), bytes(sdata, 65), pubkey))
+    return vc_err(vc, "could not recover signature");
+
+  return eth_verify_tx_sender(vc, tx, pubkey);
+}
+
 in3_ret_t eth_verify_eth_getTransaction(in3_vctx_t* vc, bytes_t tx_hash) {
 
   in3_ret_t res = IN3_OK;
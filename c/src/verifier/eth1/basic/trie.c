@@ -416,6 +416,120 @@ void trie_set_value(trie_t* t, bytes_t* key, bytes_t* value) {
   memcpy(t->root, root, 32);
 }
 
+// -- index trie --
+
+#define INDEX_TRIE_DEPTH 11 // the key of an uint32 index has up to 5 bytes, so leafs are at most at depth 10
+
+/** the values of a trie with the rlp-encoded index as key */
+typedef struct {
+  bytes_t*         values;                  /**< the values */
+  uint32_t         small;                   /**< number of keys with one byte (index 1 - 127) */
+  bytes_builder_t* nodes[INDEX_TRIE_DEPTH]; /**< one builder for each depth, which are reused */
+} index_trie_t;
+
+/** returns the index of the value at the given position, if all values are sorted by key. */
+static inline uint32_t sorted_index(index_trie_t* t, uint32_t pos) {
+  // the keys 0x01 - 0x7f come first, then 0x80 (for index 0) and then all multibyte keys, which are ordered like the index
+  return pos < t->small ? pos + 1 : (pos == t->small ? 0 : pos);
+}
+
+/** writes the nibbles of the rlp-encoded index and returns their number */
+static int key_nibbles(uint32_t index, uint8_t* dst) {
+  uint8_t key[5];
+  int     len = 1;
+  if (index == 0)
+    key[0] = 0x80;
+  else if (index < 0x80)
+    key[0] = (uint8_t) index;
+  else {
+    for (uint32_t v = index; v; v >>= 8) len++;
+    key[0] = 0x80 + len - 1;
+    for (int i = len - 1; i; i--, index >>= 8) key[i] = index & 0xFF;
+  }
+  for (int i = 0; i < len; i++) {
+    dst[i * 2]     = key[i] >> 4;
+    dst[i * 2 + 1] = key[i] & 0xF;
+  }
+  return len * 2;
+}
+
+/** adds the hex-prefix encoded path of a leaf or extension */
+static void add_path(bytes_builder_t* bb, uint8_t* nibbles, int len, bool is_leaf) {
+  uint8_t data[6];
+  bytes_t path = {.data = data, .len = len / 2 + 1};
+  data[0]      = (is_leaf ? 0x20 : 0) | ((len & 1) ? 0x10 | *(nibbles++) : 0);
+  for (uint32_t i = 1; i < path.len; i++, nibbles += 2) data[i] = (nibbles[0] << 4) | nibbles[1];
+  rlp_encode_item(bb, &path);
+}
+
+static void encode_node(index_trie_t* t, uint32_t start, uint32_t end, int depth, bytes_builder_t* bb);
+
+/** encodes the node and adds it to the parent as embedded node or as hash */
+static void add_child(index_trie_t* t, uint32_t start, uint32_t end, int depth, bytes_builder_t* parent) {
+  bytes_builder_t* bb = t->nodes[depth] ? t->nodes[depth] : (t->nodes[depth] = bb_newl(128));
+  bb_clear(bb);
+  encode_node(t, start, end, depth, bb);
+  if (bb->b.len < 32)
+    bb_write_raw_bytes(parent, bb->b.data, bb->b.len);
+  else {
+    uint8_t hash[32];
+    bytes_t h = bytes(hash, 32);
+    keccak(bb->b, hash);
+    rlp_encode_item(parent, &h);
+  }
+}
+
+/** encodes the node holding the values from start to end, whose keys all share the nibbles up to depth. */
+static void encode_node(index_trie_t* t, uint32_t start, uint32_t end, int depth, bytes_builder_t* bb) {
+  uint8_t first[10], last[10];
+  bytes_t empty   = NULL_BYTES;
+  int     l_first = key_nibbles(sorted_index(t, start), first);
+  int     l_last  = key_nibbles(sorted_index(t, end - 1), last);
+  int     common  = depth;
+  while (common < l_first && common < l_last && first[common] == last[common]) common++;
+
+  if (end - start == 1) { // leaf
+    add_path(bb, first + depth, l_first - depth, true);
+    rlp_encode_item(bb, t->values + sorted_index(t, start));
+  }
+  else if (common > depth) { // extension
+    add_path(bb, first + depth, common - depth, false);
+    add_child(t, start, end, common, bb);
+  }
+  else { // branch
+    bytes_t* value = NULL;
+    uint8_t  nibbles[10];
+    if (l_first == depth) value = t->values + sorted_index(t, start++); // the first key ends here
+    for (int n = 0; n < 16; n++) {
+      uint32_t next = start;
+      while (next < end && key_nibbles(sorted_index(t, next), nibbles) > depth && nibbles[depth] == n) next++;
+      if (next == start)
+        rlp_encode_item(bb, &empty);
+      else
+        add_child(t, start, next, depth + 1, bb);
+      start = next;
+    }
+    rlp_encode_item(bb, value ? value : &empty);
+  }
+  rlp_encode_to_list(bb);
+}
+
+void trie_index_root(bytes_t* values, uint32_t len, bytes32_t root) {
+  bytes_t      empty = NULL_BYTES;
+  index_trie_t t     = {.values = values, .small = len < 0x80 ? (len ? len - 1 : 0) : 0x7F};
+  t.nodes[0]         = bb_newl(128);
+  if (len)
+    encode_node(&t, 0, len, 0, t.nodes[0]);
+  else
+    rlp_encode_item(t.nodes[0], &empty);
+
+  // the root is always hashed, even if it is smaller than 32 bytes
+  keccak(t.nodes[0]->b, root);
+  for (int i = 0; i < INDEX_TRIE_DEPTH; i++) {
+    if (t.nodes[i]) bb_free(t.nodes[i]);
+  }
+}
+
 #ifdef TRIETEST
 static void hexprint(uint8_t* a, int l) {
   (void) a; // unused param if compiled without debug
@@ -112,6 +112,13 @@ void trie_free(trie_t* val);
  */
 void trie_set_value(trie_t* t, bytes_t* key, bytes_t* value);
 
+/**
+ * calculates the root hash of a trie using the rlp-encoded index of each value as key, like the transactions or receipts of a block.
+ *
+ * Instead of inserting each value, the nodes are built from the values sorted by key, so each node is encoded and hashed only once.
+ */
+void trie_index_root(bytes_t* values, uint32_t len, bytes32_t root);
+
 #ifdef TEST
 void trie_dump(trie_t* trie, uint8_t with_hash);
 #endif
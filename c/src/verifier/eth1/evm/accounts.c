@@ -39,36 +39,184 @@
 #include "gas.h"
 #ifdef EVM_GAS
 
+#define MAP_MIN_SIZE     16
+#define JOURNAL_MIN_SIZE 32
+
+// ---- hashtable with the key at the beginning of the items
+
+static inline uint32_t map_hash(const uint8_t* key, int len) {
+  uint32_t h = 2166136261U;
+  for (int i = 0; i < len; i++) h = (h ^ key[i]) * 16777619U;
+  return h;
+}
+
+static void* map_get(evm_map_t* map, const uint8_t* key, int len) {
+  if (!map->size) return NULL;
+  for (uint32_t i = map_hash(key, len) & (map->size - 1);; i = (i + 1) & (map->size - 1)) {
+    if (!map->slots[i]) return NULL;
+    if (memcmp(map->slots[i], key, len) == 0) return map->slots[i];
+  }
+}
+
+static void map_put(evm_map_t* map, void* item, int len) {
+  if ((map->len + 1) * 4 > map->size * 3) {
+    evm_map_t old = *map;
+    map->size     = old.size ? old.size * 2 : MAP_MIN_SIZE;
+    map->slots    = _calloc(map->size, sizeof(void*));
+    map->len      = 0;
+    for (uint32_t i = 0; i < old.size; i++) {
+      if (old.slots[i]) map_put(map, old.slots[i], len);
+    }
+    _free(old.slots);
+  }
+  uint32_t i = map_hash(item, len) & (map->size - 1);
+  while (map->slots[i]) i = (i + 1) & (map->size - 1);
+  map->slots[i] = item;
+  map->len++;
+}
+
+static void map_remove(evm_map_t* map, void* item, int len) {
+  uint32_t mask = map->size - 1, i = map_hash(item, len) & mask;
+  while (map->slots[i] != item) i = (i + 1) & mask;
+  map->slots[i] = NULL;
+  map->len--;
+  // move the following entries of the cluster back, so they can still be found
+  for (uint32_t j = (i + 1) & mask; map->slots[j]; j = (j + 1) & mask) {
+    uint32_t k = map_hash(map->slots[j], len) & mask;
+    if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+      map->slots[i] = map->slots[j];
+      map->slots[j] = NULL;
+      i             = j;
+    }
+  }
+}
+
+// ---- journal
+
+static evm_accounts_t* get_accounts(evm_t* evm) {
+  if (!evm->accounts) evm->accounts = evm->parent ? get_accounts(evm->parent) : _calloc(1, sizeof(evm_accounts_t));
+  return evm->accounts;
+}
+
+static evm_journal_t* journal_add(evm_accounts_t* accounts, int type, account_t* ac, storage_t* s) {
+  if (accounts->journal_len == accounts->journal_size) {
+    accounts->journal_size = accounts->journal_size ? accounts->journal_size * 2 : JOURNAL_MIN_SIZE;
+    accounts->journal      = _realloc(accounts->journal, accounts->journal_size * sizeof(evm_journal_t), accounts->journal_len * sizeof(evm_journal_t));
+  }
+  evm_journal_t* entry = accounts->journal + accounts->journal_len++;
+  entry->type          = type;
+  entry->account       = ac;
+  entry->storage       = s;
+  return entry;
+}
+
+/** saves the state of the account, before it is used in a subcall for the first time */
+static void journal_account(evm_t* evm, account_t* ac) {
+  if (!evm->checkpoint || ac->checkpoint == evm->checkpoint) return;
+  evm_journal_t* entry = journal_add(evm->accounts, JOURNAL_ACCOUNT_CHANGED, ac, NULL);
+  memcpy(entry->balance, ac->balance, 32);
+  memcpy(entry->nonce, ac->nonce, 32);
+  entry->code    = ac->code;
+  ac->checkpoint = evm->checkpoint;
+}
+
+/** saves the value of the storage, before it is used in a subcall for the first time */
+static void journal_storage(evm_t* evm, account_t* ac, storage_t* s) {
+  if (!evm->checkpoint || s->checkpoint == evm->checkpoint) return;
+  memcpy(journal_add(evm->accounts, JOURNAL_STORAGE_CHANGED, ac, s)->balance, s->value, 32);
+  s->checkpoint = evm->checkpoint;
+}
+
+static void add_account(evm_t* evm, account_t* ac) {
+  evm_accounts_t* accounts = evm->accounts;
+  ac->checkpoint           = evm->checkpoint;
+  ac->next                 = accounts->list;
+  accounts->list           = ac;
+  map_put(&accounts->map, ac, 20);
+  if (evm->checkpoint) journal_add(accounts, JOURNAL_ACCOUNT_CREATED, ac, NULL);
+}
+
+static void add_storage(evm_t* evm, account_t* ac, storage_t* s) {
+  s->checkpoint = evm->checkpoint;
+  s->next       = ac->storage;
+  ac->storage   = s;
+  map_put(&ac->slots, s, 32);
+  if (evm->checkpoint) journal_add(evm->accounts, JOURNAL_STORAGE_CREATED, ac, s);
+}
+
+void evm_checkpoint(evm_t* evm) {
+  evm_accounts_t* accounts = get_accounts(evm);
+  evm->checkpoint          = ++accounts->checkpoints;
+  evm->journal_pos         = accounts->journal_len;
+}
+
+void evm_revert_state(evm_t* evm) {
+  evm_accounts_t* accounts = evm->accounts;
+  if (!accounts) return;
+  // undo all changes in reverse order, so created entries are always the first in their list.
+  while (accounts->journal_len > evm->journal_pos) {
+    evm_journal_t* entry = accounts->journal + --accounts->journal_len;
+    account_t*     ac    = entry->account;
+    switch (entry->type) {
+      case JOURNAL_ACCOUNT_CREATED:
+        map_remove(&accounts->map, ac, 20);
+        accounts->list = ac->next;
+        _free(ac->slots.slots);
+        _free(ac);
+        break;
+      case JOURNAL_ACCOUNT_CHANGED:
+        memcpy(ac->balance, entry->balance, 32);
+        memcpy(ac->nonce, entry->nonce, 32);
+        ac->code = entry->code;
+        break;
+      case JOURNAL_STORAGE_CREATED:
+        map_remove(&ac->slots, entry->storage, 32);
+        ac->storage = entry->storage->next;
+        _free(entry->storage);
+        break;
+      case JOURNAL_STORAGE_CHANGED:
+        memcpy(entry->storage->value, entry->balance, 32);
+        break;
+    }
+  }
+}
+
+void evm_free_accounts(evm_t* evm) {
+  evm_accounts_t* accounts = evm->accounts;
+  evm->accounts            = NULL;
+  // subcalls share the accounts of the root
+  if (!accounts || evm->parent) return;
+  while (accounts->list) {
+    account_t* ac  = accounts->list;
+    accounts->list = ac->next;
+    while (ac->storage) {
+      storage_t* s = ac->storage;
+      ac->storage  = s->next;
+      _free(s);
+    }
+    _free(ac->slots.slots);
+    _free(ac);
+  }
+  _free(accounts->map.slots);
+  _free(accounts->journal);
+  _free(accounts);
+}
+
+// ---- accounts
+
 int evm_get_account(evm_t* evm, address_t adr, wlen_t create, account_t** dst) {
   if (!adr) {
     *dst = NULL;
     return 0;
   }
-  account_t* ac = evm->accounts;
+  evm_accounts_t* accounts = get_accounts(evm);
+  account_t*      ac       = map_get(&accounts->map, adr, 20);
 
   // check if we already have the account.
-  while (ac) {
-    if (memcmp(ac->address, adr, 20) == 0) {
-      *dst = ac;
-      return 0;
-    }
-    ac = ac->next;
-  }
-
-  // if this is a internal call take it from the parent
-  if (evm->parent) {
-    TRY(evm_get_account(evm->parent, adr, create, &ac))
-
-    if (ac) {
-      // clone and add account
-      account_t* a = _malloc(sizeof(account_t));
-      memcpy(a, ac, sizeof(account_t));
-      a->storage    = NULL;
-      a->next       = evm->accounts;
-      evm->accounts = a;
-      *dst          = a;
-      return 0;
-    }
+  if (ac) {
+    journal_account(evm, ac);
+    *dst = ac;
+    return 0;
   }
 
   // get balance, nonce and code
@@ -95,14 +243,11 @@ int evm_get_account(evm_t* evm, address_t adr, wlen_t create, account_t** dst) {
     if (ac->code.len)
       evm->env(evm, EVM_ENV_CODE_COPY, adr, 20, &ac->code.data, 0, 0);
 
-    // add to accounts
-    ac->storage   = NULL;
-    ac->next      = evm->accounts;
-    evm->accounts = ac;
-
     // set balance & nonce
     uint256_set(balance, l_balance, ac->balance);
     uint256_set(nonce, l_nonce, ac->nonce);
+
+    add_account(evm, ac);
   }
 
   *dst = ac;
@@ -130,6 +275,14 @@ int evm_create_account(evm_t* evm, uint8_t* data, uint32_t l_data, address_t cod
   return 0;
 }
 
+/** true if the address is the storage of the current or one of the parent calls */
+static bool is_called_address(evm_t* evm, address_t adr) {
+  for (; evm; evm = evm->parent) {
+    if (evm->address && memcmp(evm->address, adr, 20) == 0) return true;
+  }
+  return false;
+}
+
 int evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_key_len, wlen_t create, storage_t** dst) {
   account_t* ac = NULL;
   TRY(evm_get_account(evm, adr, create, &ac));
@@ -138,39 +291,21 @@ int evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_key_len,
     return 0;
   }
 
-  storage_t* s = ac->storage;
-
   // create full word key
   uint8_t key_data[32], *data;
   uint256_set(s_key, s_key_len, key_data);
 
   // find existing entry
-  while (s) {
-    if (memcmp(s->key, key_data, 32) == 0) {
-      *dst = s;
-      return 0;
-    }
-    s = s->next;
-  }
-
-  // not found?, but if we have parents, we try to copy the entry from there first
-  if (evm->parent) {
-    storage_t* parent_s = NULL;
-    TRY(evm_get_storage(evm->parent, adr, s_key, s_key_len, create, &parent_s));
-    if (parent_s) {
-      // clone and add account
-      s = _malloc(sizeof(storage_t));
-      memcpy(s, parent_s, sizeof(storage_t));
-      s->next     = ac->storage;
-      ac->storage = s;
-      *dst        = s;
-      return 0;
-    }
+  storage_t* s = map_get(&ac->slots, key_data, 32);
+  if (s) {
+    journal_storage(evm, ac, s);
+    *dst = s;
+    return 0;
   }
 
   // get storage value only if this is the same account
   // and if 'create' flag is set to false
-  int l = (!create && memcmp(evm->address, adr, 20))
+  int l = (!create && !is_called_address(evm, adr))
               ? 0
               : evm->env(evm, EVM_ENV_STORAGE, s_key, s_key_len, &data, 0, 0);
 
@@ -182,20 +317,24 @@ int evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_key_len,
     s = _malloc(sizeof(storage_t));
     memcpy(s->key, key_data, 32);
 
-    // add to account
-    s->next     = ac->storage;
-    ac->storage = s;
-
     // set the value
     uint256_set(data, l, s->value);
+    add_storage(evm, ac, s);
   }
   *dst = s;
   return 0;
 }
 
+void evm_clear_storage(evm_t* evm, account_t* ac) {
+  for (storage_t* s = ac->storage; s; s = s->next) {
+    journal_storage(evm, ac, s);
+    memset(s->value, 0, 32);
+  }
+}
+
 void copy_state(evm_t* dst, evm_t* src) {
 
-  // first move all logs
+  // move all logs, the accounts are shared and keep the changes of the subcall
   if (src->logs) {
     logs_t* last = src->logs;
     while (last->next) last = last->next;
@@ -204,81 +343,6 @@ void copy_state(evm_t* dst, evm_t* src) {
     dst->logs  = src->logs;
     src->logs  = NULL;
   }
-
-  account_t *sa = src->accounts, *prv = NULL;
-  while (sa) {
-    // find the account in the dst-state
-    account_t *a = dst->accounts, *da = NULL;
-    while (a) {
-      if (memcmp(a->address, sa->address, 20) == 0) {
-        da = a;
-        break;
-      }
-      a = a->next;
-    }
-    if (!da) {
-      // the account does not exist yet, so we simply move it
-
-      // remove from src
-      if (prv == NULL)
-        src->accounts = sa->next;
-      else
-        prv->next = sa->next;
-
-      // add to dst
-      sa->next      = dst->accounts;
-      dst->accounts = sa;
-
-      // next item...
-      sa = prv == NULL ? src->accounts : prv->next;
-      continue;
-    }
-    else {
-      // clone data
-      memcpy(da->balance, sa->balance, 32);
-      memcpy(da->nonce, sa->nonce, 32);
-      da->code = sa->code;
-
-      // clone storage
-      storage_t *ss = sa->storage, *ps = NULL, *ds, *s;
-      while (ss) {
-        // find the storage in the parent
-        ds = NULL;
-        s  = da->storage;
-        while (s) {
-          if (memcmp(s->key, ss->key, 32) == 0) {
-            ds = s;
-            break;
-          }
-          s = s->next;
-        }
-
-        if (ds)
-          memcpy(ds->value, ss->value, 32);
-        else {
-          // move the storage to the parent
-          // remove from src
-          if (ps == NULL)
-            sa->storage = ss->next;
-          else
-            ps->next = ss->next;
-
-          // add to dst
-          ss->next    = da->storage;
-          da->storage = ss;
-
-          // next item...
-          ss = ps == NULL ? sa->storage : ps->next;
-          continue;
-        }
-
-        ps = ss;
-        ss = ss->next;
-      }
-    }
-    prv = sa;
-    sa  = sa->next;
-  }
 }
 
 /**
@@ -42,7 +42,19 @@ int evm_get_account(evm_t* evm, address_t adr, wlen_t create, account_t** dst);
 int evm_get_storage(evm_t* evm, address_t adr, uint8_t* s_key, wlen_t s_key_len, wlen_t create, storage_t** dst);
 int evm_create_account(evm_t* evm, uint8_t* data, uint32_t l_data, address_t code_address, address_t caller, account_t** dst);
 
-/** copy state. */
+/** sets all storage values of the account to 0. */
+void evm_clear_storage(evm_t* evm, account_t* ac);
+
+/** starts a subcall, so all changes to the accounts from now on can be reverted. */
+void evm_checkpoint(evm_t* evm);
+
+/** reverts all changes to the accounts since evm_checkpoint was called for the subcall. */
+void evm_revert_state(evm_t* evm);
+
+/** frees the accounts, if the evm is not a subcall. */
+void evm_free_accounts(evm_t* evm);
+
+/** moves the logs of a successful subcall to the parent. */
 void copy_state(evm_t* dst, evm_t* src);
 
 int transfer_value(evm_t* current, address_t from_account, address_t to_account, uint8_t* value, wlen_t value_len, uint32_t base_gas, bool is_call);
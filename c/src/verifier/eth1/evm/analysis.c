@@ -0,0 +1,332 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+
+#include "analysis.h"
+#include "../../../core/util/mem.h"
+#include "../../../core/util/utils.h"
+#include "evm.h"
+#include "gas.h"
+#include <string.h>
+
+/** only those properties change the result of the analysis. */
+#define ANALYSIS_PROPS (EVM_PROP_FRONTIER | EVM_PROP_ISTANBUL)
+
+struct evm_code_cache {
+  evm_code_analysis_t* entries; /**< the entries, starting with the most recently used */
+  uint32_t             len;     /**< number of entries */
+  uint32_t             max;     /**< max number of entries we keep if they are not used anymore */
+#ifdef THREADSAFE
+  in3_mutex_t mutex;
+#endif
+};
+
+#ifdef THREADSAFE
+#define CACHE_LOCK(cache)   MUTEX_LOCK(cache->mutex)
+#define CACHE_UNLOCK(cache) MUTEX_UNLOCK(cache->mutex)
+#else
+#define CACHE_LOCK(cache)
+#define CACHE_UNLOCK(cache)
+#endif
+
+uint64_t evm_op_static_gas(uint8_t op, uint32_t properties) {
+  if (op >= 0x60 && op <= 0x9F) return G_VERY_LOW; // PUSH, DUP, SWAP
+  if (op >= 0xA0 && op <= 0xA4) return G_LOG;
+  switch (op) {
+    case 0x01: // ADD
+    case 0x03: // SUB
+    case 0x10: // LT
+    case 0x11: // GT
+    case 0x12: // SLT
+    case 0x13: // SGT
+    case 0x14: // EQ
+    case 0x15: // ISZERO
+    case 0x16: // AND
+    case 0x17: // OR
+    case 0x18: // XOR
+    case 0x19: // NOT
+    case 0x1a: // BYTE
+    case 0x1b: // SHL
+    case 0x1c: // SHR
+    case 0x1d: // SAR
+    case 0x35: // CALLDATALOAD
+    case 0x37: // CALLDATACOPY
+    case 0x39: // CODECOPY
+    case 0x3e: // RETURNDATACOPY
+    case 0x51: // MLOAD
+    case 0x52: // MSTORE
+    case 0x53: // MSTORE8
+      return G_VERY_LOW;
+    case 0x02: // MUL
+    case 0x04: // DIV
+    case 0x05: // SDIV
+    case 0x06: // MOD
+    case 0x07: // SMOD
+    case 0x0B: // SIGNEXTEND
+      return G_LOW;
+    case 0x08: // ADDMOD
+    case 0x09: // MULMOD
+    case 0x56: // JUMP
+      return G_MID;
+    case 0x0A: // EXP
+      return G_EXP;
+    case 0x20: // SHA3
+      return G_SHA3;
+    case 0x30: // ADDRESS
+    case 0x32: // ORIGIN
+    case 0x33: // CALLER
+    case 0x34: // CALLVALUE
+    case 0x36: // CALLDATA_SIZE
+    case 0x38: // CODESIZE
+    case 0x3a: // GASPRICE
+    case 0x3d: // RETURNDATASIZE
+    case 0x41: // COINBASE
+    case 0x42: // TIMESTAMP
+    case 0x43: // NUMBER
+    case 0x44: // DIFFICULTY
+    case 0x45: // GASLIMIT
+    case 0x46: // CHAINID
+    case 0x50: // POP
+    case 0x58: // PC
+    case 0x59: // MSIZE
+    case 0x5a: // GAS
+      return G_BASE;
+    case 0x31: // BALANCE
+    case 0x3f: // EXTCODEHASH
+      return G_BALANCE;
+    case 0x3b: // EXTCODESIZE
+    case 0x3c: // EXTCODECOPY
+      return G_EXTCODE;
+    case 0x40: // BLOCKHASH
+      return G_BLOCKHASH;
+    case 0x54: // SLOAD
+      return (properties & EVM_PROP_FRONTIER) ? FRONTIER_G_SLOAD : G_SLOAD;
+    case 0x57: // JUMPI
+      return G_HIGH;
+    case 0x5b: // JUMPDEST
+      return G_JUMPDEST;
+    case 0xF0: // CREATE
+    case 0xF5: // CREATE2
+      return G_CREATE;
+    case 0xF1: // CALL
+    case 0xF2: // CALLCODE
+    case 0xF4: // DELEGATE_CALL
+    case 0xFA: // STATIC_CALL
+      return G_CALL;
+    case 0xFF: // SELFDESTRUCT
+      return (properties & EVM_PROP_FRONTIER) ? 0 : G_SELFDESTRUCT;
+    default: // STOP, SSTORE, RETURN, REVERT and invalid opcodes
+      return 0;
+  }
+}
+
+/**
+ * returns true if the opcode is the last one in a block.
+ * This is the case if it changes the control-flow, stops the execution or depends on the remaining gas.
+ */
+static bool ends_block(uint8_t op, uint32_t properties) {
+  if (op >= 0x60 && op <= 0xA4) return false; // PUSH, DUP, SWAP, LOG
+  switch (op) {
+    case 0x00: // STOP
+    case 0x55: // SSTORE
+    case 0x56: // JUMP
+    case 0x57: // JUMPI
+    case 0x5a: // GAS
+    case 0xF0: // CREATE
+    case 0xF1: // CALL
+    case 0xF2: // CALLCODE
+    case 0xF3: // RETURN
+    case 0xF4: // DELEGATE_CALL
+    case 0xF5: // CREATE2
+    case 0xFA: // STATIC_CALL
+    case 0xFD: // REVERT
+    case 0xFE: // INVALID
+    case 0xFF: // SELFDESTRUCT
+      return true;
+    case 0x46: // CHAINID
+      return !(properties & EVM_PROP_ISTANBUL);
+    default:
+      return (op > 0x0B && op < 0x10) || (op > 0x1d && op < 0x20) || (op > 0x20 && op < 0x30) || (op > 0x46 && op < 0x50) || (op > 0x5b && op < 0x60) || op > 0xA4;
+  }
+}
+
+static evm_code_analysis_t* analyse(bytes_t code, uint32_t properties) {
+  evm_code_analysis_t* a = _calloc(1, sizeof(evm_code_analysis_t));
+  a->code                = bytes(_malloc(code.len + 1), code.len);
+  a->properties          = properties;
+  a->jumpdests           = _calloc((code.len >> 3) + 1, 1);
+  if (code.len) memcpy(a->code.data, code.data, code.len);
+
+  uint32_t     size   = 8;
+  evm_block_t* blocks = _malloc(size * sizeof(evm_block_t));
+  evm_block_t* block  = NULL;
+
+  for (uint32_t pos = 0; pos < code.len;) {
+    uint8_t op = code.data[pos];
+    if (op == 0x5B) {
+      a->jumpdests[pos >> 3] |= 1 << (pos & 7);
+      block = NULL; // a jumpdest always starts a new block
+    }
+    if (!block) {
+      if (a->blocks_len == size) {
+        blocks = _realloc(blocks, size * 2 * sizeof(evm_block_t), size * sizeof(evm_block_t));
+        size *= 2;
+      }
+      block        = blocks + a->blocks_len++;
+      block->start = pos;
+      block->gas   = 0;
+    }
+    block->gas += evm_op_static_gas(op, properties);
+    pos += (op >= 0x60 && op <= 0x7F) ? op - 0x5E : 1; // skip the push-data
+    block->end = pos > code.len ? code.len : pos;
+    if (ends_block(op, properties)) block = NULL;
+  }
+
+  a->blocks = a->blocks_len ? _realloc(blocks, a->blocks_len * sizeof(evm_block_t), size * sizeof(evm_block_t)) : NULL;
+  if (!a->blocks) _free(blocks);
+  return a;
+}
+
+static void analysis_free(evm_code_analysis_t* a) {
+  _free(a->code.data);
+  _free(a->jumpdests);
+  if (a->blocks) _free(a->blocks);
+  _free(a);
+}
+
+static evm_code_analysis_t* cache_find(evm_code_cache_t* cache, bytes_t code, uint32_t properties) {
+  for (evm_code_analysis_t *a = cache->entries, *prev = NULL; a; prev = a, a = a->next) {
+    if (a->properties != properties || !b_cmp(&a->code, &code)) continue;
+    // move it to the front
+    if (prev) {
+      prev->next     = a->next;
+      a->next        = cache->entries;
+      cache->entries = a;
+    }
+    a->refs++;
+    return a;
+  }
+  return NULL;
+}
+
+evm_code_cache_t* evm_code_cache_new(uint32_t max) {
+  evm_code_cache_t* cache = _calloc(1, sizeof(evm_code_cache_t));
+  cache->max              = max;
+#ifdef THREADSAFE
+  MUTEX_INIT(cache->mutex)
+#endif
+  return cache;
+}
+
+void evm_code_cache_free(evm_code_cache_t* cache) {
+  if (!cache) return;
+  while (cache->entries) {
+    evm_code_analysis_t* a = cache->entries;
+    cache->entries         = a->next;
+    analysis_free(a);
+  }
+#ifdef THREADSAFE
+  MUTEX_FREE(cache->mutex)
+#endif
+  _free(cache);
+}
+
+evm_code_analysis_t* evm_code_analyse(evm_code_cache_t* cache, bytes_t code, uint32_t properties) {
+  properties &= ANALYSIS_PROPS;
+  evm_code_analysis_t* a = NULL;
+  if (cache) {
+    CACHE_LOCK(cache)
+    a = cache_find(cache, code, properties);
+    CACHE_UNLOCK(cache)
+    if (a) return a;
+  }
+
+  // we analyse without holding the lock
+  a       = analyse(code, properties);
+  a->refs = 1;
+  if (!cache) return a;
+
+  CACHE_LOCK(cache)
+  evm_code_analysis_t* found = cache_find(cache, code, properties); // some other thread may have been faster
+  if (found)
+    analysis_free(a);
+  else {
+    a->cached      = true;
+    a->next        = cache->entries;
+    cache->entries = a;
+    cache->len++;
+
+    // remove the least recently used entries, which are not in use.
+    uint32_t n = 1; // the index of e->next
+    for (evm_code_analysis_t* e = a; e->next;) {
+      if (++n > cache->max && !e->next->refs) {
+        evm_code_analysis_t* last = e->next;
+        e->next                   = last->next;
+        analysis_free(last);
+        cache->len--;
+        n--;
+      }
+      else
+        e = e->next;
+    }
+  }
+  CACHE_UNLOCK(cache)
+  return found ? found : a;
+}
+
+void evm_code_release(evm_code_cache_t* cache, evm_code_analysis_t* analysis) {
+  if (!analysis) return;
+  if (cache && analysis->cached) {
+    CACHE_LOCK(cache)
+    analysis->refs--;
+    CACHE_UNLOCK(cache)
+  }
+  else if (--analysis->refs == 0)
+    analysis_free(analysis);
+}
+
+const evm_block_t* evm_code_block(const evm_code_analysis_t* analysis, uint32_t pos) {
+  uint32_t lo = 0, hi = analysis->blocks_len;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) >> 1;
+    if (analysis->blocks[mid].start < pos)
+      lo = mid + 1;
+    else if (analysis->blocks[mid].start > pos)
+      hi = mid;
+    else
+      return analysis->blocks + mid;
+  }
+  return NULL;
+}
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * analysis of evm-bytecode.
+ *
+ * Before running code the evm needs to know the valid jump destinations. Since contracts are usually executed
+ * many times with the same code, the result of the analysis is kept in a cache owned by the client,
+ * so calls within the same or later requests will reuse it.
+ * */
+
+#ifndef in3_evm_analysis_h__
+#define in3_evm_analysis_h__
+
+#include "../../../core/util/bytes.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EVM_CODE_CACHE_SIZE 32 /**< default number of analysed contracts kept in the cache */
+
+/** a basic block is a sequence of opcodes, which is only entered at the first and left after the last opcode. */
+typedef struct {
+  uint32_t start; /**< position of the first opcode */
+  uint32_t end;   /**< position after the last opcode */
+  uint64_t gas;   /**< the sum of the static gas of all opcodes within the block */
+} evm_block_t;
+
+/** the result of analysing code, which is shared between all evm-instances running the same code */
+typedef struct evm_code_analysis {
+  bytes_t                   code;       /**< copy of the code, used as key */
+  uint32_t                  properties; /**< the evm-properties the static gas was calculated for */
+  uint8_t*                  jumpdests;  /**< bitmask of all valid jump destinations */
+  evm_block_t*              blocks;     /**< the basic blocks ordered by position */
+  uint32_t                  blocks_len; /**< number of blocks */
+  uint32_t                  refs;       /**< number of evm-instances currently using it */
+  bool                      cached;     /**< true if the entry is owned by a cache */
+  struct evm_code_analysis* next;
+} evm_code_analysis_t;
+
+/** the cache of analysed code. */
+typedef struct evm_code_cache evm_code_cache_t;
+
+/**
+ * creates a new cache holding up to max analysed contracts.
+ */
+evm_code_cache_t* evm_code_cache_new(uint32_t max);
+
+/**
+ * frees the cache and all its entries.
+ */
+void evm_code_cache_free(evm_code_cache_t* cache);
+
+/**
+ * returns the analysis for the code, either from the cache or by analysing it.
+ *
+ * The result must be released with evm_code_release(). If the cache is NULL, the analysis is not cached.
+ */
+evm_code_analysis_t* evm_code_analyse(evm_code_cache_t* cache, bytes_t code, uint32_t properties);
+
+/**
+ * releases the analysis returned by evm_code_analyse().
+ */
+void evm_code_release(evm_code_cache_t* cache, evm_code_analysis_t* analysis);
+
+/**
+ * returns the block starting at the given position or NULL if no block starts there.
+ */
+const evm_block_t* evm_code_block(const evm_code_analysis_t* analysis, uint32_t pos);
+
+/**
+ * returns the static gas of the opcode, which is the amount paid before executing it.
+ */
+uint64_t evm_op_static_gas(uint8_t op, uint32_t properties);
+
+/**
+ * returns true if the position is a JUMPDEST, which is not part of push-data.
+ */
+static inline bool evm_is_jumpdest(const evm_code_analysis_t* analysis, uint32_t pos) {
+  return pos < analysis->code.len && (analysis->jumpdests[pos >> 3] & (1 << (pos & 7)));
+}
+
+#endif // in3_evm_analysis_h__
@@ -49,7 +49,7 @@ void evm_free(evm_t* evm) {
   if (evm->return_data.data) _free(evm->return_data.data);
   if (evm->stack.b.data) _free(evm->stack.b.data);
   if (evm->memory.b.data) _free(evm->memory.b.data);
-  if (evm->invalid_jumpdest) _free(evm->invalid_jumpdest);
+  if (evm->analysis) evm_code_release(evm->code_cache, evm->analysis);
 
 #ifdef EVM_GAS
   logs_t* l = NULL;
@@ -61,20 +61,7 @@ void evm_free(evm_t* evm) {
     _free(l);
   }
 
-  account_t* ac = NULL;
-  storage_t* s  = NULL;
-
-  while (evm->accounts) {
-    ac = evm->accounts;
-    s  = NULL;
-    while (ac->storage) {
-      s           = ac->storage;
-      ac->storage = s->next;
-      _free(s);
-    }
-    evm->accounts = ac->next;
-    _free(ac);
-  }
+  evm_free_accounts(evm);
 #endif
 }
 
@@ -98,8 +85,9 @@ int evm_prepare_evm(evm_t*      evm,
   evm->memory.bsize  = 32;
   memset(evm->memory.b.data, 0, 32);
 
-  evm->stack_size       = 0;
-  evm->invalid_jumpdest = NULL;
+  evm->stack_size = 0;
+  evm->analysis   = NULL;
+  evm->code_cache = NULL;
 
   evm->pos   = 0;
   evm->state = EVM_STATE_INIT;
@@ -131,12 +119,14 @@ int evm_prepare_evm(evm_t*      evm,
   evm->address = address;
 
 #ifdef EVM_GAS
-  evm->accounts = NULL;
-  evm->gas      = 0;
-  evm->logs     = NULL;
-  evm->parent   = NULL;
-  evm->refund   = 0;
-  evm->init_gas = 0;
+  evm->accounts    = NULL;
+  evm->gas         = 0;
+  evm->logs        = NULL;
+  evm->parent      = NULL;
+  evm->refund      = 0;
+  evm->init_gas    = 0;
+  evm->checkpoint  = 0;
+  evm->journal_pos = 0;
 #endif
 
   // if the address is NULL this is a CREATE-CALL, so don't try to fetch the code here.
@@ -182,9 +172,11 @@ int evm_sub_call(evm_t*    parent,
 
 #ifdef EVM_GAS
   evm.parent = parent;
+  evm_checkpoint(&evm);
 #endif
   evm.properties      = parent->properties;
   evm.chain_id        = parent->chain_id;
+  evm.code_cache      = parent->code_cache;
   evm.call_data.data  = data;
   evm.call_data.len   = l_data;
   evm.call_value.data = value;
@@ -296,12 +288,15 @@ int evm_call(void*     vc,
              address_t   caller,
              uint64_t    gas,
              uint64_t    chain_id,
-             bytes_t**   result,
-             json_ctx_t* receipt) {
+             bytes_t**         result,
+             json_ctx_t*       receipt,
+             evm_code_cache_t* code_cache) {
 
-  evm_t evm;
-  int   res    = evm_prepare_evm(&evm, address, address, caller, caller, in3_get_env, vc, 0);
-  evm.chain_id = chain_id;
+  evm_t      evm;
+  in3_env_t* env = in3_env_new(vc);
+  int        res = evm_prepare_evm(&evm, address, address, caller, caller, in3_get_env, env, 0);
+  evm.chain_id   = chain_id;
+  evm.code_cache = code_cache;
 
   // check if the caller is empty
   uint8_t* ccaller = caller;
@@ -337,6 +332,7 @@ int evm_call(void*     vc,
 #endif
 
   evm_free(&evm);
+  in3_env_free(env);
 
   return res;
 }
@@ -34,23 +34,144 @@
 
 #include "../../../core/client/keys.h"
 #include "../../../core/client/plugin.h"
-#include "big.h"
+#include "../../../core/util/mem.h"
 #include "code.h"
 #include "evm.h"
 
-static d_token_t* get_account(in3_vctx_t* vc, d_token_t* accounts, uint8_t* address) {
+/** an account of the proof */
+typedef struct {
+  uint8_t*       address; /**< points to the address within the proof */
+  d_token_t*     account; /**< the account-token of the proof */
+  cache_entry_t* code;    /**< the code, once it has been resolved */
+  uint32_t       slots;   /**< offset of the storage table of this account */
+  uint32_t       size;    /**< size of the storage table (a power of 2 or 0) */
+} env_account_t;
 
-  if (!accounts) {
-    vc_err(vc, "no accounts");
-    return NULL;
+/** a storage value of the proof */
+typedef struct {
+  bytes32_t  key;   /**< the left-padded storage key */
+  d_token_t* value; /**< the value or NULL if the entry is empty */
+} env_slot_t;
+
+/** the index of the proof, which is shared by all subcalls */
+struct in3_env {
+  in3_vctx_t*    vc;       /**< the verification context */
+  bytes_t*       header;   /**< the blockheader */
+  env_account_t* accounts; /**< hashtable of the accounts */
+  env_slot_t*    slots;    /**< the storage tables of all accounts */
+  uint32_t       size;     /**< size of the accounts table (a power of 2 or 0) */
+};
+
+static inline uint32_t env_hash(const uint8_t* key, int len) {
+  uint32_t h = 2166136261U;
+  for (int i = 0; i < len; i++) h = (h ^ key[i]) * 16777619U;
+  return h;
+}
+
+static inline uint32_t table_size(uint32_t len) {
+  uint32_t size = len ? 2 : 0;
+  while (size < len * 2) size <<= 1;
+  return size;
+}
+
+/** writes the storage key as 32 bytes, so keys with different leading zeros will match */
+static bool storage_key(const uint8_t* data, int len, uint8_t* dst) {
+  if (!data) return false;
+  for (; len > 32 && !*data; len--) data++;
+  if (len > 32) return false;
+  memset(dst, 0, 32 - len);
+  memcpy(dst + 32 - len, data, len);
+  return true;
+}
+
+static env_account_t* find_account(in3_env_t* env, const uint8_t* address) {
+  if (!env->size) return NULL;
+  for (uint32_t i = env_hash(address, 20) & (env->size - 1);; i = (i + 1) & (env->size - 1)) {
+    if (!env->accounts[i].account) return NULL;
+    if (memcmp(env->accounts[i].address, address, 20) == 0) return env->accounts + i;
   }
-  for (d_iterator_t it = d_iter(accounts); it.left; d_iter_next(&it)) {
-    if (memcmp(d_get_byteskl(it.token, K_ADDRESS, 20).data, address, 20) == 0)
-      return it.token;
+}
+
+static env_slot_t* find_slot(in3_env_t* env, env_account_t* ac, const uint8_t* key) {
+  if (!ac->size) return NULL;
+  env_slot_t* slots = env->slots + ac->slots;
+  for (uint32_t i = env_hash(key + 28, 4) & (ac->size - 1);; i = (i + 1) & (ac->size - 1)) {
+    if (!slots[i].value) return NULL;
+    if (memcmp(slots[i].key, key, 32) == 0) return slots + i;
   }
-  vc_err(vc, "The account could not be found!");
+}
+
+static void index_storage(in3_env_t* env, env_account_t* ac, d_token_t* storage) {
+  for (d_iterator_t it = d_iter(storage); it.left; d_iter_next(&it)) {
+    bytes32_t  slot;
+    bytes_t    k     = d_get_bytes(it.token, K_KEY);
+    d_token_t* value = d_get(it.token, K_VALUE);
+    if (!value || !d_bytes(value).data || !storage_key(k.data, k.len, slot) || find_slot(env, ac, slot)) continue;
+    uint32_t i = env_hash(slot + 28, 4) & (ac->size - 1);
+    while (env->slots[ac->slots + i].value) i = (i + 1) & (ac->size - 1);
+    memcpy(env->slots[ac->slots + i].key, slot, 32);
+    env->slots[ac->slots + i].value = value;
+  }
+}
+
+in3_env_t* in3_env_new(void* vc_ptr) {
+  in3_vctx_t* vc   = vc_ptr;
+  in3_env_t*  env  = _calloc(1, sizeof(in3_env_t));
+  d_token_t*  list = d_get(vc->proof, K_ACCOUNTS);
+  env->vc          = vc;
+  env->header      = d_as_bytes(d_get(vc->proof, K_BLOCK));
+  env->size        = table_size(d_len(list));
+  if (!env->size) return env;
+
+  // the storage tables of all accounts share one buffer, so we need to know the total size first.
+  uint32_t total = 0;
+  for (d_iterator_t it = d_iter(list); it.left; d_iter_next(&it))
+    total += table_size(d_len(d_get(it.token, K_STORAGE_PROOF)));
+  env->accounts = _calloc(env->size, sizeof(env_account_t));
+  env->slots    = total ? _calloc(total, sizeof(env_slot_t)) : NULL;
+
+  total = 0;
+  for (d_iterator_t it = d_iter(list); it.left; d_iter_next(&it)) {
+    bytes_t address = d_get_byteskl(it.token, K_ADDRESS, 20);
+    if (!address.data || find_account(env, address.data)) continue; // the first account wins, like it would when iterating
+    uint32_t i = env_hash(address.data, 20) & (env->size - 1);
+    while (env->accounts[i].account) i = (i + 1) & (env->size - 1);
+    env_account_t* ac = env->accounts + i;
+    d_token_t*     st = d_get(it.token, K_STORAGE_PROOF);
+    ac->address       = address.data;
+    ac->account       = it.token;
+    ac->slots         = total;
+    ac->size          = table_size(d_len(st));
+    total += ac->size;
+    index_storage(env, ac, st);
+  }
+  return env;
+}
+
+void in3_env_free(in3_env_t* env) {
+  if (!env) return;
+  _free(env->accounts);
+  _free(env->slots);
+  _free(env);
+}
+
+static env_account_t* get_account(in3_env_t* env, uint8_t* address) {
+  env_account_t* ac = find_account(env, address);
+  if (ac) return ac;
+  vc_err(env->vc, d_get(env->vc->proof, K_ACCOUNTS) ? "The account could not be found!" : "no accounts");
   return NULL;
 }
+
+static in3_ret_t get_code(in3_env_t* env, uint8_t* address, cache_entry_t** entry) {
+  env_account_t* ac = find_account(env, address);
+  if (ac && ac->code) {
+    *entry = ac->code;
+    return IN3_OK;
+  }
+  in3_ret_t ret = in3_get_code(env->vc, address, entry);
+  if (ac && ret == IN3_OK) ac->code = *entry;
+  return ret;
+}
 #ifdef LOGGING
 #define INVALID(msg)              \
   {                               \
@@ -66,54 +187,48 @@ static d_token_t* get_account(in3_vctx_t* vc, d_token_t* accounts, uint8_t* addr
 #endif
 
 int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, uint8_t** out_data, int offset, int len) {
-  bytes_t*  res = NULL;
-  in3_ret_t ret = IN3_OK;
-
-  d_token_t *t, *t2;
-  int        i;
+  in3_ret_t      ret = IN3_OK;
+  env_account_t* ac;
+  d_token_t*     t;
 
   evm_t* evm = evm_ptr;
   if (!evm) return EVM_ERROR_INVALID_ENV;
-  in3_vctx_t* vc = evm->env_ptr;
-  if (!vc) return EVM_ERROR_INVALID_ENV;
+  in3_env_t* env = evm->env_ptr;
+  if (!env) return EVM_ERROR_INVALID_ENV;
+  in3_vctx_t* vc = env->vc;
 
   switch (evm_key) {
     case EVM_ENV_BLOCKHEADER:
-      if (!(res = d_as_bytes(d_get(vc->proof, K_BLOCK))))
+      if (!env->header)
         INVALID("no blockheader found")
-      *out_data = res->data;
-      return res->len;
+      *out_data = env->header->data;
+      return env->header->len;
 
     case EVM_ENV_BALANCE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), in_data)) || !(t = d_get(t, K_BALANCE)))
+      if (!(ac = get_account(env, in_data)) || !(t = d_get(ac->account, K_BALANCE)))
         INVALID("account not found in proof")
       bytes_t b1 = d_bytes(t);
       *out_data  = b1.data;
       return b1.len;
 
     case EVM_ENV_NONCE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), in_data)) || !(t = d_get(t, K_NONCE)))
+      if (!(ac = get_account(env, in_data)) || !(t = d_get(ac->account, K_NONCE)))
         INVALID("account not found in proof")
       bytes_t b2 = d_bytes(t);
       *out_data  = b2.data;
       return b2.len;
 
-    case EVM_ENV_STORAGE:
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), evm->address)) || !(t = d_get(t, K_STORAGE_PROOF)))
+    case EVM_ENV_STORAGE: {
+      bytes32_t   k;
+      env_slot_t* slot;
+      if (!(ac = get_account(env, evm->address)) || !d_get(ac->account, K_STORAGE_PROOF))
         INVALID("account not found in proof")
-
-      for (i = 0, t2 = d_get_at(t, 0); i < d_len(t); i++, t2 = d_next(t2)) {
-        bytes_t k = d_bytes(d_get(t2, K_KEY));
-        if (!k.data) INVALID("no data on storage")
-
-        if (big_cmp(in_data, in_len, k.data, k.len) == 0) {
-          k = d_bytes(d_get(t2, K_VALUE));
-          if (!k.data) INVALID("no data on storage")
-          *out_data = k.data;
-          return k.len;
-        }
-      }
-      INVALID("storage not found in proof");
+      if (!storage_key(in_data, in_len, k) || !(slot = find_slot(env, ac, k)))
+        INVALID("storage not found in proof")
+      bytes_t b3 = d_bytes(slot->value);
+      *out_data  = b3.data;
+      return b3.len;
+    }
 
     case EVM_ENV_BLOCKHASH:
       return EVM_ERROR_UNSUPPORTED_CALL_OPCODE;
@@ -121,7 +236,7 @@ int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, u
     case EVM_ENV_CODE_SIZE: {
       if (in_len != 20) return EVM_ERROR_INVALID_ENV;
       cache_entry_t* entry = NULL;
-      ret                  = in3_get_code(vc, in_data, &entry);
+      ret                  = get_code(env, in_data, &entry);
       if (ret < 0) return ret;
       if (!entry) return EVM_ERROR_INVALID_ENV;
       *out_data = entry->buffer;
@@ -129,17 +244,15 @@ int in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, u
     }
     case EVM_ENV_CODE_HASH: {
       if (in_len != 20) return EVM_ERROR_INVALID_ENV;
-      if (!(t = get_account(vc, d_get(vc->proof, K_ACCOUNTS), evm->address)) || !(t = d_get(t, K_STORAGE_PROOF)))
+      if (!(ac = get_account(env, in_data)) || !(t = d_getl(ac->account, K_CODE_HASH, 32)))
         return EVM_ERROR_INVALID_ENV;
-      t = d_getl(t, K_CODE_HASH, 32);
-      if (!t) return EVM_ERROR_INVALID_ENV;
       *out_data = d_bytes(t).data;
       return 32;
     }
     case EVM_ENV_CODE_COPY: {
       if (in_len != 20) return EVM_ERROR_INVALID_ENV;
       cache_entry_t* entry = NULL;
-      ret                  = in3_get_code(vc, in_data, &entry);
+      ret                  = get_code(env, in_data, &entry);
       if (ret < 0) return ret;
       if (!entry) return EVM_ERROR_INVALID_ENV;
       *out_data = entry->value.data + offset;
@@ -47,6 +47,88 @@
 #include <stdio.h>
 #include <string.h>
 int exit_zero(void) { return 0; }
+#ifdef EVM_WORDS
+word256_t* evm_stack_push_word(evm_t* evm) {
+  if (evm->stack_size == EVM_STACK_LIMIT || bb_check_size(&evm->stack, sizeof(word256_t))) return NULL;
+  evm->stack_size++;
+  evm->stack.b.len += sizeof(word256_t);
+  return evm_stack_word(evm, 1);
+}
+
+int evm_stack_push(evm_t* evm, uint8_t* data, uint8_t len) {
+  if (len > 32) return EVM_ERROR_STACK_LIMIT;
+  // data may point into a popped slot, which is the one we are about to use
+  word256_t val;
+  word_from_bytes(&val, data, len);
+  word256_t* slot = evm_stack_push_word(evm);
+  if (!slot) return EVM_ERROR_STACK_LIMIT;
+  *slot = val;
+  return 0;
+}
+
+int evm_stack_push_int(evm_t* evm, uint32_t val) {
+  return evm_stack_push_long(evm, val);
+}
+
+int evm_stack_push_long(evm_t* evm, uint64_t val) {
+  word256_t* slot = evm_stack_push_word(evm);
+  if (!slot) return EVM_ERROR_STACK_LIMIT;
+  word_set_u64(slot, val);
+  return 0;
+}
+
+int evm_stack_pop(evm_t* evm, uint8_t* dst, uint8_t len) {
+  if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
+  word256_t* slot = evm_stack_word(evm, 1);
+  evm_stack_drop(evm, 1);
+  if (dst) {
+    uint8_t tmp[32];
+    word_to_bytes(slot, tmp);
+    memcpy(dst, tmp + 32 - len, len);
+  }
+  return word_len(slot);
+}
+
+int evm_stack_pop_ref(evm_t* evm, uint8_t** dst) {
+  if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
+  word256_t* slot = evm_stack_word(evm, 1);
+  uint8_t    tmp[32];
+  const int  l = word_len(slot);
+  evm_stack_drop(evm, 1);
+  // the slot is free now, so we can store the big endian representation there.
+  word_to_bytes(slot, tmp);
+  memcpy(slot, tmp, 32);
+  *dst = (uint8_t*) slot + 32 - l;
+  return l;
+}
+
+int evm_stack_get_ref(evm_t* evm, uint8_t pos, uint8_t** dst) {
+  if (evm->stack_size - pos < 0 || pos < 1) return EVM_ERROR_EMPTY_STACK; // stack empty
+  // we use the free space above the stack to store the big endian representation.
+  if (bb_check_size(&evm->stack, sizeof(word256_t))) return EVM_ERROR_EMPTY_STACK;
+  word256_t* slot = evm_stack_word(evm, pos);
+  const int  l    = word_len(slot);
+  word_to_bytes(slot, evm->stack.b.data + evm->stack.b.len);
+  *dst = evm->stack.b.data + evm->stack.b.len + 32 - l;
+  return l;
+}
+
+int evm_stack_pop_byte(evm_t* evm, uint8_t* dst) {
+  if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
+  word256_t* slot = evm_stack_word(evm, 1);
+  evm_stack_drop(evm, 1);
+  if (!word_is_u64(slot) || slot->n[0] > 0xFF) return -3;
+  *dst = (uint8_t) slot->n[0];
+  return 1;
+}
+
+int32_t evm_stack_pop_int(evm_t* evm) {
+  if (evm->stack_size == 0) return EVM_ERROR_EMPTY_STACK; // stack empty
+  word256_t* slot = evm_stack_word(evm, 1);
+  evm_stack_drop(evm, 1);
+  return (!word_is_u64(slot) || slot->n[0] >= 0x10000000) ? 0xFFFFFFF : (int32_t) slot->n[0];
+}
+#else
 int evm_stack_push(evm_t* evm, uint8_t* data, uint8_t len) {
   if (evm->stack_size == EVM_STACK_LIMIT || len > 32) return EVM_ERROR_STACK_LIMIT;
   // we need to make sure the data ref is not part of the stack and would be ionvalidated now
@@ -160,6 +242,8 @@ int32_t evm_stack_pop_int(evm_t* evm) {
   return (l > 4 || (l == 4 && *p & 0xF0)) ? 0xFFFFFFF : bytes_to_int(p, l);
 }
 
+#endif
+
 #define __code(n)                     \
   {                                   \
     in3_log_trace(COLOR_GREEN_S2, n); \
@@ -298,6 +382,103 @@ void evm_print_stack(evm_t* evm, uint64_t last_gas, uint32_t pos) {
   }
 }
 
+#ifdef EVM_GAS
+#define op_gas(evm) evm_stack_push_long(evm, evm->gas)
+#else
+// here we always return enough gas to keep going, since eth call should not use it anyway
+#define op_gas(evm) evm_stack_push_int(evm, 0xFFFFFFF)
+#endif
+
+static inline int op_stop(evm_t* evm) {
+  evm->state = EVM_STATE_STOPPED;
+  return 0;
+}
+
+static inline int op_chainid(evm_t* evm) {
+  return (evm->properties & EVM_PROP_ISTANBUL) ? evm_stack_push_long(evm, evm->chain_id) : EVM_ERROR_INVALID_OPCODE;
+}
+
+#define G_SLOAD_(evm)        ((evm->properties & EVM_PROP_FRONTIER) ? FRONTIER_G_SLOAD : G_SLOAD)
+#define G_SELFDESTRUCT_(evm) ((evm->properties & EVM_PROP_FRONTIER) ? 0 : G_SELFDESTRUCT)
+
+/**
+ * all opcodes except PUSH, DUP, SWAP and LOG as OP(opcode, static gas, execution).
+ * The static gas must match evm_op_static_gas().
+ */
+#define EVM_OPCODES(OP)                                                                                 \
+  OP(0x00, 0, op_stop(evm))                                                        /* STOP */           \
+  OP(0x01, G_VERY_LOW, op_math(evm, MATH_ADD, 0))                                  /* ADD */            \
+  OP(0x02, G_LOW, op_math(evm, MATH_MUL, 0))                                       /* MUL */            \
+  OP(0x03, G_VERY_LOW, op_math(evm, MATH_SUB, 0))                                  /* SUB */            \
+  OP(0x04, G_LOW, op_math(evm, MATH_DIV, 0))                                       /* DIV */            \
+  OP(0x05, G_LOW, op_math(evm, MATH_SDIV, 0))                                      /* SDIV */           \
+  OP(0x06, G_LOW, op_math(evm, MATH_MOD, 0))                                       /* MOD */            \
+  OP(0x07, G_LOW, op_math(evm, MATH_SMOD, 0))                                      /* SMOD */           \
+  OP(0x08, G_MID, op_math(evm, MATH_ADD, 1))                                       /* ADDMOD */         \
+  OP(0x09, G_MID, op_math(evm, MATH_MUL, 1))                                       /* MULMOD */         \
+  OP(0x0A, G_EXP, op_math(evm, MATH_EXP, 0))                                       /* EXP */            \
+  OP(0x0B, G_LOW, op_signextend(evm))                                              /* SIGNEXTEND */     \
+  OP(0x10, G_VERY_LOW, op_cmp(evm, -1, 0))                                         /* LT */             \
+  OP(0x11, G_VERY_LOW, op_cmp(evm, 1, 0))                                          /* GT */             \
+  OP(0x12, G_VERY_LOW, op_cmp(evm, -1, 1))                                         /* SLT */            \
+  OP(0x13, G_VERY_LOW, op_cmp(evm, 1, 1))                                          /* SGT */            \
+  OP(0x14, G_VERY_LOW, op_cmp(evm, 0, 0))                                          /* EQ */             \
+  OP(0x15, G_VERY_LOW, op_is_zero(evm))                                            /* ISZERO */         \
+  OP(0x16, G_VERY_LOW, op_bit(evm, OP_AND))                                        /* AND */            \
+  OP(0x17, G_VERY_LOW, op_bit(evm, OP_OR))                                         /* OR */             \
+  OP(0x18, G_VERY_LOW, op_bit(evm, OP_XOR))                                        /* XOR */            \
+  OP(0x19, G_VERY_LOW, op_not(evm))                                                /* NOT */            \
+  OP(0x1a, G_VERY_LOW, op_byte(evm))                                               /* BYTE */           \
+  OP(0x1b, G_VERY_LOW, op_shift(evm, 1))                                           /* SHL */            \
+  OP(0x1c, G_VERY_LOW, op_shift(evm, 0))                                           /* SHR */            \
+  OP(0x1d, G_VERY_LOW, op_shift(evm, 2))                                           /* SAR */            \
+  OP(0x20, G_SHA3, op_sha3(evm))                                                   /* SHA3 */           \
+  OP(0x30, G_BASE, evm_stack_push(evm, evm->address, 20))                          /* ADDRESS */        \
+  OP(0x31, G_BALANCE, op_account(evm, EVM_ENV_BALANCE))                            /* BALANCE */        \
+  OP(0x32, G_BASE, evm_stack_push(evm, evm->origin, 20))                           /* ORIGIN */         \
+  OP(0x33, G_BASE, evm_stack_push(evm, evm->caller, 20))                           /* CALLER */         \
+  OP(0x34, G_BASE, evm_stack_push(evm, evm->call_value.data, evm->call_value.len)) /* CALLVALUE */      \
+  OP(0x35, G_VERY_LOW, op_dataload(evm))                                           /* CALLDATALOAD */   \
+  OP(0x36, G_BASE, evm_stack_push_int(evm, evm->call_data.len))                    /* CALLDATA_SIZE */  \
+  OP(0x37, G_VERY_LOW, op_datacopy(evm, &evm->call_data, 0))                       /* CALLDATACOPY */   \
+  OP(0x38, G_BASE, evm_stack_push_int(evm, evm->code.len))                         /* CODESIZE */       \
+  OP(0x39, G_VERY_LOW, op_datacopy(evm, &evm->code, 0))                            /* CODECOPY */       \
+  OP(0x3a, G_BASE, evm_stack_push(evm, evm->gas_price.data, evm->gas_price.len))   /* GASPRICE */       \
+  OP(0x3b, G_EXTCODE, op_account(evm, EVM_ENV_CODE_SIZE))                          /* EXTCODESIZE */    \
+  OP(0x3c, G_EXTCODE, op_extcodecopy(evm))                                         /* EXTCODECOPY */    \
+  OP(0x3d, G_BASE, evm_stack_push_int(evm, evm->last_returned.len))                /* RETURNDATASIZE */ \
+  OP(0x3e, G_VERY_LOW, op_datacopy(evm, &evm->last_returned, 1))                   /* RETURNDATACOPY */ \
+  OP(0x3f, G_BALANCE, op_account(evm, EVM_ENV_CODE_HASH))                          /* EXTCODEHASH */    \
+  OP(0x40, G_BLOCKHASH, op_account(evm, EVM_ENV_BLOCKHASH))                        /* BLOCKHASH */      \
+  OP(0x41, G_BASE, op_header(evm, BLOCKHEADER_MINER))                              /* COINBASE */       \
+  OP(0x42, G_BASE, op_header(evm, BLOCKHEADER_TIMESTAMP))                          /* TIMESTAMP */      \
+  OP(0x43, G_BASE, op_header(evm, BLOCKHEADER_NUMBER))                             /* NUMBER */         \
+  OP(0x44, G_BASE, op_header(evm, BLOCKHEADER_DIFFICULTY))                         /* DIFFICULTY */     \
+  OP(0x45, G_BASE, op_header(evm, BLOCKHEADER_GAS_LIMIT))                          /* GASLIMIT */       \
+  OP(0x46, G_BASE, op_chainid(evm))                                                /* CHAINID */        \
+  OP(0x50, G_BASE, op_pop(evm))                                                    /* POP */            \
+  OP(0x51, G_VERY_LOW, op_mload(evm))                                              /* MLOAD */          \
+  OP(0x52, G_VERY_LOW, op_mstore(evm, 32))                                         /* MSTORE */         \
+  OP(0x53, G_VERY_LOW, op_mstore(evm, 1))                                          /* MSTORE8 */        \
+  OP(0x54, G_SLOAD_(evm), op_sload(evm))                                           /* SLOAD */          \
+  OP(0x55, 0, OP_SSTORE(evm))                                                      /* SSTORE */         \
+  OP(0x56, G_MID, op_jump(evm, 0))                                                 /* JUMP */           \
+  OP(0x57, G_HIGH, op_jump(evm, 1))                                                /* JUMPI */          \
+  OP(0x58, G_BASE, evm_stack_push_int(evm, evm->pos - 1))                          /* PC */             \
+  OP(0x59, G_BASE, evm_stack_push_int(evm, evm->memory.b.len))                     /* MSIZE */          \
+  OP(0x5a, G_BASE, op_gas(evm))                                                    /* GAS */            \
+  OP(0x5b, G_JUMPDEST, 0)                                                          /* JUMPDEST */       \
+  OP(0xF0, G_CREATE, OP_CREATE(evm, 0))                                            /* CREATE */         \
+  OP(0xF1, G_CALL, op_call(evm, CALL_CALL))                                        /* CALL */           \
+  OP(0xF2, G_CALL, op_call(evm, CALL_CODE))                                        /* CALLCODE */       \
+  OP(0xF3, 0, op_return(evm, 0))                                                   /* RETURN */         \
+  OP(0xF4, G_CALL, op_call(evm, CALL_DELEGATE))                                    /* DELEGATE_CALL */  \
+  OP(0xF5, G_CREATE, OP_CREATE(evm, 1))                                            /* CREATE2 */        \
+  OP(0xFA, G_CALL, op_call(evm, CALL_STATIC))                                      /* STATIC_CALL */    \
+  OP(0xFD, 0, op_return(evm, 1))                                                   /* REVERT */         \
+  OP(0xFE, 0, EVM_ERROR_INVALID_OPCODE)                                            /* INVALID OPCODE */ \
+  OP(0xFF, G_SELFDESTRUCT_(evm), OP_SELFDESTRUCT(evm))                             /* SELFDESTRUCT */
+
 int evm_execute(evm_t* evm) {
 
   uint8_t op = evm->code.data[evm->pos++];
@@ -311,162 +492,122 @@ int evm_execute(evm_t* evm) {
     op_exec(OP_LOG(evm, op - 0xA0), G_LOG);
 
   switch (op) {
-    case 0x00: // STOP
-      evm->state = EVM_STATE_STOPPED;
-      return 0;
-
-    case 0x01: //  ADD
-      op_exec(op_math(evm, MATH_ADD, 0), G_VERY_LOW);
-    case 0x02: //  MUL
-      op_exec(op_math(evm, MATH_MUL, 0), G_LOW);
-    case 0x03: //  SUB
-      op_exec(op_math(evm, MATH_SUB, 0), G_VERY_LOW);
-    case 0x04: //  DIV
-      op_exec(op_math(evm, MATH_DIV, 0), G_LOW);
-    case 0x05: //  SDIV
-      op_exec(op_math(evm, MATH_SDIV, 0), G_LOW);
-    case 0x06: //  MOD
-      op_exec(op_math(evm, MATH_MOD, 0), G_LOW);
-    case 0x07: //  SMOD
-      op_exec(op_math(evm, MATH_SMOD, 0), G_LOW);
-    case 0x08: //  ADDMOD
-      op_exec(op_math(evm, MATH_ADD, 1), G_MID);
-    case 0x09: //  MULMOD
-      op_exec(op_math(evm, MATH_MUL, 1), G_MID);
-    case 0x0A: //  EXP
-      op_exec(op_math(evm, MATH_EXP, 0), G_EXP);
-    case 0x0B: //  SIGNEXTEND
-      op_exec(op_signextend(evm), G_LOW);
-
-    case 0x10: // LT
-      op_exec(op_cmp(evm, -1, 0), G_VERY_LOW);
-    case 0x11: // GT
-      op_exec(op_cmp(evm, 1, 0), G_VERY_LOW);
-    case 0x12: // SLT
-      op_exec(op_cmp(evm, -1, 1), G_VERY_LOW);
-    case 0x13: // SGT
-      op_exec(op_cmp(evm, 1, 1), G_VERY_LOW);
-    case 0x14: // EQ
-      op_exec(op_cmp(evm, 0, 0), G_VERY_LOW);
-    case 0x15: // IS_ZERO
-      op_exec(op_is_zero(evm), G_VERY_LOW);
-    case 0x16: // AND
-      op_exec(op_bit(evm, OP_AND), G_VERY_LOW);
-    case 0x17: // OR
-      op_exec(op_bit(evm, OP_OR), G_VERY_LOW);
-    case 0x18: // XOR
-      op_exec(op_bit(evm, OP_XOR), G_VERY_LOW);
-    case 0x19: // NOT
-      op_exec(op_not(evm), G_VERY_LOW);
-    case 0x1a: // BYTE
-      op_exec(op_byte(evm), G_VERY_LOW);
-    case 0x1b: // SHL
-      op_exec(op_shift(evm, 1), G_VERY_LOW);
-    case 0x1c: // SHR
-      op_exec(op_shift(evm, 0), G_VERY_LOW);
-    case 0x1d: // SAR
-      op_exec(op_shift(evm, 2), G_VERY_LOW);
-    case 0x20: // SHA3
-      op_exec(op_sha3(evm), G_SHA3);
-    case 0x30: // ADDRESS
-      op_exec(evm_stack_push(evm, evm->address, 20), G_BASE);
-    case 0x31: // BALANCE
-      op_exec(op_account(evm, EVM_ENV_BALANCE), G_BALANCE);
-    case 0x32: // ORIGIN
-      op_exec(evm_stack_push(evm, evm->origin, 20), G_BASE);
-    case 0x33: // CALLER
-      op_exec(evm_stack_push(evm, evm->caller, 20), G_BASE);
-    case 0x34: // CALLVALUE
-      op_exec(evm_stack_push(evm, evm->call_value.data, evm->call_value.len), G_BASE);
-    case 0x35: // CALLDATALOAD
-      op_exec(op_dataload(evm), G_VERY_LOW);
-    case 0x36: // CALLDATA_SIZE
-      op_exec(evm_stack_push_int(evm, evm->call_data.len), G_BASE);
-    case 0x37: // CALLDATACOPY
-      op_exec(op_datacopy(evm, &evm->call_data, 0), G_VERY_LOW);
-    case 0x38: // CODESIZE
-      op_exec(evm_stack_push_int(evm, evm->code.len), G_BASE);
-    case 0x39: // CODECOPY
-      op_exec(op_datacopy(evm, &evm->code, 0), G_VERY_LOW);
-    case 0x3a: // GASPRICE
-      op_exec(evm_stack_push(evm, evm->gas_price.data, evm->gas_price.len), G_BASE);
-    case 0x3b: // EXTCODESIZE
-      op_exec(op_account(evm, EVM_ENV_CODE_SIZE), G_EXTCODE);
-    case 0x3c: // EXTCODECOPY
-      op_exec(op_extcodecopy(evm), G_EXTCODE);
-    case 0x3d: // RETURNDATASIZE
-      op_exec(evm_stack_push_int(evm, evm->last_returned.len), G_BASE);
-    case 0x3e: // RETURNDATACOPY
-      op_exec(op_datacopy(evm, &evm->last_returned, 1), G_VERY_LOW);
-    case 0x3f: // EXTCODEHASH
-      op_exec(op_account(evm, EVM_ENV_CODE_HASH), G_BALANCE);
-    case 0x40: // BLOCKHASH
-      op_exec(op_account(evm, EVM_ENV_BLOCKHASH), G_BLOCKHASH);
-    case 0x41: // COINBASE
-      op_exec(op_header(evm, BLOCKHEADER_MINER), G_BASE);
-    case 0x42: // TIMESTAMP
-      op_exec(op_header(evm, BLOCKHEADER_TIMESTAMP), G_BASE);
-    case 0x43: // NUMBER
-      op_exec(op_header(evm, BLOCKHEADER_NUMBER), G_BASE);
-    case 0x44: // DIFFICULTY
-      op_exec(op_header(evm, BLOCKHEADER_DIFFICULTY), G_BASE);
-    case 0x45: // GASLIMIT
-      op_exec(op_header(evm, BLOCKHEADER_GAS_LIMIT), G_BASE);
-    case 0x46: // CHAINID
-      op_exec((evm->properties & EVM_PROP_ISTANBUL) ? evm_stack_push_long(evm, evm->chain_id) : EVM_ERROR_INVALID_OPCODE, G_BASE);
-
-    case 0x50: // POP
-      op_exec(op_pop(evm), G_BASE);
-    case 0x51: // MLOAD
-      op_exec(op_mload(evm), G_VERY_LOW);
-    case 0x52: // MSTORE
-      op_exec(op_mstore(evm, 32), G_VERY_LOW);
-    case 0x53: // MSTORE8
-      op_exec(op_mstore(evm, 1), G_VERY_LOW);
-    case 0x54: // SLOAD
-      op_exec(op_sload(evm), evm->properties & EVM_PROP_FRONTIER ? FRONTIER_G_SLOAD : G_SLOAD);
-    case 0x55: // SSTORE
-      return OP_SSTORE(evm);
-    case 0x56: // JUMP
-      op_exec(op_jump(evm, 0), G_MID);
-    case 0x57: // JUMPI
-      op_exec(op_jump(evm, 1), G_HIGH);
-    case 0x58: // PC
-      op_exec(evm_stack_push_int(evm, evm->pos - 1), G_BASE);
-    case 0x59: // MSIZE
-      op_exec(evm_stack_push_int(evm, evm->memory.b.len), G_BASE);
-    case 0x5a: // GAS     --> here we always return enough gas to keep going, since eth call should not use it anyway
-#ifdef EVM_GAS
-      op_exec(evm_stack_push_long(evm, evm->gas), G_BASE);
+#define OP_CASE(code, gas, exec) \
+  case code: op_exec(exec, gas);
+    EVM_OPCODES(OP_CASE)
+#undef OP_CASE
+    default:
+      return EVM_ERROR_INVALID_OPCODE;
+  }
+}
+
+/**
+ * executes the code block by block.
+ *
+ * The static gas of a whole basic block is paid when entering it, so the opcodes itself only pay their dynamic costs.
+ * Since opcodes depending on the remaining gas always end a block, they see the same gas as if it was paid per opcode.
+ * With GCC or clang, the opcodes are dispatched by jumping directly to the label of the next opcode (threaded code),
+ * otherwise a switch is used.
+ */
+static int evm_run_blocks(evm_t* evm, uint32_t* timeout) {
+  const evm_code_analysis_t* analysis = evm->analysis;
+  const evm_block_t*         block    = NULL;
+  const uint8_t*             code     = evm->code.data;
+  uint32_t                   start = 0, end = 0;
+  uint8_t                    op  = 0;
+  int                        res = 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#ifdef __clang__
+#pragma GCC diagnostic ignored "-Winitializer-overrides"
 #else
-      return evm_stack_push_int(evm, 0xFFFFFFF);
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+#define OP_TARGET(code, gas, exec) [code] = &&op_##code,
+  static const void* const targets[256] = {
+      [0 ... 0xFF]    = &&op_invalid,
+      [0x60 ... 0x7F] = &&op_push,
+      [0x80 ... 0x8F] = &&op_dup,
+      [0x90 ... 0x9F] = &&op_swap,
+      [0xA0 ... 0xA4] = &&op_log,
+      EVM_OPCODES(OP_TARGET)};
+#undef OP_TARGET
+#pragma GCC diagnostic pop
+// after each opcode we continue with the next within the block or leave it.
+#define DISPATCH()                                                  \
+  {                                                                 \
+    if (res < 0 || evm->pos >= end || evm->pos <= start) goto next; \
+    op = code[evm->pos++];                                          \
+    goto* targets[op];                                              \
+  }
+#define OP_LABEL(code, gas, exec) \
+  op_##code : res = exec;         \
+  DISPATCH()
 #endif
-    case 0x5b: // JUMPDEST
-      op_exec(0, G_JUMPDEST);
-    case 0xF0: // CREATE
-      op_exec(OP_CREATE(evm, 0), G_CREATE);
-    case 0xF1: // CALL
-      op_exec(op_call(evm, CALL_CALL), G_CALL);
-    case 0xF2: // CALLCODE
-      op_exec(op_call(evm, CALL_CODE), G_CALL);
-    case 0xF3: // RETURN
-      return op_return(evm, 0);
-    case 0xF4: // DELEGATE_CALL
-      op_exec(op_call(evm, CALL_DELEGATE), G_CALL);
-    case 0xF5: // CREATE2
-      op_exec(OP_CREATE(evm, 1), G_CREATE);
-    case 0xFA: // STATIC_CALL
-      op_exec(op_call(evm, CALL_STATIC), G_CALL);
-    case 0xFD: // REVERT
-      return op_return(evm, 1);
-    case 0xFE: // INVALID OPCODE
-      return EVM_ERROR_INVALID_OPCODE;
-    case 0xFF: // SELFDESTRUCT
-      op_exec(OP_SELFDESTRUCT(evm), (evm->properties & EVM_PROP_FRONTIER) ? 0 : G_SELFDESTRUCT);
 
-    default:
-      return EVM_ERROR_INVALID_OPCODE;
+  while (res >= 0 && evm->state == EVM_STATE_RUNNING && evm->pos < evm->code.len) {
+    // find the block, which is usually the next one
+    if (block && block + 1 < analysis->blocks + analysis->blocks_len && block[1].start == evm->pos)
+      block++;
+    else if (!(block = evm_code_block(analysis, evm->pos))) {
+      // we are not at the start of a block, so we execute the opcode on its own.
+      res = evm_execute(evm);
+      continue;
+    }
+    if ((*timeout)-- == 0) return EVM_ERROR_TIMEOUT;
+    subgas(block->gas);
+    start = block->start;
+    end   = block->end;
+
+#if defined(__GNUC__) || defined(__clang__)
+    op = code[evm->pos++];
+    goto* targets[op];
+
+    EVM_OPCODES(OP_LABEL)
+  op_push:
+    res = op_push(evm, op - 0x5F);
+    DISPATCH()
+  op_dup:
+    res = op_dup(evm, op - 0x7F);
+    DISPATCH()
+  op_swap:
+    res = op_swap(evm, op - 0x8E);
+    DISPATCH()
+  op_log:
+    res = OP_LOG(evm, op - 0xA0);
+    DISPATCH()
+  op_invalid:
+    res = EVM_ERROR_INVALID_OPCODE;
+  next:
+    continue;
+#undef OP_LABEL
+#undef DISPATCH
+#else
+    do {
+      op = code[evm->pos++];
+      if (op >= 0x60 && op <= 0x7F) // PUSH
+        res = op_push(evm, op - 0x5F);
+      else if (op >= 0x80 && op <= 0x8F) // DUP
+        res = op_dup(evm, op - 0x7F);
+      else if (op >= 0x90 && op <= 0x9F) // SWAP
+        res = op_swap(evm, op - 0x8E);
+      else if (op >= 0xA0 && op <= 0xA4) // LOG
+        res = OP_LOG(evm, op - 0xA0);
+      else {
+        switch (op) {
+#define OP_CASE(code, gas, exec) \
+  case code: res = exec; break;
+          EVM_OPCODES(OP_CASE)
+#undef OP_CASE
+          default:
+            res = EVM_ERROR_INVALID_OPCODE;
+        }
+      }
+    } while (res >= 0 && evm->pos < end && evm->pos > start);
+#endif
   }
+  return res;
 }
 
 int evm_run(evm_t* evm, address_t code_address) {
@@ -486,6 +627,15 @@ int evm_run(evm_t* evm, address_t code_address) {
   // inital state
   evm->state = EVM_STATE_RUNNING;
 
+  // run block by block, unless we want to trace each opcode
+  int trace = 0;
+  EVM_DEBUG_BLOCK({ trace = 1; });
+  if (!trace && evm->code.len) {
+    if (!evm->analysis) evm->analysis = evm_code_analyse(evm->code_cache, evm->code, evm->properties);
+    res = evm_run_blocks(evm, &timeout);
+    if (res == EVM_ERROR_TIMEOUT) return res;
+  }
+
   // loop opcodes
   while (res >= 0 && evm->state == EVM_STATE_RUNNING && evm->pos < evm->code.len) {
     EVM_DEBUG_BLOCK({
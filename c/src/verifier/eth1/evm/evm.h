@@ -40,6 +40,10 @@
 #include "../../../core/util/data.h"
 #ifndef evm_h__
 #define evm_h__
+#include "analysis.h"
+#ifdef EVM_WORDS
+#include "word256.h"
+#endif
 int exit_zero(void);
 //#define EVM_GAS
 /** the current state of the evm*/
@@ -51,13 +55,15 @@ typedef enum evm_state {
 } evm_state_t;
 
 #ifdef EVM_GAS
-#define gas_options       \
-  struct {                \
-    account_t*  accounts; \
-    struct evm* parent;   \
-    logs_t*     logs;     \
-    uint64_t    refund;   \
-    uint64_t    init_gas; \
+#define gas_options                                                                                     \
+  struct {                                                                                              \
+    evm_accounts_t* accounts;    /**< the accounts, which are shared with all parents and subcalls */   \
+    struct evm*     parent;                                                                             \
+    logs_t*         logs;                                                                               \
+    uint64_t        refund;                                                                             \
+    uint64_t        init_gas;                                                                           \
+    uint32_t        checkpoint;  /**< the id of the subcall used to journal changes (0 for the root) */ \
+    uint32_t        journal_pos; /**< the length of the journal when the subcall started */             \
   }
 #else
 #define gas_options
@@ -214,9 +220,17 @@ typedef enum evm_state {
  */
 typedef int (*evm_get_env)(void* evm, uint16_t evm_key, uint8_t* in_data, int in_len, uint8_t** out_data, int offset, int len);
 
+/** hashtable of pointers to structs starting with the key. */
+typedef struct {
+  void**   slots; /**< the slots (size is a power of 2) */
+  uint32_t size;  /**< number of slots */
+  uint32_t len;   /**< number of used slots */
+} evm_map_t;
+
 typedef struct account_storage {
   bytes32_t               key;
   bytes32_t               value;
+  uint32_t                checkpoint; /**< the subcall which last saved the value in the journal */
   struct account_storage* next;
 } storage_t;
 typedef struct logs {
@@ -231,21 +245,49 @@ typedef struct account {
   bytes32_t       balance;
   bytes32_t       nonce;
   bytes_t         code;
-  storage_t*      storage;
+  storage_t*      storage;    /**< all storage entries, the latest first */
+  evm_map_t       slots;      /**< the storage entries by key */
+  uint32_t        checkpoint; /**< the subcall which last saved the account in the journal */
   struct account* next;
 } account_t;
 
+/** a change of a account or storage value, which may be reverted. */
+typedef struct {
+  enum {
+    JOURNAL_ACCOUNT_CREATED,
+    JOURNAL_ACCOUNT_CHANGED,
+    JOURNAL_STORAGE_CREATED,
+    JOURNAL_STORAGE_CHANGED
+  } type;
+  account_t* account;
+  storage_t* storage;
+  bytes32_t  balance; /**< the previous balance or storage value */
+  bytes32_t  nonce;
+  bytes_t    code;
+} evm_journal_t;
+
+/** the accounts touched during the execution of a call */
+typedef struct {
+  account_t*     list;         /**< all accounts, the latest first */
+  evm_map_t      map;          /**< the accounts by address */
+  evm_journal_t* journal;      /**< changes made in subcalls, which are reverted if the subcall fails */
+  uint32_t       journal_len;  /**< number of entries in the journal */
+  uint32_t       journal_size; /**< allocated entries of the journal */
+  uint32_t       checkpoints;  /**< the last id used for a subcall */
+} evm_accounts_t;
+
 typedef struct evm {
   // internal data
-  bytes_builder_t stack;
-  bytes_builder_t memory;
-  int             stack_size;
-  bytes_t         code;
-  uint32_t        pos;
-  evm_state_t     state;
-  bytes_t         last_returned;
-  bytes_t         return_data;
-  uint32_t*       invalid_jumpdest;
+  bytes_builder_t      stack;
+  bytes_builder_t      memory;
+  int                  stack_size;
+  bytes_t              code;
+  uint32_t             pos;
+  evm_state_t          state;
+  bytes_t              last_returned;
+  bytes_t              return_data;
+  evm_code_analysis_t* analysis;   /**< the analysis of the code, created with the first jump */
+  evm_code_cache_t*    code_cache; /**< the cache for analysed code (may be NULL) */
 
   // set properties as to which EIPs to use.
   uint32_t properties;
@@ -269,7 +311,9 @@ typedef struct evm {
 } evm_t;
 
 int evm_stack_push(evm_t* evm, uint8_t* data, uint8_t len);
+#ifndef EVM_WORDS
 int evm_stack_push_ref(evm_t* evm, uint8_t** dst, uint8_t len);
+#endif
 int evm_stack_push_int(evm_t* evm, uint32_t val);
 int evm_stack_push_long(evm_t* evm, uint64_t val);
 
@@ -279,6 +323,23 @@ int     evm_stack_pop_ref(evm_t* evm, uint8_t** dst);
 int     evm_stack_pop_byte(evm_t* evm, uint8_t* dst);
 int32_t evm_stack_pop_int(evm_t* evm);
 
+#ifdef EVM_WORDS
+/**
+ * with EVM_WORDS the stack holds fixed 256-bit words, so the opcodes can work directly on the stack slots.
+ * All refs returned by the byte-functions (evm_stack_pop_ref, evm_stack_get_ref) are only valid until the next push.
+ */
+word256_t* evm_stack_push_word(evm_t* evm); /**< adds a new slot on top of the stack and returns it or NULL if the stack limit is reached. */
+
+/** returns the slot at the position from the top (1 = top) without checking the stack size. */
+static inline word256_t* evm_stack_word(evm_t* evm, int pos) { return ((word256_t*) (void*) evm->stack.b.data) + evm->stack_size - pos; }
+
+/** removes the top elements from the stack */
+static inline void evm_stack_drop(evm_t* evm, int n) {
+  evm->stack_size -= n;
+  evm->stack.b.len -= n * sizeof(word256_t);
+}
+#endif
+
 int evm_run(evm_t* evm, address_t code_address);
 #define EVM_CALL_MODE_STATIC   1
 #define EVM_CALL_MODE_DELEGATE 2
@@ -298,6 +359,13 @@ int evm_sub_call(evm_t*   parent,
 
 int  evm_ensure_memory(evm_t* evm, uint32_t max_pos);
 int  in3_get_env(void* evm_ptr, uint16_t evm_key, uint8_t* in_data, int in_len, uint8_t** out_data, int offset, int len);
+
+/** the accounts and storage of the proof indexed by address and key, which is passed as env_ptr to in3_get_env */
+typedef struct in3_env in3_env_t;
+
+in3_env_t* in3_env_new(void* vc);
+void       in3_env_free(in3_env_t* env);
+
 int  evm_call(void*    vc,
               uint8_t  address[20],
               uint8_t* value, wlen_t l_value,
@@ -305,8 +373,9 @@ int  evm_call(void*    vc,
               uint8_t     caller[20],
               uint64_t    gas,
               uint64_t    chain_id,
-              bytes_t**   result,
-              json_ctx_t* receipt);
+              bytes_t**         result,
+              json_ctx_t*       receipt,
+              evm_code_cache_t* code_cache);
 void evm_print_stack(evm_t* evm, uint64_t last_gas, uint32_t pos);
 void evm_free(evm_t* evm);
 
@@ -48,12 +48,14 @@ void update_account_code(evm_t* evm, account_t* new_account) {
 }
 
 void evm_init(evm_t* evm) {
-  evm->accounts = NULL;
-  evm->gas      = 0;
-  evm->logs     = NULL;
-  evm->parent   = NULL;
-  evm->refund   = 0;
-  evm->init_gas = 0;
+  evm->accounts    = NULL;
+  evm->gas         = 0;
+  evm->logs        = NULL;
+  evm->parent      = NULL;
+  evm->refund      = 0;
+  evm->init_gas    = 0;
+  evm->checkpoint  = 0;
+  evm->journal_pos = 0;
 }
 
 void finalize_and_refund_gas(evm_t* evm) {
@@ -75,8 +77,11 @@ void finalize_and_refund_gas(evm_t* evm) {
 void finalize_subcall_gas(evm_t* evm, int success, evm_t* parent) {
   // if the subcall was successful
   if (success == 0 || success == EVM_ERROR_SUCCESS_CONSUME_GAS) {
-    // if we didn't have to revert, copy new state to parent
-    if (evm->state != EVM_STATE_REVERTED) copy_state(parent, evm);
+    // if we didn't have to revert, keep the new state for the parent
+    if (evm->state != EVM_STATE_REVERTED)
+      copy_state(parent, evm);
+    else
+      evm_revert_state(evm);
 
     // refund gas left to parent
     parent->gas += evm->gas;
@@ -84,9 +89,11 @@ void finalize_subcall_gas(evm_t* evm, int success, evm_t* parent) {
     // if parent was depending on refund, deduce gas that was on hold
     if (evm->properties & EVM_PROP_CALL_DEPEND_ON_REFUND) parent->gas -= evm->init_gas;
   }
-  // If balance was insuficient, we return only the deduced stipend
-  else if (success == EVM_ERROR_BALANCE_TOO_LOW)
-    parent->gas += G_CALLSTIPEND;
+  else {
+    evm_revert_state(evm);
+    // If balance was insuficient, we return only the deduced stipend
+    if (success == EVM_ERROR_BALANCE_TOO_LOW) parent->gas += G_CALLSTIPEND;
+  }
 }
 
 #endif
\ No newline at end of file
@@ -48,6 +48,132 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef EVM_WORDS
+int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
+  if (evm->stack_size < (mod ? 3 : 2)) return EVM_ERROR_EMPTY_STACK;
+  word256_t *a = evm_stack_word(evm, 1), *b = evm_stack_word(evm, 2);
+  switch (op) {
+    case MATH_ADD:
+      if (mod)
+        word_addmod(evm_stack_word(evm, 3), a, b, evm_stack_word(evm, 3));
+      else
+        word_add(b, a, b);
+      break;
+    case MATH_SUB:
+      word_sub(b, a, b);
+      break;
+    case MATH_MUL:
+      if (mod)
+        word_mulmod(evm_stack_word(evm, 3), a, b, evm_stack_word(evm, 3));
+      else
+        word_mul(b, a, b);
+      break;
+    case MATH_DIV:
+      word_divmod(a, b, b, NULL);
+      break;
+    case MATH_SDIV:
+      word_sdivmod(a, b, b, NULL);
+      break;
+    case MATH_MOD:
+      word_divmod(a, b, NULL, b);
+      break;
+    case MATH_SMOD:
+      word_sdivmod(a, b, NULL, b);
+      break;
+    case MATH_EXP:
+      subgas((evm->properties & EVM_PROP_FRONTIER ? FRONTIER_G_EXPBYTE : G_EXPBYTE) * word_bytes(b));
+      word_exp(b, a, b);
+      break;
+    default:
+      return EVM_ERROR_INVALID_OPCODE;
+  }
+  evm_stack_drop(evm, mod ? 2 : 1);
+  return 0;
+}
+
+int op_signextend(evm_t* evm) {
+  if (evm->stack_size < 2) return EVM_ERROR_EMPTY_STACK;
+  word256_t* k = evm_stack_word(evm, 1);
+  if (word_is_u64(k) && k->n[0] < 31) word_signextend(evm_stack_word(evm, 2), (uint32_t) k->n[0]);
+  evm_stack_drop(evm, 1);
+  return 0;
+}
+
+int op_is_zero(evm_t* evm) {
+  if (evm->stack_size < 1) return EVM_ERROR_EMPTY_STACK;
+  word256_t* a = evm_stack_word(evm, 1);
+  word_set_u64(a, word_is_zero(a));
+  return 0;
+}
+
+int op_not(evm_t* evm) {
+  if (evm->stack_size < 1) return EVM_ERROR_EMPTY_STACK;
+  word256_t* a = evm_stack_word(evm, 1);
+  for (int i = 0; i < 4; i++) a->n[i] = ~a->n[i];
+  return 0;
+}
+
+int op_bit(evm_t* evm, uint8_t op) {
+  if (evm->stack_size < 2) return EVM_ERROR_EMPTY_STACK;
+  word256_t *a = evm_stack_word(evm, 1), *b = evm_stack_word(evm, 2);
+  switch (op) {
+    case OP_AND:
+      for (int i = 0; i < 4; i++) b->n[i] &= a->n[i];
+      break;
+    case OP_OR:
+      for (int i = 0; i < 4; i++) b->n[i] |= a->n[i];
+      break;
+    case OP_XOR:
+      for (int i = 0; i < 4; i++) b->n[i] ^= a->n[i];
+      break;
+    default:
+      return -1;
+  }
+  evm_stack_drop(evm, 1);
+  return 0;
+}
+
+int op_byte(evm_t* evm) {
+  if (evm->stack_size < 2) return EVM_ERROR_EMPTY_STACK;
+  word256_t *pos = evm_stack_word(evm, 1), *b = evm_stack_word(evm, 2);
+  word_set_u64(b, word_is_u64(pos) && pos->n[0] < 32 ? word_byte(b, (uint32_t) pos->n[0]) : 0);
+  evm_stack_drop(evm, 1);
+  return 0;
+}
+
+int op_cmp(evm_t* evm, int8_t eq, uint8_t sig) {
+  if (evm->stack_size < 2) return EVM_ERROR_EMPTY_STACK;
+  word256_t *a = evm_stack_word(evm, 1), *b = evm_stack_word(evm, 2);
+  bool       res;
+  switch (eq) {
+    case -1:
+      res = sig ? word_slt(a, b) : word_lt(a, b);
+      break;
+    case 1:
+      res = sig ? word_slt(b, a) : word_lt(b, a);
+      break;
+    default:
+      res = word_eq(a, b);
+      break;
+  }
+  word_set_u64(b, res);
+  evm_stack_drop(evm, 1);
+  return 0;
+}
+
+int op_shift(evm_t* evm, uint8_t left) {
+  if ((evm->properties & EVM_PROP_CONSTANTINOPL) == 0) return EVM_ERROR_INVALID_OPCODE;
+  if (evm->stack_size < 2) return EVM_ERROR_EMPTY_STACK;
+  word256_t *     pos = evm_stack_word(evm, 1), *b = evm_stack_word(evm, 2);
+  const uint32_t shift = word_is_u64(pos) && pos->n[0] < 256 ? (uint32_t) pos->n[0] : 256;
+  if (left == 1)
+    word_shl(b, b, shift);
+  else
+    word_shr(b, b, shift, left == 2);
+  evm_stack_drop(evm, 1);
+  return 0;
+}
+#else
 int op_math(evm_t* evm, uint8_t op, uint8_t mod) {
   uint8_t *a, *b, res[65], *r = res;
   int      la = evm_stack_pop_ref(evm, &a), lb = evm_stack_pop_ref(evm, &b), l;
@@ -274,6 +400,7 @@ int op_shift(evm_t* evm, uint8_t left) {
   optimize_len(b, pos);
   return evm_stack_push(evm, b, pos);
 }
+#endif
 
 int op_sha3(evm_t* evm) {
   int offset = evm_stack_pop_int(evm);
@@ -393,8 +520,15 @@ int op_mload(evm_t* evm) {
 
   uint8_t tmp[32] = {0};
   memcpy(tmp + 32 - off_len, off, off_len);
+#ifdef EVM_WORDS
+  uint8_t data[32];
+  dst = data;
+  TRY(evm_mem_read(evm, bytes(tmp, 32), dst, 32))
+  return evm_stack_push(evm, dst, 32);
+#else
   if (evm_stack_push_ref(evm, &dst, 32)) return EVM_ERROR_ILLEGAL_MEMORY_ACCESS;
   return evm_mem_read(evm, bytes(tmp, 32), dst, 32);
+#endif
 }
 
 int op_mstore(evm_t* evm, uint8_t len) {
@@ -432,37 +566,9 @@ int op_jump(evm_t* evm, uint8_t cond) {
     if (ret == EVM_ERROR_EMPTY_STACK) return EVM_ERROR_EMPTY_STACK;
     if (!c && ret >= 0) return 0; // the condition was false
   }
-  if ((uint32_t) pos > evm->code.len || evm->code.data[pos] != 0x5B) return EVM_ERROR_INVALID_JUMPDEST;
-
-  // check if this is a invalid jumpdest
-  if (evm->invalid_jumpdest == NULL) {
-    uint32_t size = 8, p = 0, *list = _malloc(8 * sizeof(uint32_t)), i, cl = evm->code.len;
-    uint8_t  op, jumpl = 0;
-    for (i = 0; i < cl; i++) {
-      op = evm->code.data[i];
-      if (jumpl) {
-        if (op == 0x5B) {
-          // add it
-          if (p == size - 2) {
-            list = _realloc(list, (size + 8) * sizeof(uint32_t), size * sizeof(uint32_t));
-            size = size + 8;
-          }
-          list[p++] = i;
-        }
-        jumpl--;
-      }
-      else if (op >= 0x60 && op <= 0x7F) // PUSH
-        jumpl = op - 0x5F;
-    }
-    list[p]               = 0xFFFFFFFF;
-    evm->invalid_jumpdest = list;
-  }
-
-  // check if our dest contains the pos as invalid
-  for (int i = 0;; i++) {
-    if (evm->invalid_jumpdest[i] == 0xFFFFFFFF) break;
-    if (evm->invalid_jumpdest[i] == (uint32_t) pos) return EVM_ERROR_INVALID_JUMPDEST;
-  }
+  // the analysis knows all jumpdests, which are not part of push-data
+  if (!evm->analysis) evm->analysis = evm_code_analyse(evm->code_cache, evm->code, evm->properties);
+  if (!evm_is_jumpdest(evm->analysis, (uint32_t) pos)) return EVM_ERROR_INVALID_JUMPDEST;
 
   evm->pos = pos;
   return 0;
@@ -482,6 +588,23 @@ int op_push(evm_t* evm, wlen_t len) {
   return 0;
 }
 
+#ifdef EVM_WORDS
+int op_dup(evm_t* evm, uint8_t pos) {
+  if (evm->stack_size < pos) return EVM_ERROR_EMPTY_STACK;
+  word256_t* dst = evm_stack_push_word(evm);
+  if (!dst) return EVM_ERROR_STACK_LIMIT;
+  *dst = *evm_stack_word(evm, pos + 1);
+  return 0;
+}
+
+int op_swap(evm_t* evm, uint8_t pos) {
+  if (evm->stack_size < pos) return EVM_ERROR_EMPTY_STACK;
+  word256_t *a = evm_stack_word(evm, 1), *b = evm_stack_word(evm, pos), tmp = *a;
+  *a           = *b;
+  *b           = tmp;
+  return 0;
+}
+#else
 int op_dup(evm_t* evm, uint8_t pos) {
   uint8_t* data = NULL;
   int      l    = evm_stack_get_ref(evm, pos, &data);
@@ -514,6 +637,7 @@ int op_swap(evm_t* evm, uint8_t pos) {
   }
   return 0;
 }
+#endif
 
 int op_return(evm_t* evm, uint8_t revert) {
   int offset, len;
@@ -666,12 +790,7 @@ int op_selfdestruct(evm_t* evm) {
   memset(self_account->balance, 0, 32);
   memset(self_account->nonce, 0, 32);
   self_account->code.len = 0;
-  storage_t* s           = NULL;
-  while (self_account->storage) {
-    s                     = self_account->storage;
-    self_account->storage = s->next;
-    _free(s);
-  }
+  evm_clear_storage(evm, self_account);
   evm->state = EVM_STATE_STOPPED;
   return 0;
 }
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifdef EVM_WORDS
+#include "word256.h"
+
+/** number of limbs without leading zeros */
+static int limbs_len(const uint64_t* u, int len) {
+  while (len > 0 && !u[len - 1]) len--;
+  return len;
+}
+
+/**
+ * divides u (m limbs) by v (n limbs, v[n-1]!=0 and m>=n) using Knuth's algorithm D with 64-bit digits.
+ * q needs m-n+1 limbs and r n limbs, but both may be NULL.
+ */
+static void divmod_limbs(const uint64_t* u, int m, const uint64_t* v, int n, uint64_t* q, uint64_t* r) {
+  if (n == 1) {
+    uint64_t rem = 0;
+    for (int j = m - 1; j >= 0; j--) {
+      const uint128_t num = ((uint128_t) rem << 64) | u[j];
+      const uint64_t  d   = (uint64_t) (num / v[0]);
+      rem                 = (uint64_t) (num - (uint128_t) d * v[0]);
+      if (q) q[j] = d;
+    }
+    if (r) r[0] = rem;
+    return;
+  }
+
+  // normalize, so the highest bit of the divisor is set
+  uint64_t  un[9], vn[4];
+  const int s = __builtin_clzll(v[n - 1]);
+  for (int i = n - 1; i > 0; i--) vn[i] = (v[i] << s) | (s ? v[i - 1] >> (64 - s) : 0);
+  vn[0] = v[0] << s;
+  un[m] = s ? u[m - 1] >> (64 - s) : 0;
+  for (int i = m - 1; i > 0; i--) un[i] = (u[i] << s) | (s ? u[i - 1] >> (64 - s) : 0);
+  un[0] = u[0] << s;
+
+  for (int j = m - n; j >= 0; j--) {
+    // estimate the quotient digit, which may be too large by at most 2
+    const uint128_t num  = ((uint128_t) un[j + n] << 64) | un[j + n - 1];
+    uint128_t       qhat = num / vn[n - 1], rhat = num - qhat * vn[n - 1];
+    while ((qhat >> 64) || qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >> 64) break;
+    }
+
+    // multiply and subtract
+    uint128_t borrow = 0;
+    for (int i = 0; i < n; i++) {
+      const uint128_t p   = qhat * vn[i];
+      const uint128_t sub = (uint128_t) (uint64_t) p + borrow;
+      const uint64_t  x   = un[i + j];
+      un[i + j]           = x - (uint64_t) sub;
+      borrow              = (p >> 64) + (sub >> 64) + (x < (uint64_t) sub);
+    }
+    const bool negative = borrow > un[j + n];
+    un[j + n] -= (uint64_t) borrow;
+
+    // if we subtracted too much, we add it back
+    if (negative) {
+      qhat--;
+      uint128_t carry = 0;
+      for (int i = 0; i < n; i++) {
+        carry += (uint128_t) un[i + j] + vn[i];
+        un[i + j] = (uint64_t) carry;
+        carry >>= 64;
+      }
+      un[j + n] += (uint64_t) carry;
+    }
+    if (q) q[j] = (uint64_t) qhat;
+  }
+
+  // unnormalize the remainder
+  if (r) {
+    for (int i = 0; i < n; i++) r[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+  }
+}
+
+/** r = u % m for a number with up to 8 limbs */
+static void mod_limbs(word256_t* r, const uint64_t* u, int len, const word256_t* m) {
+  const int n = limbs_len(m->n, 4), l = limbs_len(u, len);
+  uint64_t  rem[4] = {0};
+  if (!n) {
+    word_set_u64(r, 0);
+    return;
+  }
+  if (l < n)
+    memcpy(rem, u, l * sizeof(uint64_t));
+  else
+    divmod_limbs(u, l, m->n, n, NULL, rem);
+  memcpy(r->n, rem, sizeof(rem));
+}
+
+void word_divmod(const word256_t* a, const word256_t* b, word256_t* q, word256_t* r) {
+  const int n = limbs_len(b->n, 4), m = limbs_len(a->n, 4);
+  uint64_t  quot[4] = {0}, rem[4] = {0};
+  if (n && m >= n)
+    divmod_limbs(a->n, m, b->n, n, quot, rem);
+  else if (n)
+    memcpy(rem, a->n, sizeof(rem)); // a < b
+  if (q) memcpy(q->n, quot, sizeof(quot));
+  if (r) memcpy(r->n, rem, sizeof(rem));
+}
+
+void word_sdivmod(const word256_t* a, const word256_t* b, word256_t* q, word256_t* r) {
+  const bool neg_a = word_is_negative(a), neg_b = word_is_negative(b);
+  word256_t  ua = *a, ub = *b, quot, rem;
+  if (neg_a) word_neg(&ua, &ua);
+  if (neg_b) word_neg(&ub, &ub);
+  word_divmod(&ua, &ub, &quot, &rem);
+  if (neg_a != neg_b) word_neg(&quot, &quot);
+  if (neg_a) word_neg(&rem, &rem);
+  if (q) *q = quot;
+  if (r) *r = rem;
+}
+
+void word_addmod(word256_t* r, const word256_t* a, const word256_t* b, const word256_t* m) {
+  uint64_t  sum[5];
+  uint128_t carry = 0;
+  for (int i = 0; i < 4; i++) {
+    carry += (uint128_t) a->n[i] + b->n[i];
+    sum[i] = (uint64_t) carry;
+    carry >>= 64;
+  }
+  sum[4] = (uint64_t) carry;
+  mod_limbs(r, sum, 5, m);
+}
+
+void word_mulmod(word256_t* r, const word256_t* a, const word256_t* b, const word256_t* m) {
+  uint64_t prod[8] = {0};
+  for (int i = 0; i < 4; i++) {
+    uint128_t carry = 0;
+    for (int j = 0; j < 4; j++) {
+      carry += (uint128_t) a->n[i] * b->n[j] + prod[i + j];
+      prod[i + j] = (uint64_t) carry;
+      carry >>= 64;
+    }
+    prod[i + 4] = (uint64_t) carry;
+  }
+  mod_limbs(r, prod, 8, m);
+}
+
+void word_exp(word256_t* r, const word256_t* base, const word256_t* exp) {
+  word256_t res = {{1, 0, 0, 0}}, b = *base;
+  for (int bits = word_bytes(exp) * 8, i = 0; i < bits; i++) {
+    if ((exp->n[i >> 6] >> (i & 63)) & 1) word_mul(&res, &res, &b);
+    if (i + 1 < bits) word_mul(&b, &b, &b);
+  }
+  *r = res;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** @file
+ * fixed-width 256-bit words used by the evm-stack, if build with EVM_WORDS.
+ *
+ * A word is stored as 4 64-bit limbs starting with the least significant one,
+ * so all operations can use native 64-bit (and 128-bit) arithmetic instead of working byte by byte.
+ * */
+
+#ifndef in3_word256_h__
+#define in3_word256_h__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef __SIZEOF_INT128__
+#error "EVM_WORDS requires a compiler supporting __int128"
+#endif
+
+typedef unsigned __int128 uint128_t;
+
+/** a 256-bit word as little endian 64-bit limbs */
+typedef struct {
+  uint64_t n[4];
+} word256_t;
+
+/** sets the word to a 64 bit value */
+static inline void word_set_u64(word256_t* w, uint64_t val) {
+  w->n[0] = val;
+  w->n[1] = w->n[2] = w->n[3] = 0;
+}
+
+/** reads a big endian number with up to 32 bytes */
+static inline void word_from_bytes(word256_t* w, const uint8_t* data, int len) {
+  uint8_t  tmp[32] = {0};
+  uint64_t limb;
+  memcpy(tmp + 32 - len, data, len);
+  for (int i = 0; i < 4; i++) {
+    memcpy(&limb, tmp + 24 - 8 * i, 8);
+    w->n[i] = __builtin_bswap64(limb);
+  }
+}
+
+/** writes the word as 32 bytes big endian */
+static inline void word_to_bytes(const word256_t* w, uint8_t* dst) {
+  for (int i = 0; i < 4; i++) {
+    const uint64_t limb = __builtin_bswap64(w->n[i]);
+    memcpy(dst + 24 - 8 * i, &limb, 8);
+  }
+}
+
+/** returns the number of significant bytes, which is 0 for zero. */
+static inline int word_bytes(const word256_t* w) {
+  for (int i = 3; i >= 0; i--) {
+    if (w->n[i]) return i * 8 + 8 - (__builtin_clzll(w->n[i]) >> 3);
+  }
+  return 0;
+}
+
+/** returns the number of bytes the optimized big endian representation has, which is at least 1 (same as optimize_len). */
+static inline int word_len(const word256_t* w) {
+  const int l = word_bytes(w);
+  return l ? l : 1;
+}
+
+static inline bool word_is_zero(const word256_t* w) {
+  return !(w->n[0] | w->n[1] | w->n[2] | w->n[3]);
+}
+
+/** true if the value fits into 64 bits. */
+static inline bool word_is_u64(const word256_t* w) {
+  return !(w->n[1] | w->n[2] | w->n[3]);
+}
+
+static inline bool word_is_negative(const word256_t* w) {
+  return w->n[3] >> 63;
+}
+
+static inline bool word_eq(const word256_t* a, const word256_t* b) {
+  return !((a->n[0] ^ b->n[0]) | (a->n[1] ^ b->n[1]) | (a->n[2] ^ b->n[2]) | (a->n[3] ^ b->n[3]));
+}
+
+/** a < b (unsigned), computed as the borrow of a - b. */
+static inline bool word_lt(const word256_t* a, const word256_t* b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) borrow = (uint64_t) (((uint128_t) a->n[i] - b->n[i] - borrow) >> 64) & 1;
+  return borrow;
+}
+
+/** a < b (signed) */
+static inline bool word_slt(const word256_t* a, const word256_t* b) {
+  const uint64_t sa = a->n[3] >> 63, diff = sa ^ (b->n[3] >> 63);
+  return (diff & sa) | (~diff & word_lt(a, b));
+}
+
+/** r = a + b. r may be the same as a or b. */
+static inline void word_add(word256_t* r, const word256_t* a, const word256_t* b) {
+  uint128_t carry = 0;
+  for (int i = 0; i < 4; i++) {
+    carry += (uint128_t) a->n[i] + b->n[i];
+    r->n[i] = (uint64_t) carry;
+    carry >>= 64;
+  }
+}
+
+/** r = a - b. r may be the same as a or b. */
+static inline void word_sub(word256_t* r, const word256_t* a, const word256_t* b) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) {
+    const uint128_t d = (uint128_t) a->n[i] - b->n[i] - borrow;
+    r->n[i]           = (uint64_t) d;
+    borrow            = (uint64_t) (d >> 64) & 1;
+  }
+}
+
+/** r = -a */
+static inline void word_neg(word256_t* r, const word256_t* a) {
+  const word256_t zero = {{0}};
+  word_sub(r, &zero, a);
+}
+
+/** r = a * b (mod 2^256). r may be the same as a or b. */
+static inline void word_mul(word256_t* r, const word256_t* a, const word256_t* b) {
+  uint64_t res[4] = {0};
+  for (int i = 0; i < 4; i++) {
+    uint128_t carry = 0;
+    for (int j = 0; j < 4 - i; j++) {
+      carry += (uint128_t) a->n[i] * b->n[j] + res[i + j];
+      res[i + j] = (uint64_t) carry;
+      carry >>= 64;
+    }
+  }
+  memcpy(r->n, res, sizeof(res));
+}
+
+/** r = a << shift. r may be the same as a. */
+static inline void word_shl(word256_t* r, const word256_t* a, uint32_t shift) {
+  uint64_t       res[4] = {0};
+  const uint32_t limbs = shift >> 6, bits = shift & 63;
+  for (uint32_t i = limbs; i < 4; i++) {
+    res[i] = a->n[i - limbs] << bits;
+    if (bits && i > limbs) res[i] |= a->n[i - limbs - 1] >> (64 - bits);
+  }
+  memcpy(r->n, res, sizeof(res));
+}
+
+/** r = a >> shift. if arithmetic is set, the sign is kept. r may be the same as a. */
+static inline void word_shr(word256_t* r, const word256_t* a, uint32_t shift, bool arithmetic) {
+  const uint64_t fill   = arithmetic && word_is_negative(a) ? UINT64_MAX : 0;
+  uint64_t       res[4] = {fill, fill, fill, fill};
+  const uint32_t limbs = shift >> 6, bits = shift & 63;
+  for (uint32_t i = 0; i + limbs < 4; i++) {
+    res[i] = a->n[i + limbs] >> bits;
+    if (bits) res[i] |= (i + limbs < 3 ? a->n[i + limbs + 1] : fill) << (64 - bits);
+  }
+  memcpy(r->n, res, sizeof(res));
+}
+
+/** returns the byte at the given index, counting from the most significant one. */
+static inline uint8_t word_byte(const word256_t* w, uint32_t index) {
+  return index < 32 ? (w->n[3 - (index >> 3)] >> (56 - ((index & 7) << 3))) & 0xFF : 0;
+}
+
+/** extends the sign of the number with the given number of bytes (-1). */
+static inline void word_signextend(word256_t* w, uint32_t k) {
+  if (k >= 31) return;
+  const uint32_t bit  = k * 8 + 7, limb = bit >> 6, offset = bit & 63;
+  const uint64_t fill = ((w->n[limb] >> offset) & 1) ? UINT64_MAX : 0;
+  const uint64_t mask = offset == 63 ? 0 : UINT64_MAX << (offset + 1);
+  w->n[limb]          = (w->n[limb] & ~mask) | (fill & mask);
+  for (uint32_t i = limb + 1; i < 4; i++) w->n[i] = fill;
+}
+
+void word_divmod(const word256_t* a, const word256_t* b, word256_t* q, word256_t* r);               /**< q = a / b and r = a % b (unsigned), which are 0 for b==0. q or r may be NULL. */
+void word_sdivmod(const word256_t* a, const word256_t* b, word256_t* q, word256_t* r);              /**< signed division, where the remainder has the sign of a. q or r may be NULL. */
+void word_addmod(word256_t* r, const word256_t* a, const word256_t* b, const word256_t* m);          /**< r = (a + b) % m without overflow */
+void word_mulmod(word256_t* r, const word256_t* a, const word256_t* b, const word256_t* m);          /**< r = (a * b) % m without overflow */
+void word_exp(word256_t* r, const word256_t* base, const word256_t* exp);                           /**< r = base ^ exp (mod 2^256) */
+
+#endif
@@ -46,8 +46,10 @@
 #include <string.h>
 
 in3_ret_t in3_verify_eth_full(void* pdata, in3_plugin_act_t action, void* pctx) {
-  UNUSED_VAR(pdata);
-  UNUSED_VAR(action);
+  if (action == PLGN_ACT_TERM) {
+    evm_code_cache_free(pdata);
+    return IN3_OK;
+  }
   in3_vctx_t* vc = pctx;
   if (vc->chain->type != CHAIN_ETH) return IN3_EIGNORE;
   if (in3_req_get_proof(vc->req, vc->index) == PROOF_NONE) return IN3_OK;
@@ -83,7 +85,7 @@ in3_ret_t in3_verify_eth_full(void* pdata, in3_plugin_act_t action, void* pctx)
       }
     }
 
-    int ret = evm_call(vc, address.data ? address.data : zeros, value.data ? value.data : zeros, value.data ? value.len : 1, data.data ? data.data : zeros, data.data ? data.len : 0, from.data ? from.data : zeros, gas_limit, vc->chain->id, &result, receipt);
+    int ret = evm_call(vc, address.data ? address.data : zeros, value.data ? value.data : zeros, value.data ? value.len : 1, data.data ? data.data : zeros, data.data ? data.len : 0, from.data ? from.data : zeros, gas_limit, vc->chain->id, &result, receipt, pdata);
 #if defined(DEBUG) && defined(LOGGING)
     in3_log_set_level(old);
     in3_log_enable_prefix();
@@ -136,5 +138,7 @@ in3_ret_t in3_verify_eth_full(void* pdata, in3_plugin_act_t action, void* pctx)
 
 in3_ret_t in3_register_eth_full(in3_t* c) {
   in3_register_eth_basic(c);
-  return in3_plugin_register(c, PLGN_ACT_RPC_VERIFY, in3_verify_eth_full, NULL, false);
+  if (in3_plugin_get_data(c, in3_verify_eth_full)) return IN3_OK; // already registered
+  // the analysed code is kept in a cache, so calls to the same contracts don't need to analyse it again.
+  return in3_plugin_register(c, PLGN_ACT_RPC_VERIFY | PLGN_ACT_TERM, in3_verify_eth_full, evm_code_cache_new(EVM_CODE_CACHE_SIZE), false);
 }
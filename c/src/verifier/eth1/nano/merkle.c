@@ -163,10 +163,67 @@ static int check_node(bytes_t* raw_node, uint8_t** key, bytes_t* expectedValue,
   return 1;
 }
 
+#define PROOF_CACHE_MIN_SIZE 32
+
+static inline uint32_t node_key(const uint8_t* data, uint32_t len) {
+  // the nodes end with hashes or values, so the last bytes are the most random ones.
+  uint32_t h = 2166136261U ^ len, n = len < 16 ? len : 16;
+  for (const uint8_t* p = data + len - n; n; n--, p++) h = (h ^ *p) * 16777619U;
+  return h;
+}
+
+static void cache_put(trie_proof_cache_t* cache, trie_proof_node_t* node) {
+  uint32_t i = node_key(node->data, node->len) & (cache->size - 1);
+  while (cache->nodes[i].data) i = (i + 1) & (cache->size - 1);
+  cache->nodes[i] = *node;
+  cache->len++;
+}
+
+static void cache_grow(trie_proof_cache_t* cache) {
+  trie_proof_cache_t old = *cache;
+  cache->size            = old.size ? old.size * 2 : PROOF_CACHE_MIN_SIZE;
+  cache->nodes           = _calloc(cache->size, sizeof(trie_proof_node_t));
+  cache->len             = 0;
+  for (uint32_t i = 0; i < old.size; i++) {
+    if (old.nodes[i].data) cache_put(cache, old.nodes + i);
+  }
+  _free(old.nodes);
+}
+
+/** writes the hash of the node, which is only calculated if the same content is not in the cache yet */
+static int node_hash(trie_proof_cache_t* cache, bytes_t* node, uint8_t* dst) {
+  if (!cache) return keccak(*node, dst);
+  if (cache->size) {
+    for (uint32_t i = node_key(node->data, node->len) & (cache->size - 1); cache->nodes[i].data; i = (i + 1) & (cache->size - 1)) {
+      trie_proof_node_t* n = cache->nodes + i;
+      if (n->len == node->len && (n->data == node->data || memcmp(n->data, node->data, node->len) == 0)) {
+        memcpy(dst, n->hash, 32);
+        return 0;
+      }
+    }
+  }
+  if (keccak(*node, dst)) return -1;
+  if (!node->data) return 0;
+  if ((cache->len + 1) * 4 > cache->size * 3) cache_grow(cache);
+  trie_proof_node_t n = {.data = node->data, .len = node->len};
+  memcpy(n.hash, dst, 32);
+  cache_put(cache, &n);
+  return 0;
+}
+
+void trie_proof_cache_free(trie_proof_cache_t* cache) {
+  _free(cache->nodes);
+  memset(cache, 0, sizeof(trie_proof_cache_t));
+}
+
 int trie_verify_proof(bytes_t* rootHash, bytes_t* path, bytes_t** proof, bytes_t* expectedValue) {
+  return trie_verify_proof_cached(NULL, rootHash, path, proof, expectedValue);
+}
+
+int trie_verify_proof_cached(trie_proof_cache_t* cache, bytes_t* rootHash, bytes_t* path, bytes_t** proof, bytes_t* expectedValue) {
   int      res        = 1;
   uint8_t* full_key   = trie_path_to_nibbles(*path, 0);
-  uint8_t *key        = full_key, expected_hash[32], node_hash[32];
+  uint8_t *key        = full_key, expected_hash[32], hash[32];
   bytes_t  last_value = {.data = NULL, .len = 0};
 
   // start with root hash
@@ -175,7 +232,7 @@ int trie_verify_proof(bytes_t* rootHash, bytes_t* path, bytes_t** proof, bytes_t
   size_t depth = 0;
   for (; *proof; proof += 1) {
     // create and check the hash of node
-    if (!(res = keccak(*(*proof), node_hash) == 0 && memcmp(expected_hash, node_hash, 32) == 0)) break;
+    if (!(res = node_hash(cache, *proof, hash) == 0 && memcmp(expected_hash, hash, 32) == 0)) break;
     // check embedded nodes and find the next expected hash
     if (!(res = check_node(*proof, &key, expectedValue, *(proof + 1) == NULL, &last_value, expected_hash, &depth))) break;
   }
@@ -46,6 +46,26 @@
 #define MERKLE_DEPTH_MAX 64
 #endif
 
+/** a rlp-encoded node of a proof with its hash */
+typedef struct {
+  uint8_t*  data; /**< the raw node, which is not owned by the cache */
+  uint32_t  len;  /**< length of the node */
+  bytes32_t hash; /**< the keccak-hash of the node */
+} trie_proof_node_t;
+
+/**
+ * a table of the nodes of the proofs within one response, addressed by their content.
+ *
+ * Proofs for multiple paths of the same trie (like the storage proofs of an account or the receipts of a block) share the upper nodes,
+ * which are hashed only once, if all of those proofs are verified with the same cache.
+ * The cache must be initialized with zeros and only references the nodes, so it must not outlive the response.
+ */
+typedef struct {
+  trie_proof_node_t* nodes; /**< the hashtable */
+  uint32_t           size;  /**< the size of the table (a power of 2) */
+  uint32_t           len;   /**< the number of nodes in the table */
+} trie_proof_cache_t;
+
 /**
  *  verifies a merkle proof.
  *
@@ -62,6 +82,21 @@
 NONULL_FOR((1, 2, 3))
 int trie_verify_proof(bytes_t* rootHash, bytes_t* path, bytes_t** proof, bytes_t* expectedValue);
 
+/**
+ * verifies a merkle proof like trie_verify_proof, but takes the hashes of the nodes from the cache.
+ *
+ * Nodes which are not in the cache yet will be hashed and added.
+ *
+ * \param cache the cache shared by all proofs of the response. If NULL, all nodes will be hashed.
+ */
+NONULL_FOR((2, 3, 4))
+int trie_verify_proof_cached(trie_proof_cache_t* cache, bytes_t* rootHash, bytes_t* path, bytes_t** proof, bytes_t* expectedValue);
+
+/**
+ * frees the table of the cache, but not the nodes.
+ */
+NONULL void trie_proof_cache_free(trie_proof_cache_t* cache);
+
 /**
  * helper function split a path into 4-bit nibbles.
  *
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/**
+ * runs the evm-tests repeatedly and reports the time spent executing the code.
+ *
+ * usage: evm_bench [-n <iterations>] [-c] <test-file> ...
+ *
+ * Only the time spent in evm_run() is measured, so preparing the accounts and checking the post-state
+ * does not hide changes in the interpreter itself.
+ */
+
+#ifndef TEST
+#define TEST
+#endif
+#include "../src/core/util/data.h"
+#include "../src/core/util/log.h"
+#include "../src/core/util/mem.h"
+#include "../src/verifier/eth1/evm/evm.h"
+#include "vm_runner.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void print_error(char* msg) { in3_log_debug("!! %s", msg); }
+void print_success(char* msg) { in3_log_debug(".. %s", msg); }
+
+static char* read_file(char* name) {
+  FILE* file = fopen(name, "r");
+  if (!file) return NULL;
+  size_t allocated = 1024, len = 0;
+  char*  buffer    = malloc(allocated);
+  while (!feof(file)) {
+    len += fread(buffer + len, 1, allocated - len - 1, file);
+    if (len + 1 == allocated) buffer = realloc(buffer, allocated *= 2);
+  }
+  buffer[len] = 0;
+  fclose(file);
+  return buffer;
+}
+
+static int bench_file(char* name, int iterations, uint32_t props, uint64_t* total) {
+  char* content = read_file(name);
+  if (!content) {
+    printf("could not read %s\n", name);
+    return -1;
+  }
+  json_ctx_t* jc = parse_json_indexed(content);
+  if (!jc) {
+    free(content);
+    printf("could not parse %s\n", name);
+    return -1;
+  }
+
+  int failed = 0;
+  for (d_iterator_t it = d_iter(jc->result); it.left; d_iter_next(&it)) {
+    char*    tname = d_get_keystr(jc, d_get_key(it.token));
+    uint64_t ms = 0, best = UINT64_MAX, sum = 0;
+    int      fail = 0, runs = 0;
+    for (; runs < iterations && !fail; runs++) {
+      mem_reset();
+      evm_run_us = 0;
+      fail       = test_evm(jc, it.token, props, &ms);
+      sum += evm_run_us;
+      if (evm_run_us < best) best = evm_run_us;
+    }
+    if (fail) failed++;
+    *total += sum;
+    printf("%-60s %10" PRIu64 " us %10" PRIu64 " us %s\n", tname ? tname : name, best, sum / runs, fail ? "FAILED" : "");
+  }
+
+  json_free(jc);
+  free(content);
+  return failed;
+}
+
+int main(int argc, char* argv[]) {
+  int      iterations = 10, failed = 0;
+  uint32_t props      = 0;
+  uint64_t total      = 0;
+
+  in3_log_set_level(LOG_ERROR);
+  printf("%-60s %13s %13s\n", "test", "min", "avg");
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      iterations = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-c") == 0)
+      props |= EVM_PROP_CONSTANTINOPL;
+    else
+      failed += bench_file(argv[i], iterations > 0 ? iterations : 1, props, &total);
+  }
+  printf("\ntotal: %" PRIu64 " us in evm_run%s\n", total, failed ? " (some tests failed)" : "");
+  return failed ? 1 : 0;
+}
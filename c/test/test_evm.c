@@ -55,6 +55,7 @@
 #include <time.h>
 
 #include "vm_runner.h"
+uint64_t           evm_run_us    = 0;
 static json_ctx_t* jc            = NULL;
 static bytes_t     current_block = {.data = NULL, .len = 0};
 d_token_t*         vm_get_account(d_token_t* test, uint8_t* adr) {
@@ -355,7 +356,7 @@ int generate_state_root(evm_t* evm, uint8_t* dst) {
   });
 
   //
-  account_t* ac = evm->accounts;
+  account_t* ac = evm->accounts ? evm->accounts->list : NULL;
   while (ac) {
     if (num_bytes(ac->nonce, 32) == 0 && num_bytes(ac->balance, 32) == 0 && ac->code.len == 0) {
       ac = ac->next;
@@ -448,7 +449,8 @@ int run_evm(json_ctx_t* jctx, d_token_t* test, uint32_t props, uint64_t* ms, cha
   evm.memory.b.len  = 0;
   evm.memory.bsize  = 32;
 
-  evm.invalid_jumpdest = NULL;
+  evm.analysis   = NULL;
+  evm.code_cache = NULL;
 
   evm.stack_size = 0;
 
@@ -479,12 +481,14 @@ int run_evm(json_ctx_t* jctx, d_token_t* test, uint32_t props, uint64_t* ms, cha
     evm.account = d_get_bytes(exec, ikey(jc, "address")).data;
 
 #ifdef EVM_GAS
-    evm.accounts = NULL;
-    evm.gas      = d_get_long(exec, ikey(jc, "gas"));
-    evm.code     = d_bytes(d_get(exec, ikey(jc, "code")));
-    evm.parent   = NULL;
-    evm.logs     = NULL;
-    evm.init_gas = 0;
+    evm.accounts    = NULL;
+    evm.gas         = d_get_long(exec, ikey(jc, "gas"));
+    evm.code        = d_bytes(d_get(exec, ikey(jc, "code")));
+    evm.parent      = NULL;
+    evm.logs        = NULL;
+    evm.init_gas    = 0;
+    evm.checkpoint  = 0;
+    evm.journal_pos = 0;
 #endif
   }
   else if (transaction) {
@@ -516,12 +520,14 @@ int run_evm(json_ctx_t* jctx, d_token_t* test, uint32_t props, uint64_t* ms, cha
       evm.code = evm.call_data;
 
 #ifdef EVM_GAS
-    evm.accounts = NULL;
-    evm.gas      = d_long(get_test_val(transaction, "gasLimit", indexes));
-    evm.parent   = NULL;
-    evm.logs     = NULL;
-    evm.refund   = 0;
-    evm.init_gas = evm.gas;
+    evm.accounts    = NULL;
+    evm.gas         = d_long(get_test_val(transaction, "gasLimit", indexes));
+    evm.parent      = NULL;
+    evm.logs        = NULL;
+    evm.refund      = 0;
+    evm.init_gas    = evm.gas;
+    evm.checkpoint  = 0;
+    evm.journal_pos = 0;
 
     // check if we have enough gas to pay for intrinsic transaction cost
     uint64_t tx_intrinsic_gas = G_TRANSACTION; // base gas cost for any transaction
@@ -611,6 +617,7 @@ int run_evm(json_ctx_t* jctx, d_token_t* test, uint32_t props, uint64_t* ms, cha
   uint64_t start = clock(), gas_before = evm.gas;
   int      fail = has_enough_gas ? evm_run(&evm, evm.account) : 0;
   *ms           = (clock() - start) / 1000;
+  evm_run_us += (clock() - start) * 1000000 / CLOCKS_PER_SEC;
 
   if (transaction) {
 #ifdef EVM_GAS
@@ -621,22 +628,9 @@ int run_evm(json_ctx_t* jctx, d_token_t* test, uint32_t props, uint64_t* ms, cha
         total_gas = d_long(get_test_val(transaction, "gasLimit", indexes));
         evm.gas   = 0;
         fail      = 0;
-        uint8_t    gas_tmp[32], gas_tmp2[32];
-        account_t* ac = NULL;
-        storage_t* s  = NULL;
+        uint8_t gas_tmp[32], gas_tmp2[32];
         // reset all accounts except the sender
-        while (evm.accounts) {
-          ac = evm.accounts;
-          //    if (ac->code.data) _free(ac->code.data);
-          s = NULL;
-          while (ac->storage) {
-            s           = ac->storage;
-            ac->storage = s->next;
-            _free(s);
-          }
-          evm.accounts = ac->next;
-          _free(ac);
-        }
+        evm_free_accounts(&evm);
 
         // read the accounts from pre-state
         read_accounts(&evm, d_get(test, ikey(jc, "pre")));
@@ -39,10 +39,15 @@
 #define DEBUG
 #endif
 
+#include "../../src/core/client/keys.h"
 #include "../../src/core/client/plugin.h"
+#include "../../src/core/client/request_internal.h"
 #include "../../src/core/util/data.h"
 #include "../../src/core/util/log.h"
 #include "../../src/core/util/scache.h"
+#ifdef KV_STORAGE
+#include "../../src/tools/storage/kv_storage.h"
+#endif
 #include "../../src/verifier/eth1/nano/eth_nano.h"
 #include "../test_utils.h"
 #include "nodeselect/full/cache.h"
@@ -271,6 +276,271 @@ static void test_scache() {
   _free(cache);
 }
 
+static void test_lru_cache() {
+  uint8_t          value[250];
+  in3_lru_cache_t* lru = in3_lru_new(1000); // fits 3 entries
+  memset(value, 1, sizeof(value));
+  for (int i = 0; i < 3; i++) in3_lru_set(lru, bytes((uint8_t*) &i, sizeof(int)), bytes(value, sizeof(value)));
+
+  int      i   = 0;
+  bytes_t* val = in3_lru_get(lru, bytes((uint8_t*) &i, sizeof(int)), 0);
+  TEST_ASSERT_TRUE(val != NULL && val->len == sizeof(value) && val->data[0] == 1);
+  b_free(val);
+
+  // using 0 made 1 the least recently used, which is removed by the next entry
+  i = 3;
+  in3_lru_set(lru, bytes((uint8_t*) &i, sizeof(int)), bytes(value, sizeof(value)));
+  for (i = 0; i < 4; i++) {
+    val = in3_lru_get(lru, bytes((uint8_t*) &i, sizeof(int)), 0);
+    TEST_ASSERT_TRUE(i == 1 ? val == NULL : val != NULL);
+    b_free(val);
+  }
+  in3_lru_free(lru);
+
+  // many entries make the index grow
+  lru = in3_lru_new(1000000);
+  for (i = 0; i < 1000; i++) in3_lru_set(lru, bytes((uint8_t*) &i, sizeof(int)), bytes((uint8_t*) &i, sizeof(int)));
+  for (i = 0; i < 1000; i++) {
+    val = in3_lru_get(lru, bytes((uint8_t*) &i, sizeof(int)), 0);
+    TEST_ASSERT_TRUE(val && *((int*) (void*) val->data) == i);
+    b_free(val);
+  }
+  in3_lru_free(lru);
+}
+
+static in3_ret_t accept_balance(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx) {
+  UNUSED_VAR(plugin_data);
+  UNUSED_VAR(action);
+  const char* method = ((in3_vctx_t*) plugin_ctx)->method;
+  return strcmp(method, "eth_getBalance") && strcmp(method, "eth_getTransactionByHash") ? IN3_EIGNORE : IN3_OK;
+}
+
+static in3_req_state_t exec_balance(in3_t* c, char* block, char* response) {
+  char req_data[200];
+  sprintf(req_data, "{\"method\":\"eth_getBalance\",\"params\":[\"0x" "ac1b824795e1eb1f6e609fe0da9b9af8beaab60f\",\"%s\"]}", block);
+  in3_req_t*      req   = req_new(c, req_data);
+  in3_req_state_t state = in3_req_exec_state(req);
+  if (state == REQ_WAITING_TO_SEND && response) {
+    in3_http_request_t* request = in3_create_request(req);
+    in3_ctx_add_response(request->req, 0, false, response, -1, 0);
+    request_free(request);
+    state = in3_req_exec_state(req);
+    TEST_ASSERT_EQUAL_STRING("0x2a", d_get_string(req->responses[0], K_RESULT));
+  }
+  req_free(req);
+  return state;
+}
+
+static in3_req_state_t exec_tx(in3_t* c, char* response) {
+  in3_req_t*      req   = req_new(c, "{\"method\":\"eth_getTransactionByHash\",\"params\":[\"0x" "9241334b0b568ef6cd44d80e37a0ce14de05557a3cfa98b5fd1d006204caf164\"]}");
+  in3_req_state_t state = in3_req_exec_state(req);
+  if (state == REQ_WAITING_TO_SEND && response) {
+    in3_http_request_t* request = in3_create_request(req);
+    in3_ctx_add_response(request->req, 0, false, response, -1, 0);
+    request_free(request);
+    state = in3_req_exec_state(req);
+  }
+  req_free(req);
+  return state;
+}
+
+static void test_response_cache() {
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  TEST_ASSERT_NULL(in3_configure(c, "{\"autoUpdateList\":false,\"requestCount\":1,\"maxAttempts\":1,\"nodeRegistry\":{\"needsUpdate\":false},\"responseCache\":10000}"));
+  in3_plugin_register(c, PLGN_ACT_RPC_VERIFY, accept_balance, NULL, false);
+
+  // a final block is cached, so the next request does not need to send anything
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_balance(c, "0x10", "{\"result\":\"0x2a\",\"in3\":{\"currentBlock\":\"0x100\"}}"));
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_balance(c, "0x10", NULL));
+
+  // recent blocks or latest may still change
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_balance(c, "0xff", "{\"result\":\"0x2a\",\"in3\":{\"currentBlock\":\"0x100\"}}"));
+  TEST_ASSERT_EQUAL(REQ_WAITING_TO_SEND, exec_balance(c, "0xff", NULL));
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_balance(c, "latest", "{\"result\":\"0x2a\",\"in3\":{\"currentBlock\":\"0x100\"}}"));
+  TEST_ASSERT_EQUAL(REQ_WAITING_TO_SEND, exec_balance(c, "latest", NULL));
+
+  // transactions may still be moved to another block by a reorg, until their block is final
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_tx(c, "{\"result\":{\"blockHash\":\"0x" "1111111111111111111111111111111111111111111111111111111111111111\",\"blockNumber\":\"0xff\"},\"in3\":{\"currentBlock\":\"0x100\"}}"));
+  TEST_ASSERT_EQUAL(REQ_WAITING_TO_SEND, exec_tx(c, NULL));
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_tx(c, "{\"result\":{\"blockHash\":\"0x" "1111111111111111111111111111111111111111111111111111111111111111\",\"blockNumber\":\"0x10\"},\"in3\":{\"currentBlock\":\"0x100\"}}"));
+  TEST_ASSERT_EQUAL(REQ_SUCCESS, exec_tx(c, NULL));
+
+  // turning the cache off
+  TEST_ASSERT_NULL(in3_configure(c, "{\"responseCache\":0}"));
+  TEST_ASSERT_EQUAL(REQ_WAITING_TO_SEND, exec_balance(c, "0x10", NULL));
+  in3_free(c);
+}
+
+static void cache_put(in3_t* c, char* key, char* value) {
+  bytes_t         content = bytes((uint8_t*) value, strlen(value));
+  in3_cache_ctx_t cctx    = {.req = NULL, .key = key, .content = &content};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_all(c, PLGN_ACT_CACHE_SET, &cctx));
+}
+
+static void cache_assert(in3_t* c, char* key, char* expected) {
+  in3_cache_ctx_t cctx = {.req = NULL, .key = key, .content = NULL};
+  in3_plugin_execute_all(c, PLGN_ACT_CACHE_GET, &cctx);
+  if (!expected) {
+    TEST_ASSERT_NULL(cctx.content);
+  }
+  else {
+    TEST_ASSERT_NOT_NULL(cctx.content);
+    TEST_ASSERT_EQUAL(strlen(expected), cctx.content->len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, cctx.content->data, cctx.content->len);
+    b_free(cctx.content);
+  }
+}
+
+static uint64_t now = 0;
+static uint64_t fixed_time(void* t) {
+  UNUSED_VAR(t);
+  return now;
+}
+
+static void test_memory_cache() {
+  char   value[401];
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  memset(value, 'x', 400);
+  value[400] = 0;
+  now        = 1000;
+  in3_set_func_time(fixed_time);
+  TEST_ASSERT_NULL(in3_configure(c, "{\"memoryCache\":1500,\"cacheTimeout\":10}"));
+  TEST_ASSERT_EQUAL(1500, in3_get_memory_cache(c));
+  char* config = in3_get_config(c);
+  TEST_ASSERT_NOT_NULL(strstr(config, "\"memoryCache\":1500"));
+  _free(config);
+
+  // the limit fits 3 values, so the least recently used is removed by the 4th
+  cache_put(c, "a", value);
+  cache_put(c, "b", value);
+  cache_put(c, "c", value);
+  cache_assert(c, "a", value);
+  cache_put(c, "d", value);
+  cache_assert(c, "b", NULL);
+  cache_assert(c, "a", value);
+  cache_assert(c, "c", value);
+  cache_assert(c, "d", value);
+
+  // values older than cacheTimeout are not used anymore
+  cache_put(c, "e", "1");
+  now += 10;
+  cache_assert(c, "e", "1");
+  now++;
+  cache_assert(c, "e", NULL);
+
+  // changing the size removes all values and 0 turns it off
+  TEST_ASSERT_NULL(in3_configure(c, "{\"memoryCache\":1000}"));
+  TEST_ASSERT_EQUAL(1000, in3_get_memory_cache(c));
+  cache_assert(c, "a", NULL);
+  TEST_ASSERT_NULL(in3_configure(c, "{\"memoryCache\":0}"));
+  TEST_ASSERT_EQUAL(0, in3_get_memory_cache(c));
+  cache_put(c, "a", "1");
+  cache_assert(c, "a", NULL);
+  in3_free(c);
+}
+
+#ifdef KV_STORAGE
+#define KV_TEST_FILE "kv_test.db"
+
+static void test_kv_storage() {
+  unlink(KV_TEST_FILE);
+  in3_t* c1 = in3_for_chain(CHAIN_ID_MAINNET);
+  in3_t* c2 = in3_for_chain(CHAIN_ID_MAINNET);
+  TEST_ASSERT_EQUAL(IN3_OK, in3_register_kv_storage(c1, KV_TEST_FILE));
+  TEST_ASSERT_EQUAL(IN3_OK, in3_register_kv_storage(c2, KV_TEST_FILE));
+
+  cache_assert(c1, "a", NULL);
+  cache_put(c1, "a", "1");
+  cache_put(c1, "b", "2");
+  cache_put(c1, "a", "3");
+  cache_assert(c1, "a", "3");
+  cache_assert(c1, "b", "2");
+  cache_assert(c1, "c", NULL);
+
+  // changes are seen by other instances using the same file
+  cache_assert(c2, "a", "3");
+  cache_put(c2, "c", "4");
+  cache_assert(c1, "c", "4");
+
+  // outdated records are removed once they take more than half of the file
+  char big[1001];
+  memset(big, 'x', 1000);
+  big[1000] = 0;
+  for (int i = 0; i < 100; i++) cache_put(c1, "big", big);
+  FILE* f = fopen(KV_TEST_FILE, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  TEST_ASSERT_TRUE(ftell(f) < 0x10000);
+  fclose(f);
+  cache_assert(c2, "big", big);
+  cache_assert(c2, "a", "3");
+
+  // data after the last committed record is ignored
+  f = fopen(KV_TEST_FILE, "ab");
+  fwrite("garbage", 1, 7, f);
+  fclose(f);
+  cache_assert(c2, "b", "2");
+  cache_put(c2, "d", "5");
+  cache_assert(c1, "d", "5");
+
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_all(c1, PLGN_ACT_CACHE_CLEAR, NULL));
+  cache_assert(c2, "a", NULL);
+  cache_assert(c1, "d", NULL);
+
+  in3_free(c1);
+  in3_free(c2);
+  unlink(KV_TEST_FILE);
+}
+#endif
+
+static void test_nodelist_cache() {
+  in3_t* c   = in3_for_chain(0x34ff);
+  char*  err = in3_configure(c, "{\"chainId\":\"0x34ff\",\"chainType\":0,\"autoUpdateList\":false,"
+                               "\"nodeRegistry\":{"
+                               "   \"needsUpdate\":false,"
+                               "   \"contract\": \"" CONTRACT_ADDRS "\","
+                               "   \"registryId\": \"" REGISTRY_ID "\","
+                               "   \"nodeList\": [{"
+                               "      \"url\":\"https://in3-v2.slock.it/priv/nd-1\","
+                               "      \"address\":\"0x45d45e6ff99e6c34a235d263965910298985fcfe\","
+                               "      \"props\":\"0x1dd\""
+                               "    },"
+                               "    {"
+                               "      \"url\":\"https://in3-v2.slock.it/priv/nd-2\","
+                               "      \"address\":\"0x1fe2e9bf29aa1938859af64c413361227d04059a\","
+                               "      \"props\":\"0xff\""
+                               "    }]"
+                               "}}");
+  TEST_ASSERT_NULL_MESSAGE(err, err);
+  setup_test_cache(c);
+
+  in3_nodeselect_def_t* nl = in3_nodeselect_def_data(c);
+  nl->weights[1].latency   = 42;
+  nl->last_block           = 1234;
+  nl->dirty                = true;
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_store_nodelist(c, nl));
+
+  // the nodes are read with the urls pointing to the cached data
+  nl->weights[1].latency = 0;
+  TEST_ASSERT_EQUAL(IN3_OK, in3_cache_update_nodelist(c, nl));
+  TEST_ASSERT_EQUAL(2, nl->nodelist_length);
+  TEST_ASSERT_EQUAL(1234, nl->last_block);
+  TEST_ASSERT_EQUAL(42, nl->weights[1].latency);
+  TEST_ASSERT_EQUAL(0xff, nl->nodelist[1].props);
+  TEST_ASSERT_EQUAL_STRING("https://in3-v2.slock.it/priv/nd-2", nl->nodelist[1].url);
+  TEST_ASSERT_NOT_NULL(nl->cached);
+  TEST_ASSERT_TRUE((uint8_t*) nl->nodelist[1].url > nl->cached->data && (uint8_t*) nl->nodelist[1].url < nl->cached->data + nl->cached->len);
+
+  // changed data is rejected
+  for (int i = 0; i < MAX_ENTRIES && cache.keys[i]; i++) {
+    if (strncmp(cache.keys[i], "nodelist_", 9) == 0) cache.values[i].data[cache.values[i].len - 5] ^= 1;
+  }
+  TEST_ASSERT_EQUAL(IN3_EINVALDT, in3_cache_update_nodelist(c, nl));
+  TEST_ASSERT_EQUAL_STRING("https://in3-v2.slock.it/priv/nd-2", nl->nodelist[1].url);
+
+  in3_free(c);
+}
+
 static void test_whitelist_cache() {
   address_t contract;
   hex_to_bytes(CONTRACT_ADDRS, -1, contract, 20);
@@ -339,8 +609,15 @@ int main() {
   // now run tests
   TESTS_BEGIN();
   RUN_TEST(test_scache);
+  RUN_TEST(test_lru_cache);
+  RUN_TEST(test_response_cache);
+  RUN_TEST(test_nodelist_cache);
+#ifdef KV_STORAGE
+  RUN_TEST(test_kv_storage);
+#endif
   //  RUN_TEST(test_cache);
   //  RUN_TEST(test_newchain);
   RUN_TEST(test_whitelist_cache);
+  RUN_TEST(test_memory_cache); // last, since it mocks the time
   return TESTS_END();
 }
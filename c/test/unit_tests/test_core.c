@@ -43,6 +43,8 @@
 #include "../../src/core/util/data.h"
 #include "../../src/core/util/debug.h"
 #include "../../src/core/util/utils.h"
+#include "../../src/verifier/eth1/basic/trie.h"
+#include "../../src/verifier/eth1/evm/evm.h"
 #include "../../src/verifier/eth1/nano/eth_nano.h"
 #include "../test_utils.h"
 #include "nodeselect/full/cache.h"
@@ -74,6 +76,49 @@ void test_bytes() {
   _free(clone.data);
 }
 
+void test_hex() {
+  const char* hex = "00112233445566778899aabbccddeeffAABBCCDDEEFF0123456789abcdef";
+  uint8_t     expected[30], out[30];
+  for (int i = 0; i < 30; i++) expected[i] = (hexchar_to_int(hex[i * 2]) << 4) | hexchar_to_int(hex[i * 2 + 1]);
+
+  TEST_ASSERT_EQUAL(30, hex_to_bytes(hex, 60, out, 30));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, 30);
+  // odd length
+  TEST_ASSERT_EQUAL(30, hex_to_bytes(hex + 1, 59, out, 30));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected + 1, out + 1, 29);
+
+  TEST_ASSERT_TRUE(is_hex_chars(hex, 60));
+  TEST_ASSERT_TRUE(is_hex_chars(hex, 0));
+  TEST_ASSERT_FALSE(is_hex_chars("00112233445566778899aabbccddeeffg", 33));
+  TEST_ASSERT_FALSE(is_hex_chars("0011223344556677889:aabbccddeeff", 32));
+  TEST_ASSERT_FALSE(is_hex_chars("001122334455667788990aabbccddeeG", 32));
+  TEST_ASSERT_FALSE(is_hex_chars("@0112233445566778899aabbccddeeff", 32));
+
+  // long strings with escapes and quotes at different positions
+  for (int n = 0; n < 40; n++) {
+    sb_t sb = {0};
+    sb_add_chars(&sb, "{\"a\":\"");
+    for (int i = 0; i < n; i++) sb_add_char(&sb, 'x');
+    sb_add_chars(&sb, "\\\"'");
+    for (int i = 0; i < n; i++) sb_add_char(&sb, 'y');
+    sb_add_chars(&sb, "\",\"b\":\"0x");
+    for (int i = 0; i < n; i++) sb_add_chars(&sb, "aB");
+    sb_add_chars(&sb, "\"}");
+    json_ctx_t* json = parse_json(sb.data);
+    TEST_ASSERT_NOT_NULL(json);
+    TEST_ASSERT_EQUAL(n * 2 + 2, d_len(d_get(json->result, key("a"))));
+    TEST_ASSERT_EQUAL('"', d_get_string(json->result, key("a"))[n]);
+    bytes_t b = d_get_bytes(json->result, key("b"));
+    if (n > 4) {
+      TEST_ASSERT_EQUAL(n, b.len);
+      TEST_ASSERT_EQUAL(0xab, b.data[n - 1]);
+    }
+    json_free(json);
+    _free(sb.data);
+  }
+  TEST_ASSERT_NULL(parse_json("{\"a\":\"abc\\"));
+}
+
 void test_float_parser() {
   TEST_ASSERT_EQUAL_INT64(1, parse_float_val("1.005", 0));
   TEST_ASSERT_EQUAL_INT64(100, parse_float_val("1.005", 2));
@@ -172,6 +217,82 @@ void test_parse_json() {
   verify_valid_json("[{\"id\":0,\"jsonrpc\":\"2.0\",\"error\":{\"message\":\"VM Exception while processing transaction: revert \\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000'\\u0011\",\"code\":-32000,\"data\":{\"0x1f426a9536e776d61eccca7500db78b53a8296ee50977e50d6c76c44f8430571\":{\"error\":\"revert\",\"program_counter\":112,\"return\":\"0x08c379a0000000000000000000000000000000000000000000000000000000000000002000000000000000000000000000000000000000000000000000000000000000200000000000000000000000000000000000000000000000000000000000002711\",\"reason\":\"\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000'\\u0011\"},\"stack\":\"c: VM Exception while processing transaction: revert \\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000\\u0000'\\u0011\n    at Function.c.fromResults (/Users/simon/ws/custody/cutody-lib/node_modules/ganache-cli/build/ganache-core.node.cli.js:2:157333)\n    at readyCall (/Users/simon/ws/custody/cutody-lib/node_modules/ganache-cli/build/ganache-core.node.cli.js:17:121221)\",\"name\":\"c\"}}}]", T_ARRAY, );
 }
 
+void test_token_size() {
+  json_ctx_t* json = parse_json("{\"a\":[1,2,{\"x\":[]},[3,4]],\"b\":{\"c\":\"0x1234\"},\"d\":[5,6,7],\"e\":true}");
+  TEST_ASSERT_NOT_NULL(json);
+  TEST_ASSERT_EQUAL(json->len, d_token_size(json->result));
+  TEST_ASSERT_EQUAL(8, d_token_size(d_get(json->result, key("a"))));
+  TEST_ASSERT_EQUAL(4, d_get_int_at(d_get_at(d_get(json->result, key("a")), 3), 1));
+  TEST_ASSERT_EQUAL(T_ARRAY, d_type(d_get(d_get_at(d_get(json->result, key("a")), 2), key("x"))));
+  TEST_ASSERT_EQUAL_STRING("0x1234", d_get_string(d_get(json->result, key("b")), key("c")));
+  TEST_ASSERT_EQUAL(7, d_get_int_at(d_get(json->result, key("d")), 2));
+  TEST_ASSERT_NULL(d_get_at(d_get(json->result, key("d")), 3));
+  TEST_ASSERT_TRUE(d_int(d_get(json->result, key("e"))));
+
+  // the binary parser must produce the same sizes
+  bytes_builder_t* bb = bb_new();
+  d_serialize_binary(bb, json->result);
+  json_ctx_t* bin = parse_binary(&bb->b);
+  TEST_ASSERT_EQUAL(json->len, d_token_size(bin->result));
+  TEST_ASSERT_EQUAL(7, d_get_int_at(d_get(bin->result, key("d")), 2));
+  json_free(bin);
+  bb_free(bb);
+  json_free(json);
+
+  // subtrees too large to store their size are still walked correctly
+  sb_t sb = {0};
+  sb_add_chars(&sb, "{\"list\":[");
+  for (int i = 0; i < 10000; i++) sb_add_chars(&sb, i ? ",{\"v\":1}" : "{\"v\":1}");
+  sb_add_chars(&sb, "],\"last\":42}");
+  json = parse_json(sb.data);
+  TEST_ASSERT_EQUAL(20001, d_token_size(d_get(json->result, key("list"))));
+  TEST_ASSERT_EQUAL(42, d_get_int(json->result, key("last")));
+  TEST_ASSERT_EQUAL(1, d_get_int(d_get_at(d_get(json->result, key("list")), 9999), key("v")));
+  json_free(json);
+  _free(sb.data);
+}
+
+void test_json_stream() {
+  const char* js = "{\"id\":1,\"result\":{\"a\":[1,-2,3.5e2,{\"x\":[]},[true,false,null]],\"big\":18446744073709551615,"
+                   "\"s\":\"es\\\"caped\",\"hex\":\"0x1234\"},\"list\":[\"0x01\",\"0x02\"],\"jsonrpc\":\"2.0\"}";
+  json_ctx_t*    expected = parse_json(js);
+  json_stream_t* stream   = json_stream_new();
+  sb_t           sb       = {0};
+
+  // we feed one char at a time, so the buffer is moved several times while parsing
+  for (size_t i = 0; js[i]; i++) {
+    TEST_ASSERT_EQUAL(0, json_stream_parse(stream, sb.data ? sb.data : "", sb.len));
+    sb_add_range(&sb, js, i, 1);
+  }
+  TEST_ASSERT_EQUAL(1, json_stream_parse(stream, sb.data, sb.len));
+  json_ctx_t* json = json_stream_finish(stream, sb.data, sb.len);
+  TEST_ASSERT_NOT_NULL(json);
+  TEST_ASSERT_EQUAL(expected->len, json->len);
+  TEST_ASSERT_EQUAL(json->len, d_token_size(json->result));
+  TEST_ASSERT_TRUE(d_eq(expected->result, json->result));
+  TEST_ASSERT_EQUAL_STRING("es\"caped", d_get_string(d_get(json->result, key("result")), key("s")));
+  TEST_ASSERT_EQUAL_STRING("3.5e2", d_string(d_get_at(d_get(d_get(json->result, key("result")), key("a")), 2)));
+  TEST_ASSERT_TRUE(d_to_json(d_get(json->result, key("list"))).data == sb.data + (strstr(js, "[\"0x01") - js)); // no copy
+  json_free(json);
+  json_free(expected);
+  _free(sb.data);
+
+  // a root number is only complete at the end
+  stream = json_stream_new();
+  TEST_ASSERT_EQUAL(0, json_stream_parse(stream, "12", 2));
+  json = json_stream_finish(stream, "123", 3);
+  TEST_ASSERT_EQUAL(123, d_int(json->result));
+  json_free(json);
+
+  // incomplete or invalid data
+  stream = json_stream_new();
+  TEST_ASSERT_EQUAL(0, json_stream_parse(stream, "{\"a\":\"abc", 9));
+  TEST_ASSERT_NULL(json_stream_finish(stream, "{\"a\":\"abc", 9));
+  stream = json_stream_new();
+  TEST_ASSERT_TRUE(json_stream_parse(stream, "{\"a\":1]", 7) < 0);
+  json_stream_free(stream);
+}
+
 void test_sb() {
   sb_t* sb = sb_new("a=\"");
   TEST_ASSERT_EQUAL_STRING("a=\"", sb->data);
@@ -189,6 +310,78 @@ void test_sb() {
   sb_free(sb);
 }
 
+static void test_arena() {
+  in3_arena_t arena = {0};
+  uint8_t*    a     = arena_alloc(&arena, 3);
+  uint8_t*    b     = arena_alloc(&arena, 8);
+  TEST_ASSERT_EQUAL(8, b - a);
+  TEST_ASSERT_EQUAL(0, ((uintptr_t) b) & 7);
+  memset(a, 1, 3);
+  memset(b, 2, 8);
+
+  // a large allocation gets its own block, so the current block is still used afterwards
+  uint8_t* large = arena_alloc(&arena, ARENA_BLOCK_SIZE * 4);
+  memset(large, 3, ARENA_BLOCK_SIZE * 4);
+  TEST_ASSERT_EQUAL(16, (uint8_t*) arena_alloc(&arena, 1) - a);
+
+  // filling the block creates a new one without touching the old data
+  for (int i = 0; i < 100; i++) memset(arena_alloc(&arena, 100), 4, 100);
+  TEST_ASSERT_EQUAL(1, a[2]);
+  TEST_ASSERT_EQUAL(2, b[7]);
+  arena_free(&arena);
+  TEST_ASSERT_NULL(arena.blocks);
+  arena_free(&arena);
+}
+
+static void test_arena_realloc() {
+  in3_arena_t arena = {0};
+  uint8_t*    a     = arena_alloc(&arena, 16);
+  uint8_t*    b     = arena_alloc(&arena, 16);
+  memset(a, 1, 16);
+
+  // the last allocation of the current block grows in place
+  TEST_ASSERT_TRUE(b == arena_realloc(&arena, b, 32, 16));
+  TEST_ASSERT_EQUAL(48, (uint8_t*) arena_alloc(&arena, 8) - a);
+
+  // the only allocation of a block is reallocated with its block
+  uint8_t* large = arena_alloc(&arena, ARENA_BLOCK_SIZE);
+  memset(large, 2, ARENA_BLOCK_SIZE);
+  large = arena_realloc(&arena, large, ARENA_BLOCK_SIZE * 4, ARENA_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(2, large[ARENA_BLOCK_SIZE - 1]);
+
+  // everything else is copied
+  uint8_t* c = arena_realloc(&arena, a, 32, 16);
+  TEST_ASSERT_TRUE(c != a);
+  TEST_ASSERT_EQUAL(1, c[15]);
+  arena_free(&arena);
+}
+
+static void test_json_arena() {
+  in3_arena_t arena = {0};
+  sb_t        sb    = {0};
+  sb_add_char(&sb, '[');
+  for (int i = 0; i < 100; i++) sb_print(&sb, "%s{\"n\":%i,\"s\":\"a\\\"%i\",\"b\":12345678901234,\"h\":\"0x0102030405\"}", i ? "," : "", i, i);
+  sb_add_char(&sb, ']');
+
+  json_ctx_t* ctx = parse_json_arena(sb.data, &arena);
+  TEST_ASSERT_NOT_NULL(ctx);
+  TEST_ASSERT_TRUE(ctx->arena == &arena);
+  TEST_ASSERT_EQUAL(100, d_len(ctx->result));
+  d_token_t* last = d_get_at(ctx->result, 99);
+  TEST_ASSERT_EQUAL(99, d_get_int(last, key("n")));
+  TEST_ASSERT_EQUAL_STRING("a\"99", d_get_string(last, key("s")));
+  TEST_ASSERT_EQUAL(12345678901234ULL, d_get_long(last, key("b")));
+  // converting a token allocates its data on the heap, which is freed with the context
+  bytes_t h = d_bytesl(d_get(last, key("h")), 8);
+  TEST_ASSERT_EQUAL(8, h.len);
+  TEST_ASSERT_EQUAL(5, h.data[7]);
+  json_free(ctx);
+
+  TEST_ASSERT_NULL(parse_json_arena("[1,", &arena));
+  arena_free(&arena);
+  _free(sb.data);
+}
+
 static void test_utils() {
   TEST_ASSERT_EQUAL(1, IS_APPROX(5, 4, 1));
   TEST_ASSERT_EQUAL(0, bytes_to_int(NULL, 0));
@@ -199,6 +392,62 @@ static void test_utils() {
 /*
  * Main
  */
+static void test_evm_code_analysis() {
+  // PUSH1 0x5b, JUMPDEST, JUMP, STOP
+  uint8_t              data[] = {0x60, 0x5b, 0x5b, 0x56, 0x00};
+  bytes_t              code   = bytes(data, sizeof(data));
+  evm_code_cache_t*    cache  = evm_code_cache_new(2);
+  evm_code_analysis_t* a      = evm_code_analyse(cache, code, EVM_PROP_CONSTANTINOPL);
+
+  TEST_ASSERT_FALSE(evm_is_jumpdest(a, 1)); // push-data
+  TEST_ASSERT_TRUE(evm_is_jumpdest(a, 2));
+  TEST_ASSERT_FALSE(evm_is_jumpdest(a, 5));
+  TEST_ASSERT_EQUAL(3, a->blocks_len);
+  TEST_ASSERT_EQUAL(3, evm_code_block(a, 0)->gas);
+  TEST_ASSERT_EQUAL(9, evm_code_block(a, 2)->gas);
+  TEST_ASSERT_EQUAL(4, evm_code_block(a, 2)->end);
+  TEST_ASSERT_NULL(evm_code_block(a, 1));
+
+  // the same code is taken from the cache
+  TEST_ASSERT_TRUE(a == evm_code_analyse(cache, code, EVM_PROP_CONSTANTINOPL));
+  evm_code_release(cache, a);
+  evm_code_release(cache, a);
+
+  // only the entries not used anymore are removed
+  evm_code_analysis_t* b = evm_code_analyse(cache, code, EVM_PROP_FRONTIER);
+  TEST_ASSERT_TRUE(a != b);
+  data[4] = 0xfe;
+  evm_code_release(cache, evm_code_analyse(cache, code, EVM_PROP_CONSTANTINOPL));
+  data[4] = 0x00;
+  TEST_ASSERT_TRUE(b == evm_code_analyse(cache, code, EVM_PROP_FRONTIER));
+  evm_code_release(cache, b);
+  evm_code_release(cache, b);
+  evm_code_cache_free(cache);
+}
+
+void test_trie_index_root() {
+  // compare the roots with a trie built by inserting each value, crossing the keys with 1, 2 and 3 bytes
+  uint32_t lens[] = {0, 1, 2, 16, 127, 128, 129, 300};
+  uint8_t  data[64];
+  for (uint32_t n = 0; n < sizeof(lens) / sizeof(uint32_t); n++) {
+    bytes_t*  values = _malloc(lens[n] * sizeof(bytes_t) + 1);
+    trie_t*   trie   = trie_new();
+    bytes32_t root;
+    for (uint32_t i = 0; i < lens[n]; i++) {
+      memset(data, i & 0xFF, sizeof(data));
+      values[i]     = cloned_bytes(bytes(data, i % 32 + 32)); // like transactions, the values are too long to be embedded
+      bytes_t* path = create_tx_path(i);
+      trie_set_value(trie, path, values + i);
+      b_free(path);
+    }
+    trie_index_root(values, lens[n], root);
+    TEST_ASSERT_EQUAL_MEMORY(trie->root, root, 32);
+    for (uint32_t i = 0; i < lens[n]; i++) _free(values[i].data);
+    _free(values);
+    trie_free(trie);
+  }
+}
+
 int main() {
   dbg_log("starting cor tests");
 
@@ -208,9 +457,17 @@ int main() {
   RUN_TEST(test_debug);
   RUN_TEST(test_c_to_long);
   RUN_TEST(test_bytes);
+  RUN_TEST(test_hex);
   RUN_TEST(test_json);
+  RUN_TEST(test_token_size);
+  RUN_TEST(test_json_stream);
   RUN_TEST(test_str_replace);
   RUN_TEST(test_sb);
   RUN_TEST(test_utils);
+  RUN_TEST(test_arena);
+  RUN_TEST(test_arena_realloc);
+  RUN_TEST(test_json_arena);
+  RUN_TEST(test_evm_code_analysis);
+  RUN_TEST(test_trie_index_root);
   return TESTS_END();
 }
@@ -0,0 +1,285 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+
+#include "../../src/core/client/keys.h"
+#include "../../src/core/client/request_internal.h"
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/mem.h"
+#include "../../src/transport/curl/in3_curl.h"
+#include "../../src/verifier/eth1/basic/eth_basic.h"
+#include "../test_utils.h"
+#include "nodeselect/full/nodeselect_def.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
+
+#define MAX_PEERS 16
+
+/** what the test-server does with a complete request */
+typedef enum {
+  SERVER_RESPOND, /**< sends a response with the id of the request */
+  SERVER_CLOSE,   /**< closes the connection without a response */
+  SERVER_IGNORE   /**< keeps the connection open without responding */
+} server_action_t;
+
+/** a connection to the local test-server, which is driven by the test between the steps of the multiplexer */
+typedef struct {
+  int  fd;
+  sb_t in;
+} peer_t;
+
+static int    server = -1;
+static int    port   = 0;
+static peer_t peers[MAX_PEERS];
+
+static void server_start() {
+  struct sockaddr_in addr = {0};
+  socklen_t          len  = sizeof(addr);
+  int                opt  = 1;
+  addr.sin_family         = AF_INET;
+  addr.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+  server                  = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  TEST_ASSERT_EQUAL(0, bind(server, (struct sockaddr*) &addr, sizeof(addr)));
+  TEST_ASSERT_EQUAL(0, listen(server, MAX_PEERS));
+  getsockname(server, (struct sockaddr*) &addr, &len);
+  port = ntohs(addr.sin_port);
+  fcntl(server, F_SETFL, fcntl(server, F_GETFL, 0) | O_NONBLOCK);
+  for (int i = 0; i < MAX_PEERS; i++) peers[i].fd = -1;
+}
+
+static void server_close_peers() {
+  for (int i = 0; i < MAX_PEERS; i++) {
+    if (peers[i].fd >= 0) close(peers[i].fd);
+    _free(peers[i].in.data);
+    peers[i] = (peer_t){.fd = -1};
+  }
+}
+
+/** returns true if the buffer holds a complete http-request */
+static bool request_complete(sb_t* in) {
+  char* header = in->data ? strstr(in->data, "\r\n\r\n") : NULL;
+  if (!header) return false;
+  char* cl = strstr(in->data, "Content-Length:");
+  return (size_t) (header + 4 - in->data) + (cl ? atoi(cl + 15) : 0) <= in->len;
+}
+
+/**
+ * accepts new connections, reads the requests and handles the complete ones.
+ * Returns the number of complete requests.
+ */
+static int server_handle(server_action_t action) {
+  int  handled = 0, fd;
+  char buf[4096];
+  while ((fd = accept(server, NULL, NULL)) >= 0) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    for (int i = 0; i < MAX_PEERS; i++) {
+      if (peers[i].fd >= 0) continue;
+      peers[i].fd = fd;
+      break;
+    }
+  }
+  for (int i = 0; i < MAX_PEERS; i++) {
+    peer_t* p = peers + i;
+    ssize_t n;
+    if (p->fd < 0) continue;
+    while ((n = recv(p->fd, buf, sizeof(buf), 0)) > 0) sb_add_range(&p->in, buf, 0, n);
+    if (!request_complete(&p->in)) continue;
+    handled++;
+    if (action == SERVER_IGNORE) continue;
+    if (action == SERVER_CLOSE) {
+      close(p->fd);
+      _free(p->in.data);
+      *p = (peer_t){.fd = -1};
+      continue;
+    }
+    char* id      = strstr(p->in.data, "\"id\":");
+    sb_t  payload = {0}, response = {0};
+    sb_print(&payload, "[{\"jsonrpc\":\"2.0\",\"id\":%i,\"result\":\"0x10\"}]", id ? atoi(id + 5) : 1);
+    sb_print(&response, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n%s", (unsigned int) payload.len, payload.data);
+    TEST_ASSERT_EQUAL(response.len, send(p->fd, response.data, response.len, 0));
+    _free(payload.data);
+    _free(response.data);
+    _free(p->in.data);
+    p->in = (sb_t){0};
+  }
+  return handled;
+}
+
+static in3_t* new_client() {
+  char   config[512];
+  in3_t* c = in3_for_chain(CHAIN_ID_LOCAL);
+  sprintf(config, "{\"proof\":\"none\",\"maxAttempts\":1,\"autoUpdateList\":false,\"nodeRegistry\":{\"needsUpdate\":false,\"nodeList\":[{"
+                  "\"url\":\"http://127.0.0.1:%i\",\"address\":\"0x784bfa9eb182c3a02dbeb5285e3dba92d717e07a\",\"props\":\"0xFFFF\"}]}}",
+          port);
+  TEST_ASSERT_NULL(in3_configure(c, config));
+  return c;
+}
+
+static void test_multi_step() {
+  in3_t*            c = new_client();
+  in3_curl_multi_t* m = in3_curl_multi_new();
+  in3_req_t*        reqs[3];
+  for (int i = 0; i < 3; i++) {
+    reqs[i] = req_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+    in3_curl_multi_add(m, reqs[i]);
+  }
+  TEST_ASSERT_NULL(in3_curl_multi_next(m));
+
+  // the requests stay active, until the server responds
+  for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL(3, in3_curl_multi_wait(m, 10));
+  TEST_ASSERT_NULL(in3_curl_multi_next(m));
+
+  int done = 0;
+  for (int i = 0; i < 500 && done < 3; i++) {
+    server_handle(SERVER_RESPOND);
+    in3_curl_multi_wait(m, 10);
+    for (in3_req_t* req = in3_curl_multi_next(m); req; req = in3_curl_multi_next(m), done++) {
+      TEST_ASSERT_EQUAL(REQ_SUCCESS, in3_req_exec_state(req));
+      TEST_ASSERT_EQUAL(16, d_get_long(req->responses[0], K_RESULT));
+    }
+  }
+  TEST_ASSERT_EQUAL(3, done);
+  TEST_ASSERT_EQUAL(0, in3_curl_multi_perform(m));
+  TEST_ASSERT_EQUAL(-1, in3_curl_multi_timeout(m));
+
+  in3_curl_multi_free(m);
+  for (int i = 0; i < 3; i++) req_free(reqs[i]);
+  server_close_peers();
+  in3_free(c);
+}
+
+static void test_multi_error() {
+  // the server closes the connection without a response, so the request fails, since no other attempt is allowed.
+  in3_t*            c   = new_client();
+  in3_curl_multi_t* m   = in3_curl_multi_new();
+  in3_req_t*        req = req_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+  in3_req_t*        res = NULL;
+  in3_curl_multi_add(m, req);
+  for (int i = 0; i < 500 && !res; i++) {
+    server_handle(SERVER_CLOSE);
+    in3_curl_multi_wait(m, 10);
+    res = in3_curl_multi_next(m);
+  }
+  TEST_ASSERT_TRUE(req == res);
+  TEST_ASSERT_EQUAL(REQ_ERROR, in3_req_exec_state(req));
+  TEST_ASSERT_NOT_NULL(req->error);
+
+  in3_curl_multi_free(m);
+  req_free(req);
+  server_close_peers();
+  in3_free(c);
+}
+
+static void test_multi_abort() {
+  // freeing the multiplexer aborts the pending transfers, but the requests are still owned by the caller.
+  in3_t*            c    = new_client();
+  in3_curl_multi_t* m    = in3_curl_multi_new();
+  in3_req_t*        req  = req_new(c, "{\"method\":\"eth_blockNumber\",\"params\":[]}");
+  int               seen = 0;
+  in3_curl_multi_add(m, req);
+  for (int i = 0; i < 500 && !seen; i++) {
+    in3_curl_multi_wait(m, 10);
+    seen = server_handle(SERVER_IGNORE);
+  }
+  TEST_ASSERT_EQUAL(1, seen);
+  TEST_ASSERT_EQUAL(1, in3_curl_multi_perform(m));
+  TEST_ASSERT_NULL(in3_curl_multi_next(m));
+  in3_curl_multi_free(m);
+
+  // the request is still waiting for the response of the aborted transfer
+  TEST_ASSERT_EQUAL(REQ_WAITING_FOR_RESPONSE, in3_req_state(req));
+  req_free(req);
+  server_close_peers();
+  in3_free(c);
+}
+
+#ifdef THREADSAFE
+static void* send_block_number(void* c) {
+  char *result = NULL, *error = NULL;
+  in3_client_rpc(c, "eth_blockNumber", "[]", &result, &error);
+  bool ok = result && !error && !strcmp(result, "\"0x10\"");
+  _free(result);
+  _free(error);
+  return ok ? c : NULL;
+}
+
+static void test_pool_free_while_sending() {
+  // the transfer keeps its reference to the pool, so freeing the pool of the process while it runs, must not free it
+  in3_t*    c    = new_client();
+  pthread_t t    = 0;
+  void*     res  = NULL;
+  int       seen = 0;
+  in3_register_curl(c);
+  pthread_create(&t, NULL, send_block_number, c);
+  for (int i = 0; i < 500 && !seen; i++) {
+    usleep(10000);
+    seen = server_handle(SERVER_IGNORE);
+  }
+  TEST_ASSERT_EQUAL(1, seen);
+  in3_curl_pool_free();
+  in3_curl_pool_free(); // only the pool of the process is released, not the one of the transfer
+
+  for (int i = 0; i < 500 && !server_handle(SERVER_RESPOND); i++) usleep(10000);
+  pthread_join(t, &res);
+  TEST_ASSERT_TRUE(res == c);
+  server_close_peers();
+  in3_free(c);
+}
+#endif
+
+int main() {
+  in3_register_default(in3_register_eth_basic);
+  in3_register_default(in3_register_nodeselect_def);
+  server_start();
+  TESTS_BEGIN();
+  RUN_TEST(test_multi_step);
+  RUN_TEST(test_multi_error);
+  RUN_TEST(test_multi_abort);
+#ifdef THREADSAFE
+  RUN_TEST(test_pool_free_while_sending);
+#endif
+  int res = TESTS_END();
+  close(server);
+  return res;
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+
+#include "../../src/cmd/http-server/http_server.h"
+#include "../../src/core/util/mem.h"
+#include "../test_utils.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_REQUEST_SIZE (10 * 1024 * 1024) // the limit of the http-server for one request including the body
+#define REQUEST_HEADER   "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: %u\r\n\r\n"
+
+static int  port   = 0;
+static char port_str[8];
+
+/** connects to the server, which may still be starting */
+static int connect_server() {
+  struct sockaddr_in addr = {0};
+  addr.sin_family         = AF_INET;
+  addr.sin_port           = htons(port);
+  addr.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < 100; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0) {
+      struct timeval timeout = {.tv_sec = 10};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      return fd;
+    }
+    close(fd);
+    usleep(50000);
+  }
+  TEST_FAIL_MESSAGE("could not connect to the server");
+  return -1;
+}
+
+static void send_all(int fd, const char* data, size_t len) {
+  for (size_t pos = 0; pos < len;) {
+    ssize_t n = send(fd, data + pos, len - pos, 0);
+    TEST_ASSERT_TRUE_MESSAGE(n > 0, "could not send the request");
+    pos += n;
+  }
+}
+
+/** reads the status-line of the response or returns an empty string if the server did not answer in time. */
+static void read_status(int fd, char* dst, size_t max) {
+  size_t len = 0;
+  while (len < max - 1 && !memchr(dst, '\n', len)) {
+    ssize_t n = recv(fd, dst + len, max - 1 - len, 0);
+    if (n <= 0) break;
+    len += n;
+  }
+  dst[len] = 0;
+}
+
+/** sends a request with the given content-length, but only the header and the first body-bytes. */
+static void send_request(int fd, size_t body_len, size_t send_len) {
+  char header[128];
+  send_all(fd, header, sprintf(header, REQUEST_HEADER, (unsigned int) body_len));
+  char* body = _malloc(send_len + 1);
+  memset(body, 'x', send_len);
+  send_all(fd, body, send_len);
+  _free(body);
+}
+
+static size_t header_len(size_t body_len) {
+  return snprintf(NULL, 0, REQUEST_HEADER, (unsigned int) body_len);
+}
+
+static void test_oversized_body() {
+  // the body alone would fit, but not together with the header, so the server could never receive it completely.
+  char   status[256];
+  int    fd       = connect_server();
+  size_t body_len = MAX_REQUEST_SIZE - header_len(MAX_REQUEST_SIZE) + 1;
+  send_request(fd, body_len, 0);
+  read_status(fd, status, sizeof(status));
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 400", status, 12);
+  close(fd);
+}
+
+static void test_max_body() {
+  // a request using the whole buffer is still executed
+  char   status[256];
+  int    fd       = connect_server();
+  size_t body_len = MAX_REQUEST_SIZE - header_len(MAX_REQUEST_SIZE);
+  send_request(fd, body_len, body_len);
+  read_status(fd, status, sizeof(status));
+  TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 200", status, 12);
+  close(fd);
+}
+
+int main() {
+  port = 20000 + getpid() % 20000;
+  sprintf(port_str, "%i", port);
+  pid_t server = fork();
+  if (server == 0) {
+    in3_t* c = in3_for_chain(CHAIN_ID_LOCAL);
+    http_run_server(port_str, c, NULL, 1);
+    exit(EXIT_FAILURE);
+  }
+
+  TESTS_BEGIN();
+  RUN_TEST(test_oversized_body);
+  RUN_TEST(test_max_body);
+  int res = TESTS_END();
+
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+  return res;
+}
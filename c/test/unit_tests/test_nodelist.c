@@ -38,7 +38,11 @@
 #endif
 
 #include "../../src/api/eth1/eth_api.h"
+#include "../../src/core/client/request_internal.h"
+#include "../../src/core/util/crypto.h"
 #include "../../src/verifier/eth1/full/eth_full.h"
+#include "../../src/verifier/eth1/nano/merkle.h"
+#include "../../src/verifier/eth1/nano/rlp.h"
 #include "../src/core/util/log.h"
 #include "../test_utils.h"
 #include "../util/transport.h"
@@ -730,6 +734,7 @@ static void test_nodelist_pick_signer_exclusions() {
     pctx.type = NL_SIGNER;
     TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
     TEST_ASSERT_NOT_NULL(ctx->nodes);
+    TEST_ASSERT_NOT_NULL(str_find(ctx->nodes->url, "https://in3-v2.slock.it/"));
     TEST_ASSERT_EQUAL(1, ctx->signers_length);
     TEST_ASSERT(memcmp(ctx->nodes->address, ctx->signers, 20) != 0);
     req_free(ctx);
@@ -738,6 +743,201 @@ static void test_nodelist_pick_signer_exclusions() {
   in3_free(in3);
 }
 
+static void test_nodelist_pick_latency() {
+  in3_t* in3 = in3_for_chain(0x34ff);
+  char*  err = in3_configure(in3, "{\"chainId\":\"0x34ff\",\"chainType\":0,\"autoUpdateList\":false,\"signatureCount\":0,\"requestCount\":1,\"maxAttempts\":1,"
+                                 "\"nodeSelection\":\"latency\",\"hedgeTimeout\":500,"
+                                 "\"nodeRegistry\":{"
+                                 "   \"needsUpdate\":false,"
+                                 "   \"contract\": \"0x5f51e413581dd76759e9eed51e63d14c8d1379c8\","
+                                 "   \"registryId\": \"0x67c02e5e272f9d6b4a33716614061dd298283f86351079ef903bf0d4410a44ea\","
+                                 "   \"nodeList\": [{"
+                                 "      \"url\":\"https://in3-v2.slock.it/priv/nd-1\","
+                                 "      \"address\":\"0x45d45e6ff99e6c34a235d263965910298985fcfe\","
+                                 "      \"props\":\"0x1dd\""
+                                 "    },"
+                                 "    {"
+                                 "      \"url\":\"https://in3-v2.slock.it/priv/nd-2\","
+                                 "      \"address\":\"0x1fe2e9bf29aa1938859af64c413361227d04059a\","
+                                 "      \"props\":\"0x1dd\""
+                                 "    }]"
+                                 "}}");
+  TEST_ASSERT_NULL_MESSAGE(err, err);
+  register_transport(in3, test_transport);
+
+  char* config = in3_get_config(in3);
+  TEST_ASSERT_NOT_NULL(str_find(config, "\"nodeSelection\":\"latency\""));
+  TEST_ASSERT_NOT_NULL(str_find(config, "\"hedgeTimeout\":500"));
+  _free(config);
+
+  // without any latency samples, no node is hedged
+  for (int i = 0; i < 10; i++) {
+    in3_req_t*        ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+    in3_nl_pick_ctx_t pctx = {.type = NL_DATA, .req = ctx};
+    TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+    TEST_ASSERT_EQUAL(1, req_nodes_len(ctx->nodes));
+    req_free(ctx);
+  }
+
+  in3_node_weight_t* weights = in3_nodeselect_def_data(in3)->weights;
+  weights[0].latency         = 1000;
+  weights[0].latency_dev     = 100;
+  weights[1].latency         = 10;
+  weights[1].latency_dev     = 5;
+  in3_nodelist_snapshot_clear(in3_nodeselect_def_data(in3));
+
+  // the faster node is always picked and is not expected to need a hedge
+  for (int i = 0; i < 10; i++) {
+    in3_req_t*        ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+    in3_nl_pick_ctx_t pctx = {.type = NL_DATA, .req = ctx};
+    TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+    TEST_ASSERT_EQUAL(1, req_nodes_len(ctx->nodes));
+    TEST_ASSERT_EQUAL(1, ctx->nodes->index);
+    req_free(ctx);
+  }
+
+  // a high error rate alone does not trigger a hedge
+  weights[1].error_rate = 500;
+  in3_nodelist_snapshot_clear(in3_nodeselect_def_data(in3));
+  in3_req_t*        ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+  in3_nl_pick_ctx_t pctx = {.type = NL_DATA, .req = ctx};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+  TEST_ASSERT_EQUAL(1, req_nodes_len(ctx->nodes));
+  req_free(ctx);
+
+  // but a latency tail over the hedge timeout does (400 + 2 * 100 > 500)
+  weights[1].error_rate  = 0;
+  weights[1].latency     = 400;
+  weights[1].latency_dev = 100;
+  in3_nodelist_snapshot_clear(in3_nodeselect_def_data(in3));
+  ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+  pctx = (in3_nl_pick_ctx_t){.type = NL_DATA, .req = ctx};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+  TEST_ASSERT_EQUAL(2, req_nodes_len(ctx->nodes));
+  TEST_ASSERT_EQUAL(1, ctx->nodes->index);
+  req_free(ctx);
+
+  in3_free(in3);
+}
+
+static uint64_t snapshot_now = 1000;
+static uint64_t snapshot_time(void* t) {
+  UNUSED_VAR(t);
+  return snapshot_now;
+}
+
+static void test_nodelist_snapshot() {
+  in3_set_func_time(snapshot_time);
+  in3_t* in3 = in3_for_chain(0x34ff);
+  char*  err = in3_configure(in3, "{\"chainId\":\"0x34ff\",\"chainType\":0,\"autoUpdateList\":false,\"signatureCount\":0,\"requestCount\":1,\"maxAttempts\":1,"
+                                 "\"nodeRegistry\":{"
+                                 "   \"needsUpdate\":false,"
+                                 "   \"contract\": \"0x5f51e413581dd76759e9eed51e63d14c8d1379c8\","
+                                 "   \"registryId\": \"0x67c02e5e272f9d6b4a33716614061dd298283f86351079ef903bf0d4410a44ea\","
+                                 "   \"nodeList\": [{"
+                                 "      \"url\":\"https://in3-v2.slock.it/priv/nd-1\","
+                                 "      \"address\":\"0x45d45e6ff99e6c34a235d263965910298985fcfe\","
+                                 "      \"props\":\"0x1dd\""
+                                 "    },"
+                                 "    {"
+                                 "      \"url\":\"https://in3-v2.slock.it/priv/nd-2\","
+                                 "      \"address\":\"0x1fe2e9bf29aa1938859af64c413361227d04059a\","
+                                 "      \"props\":\"0x1dd\""
+                                 "    }]"
+                                 "}}");
+  TEST_ASSERT_NULL_MESSAGE(err, err);
+  register_transport(in3, test_transport);
+
+  // as long as the nodelist does not change, all picks share the same copy
+  in3_nodeselect_def_t*    nl = in3_nodeselect_def_data(in3);
+  in3_nodelist_snapshot_t* s  = in3_nodelist_snapshot(nl);
+  TEST_ASSERT_TRUE(s == in3_nodelist_snapshot(nl));
+  in3_nodelist_snapshot_release(nl, s);
+  TEST_ASSERT_EQUAL(2, s->len);
+  TEST_ASSERT_EQUAL_STRING("https://in3-v2.slock.it/priv/nd-2", s->nodes[1].url);
+  TEST_ASSERT_TRUE(s->nodes[1].url != nl->nodelist[1].url);
+
+  // blacklisting a node replaces the snapshot, while the old one stays valid until it is released
+  TEST_ASSERT_EQUAL(IN3_OK, blacklist_node_addr(nl, nl->nodelist[1].address, 3600));
+  TEST_ASSERT_NULL(nl->snapshot);
+  TEST_ASSERT_EQUAL(0, s->weights[1].blacklisted_until);
+  for (int i = 0; i < 10; i++) {
+    in3_req_t*        ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+    in3_nl_pick_ctx_t pctx = {.type = NL_DATA, .req = ctx};
+    TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+    TEST_ASSERT_EQUAL(0, ctx->nodes->index);
+    req_free(ctx);
+  }
+  TEST_ASSERT_TRUE(nl->snapshot && nl->snapshot != s && nl->snapshot->weights[1].blacklisted_until);
+  in3_nodelist_snapshot_release(nl, s);
+
+  // response times update the stats in place, but keep the snapshot until it expires
+  s                      = in3_nodelist_snapshot(nl);
+  in3_req_t*        ctx  = req_new(in3, "{\"jsonrpc\":\"2.0\",\"method\":\"eth_blockNumber\",\"params\":[]}");
+  in3_nl_pick_ctx_t pctx = {.type = NL_DATA, .req = ctx};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK, &pctx));
+  ctx->raw_response          = _calloc(1, sizeof(in3_response_t));
+  ctx->raw_response[0].time  = 100;
+  in3_nl_followup_ctx_t fctx = {.req = ctx, .node = ctx->nodes};
+  TEST_ASSERT_EQUAL(IN3_OK, in3_plugin_execute_first(ctx, PLGN_ACT_NL_PICK_FOLLOWUP, &fctx));
+  req_free(ctx);
+  TEST_ASSERT_EQUAL(100, nl->weights[0].latency);
+  TEST_ASSERT_TRUE(nl->snapshot == s);
+  TEST_ASSERT_EQUAL(0, s->weights[0].latency);
+  in3_nodelist_snapshot_release(nl, s);
+
+  snapshot_now += NODELIST_SNAPSHOT_TTL;
+  s = in3_nodelist_snapshot(nl);
+  TEST_ASSERT_EQUAL(100, s->weights[0].latency);
+  in3_nodelist_snapshot_release(nl, s);
+
+  in3_free(in3);
+  in3_set_func_time(mock_time);
+}
+
+static void test_storage_proof_cache() {
+  FILE* f = fopen("../c/test/testdata/requests/in3_nodeList.json", "r");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  long  length = ftell(f);
+  char* buffer = _malloc(length + 1);
+  fseek(f, 0, SEEK_SET);
+  buffer[fread(buffer, 1, length, f)] = 0;
+  fclose(f);
+
+  json_ctx_t* json    = parse_json(buffer);
+  d_token_t*  proof   = d_get(d_get(d_get_at(d_get(d_get_at(json->result, 0), key("response")), 0), key("in3")), key("proof"));
+  d_token_t*  account = d_iter(d_get(proof, key("accounts"))).token;
+  bytes_t     root    = d_get_bytes(account, key("storageHash"));
+  uint32_t    nodes   = 0;
+
+  // all storage proofs of the nodelist share the upper nodes
+  trie_proof_cache_t cache = {0};
+  for (d_iterator_t it = d_iter(d_get(account, key("storageProof"))); it.left; d_iter_next(&it)) {
+    uint8_t         hash[32], val[36];
+    bytes_t         path = bytes(hash, 32);
+    bytes_builder_t bb   = {.bsize = 36, .b = {.data = val, .len = 0}};
+    bytes_t**       p    = d_create_bytes_vec(d_get(it.token, key("proof")));
+    d_bytes_to(d_get(it.token, key("key")), hash, 32);
+    keccak(path, hash);
+    if ((bb.b.len = d_bytes_to(d_get(it.token, key("value")), val, -1))) rlp_encode_to_item(&bb);
+
+    TEST_ASSERT_TRUE(trie_verify_proof(&root, &path, p, bb.b.len ? &bb.b : NULL));
+    TEST_ASSERT_TRUE(trie_verify_proof_cached(&cache, &root, &path, p, bb.b.len ? &bb.b : NULL));
+    // now all nodes are cached, but a wrong value must still fail
+    bytes_t wrong = bytes((uint8_t*) "\x05", 1);
+    TEST_ASSERT_FALSE(trie_verify_proof_cached(&cache, &root, &path, p, &wrong));
+    for (bytes_t** n = p; *n; n++) nodes++;
+    _free(p);
+  }
+  TEST_ASSERT_EQUAL(28, nodes);
+  TEST_ASSERT_EQUAL(16, cache.len);
+
+  trie_proof_cache_free(&cache);
+  json_free(json);
+  _free(buffer);
+}
+
 /*
  * Main
  */
@@ -757,5 +957,8 @@ int main() {
   RUN_TEST(test_nodelist_update_6);
   RUN_TEST(test_nodelist_update_7);
   RUN_TEST(test_nodelist_update_8);
+  RUN_TEST(test_nodelist_pick_latency);
+  RUN_TEST(test_nodelist_snapshot);
+  RUN_TEST(test_storage_proof_cache);
   return TESTS_END();
 }
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * This file is part of the Incubed project.
+ * Sources: https://github.com/blockchainsllc/in3
+ *
+ * Copyright (C) 2018-2020 slock.it GmbH, Blockchains LLC
+ *
+ *
+ * COMMERCIAL LICENSE USAGE
+ *
+ * Licensees holding a valid commercial license may use this file in accordance
+ * with the commercial license agreement provided with the Software or, alternatively,
+ * in accordance with the terms contained in a written agreement between you and
+ * slock.it GmbH/Blockchains LLC. For licensing terms and conditions or further
+ * information please contact slock.it at in3@slock.it.
+ *
+ * Alternatively, this file may be used under the AGPL license as follows:
+ *
+ * AGPL LICENSE USAGE
+ *
+ * This program is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Affero General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+ * [Permissions of this strong copyleft license are conditioned on making available
+ * complete source code of licensed works and modifications, which include larger
+ * works using a licensed work, under the same license. Copyright and license notices
+ * must be preserved. Contributors provide an express grant of patent rights.]
+ * You should have received a copy of the GNU Affero General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+#ifndef TEST
+#define TEST
+#endif
+#ifndef TEST
+#define DEBUG
+#endif
+
+#include "../../src/cmd/in3/req_stream.h"
+#include "../../src/core/client/request.h"
+#include "../../src/core/util/data.h"
+#include "../../src/core/util/log.h"
+#include "../../src/core/util/mem.h"
+#include "../test_utils.h"
+#include <unistd.h>
+
+/** handles test_sleep, which waits for params[0] ms and returns params[1] */
+static in3_ret_t test_rpc(void* data, in3_plugin_act_t action, void* arg) {
+  UNUSED_VAR(data);
+  UNUSED_VAR(action);
+  in3_rpc_handle_ctx_t* ctx = arg;
+  if (strcmp(ctx->method, "test_sleep")) return IN3_EIGNORE;
+  usleep(d_get_int_at(ctx->params, 0) * 1000);
+  return in3_rpc_handle_with_int(ctx, d_get_int_at(ctx->params, 1));
+}
+
+static in3_t* test_client() {
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  in3_plugin_register(c, PLGN_ACT_RPC_HANDLE, test_rpc, NULL, false);
+  return c;
+}
+
+static void collect(void* ptr, const char* response, bool more) {
+  UNUSED_VAR(more);
+  sb_add_chars(ptr, response);
+}
+
+/** executes all requests in the input and returns the response lines */
+static char* exec_stream(char* input, uint32_t threads, bool ordered, in3_ret_t expected) {
+  in3_t* c  = test_client();
+  sb_t   sb = {0};
+  FILE*  f  = fmemopen(input, strlen(input), "r");
+  TEST_ASSERT_EQUAL(expected, req_stream_exec(c, f, threads, ordered, collect, &sb));
+  fclose(f);
+  in3_free(c);
+  return sb.data ? sb.data : _strdupn("", 0);
+}
+
+static void test_splitter() {
+  json_splitter_t s          = {0};
+  char*           input      = " garbage }] {\"a\":\"}{[\\\"]\",\"b\":[{}]} , [1,[2]]\n{\"c\":\"\\\\\"}{\"x\":\"}";
+  char*           expected[] = {"{\"a\":\"}{[\\\"]\",\"b\":[{}]}", "[1,[2]]", "{\"c\":\"\\\\\"}"};
+  int             found      = 0;
+  for (char* p = input; *p; p++) {
+    if (!json_splitter_add(&s, *p)) continue;
+    TEST_ASSERT_TRUE(found < 3);
+    TEST_ASSERT_EQUAL_STRING(expected[found], s.sb.data);
+    found++;
+  }
+  TEST_ASSERT_EQUAL(3, found);
+  TEST_ASSERT_TRUE(s.level > 0); // the last request is incomplete
+  TEST_ASSERT_TRUE(s.in_string);
+  _free(s.sb.data);
+}
+
+static void test_ids() {
+  char* res = exec_stream("{\"id\":\"0x07\",\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[0,1]}"
+                          "xx{\"id\":7,\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[0,2]}\n"
+                          "{\"id\":\"q\" \"method\":1}\n"
+                          "{\"id\":\"err\",\"jsonrpc\":\"2.0\"}\n"
+                          "{\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[0,3]}",
+                          1, false, IN3_OK);
+  char* lines[5];
+  int   n = 0;
+  for (char* l = strtok(res, "\n"); l && n < 5; l = strtok(NULL, "\n")) lines[n++] = l;
+  TEST_ASSERT_EQUAL(5, n);
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":\"0x07\",\"result\":\"0x1\"}", lines[0]);
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":7,\"result\":\"0x2\"}", lines[1]);
+  TEST_ASSERT_NOT_NULL(strstr(lines[2], "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":")); // parse error
+  TEST_ASSERT_NOT_NULL(strstr(lines[3], "{\"jsonrpc\":\"2.0\",\"id\":\"err\",\"error\":"));
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":null,\"result\":\"0x3\"}", lines[4]); // no id to echo
+  _free(res);
+}
+
+static void test_incomplete() {
+  char* res = exec_stream("{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[0,1]} {\"id\":2", 1, false, IN3_EINVAL);
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":\"0x1\"}\n", res);
+  _free(res);
+}
+
+#ifdef THREADSAFE
+#define SLOW_AND_FAST "{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[300,1]}" \
+                      "{\"id\":2,\"jsonrpc\":\"2.0\",\"method\":\"test_sleep\",\"params\":[0,2]}"
+
+static void test_ordered() {
+  char* res = exec_stream(SLOW_AND_FAST, 2, true, IN3_OK);
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":\"0x1\"}\n"
+                           "{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":\"0x2\"}\n",
+                           res);
+  _free(res);
+}
+
+static void test_unordered() {
+  char* res = exec_stream(SLOW_AND_FAST, 2, false, IN3_OK);
+  TEST_ASSERT_EQUAL_STRING("{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":\"0x2\"}\n"
+                           "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":\"0x1\"}\n",
+                           res);
+  _free(res);
+}
+
+static void test_invalid_unordered() {
+  char* res = exec_stream("{\"id\":\"a\",\"jsonrpc\":\"2.0\"}{\"id\":5,\"jsonrpc\":\"2.0\"}{\"id\":\"c\" 1}", 2, false, IN3_OK);
+  TEST_ASSERT_NOT_NULL(strstr(res, "{\"jsonrpc\":\"2.0\",\"id\":\"a\",\"error\":"));
+  TEST_ASSERT_NOT_NULL(strstr(res, "{\"jsonrpc\":\"2.0\",\"id\":5,\"error\":"));
+  TEST_ASSERT_NOT_NULL(strstr(res, "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":"));
+  TEST_ASSERT_NULL(strstr(res, "\"id\":1,"));
+  _free(res);
+}
+#endif
+
+/*
+ * Main
+ */
+int main() {
+  in3_log_set_quiet(true);
+  TESTS_BEGIN();
+  RUN_TEST(test_splitter);
+  RUN_TEST(test_ids);
+  RUN_TEST(test_incomplete);
+#ifdef THREADSAFE
+  RUN_TEST(test_ordered);
+  RUN_TEST(test_unordered);
+  RUN_TEST(test_invalid_unordered);
+#endif
+  return TESTS_END();
+}
@@ -53,6 +53,10 @@
 #include "nodeselect/full/cache.h"
 #include "nodeselect/full/nodelist.h"
 #include "nodeselect/full/nodeselect_def.h"
+#if defined(THREADSAFE) && !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #define TEST_ASSERT_CONFIGURE_FAIL(desc, in3, config, err_slice) \
   do {                                                           \
@@ -914,6 +918,142 @@ static void test_sigs() {
   in3_free(in3);
 }
 
+#if defined(THREADSAFE) && !defined(_WIN32)
+static int             flight_sends   = 0;
+static uint32_t        flight_waiters = 0; // number of identical requests the transport waits for before it responds
+static pthread_mutex_t flight_lock    = PTHREAD_MUTEX_INITIALIZER;
+
+static in3_ret_t flight_transport(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx) {
+  UNUSED_VAR(plugin_data);
+  in3_http_request_t* req = plugin_ctx;
+  if (action != PLGN_ACT_TRANSPORT_SEND) return IN3_OK;
+  pthread_mutex_lock(&flight_lock);
+  flight_sends++;
+  pthread_mutex_unlock(&flight_lock);
+  // we hold the response until all other requests wait for it, so none of them can be sent on its own (giving up after 10s, which fails the test)
+  for (int i = 0; i < 10000 && in3_flights_waiting(req->req->client->flights) < flight_waiters; i++) usleep(1000);
+  for (int i = 0; i < req->urls_len; i++) in3_ctx_add_response(req->req, i, false, "{\"result\":\"0x10\"}", -1, 0);
+  return IN3_OK;
+}
+
+static void* send_gas_price(void* c) {
+  char *result = NULL, *error = NULL;
+  in3_client_rpc(c, "eth_gasPrice", "[]", &result, &error);
+  bool ok = result && !error && strstr(result, "0x10");
+  _free(result);
+  _free(error);
+  return ok ? c : NULL;
+}
+
+static sb_t batch_sent = {0}; // the methods of all requests sent, with one line per send
+
+static in3_ret_t batch_transport(void* plugin_data, in3_plugin_act_t action, void* plugin_ctx) {
+  UNUSED_VAR(plugin_data);
+  in3_http_request_t* req = plugin_ctx;
+  if (action != PLGN_ACT_TRANSPORT_SEND) return IN3_OK;
+  json_ctx_t* payload = parse_json(req->payload);
+  sb_t        sb      = {0};
+  pthread_mutex_lock(&flight_lock);
+  flight_sends++;
+  for (int i = 0; i < d_len(payload->result); i++) {
+    d_token_t* r = d_get_at(payload->result, i);
+    if (i) sb_add_char(&batch_sent, ',');
+    sb_add_chars(&batch_sent, d_get_string(r, K_METHOD));
+    sb_add_chars(&sb, i ? ",{\"id\":" : "[{\"id\":");
+    sb_add_int(&sb, d_get_int(r, K_ID));
+    sb_add_chars(&sb, ",\"result\":\"0x10\"}");
+  }
+  sb_add_char(&batch_sent, '\n');
+  pthread_mutex_unlock(&flight_lock);
+  sb_add_char(&sb, ']');
+  for (int i = 0; i < req->urls_len; i++) in3_ctx_add_response(req->req, i, false, sb.data, -1, 0);
+  _free(sb.data);
+  json_free(payload);
+  return IN3_OK;
+}
+
+static void* send_balance(void* c) {
+  char  params[100], *result = NULL, *error = NULL;
+  sprintf(params, "[\"0x%040x\",\"latest\"]", (unsigned) (uintptr_t) pthread_self() & 0xFFFFFF);
+  in3_client_rpc(c, "eth_getBalance", params, &result, &error);
+  bool ok = result && !error && strstr(result, "0x10");
+  _free(result);
+  _free(error);
+  return ok ? c : NULL;
+}
+
+static void test_batch() {
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  // the window is only reached if the test fails, since all batches are sent as soon as they are full
+  TEST_ASSERT_NULL(in3_configure(c, "{\"autoUpdateList\":false,\"requestCount\":1,\"maxAttempts\":1,\"proof\":\"none\",\"batchWindow\":10000,\"batchSize\":4,\"nodeRegistry\":{\"needsUpdate\":false}}"));
+  register_transport(c, batch_transport);
+  flight_sends = 0;
+
+  // requests without side effects are sent as one batch
+  pthread_t threads[4];
+  void*     res = NULL;
+  for (int i = 0; i < 4; i++) pthread_create(threads + i, NULL, send_balance, c);
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], &res);
+    TEST_ASSERT_TRUE(res == c);
+  }
+  TEST_ASSERT_EQUAL(1, flight_sends);
+  TEST_ASSERT_EQUAL_STRING("eth_getBalance,eth_getBalance,eth_getBalance,eth_getBalance\n", batch_sent.data);
+
+  // requests with side effects are never batched, not even if a batch is waiting for more requests
+  TEST_ASSERT_NULL(in3_configure(c, "{\"batchSize\":2}"));
+  batch_sent.len     = 0;
+  batch_sent.data[0] = 0;
+  pthread_create(threads, NULL, send_balance, c);
+  for (int i = 0; i < 10000 && !in3_batches_open_len(c->batches); i++) usleep(1000);
+  TEST_ASSERT_EQUAL(1, in3_batches_open_len(c->batches));
+
+  char* result = NULL;
+  char* error  = NULL;
+  in3_client_rpc(c, "eth_sendRawTransaction", "[\"0x1234\"]", &result, &error);
+  TEST_ASSERT_NULL(error);
+  TEST_ASSERT_EQUAL_STRING("\"0x10\"", result);
+  TEST_ASSERT_EQUAL_STRING("eth_sendRawTransaction\n", batch_sent.data);
+  TEST_ASSERT_EQUAL(1, in3_batches_open_len(c->batches));
+  _free(result);
+
+  // the next request without side effects completes the waiting batch
+  TEST_ASSERT_TRUE(send_balance(c) == c);
+  pthread_join(threads[0], &res);
+  TEST_ASSERT_TRUE(res == c);
+  TEST_ASSERT_EQUAL_STRING("eth_sendRawTransaction\neth_getBalance,eth_getBalance\n", batch_sent.data);
+  TEST_ASSERT_EQUAL(3, flight_sends);
+
+  _free(batch_sent.data);
+  batch_sent = (sb_t){0};
+  in3_free(c);
+}
+
+static void test_single_flight() {
+  in3_t* c = in3_for_chain(CHAIN_ID_MAINNET);
+  TEST_ASSERT_NULL(in3_configure(c, "{\"autoUpdateList\":false,\"requestCount\":1,\"maxAttempts\":1,\"proof\":\"none\",\"nodeRegistry\":{\"needsUpdate\":false}}"));
+  register_transport(c, flight_transport);
+  flight_sends   = 0;
+  flight_waiters = 3;
+
+  // identical requests while the first is still sent, will wait for its response
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++) pthread_create(threads + i, NULL, send_gas_price, c);
+  for (int i = 0; i < 4; i++) {
+    void* res = NULL;
+    pthread_join(threads[i], &res);
+    TEST_ASSERT_TRUE(res == c);
+  }
+  TEST_ASSERT_EQUAL(1, flight_sends);
+
+  // once done, the next request is sent again
+  flight_waiters = 0;
+  TEST_ASSERT_TRUE(send_gas_price(c) == c);
+  TEST_ASSERT_EQUAL(2, flight_sends);
+  in3_free(c);
+}
+#endif
+
 /*
  * Main
  */
@@ -936,5 +1076,9 @@ int main() {
   RUN_TEST(test_configure_validation);
   RUN_TEST(test_parallel_signatures);
   RUN_TEST(test_sigs);
+#if defined(THREADSAFE) && !defined(_WIN32)
+  RUN_TEST(test_single_flight);
+  RUN_TEST(test_batch);
+#endif
   return TESTS_END();
 }
@@ -236,7 +236,7 @@ static void test_in3_client_context() {
 
   // null maybe a valid result
   json_ctx_t* json  = parse_json("{\"result\":null}");
-  ctx->responses    = malloc(sizeof(d_token_t*));
+  ctx->responses    = req_response_array(ctx); // allocated in the arena by req_new
   ctx->responses[0] = json->result;
   TEST_ASSERT_EQUAL(IN3_OK, req_get_error(ctx, 0));
   json_free(json);
@@ -256,7 +256,6 @@ static void test_in3_client_context() {
   TEST_ASSERT_EQUAL(IN3_ERPC, req_check_response_error(ctx, 0));
   TEST_ASSERT_EQUAL_STRING("{\"msg\":\"Unknown\",\"id\":\"0xf1\"}:Unknown", ctx->error);
   json_free(json);
-  free(ctx->responses);
   ctx->responses = NULL;
 
   // Test getter/setter
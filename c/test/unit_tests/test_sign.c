@@ -228,6 +228,39 @@ static void test_signer_prepare_tx() {
 /*
  * Main
  */
+static void test_recover_batch() {
+  const unsigned int n = 50;
+  bytes32_t          pks[50], digests[50];
+  uint8_t            sigs[50][65], expected[50 * 64], pubs[50 * 64];
+  bytes_t            dl[50], sl[50];
+  in3_ret_t          results[50];
+
+  for (unsigned int i = 0; i < n; i++) {
+    uint8_t seed = (uint8_t) i;
+    keccak(bytes(&seed, 1), pks[i]);
+    keccak(bytes(pks[i], 32), digests[i]);
+    TEST_ASSERT_EQUAL(IN3_OK, crypto_sign_digest(ECDSA_SECP256K1, bytes(digests[i], 32), pks[i], NULL, sigs[i]));
+    TEST_ASSERT_EQUAL(IN3_OK, crypto_convert(ECDSA_SECP256K1, CONV_PK32_TO_PUB64, bytes(pks[i], 32), expected + i * 64, NULL));
+    if (i % 2) sigs[i][64] += 27;
+    dl[i] = bytes(digests[i], 32);
+    sl[i] = bytes(sigs[i], 65);
+
+    TEST_ASSERT_EQUAL(IN3_OK, crypto_recover(ECDSA_SECP256K1, dl[i], sl[i], pubs));
+    TEST_ASSERT_EQUAL_MEMORY(expected + i * 64, pubs, 64);
+  }
+
+  TEST_ASSERT_EQUAL(IN3_OK, crypto_recover_batch(ECDSA_SECP256K1, n, dl, sl, pubs, results));
+  TEST_ASSERT_EQUAL_MEMORY(expected, pubs, n * 64);
+
+  // an invalid signature must not affect the others
+  memset(sigs[3], 0, 32);
+  TEST_ASSERT_EQUAL(IN3_EINVAL, crypto_recover_batch(ECDSA_SECP256K1, n, dl, sl, pubs, results));
+  for (unsigned int i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL(i == 3 ? IN3_EINVAL : IN3_OK, results[i]);
+    if (i != 3) TEST_ASSERT_EQUAL_MEMORY(expected + i * 64, pubs + i * 64, 64);
+  }
+}
+
 int main() {
   in3_log_set_quiet(true);
   in3_log_set_level(LOG_ERROR);
@@ -239,6 +272,7 @@ int main() {
   RUN_TEST(test_sign_hex);
   RUN_TEST(test_sign_sans_signer_and_from);
   RUN_TEST(test_signer);
+  RUN_TEST(test_recover_batch);
   //  RUN_TEST(test_signer_prepare_tx);
   return TESTS_END();
 }
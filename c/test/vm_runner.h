@@ -45,6 +45,8 @@ void print_error(char* msg);
 void print_success(char* msg);
 #define ERROR(s) printf("Error: %s", s)
 
+extern uint64_t evm_run_us; /**< the total time spent in evm_run() in microseconds */
+
 int test_evm(json_ctx_t* jc, d_token_t* test, uint32_t props, uint64_t* ms);
 int test_trie(json_ctx_t* jc, d_token_t* test, uint32_t props, uint64_t* ms);
 int test_rlp(json_ctx_t* jc, d_token_t* test, uint32_t props, uint64_t* ms);